@@ -0,0 +1,170 @@
+#include "corpus_generator.hpp"
+#include <fstream>
+#include <sstream>
+
+namespace devpilot {
+namespace bench {
+
+// Single responsibility: Only write synthetic C++ sources
+
+namespace {
+
+// splitmix64: tiny, and unlike the standard distributions it produces the
+// same sequence on every platform and standard library
+class Random {
+public:
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    size_t below(size_t bound) { return bound == 0 ? 0 : static_cast<size_t>(next() % bound); }
+
+private:
+    uint64_t state;
+};
+
+const size_t kFilesPerDirectory = 100;
+
+std::string directoryOf(size_t file) {
+    return "d" + std::to_string(file / kFilesPerDirectory);
+}
+
+std::string functionName(size_t file, size_t index) {
+    return "f" + std::to_string(file) + "_" + std::to_string(index);
+}
+
+// "p7::q1::q2" for file 7 at nesting 3
+std::string scopeOf(size_t file, size_t nesting) {
+    std::string scope = "p" + std::to_string(file);
+    for (size_t level = 1; level < nesting; level++) {
+        scope += "::q" + std::to_string(level);
+    }
+    return scope;
+}
+
+void openScopes(std::ostream& out, size_t file, size_t nesting) {
+    out << "namespace p" << file << " {\n";
+    for (size_t level = 1; level < nesting; level++) {
+        out << "namespace q" << level << " {\n";
+    }
+}
+
+void closeScopes(std::ostream& out, size_t nesting) {
+    for (size_t level = 0; level < nesting; level++) {
+        out << "}\n";
+    }
+}
+
+} // namespace
+
+Corpus generateCorpus(const std::filesystem::path& root, const CorpusOptions& options) {
+    Corpus corpus;
+    Random random(options.seed);
+    size_t nesting = options.nesting == 0 ? 1 : options.nesting;
+    size_t classes = options.sizeClasses == 0 ? 1 : options.sizeClasses;
+
+    // Class k holds 2^k units and is drawn with probability 2^-(k+1), the
+    // top class taking the remainder, so a unit averages (classes + 1) / 2
+    // files' worth; scaling by that keeps the mean at symbolsPerFile
+    std::vector<size_t> functionCounts(options.files);
+    for (size_t i = 0; i < options.files; i++) {
+        size_t sizeClass = 0;
+        while (sizeClass + 1 < classes && random.next() % 2 == 0) {
+            sizeClass++;
+        }
+        size_t count = options.symbolsPerFile * 2 * (size_t(1) << sizeClass) / (classes + 1);
+        functionCounts[i] = count == 0 ? 1 : count;
+    }
+
+    for (size_t i = 0; i < options.files; i++) {
+        std::filesystem::path directory = root / directoryOf(i);
+        if (i % kFilesPerDirectory == 0) {
+            std::filesystem::create_directories(directory);
+        }
+        std::string name = "f" + std::to_string(i);
+        size_t functions = functionCounts[i];
+
+        // Callees are chosen up front so the source can include their headers
+        std::vector<std::pair<size_t, size_t>> callees(functions * options.callFanout);
+        for (auto& callee : callees) {
+            callee.first = options.files == 0 ? 0 : random.below(options.files);
+            callee.second = random.below(functionCounts[callee.first]);
+        }
+
+        std::ostringstream header;
+        header << "#pragma once\n\n";
+        openScopes(header, i, nesting);
+        header << "\nclass Widget" << i << " {\npublic:\n"
+               << "    explicit Widget" << i << "(int seed) : value(seed) {}\n"
+               << "    int get() const { return value; }\n"
+               << "    void set(int next) { value = next; }\n\nprivate:\n    int value;\n};\n\n";
+        for (size_t f = 0; f < functions; f++) {
+            header << "int " << functionName(i, f) << "(int value);\n";
+        }
+        header << "\n";
+        closeScopes(header, nesting);
+
+        std::ostringstream source;
+        source << "#include \"" << name << ".h\"\n";
+        std::vector<bool> included(options.files, false);
+        included[i] = true;
+        for (const auto& callee : callees) {
+            if (!included[callee.first]) {
+                included[callee.first] = true;
+                source << "#include \"../" << directoryOf(callee.first) << "/f" << callee.first << ".h\"\n";
+            }
+        }
+        source << "\n";
+        openScopes(source, i, nesting);
+        source << "\n";
+        for (size_t f = 0; f < functions; f++) {
+            source << "int " << functionName(i, f) << "(int value) {\n"
+                   << "    Widget" << i << " widget(value);\n"
+                   << "    int total = widget.get();\n"
+                   << "    for (int step = 0; step < " << 1 + random.below(8) << "; step++) {\n"
+                   << "        total += step * " << random.below(100) << ";\n"
+                   << "    }\n";
+            for (size_t c = 0; c < options.callFanout; c++) {
+                const auto& callee = callees[f * options.callFanout + c];
+                source << "    total += ::" << scopeOf(callee.first, nesting) << "::"
+                       << functionName(callee.first, callee.second) << "(total + " << c << ");\n";
+                corpus.calls++;
+            }
+            source << "    return total;\n}\n\n";
+        }
+        closeScopes(source, nesting);
+
+        const std::pair<std::string, std::string> outputs[] = {
+            {name + ".h", header.str()}, {name + ".cpp", source.str()}};
+        for (const auto& output : outputs) {
+            std::filesystem::path path = directory / output.first;
+            std::ofstream(path, std::ios::binary) << output.second;
+            corpus.files.push_back(path.string());
+            corpus.bytes += output.second.size();
+        }
+        corpus.functions += functions;
+    }
+
+    // Query samples: one function from every file, in a shuffled order
+    std::vector<size_t> order(options.files);
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    for (size_t i = order.size(); i > 1; i--) {
+        std::swap(order[i - 1], order[random.below(i)]);
+    }
+    for (size_t file : order) {
+        size_t function = random.below(functionCounts[file]);
+        corpus.functionNames.push_back(functionName(file, function));
+        corpus.qualifiedNames.push_back(scopeOf(file, nesting) + "::" + functionName(file, function));
+    }
+    return corpus;
+}
+
+} // namespace bench
+} // namespace devpilot
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace devpilot {
+namespace bench {
+
+// Shape of a synthetic C++ project. The same options and seed always give
+// byte-identical files, so results from different builds are comparable.
+struct CorpusOptions {
+    size_t files = 500;           // Source files; each also gets a header
+    size_t symbolsPerFile = 24;   // Mean functions per file
+    size_t nesting = 2;           // Namespace depth around them (at least 1)
+    size_t callFanout = 3;        // Calls per function body, into random files
+    size_t sizeClasses = 4;       // File sizes double per class, each half as
+                                  // likely as the one below; 1 makes all equal
+    uint64_t seed = 1;
+};
+
+struct Corpus {
+    std::vector<std::string> files;  // Headers and sources, in generation order
+    uint64_t bytes = 0;
+    size_t functions = 0;
+    size_t calls = 0;
+
+    // Deterministic samples for query benchmarks
+    std::vector<std::string> functionNames;  // Plain names, e.g. "f12_3"
+    std::vector<std::string> qualifiedNames;  // e.g. "p12::q1::f12_3"
+};
+
+// Writes the corpus under `root` (created if needed) and describes it
+Corpus generateCorpus(const std::filesystem::path& root, const CorpusOptions& options);
+
+} // namespace bench
+} // namespace devpilot
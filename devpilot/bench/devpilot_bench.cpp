@@ -0,0 +1,490 @@
+#include "corpus_generator.hpp"
+#include "memory_accounting.hpp"
+#include "parser.hpp"
+#include "storage.hpp"
+#include "vector_index.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Benchmarks the indexer against a generated corpus and prints the results
+// as JSON on stdout (progress and the library's own output go to stderr).
+// Micro benchmarks call the parser and storage directly; the end-to-end
+// ones run the devpilot executable, once per thread count.
+
+using namespace devpilot;
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct BenchOptions {
+    bench::CorpusOptions corpus;
+    std::vector<unsigned> threadCounts = {1, 2, 4};
+    size_t repetitions = 3;
+    size_t queries = 200;
+    size_t vectors = 100000;  // For the vector search benchmark; 0 skips it
+    std::string executable = DEVPILOT_EXECUTABLE;
+    std::string output;  // JSON file; stdout when empty
+    bool keep = false;   // Leave the corpus and databases behind
+};
+
+struct Result {
+    std::string name;
+    std::string kind;  // "micro" or "macro"
+    std::vector<std::pair<std::string, double>> metrics;
+};
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Best of `repetitions` runs: the least disturbed by the rest of the machine
+double bestOf(size_t repetitions, const std::function<void()>& run) {
+    double best = 0;
+    for (size_t i = 0; i < repetitions; i++) {
+        Clock::time_point start = Clock::now();
+        run();
+        double seconds = secondsSince(start);
+        best = i == 0 ? seconds : std::min(best, seconds);
+    }
+    return best;
+}
+
+// Per-query latencies in microseconds, summarized
+Result latencyResult(const std::string& name, std::vector<double> micros, size_t rows) {
+    std::sort(micros.begin(), micros.end());
+    double total = 0;
+    for (double value : micros) {
+        total += value;
+    }
+    auto percentile = [&](double p) {
+        return micros.empty() ? 0.0 : micros[std::min(micros.size() - 1, size_t(p * micros.size()))];
+    };
+    return {name, "micro",
+            {{"queries", double(micros.size())},
+             {"rows", double(rows)},
+             {"mean_us", micros.empty() ? 0.0 : total / micros.size()},
+             {"p50_us", percentile(0.50)},
+             {"p99_us", percentile(0.99)},
+             {"max_us", micros.empty() ? 0.0 : micros.back()}}};
+}
+
+// Unit vectors around a thousand random directions, so the inverted lists
+// have clusters to find as they would with real embeddings
+std::vector<float> clusteredVectors(size_t count, size_t dimensions, uint64_t seed) {
+    std::mt19937_64 random(seed);
+    std::normal_distribution<float> normal;
+    auto normalize = [dimensions](float* vector) {
+        double norm = 0;
+        for (size_t d = 0; d < dimensions; d++) {
+            norm += double(vector[d]) * vector[d];
+        }
+        for (size_t d = 0; d < dimensions; d++) {
+            vector[d] = float(vector[d] / std::sqrt(norm));
+        }
+    };
+    std::vector<float> centers(1000 * dimensions);
+    for (size_t c = 0; c < 1000; c++) {
+        for (size_t d = 0; d < dimensions; d++) {
+            centers[c * dimensions + d] = normal(random);
+        }
+        normalize(&centers[c * dimensions]);
+    }
+    std::vector<float> vectors(count * dimensions);
+    for (size_t i = 0; i < count; i++) {
+        const float* center = &centers[(random() % 1000) * dimensions];
+        for (size_t d = 0; d < dimensions; d++) {
+            vectors[i * dimensions + d] = center[d] + 0.08f * normal(random);
+        }
+        normalize(&vectors[i * dimensions]);
+    }
+    return vectors;
+}
+
+template <typename Query>
+Result timeQueries(const std::string& name, const std::vector<std::string>& inputs, size_t count,
+                   Query query) {
+    std::vector<double> micros;
+    size_t rows = 0;
+    for (size_t i = 0; i < std::min(count, inputs.size()); i++) {
+        Clock::time_point start = Clock::now();
+        rows += query(inputs[i]);
+        micros.push_back(secondsSince(start) * 1e6);
+    }
+    return latencyResult(name, micros, rows);
+}
+
+std::string runCommand(const std::string& command, int& status) {
+    std::string output;
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe) {
+        status = -1;
+        return output;
+    }
+    char buffer[4096];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, bytes);
+    }
+    status = pclose(pipe);
+    return output;
+}
+
+double reportedNumber(const std::string& output, const std::string& label) {
+    size_t pos = output.find(label);
+    return pos == std::string::npos ? 0 : std::stod(output.substr(pos + label.size()));
+}
+
+// Heap allocations per repetition since `before`; only with the allocator
+// hook built in (-DENABLE_MEMORY_ACCOUNTING=ON)
+void addAllocationMetrics(Result& result, const memory::Usage& before, size_t repetitions) {
+    if (!memory::accountingAvailable()) {
+        return;
+    }
+    memory::Usage after = memory::currentUsage();
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < memory::kMemoryTagCount; i++) {
+        bytes += after.tags[i].allocatedBytes - before.tags[i].allocatedBytes;
+    }
+    result.metrics.push_back({"allocations", double(after.allocations() - before.allocations()) / repetitions});
+    result.metrics.push_back({"allocated_mib", double(bytes) / repetitions / (1 << 20)});
+}
+
+// The "Memory by phase:" block of `index --stats`, one metric per phase and
+// figure, e.g. "peak_rss_mib.resolve_calls"
+void addPhaseMetrics(Result& result, const std::string& output) {
+    std::istringstream lines(output.substr(std::min(output.size(), output.find("Memory by phase:"))));
+    std::string line;
+    std::getline(lines, line);
+    while (std::getline(lines, line) && line.compare(0, 2, "  ") == 0) {
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            break;
+        }
+        std::string phase = line.substr(2, colon - 2);
+        std::replace(phase.begin(), phase.end(), ' ', '_');
+        const std::pair<const char*, const char*> figures[] = {
+            {"peak RSS ", "peak_rss_mib."},
+            {"SQLite peak ", "sqlite_peak_mib."},
+            {"heap live ", "heap_live_mib."}};
+        for (const auto& figure : figures) {
+            size_t pos = line.find(figure.first, colon);
+            if (pos != std::string::npos) {
+                result.metrics.push_back({figure.second + phase,
+                                          std::stod(line.substr(pos + std::strlen(figure.first)))});
+            }
+        }
+        size_t allocations = line.find(" allocations");
+        if (allocations != std::string::npos) {
+            size_t begin = line.rfind(' ', allocations - 1) + 1;
+            result.metrics.push_back({"allocations." + phase,
+                                      std::stod(line.substr(begin, allocations - begin))});
+        }
+    }
+}
+
+std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+            quoted += escape;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+// Whole numbers print exactly, everything else to six significant digits
+std::string jsonNumber(double value) {
+    char text[32];
+    if (value == static_cast<double>(static_cast<int64_t>(value)) && value < 1e15 && value > -1e15) {
+        std::snprintf(text, sizeof(text), "%lld", static_cast<long long>(value));
+    } else {
+        std::snprintf(text, sizeof(text), "%.6g", value);
+    }
+    return text;
+}
+
+void writeJson(std::ostream& out, const BenchOptions& options, const bench::Corpus& corpus,
+               const std::vector<Result>& results) {
+    const bench::CorpusOptions& shape = options.corpus;
+    out << "{\n  \"suite\": \"devpilot_bench\",\n"
+        << "  \"version\": " << jsonString(DEVPILOT_VERSION) << ",\n"
+        << "  \"parser_version\": " << CppParser::kVersion << ",\n"
+        << "  \"corpus\": {\"files\": " << corpus.files.size() << ", \"bytes\": " << corpus.bytes
+        << ", \"functions\": " << corpus.functions << ", \"calls\": " << corpus.calls
+        << ", \"symbols_per_file\": " << shape.symbolsPerFile << ", \"nesting\": " << shape.nesting
+        << ", \"call_fanout\": " << shape.callFanout << ", \"size_classes\": " << shape.sizeClasses
+        << ", \"seed\": " << shape.seed << "},\n"
+        << "  \"repetitions\": " << options.repetitions << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& result = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\"name\": " << jsonString(result.name)
+            << ", \"kind\": " << jsonString(result.kind);
+        for (const auto& metric : result.metrics) {
+            out << ", " << jsonString(metric.first) << ": " << jsonNumber(metric.second);
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+void printUsage() {
+    std::cerr << "Usage: devpilot_bench [--files <n>] [--symbols <n>] [--nesting <n>] "
+              << "[--fanout <n>] [--size-classes <n>] [--seed <n>] [--threads <n,n,...>] "
+              << "[--repetitions <n>] [--queries <n>] [--vectors <n>] [--devpilot <executable>] "
+              << "[--output <file.json>] [--keep]" << std::endl;
+}
+
+bool parseOptions(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        try {
+            if (arg == "--files" && hasValue) {
+                options.corpus.files = std::stoull(argv[++i]);
+            } else if (arg == "--symbols" && hasValue) {
+                options.corpus.symbolsPerFile = std::stoull(argv[++i]);
+            } else if (arg == "--nesting" && hasValue) {
+                options.corpus.nesting = std::stoull(argv[++i]);
+            } else if (arg == "--fanout" && hasValue) {
+                options.corpus.callFanout = std::stoull(argv[++i]);
+            } else if (arg == "--size-classes" && hasValue) {
+                options.corpus.sizeClasses = std::stoull(argv[++i]);
+            } else if (arg == "--seed" && hasValue) {
+                options.corpus.seed = std::stoull(argv[++i]);
+            } else if (arg == "--threads" && hasValue) {
+                options.threadCounts.clear();
+                std::istringstream list(argv[++i]);
+                for (std::string count; std::getline(list, count, ',');) {
+                    options.threadCounts.push_back(static_cast<unsigned>(std::max(1, std::stoi(count))));
+                }
+            } else if (arg == "--repetitions" && hasValue) {
+                options.repetitions = std::max<size_t>(1, std::stoull(argv[++i]));
+            } else if (arg == "--queries" && hasValue) {
+                options.queries = std::stoull(argv[++i]);
+            } else if (arg == "--vectors" && hasValue) {
+                options.vectors = std::stoull(argv[++i]);
+            } else if (arg == "--devpilot" && hasValue) {
+                options.executable = argv[++i];
+            } else if (arg == "--output" && hasValue) {
+                options.output = argv[++i];
+            } else if (arg == "--keep") {
+                options.keep = true;
+            } else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                return false;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    // The parser and storage report to stdout; keep it for the JSON alone
+    std::streambuf* stdoutBuffer = std::cout.rdbuf(std::cerr.rdbuf());
+    memory::enable();
+
+    fs::path work = fs::temp_directory_path() / ("devpilot_bench_" + std::to_string(getpid()));
+    fs::path corpusRoot = work / "corpus";
+    Clock::time_point start = Clock::now();
+    bench::Corpus corpus = bench::generateCorpus(corpusRoot, options.corpus);
+    std::cerr << "Generated " << corpus.files.size() << " files (" << (corpus.bytes >> 10)
+              << " KiB) in " << secondsSince(start) << " s under " << corpusRoot << std::endl;
+    std::vector<Result> results;
+
+    // Micro: the parser alone, one thread, files already in the page cache
+    CppParser parser;
+    size_t parsedSymbols = 0;
+    memory::Usage before = memory::currentUsage();
+    double parseSeconds = bestOf(options.repetitions, [&]() {
+        parsedSymbols = 0;
+        for (const auto& file : corpus.files) {
+            parsedSymbols += parser.parseFile(file).size();
+        }
+    });
+    results.push_back({"parse_file", "micro",
+                       {{"seconds", parseSeconds},
+                        {"files", double(corpus.files.size())},
+                        {"symbols", double(parsedSymbols)},
+                        {"files_per_second", corpus.files.size() / parseSeconds},
+                        {"bytes_per_second", corpus.bytes / parseSeconds}}});
+    addAllocationMetrics(results.back(), before, options.repetitions);
+    std::cerr << "parse_file: " << parseSeconds << " s" << std::endl;
+
+    // Micro: bulk symbol inserts into a fresh database, in one transaction
+    // as indexing does them
+    std::vector<ParseResult> parsed;
+    for (const auto& file : corpus.files) {
+        parsed.push_back(parser.parse(file));
+    }
+    fs::path storeDatabase = work / "store.db";
+    size_t storedSymbols = 0;
+    before = memory::currentUsage();
+    double storeSeconds = bestOf(options.repetitions, [&]() {
+        fs::remove(storeDatabase);
+        SqliteStorage storage;
+        storage.initialize(storeDatabase.string());
+        storedSymbols = 0;
+        storage.beginTransaction();
+        for (size_t i = 0; i < parsed.size(); i++) {
+            storage.storeFile(corpus.files[i], parsed[i].content_hash);
+            for (const auto& symbol : parsed[i].symbols) {
+                storedSymbols += storage.storeSymbol(symbol) != 0;
+            }
+        }
+        storage.commitTransaction();
+    });
+    parsed.clear();
+    results.push_back({"store_symbols", "micro",
+                       {{"seconds", storeSeconds},
+                        {"symbols", double(storedSymbols)},
+                        {"symbols_per_second", storedSymbols / storeSeconds}}});
+    addAllocationMetrics(results.back(), before, options.repetitions);
+    std::cerr << "store_symbols: " << storeSeconds << " s" << std::endl;
+
+    // Macro: the whole pipeline per thread count, without the parse cache,
+    // then one more run with --stats for its memory use per phase. The
+    // database of the last run is the one the queries below use.
+    std::string executable = fs::absolute(options.executable).string();
+    for (unsigned threads : options.threadCounts) {
+        std::string command = "cd '" + work.string() + "' && '" + executable + "' index '" +
+                              corpusRoot.string() + "' --no-cache --force --threads " +
+                              std::to_string(threads);
+        std::string output;
+        int status = 0;
+        double seconds = bestOf(options.repetitions, [&]() {
+            fs::remove(work / "devpilot.db");
+            output = runCommand(command + " 2>&1", status);
+        });
+        if (status != 0) {
+            std::cerr << output << "index failed with status " << status << std::endl;
+            return 1;
+        }
+        double files = reportedNumber(output, "Files processed: ");
+        results.push_back({"index", "macro",
+                           {{"threads", double(threads)},
+                            {"seconds", seconds},
+                            {"files", files},
+                            {"symbols", reportedNumber(output, "Symbols extracted: ")},
+                            {"files_per_second", files / seconds},
+                            {"peak_memory_mib", reportedNumber(output, "Peak memory: ")}}});
+        fs::remove(work / "devpilot.db");
+        output = runCommand(command + " --stats 2>&1", status);
+        addPhaseMetrics(results.back(), output);
+        std::cerr << "index (" << threads << " threads): " << seconds << " s" << std::endl;
+    }
+
+    // Micro: queries against the indexed corpus, one call per sampled name
+    if (!options.threadCounts.empty()) {
+        SqliteStorage storage;
+        storage.initialize((work / "devpilot.db").string(), SqliteStorage::OpenMode::READ_ONLY);
+        results.push_back(timeQueries("search_symbols", corpus.functionNames, options.queries,
+                                      [&](const std::string& name) {
+                                          return storage.searchSymbols(name).size();
+                                      }));
+        results.push_back(timeQueries("search_symbols_qualified", corpus.qualifiedNames,
+                                      options.queries, [&](const std::string& name) {
+                                          return storage.searchSymbols(name).size();
+                                      }));
+        results.push_back(timeQueries("symbol_usages", corpus.qualifiedNames, options.queries,
+                                      [&](const std::string& name) {
+                                          return storage.getSymbolUsages(name).size();
+                                      }));
+        std::cerr << "queries: done" << std::endl;
+    }
+
+    // Micro: top-10 vector search, through the inverted lists and exactly,
+    // with the lists' recall against the exact answers
+    if (options.vectors > 0) {
+        const size_t dimensions = 256;
+        const size_t k = 10;
+        std::vector<float> vectors = clusteredVectors(options.vectors, dimensions, options.corpus.seed);
+        fs::path vectorFile = work / "bench.vectors";
+        VectorIndexBuilder builder(dimensions);
+        for (size_t i = 0; i < options.vectors; i++) {
+            builder.add(int64_t(i), &vectors[i * dimensions]);
+        }
+        size_t lists = 0;
+        Clock::time_point buildStart = Clock::now();
+        builder.write(vectorFile.string(), "bench", 0, VectorBuildOptions(), lists);
+        double buildSeconds = secondsSince(buildStart);
+        VectorIndex index;
+        index.open(vectorFile.string());
+
+        std::vector<std::string> samples;
+        for (size_t i = 0; i < std::min(options.queries, options.vectors); i++) {
+            samples.push_back(std::to_string(i * (options.vectors / std::min(options.queries, options.vectors))));
+        }
+        Result exact = timeQueries("vector_search_exact", samples, options.queries, [&](const std::string& row) {
+            return index.searchExact(&vectors[std::stoull(row) * dimensions], k).size();
+        });
+        Result approximate = timeQueries("vector_search_ivf", samples, options.queries, [&](const std::string& row) {
+            return index.search(&vectors[std::stoull(row) * dimensions], k, 16).size();
+        });
+        size_t found = 0;
+        size_t wanted = 0;
+        for (const auto& row : samples) {
+            const float* query = &vectors[std::stoull(row) * dimensions];
+            auto matches = index.search(query, k, 16);
+            for (const auto& expected : index.searchExact(query, k)) {
+                for (const auto& match : matches) {
+                    found += match.id == expected.id;
+                }
+                wanted++;
+            }
+        }
+        exact.metrics.push_back({"vectors", double(options.vectors)});
+        approximate.metrics.push_back({"vectors", double(options.vectors)});
+        approximate.metrics.push_back({"lists", double(lists)});
+        approximate.metrics.push_back({"probes", 16});
+        approximate.metrics.push_back({"recall_at_10", wanted ? double(found) / wanted : 0.0});
+        approximate.metrics.push_back({"build_seconds", buildSeconds});
+        results.push_back(exact);
+        results.push_back(approximate);
+        std::cerr << "vector search (" << dotProductKernel() << "): done" << std::endl;
+    }
+
+    if (!options.keep) {
+        fs::remove_all(work);
+    }
+
+    std::cout.rdbuf(stdoutBuffer);
+    if (options.output.empty()) {
+        writeJson(std::cout, options, corpus, results);
+    } else {
+        std::ofstream file(options.output);
+        writeJson(file, options, corpus, results);
+        std::cerr << "Results written to " << options.output << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace devpilot {
+
+// Bump allocator for the strings of one parse result. Copies are appended to
+// the current chunk and never freed individually; reset() drops them all at
+// once. Chunks start small and double, so a small file costs one allocation.
+class StringArena {
+public:
+    StringArena() = default;
+    StringArena(StringArena&& other) noexcept;
+    StringArena& operator=(StringArena&& other) noexcept;
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+
+    // Views stay valid until reset() or destruction, including across moves
+    std::string_view copy(std::string_view text);
+    std::string_view concat(std::string_view a, std::string_view b, std::string_view c = {});
+    char* allocate(size_t size);
+
+    void reset();
+    size_t bytesReserved() const;
+
+private:
+    static constexpr size_t kFirstChunkSize = 4 * 1024;
+    static constexpr size_t kMaxChunkSize = 256 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> chunks;
+    char* cursor = nullptr;
+    size_t remaining = 0;
+    size_t nextChunkSize = kFirstChunkSize;
+    size_t reserved = 0;
+};
+
+// Interned strings with stable views, e.g. the file path shared by every
+// record parsed from one file: stored once per run, so thousands of symbols
+// carry one pointer instead of one copy each. Safe to use from several threads.
+class StringTable {
+public:
+    std::string_view intern(std::string_view text);
+    size_t size() const;
+    // The strings and the set over them; node sizes are estimated
+    size_t bytesReserved() const;
+
+private:
+    mutable std::mutex mutex;
+    StringArena arena;
+    std::unordered_set<std::string_view> strings;
+};
+
+} // namespace devpilot
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace devpilot {
+
+// Varint byte encoding shared by the on-disk formats (parse cache entries,
+// index artifacts). Unsigned values take seven bits per byte, low first.
+
+class ByteWriter {
+public:
+    void varint(uint64_t value) {
+        while (value >= 0x80) {
+            bytes.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<char>(value));
+    }
+
+    // Zigzag so the -1 "unknown" markers stay one byte
+    void signedVarint(int64_t value) {
+        varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void string(std::string_view value) {
+        varint(value.size());
+        bytes.append(value);
+    }
+
+    void fixed(uint64_t value, int width) {
+        for (int i = 0; i < width; i++) {
+            bytes.push_back(static_cast<char>(value >> (8 * i)));
+        }
+    }
+
+    std::string bytes;
+};
+
+class ByteReader {
+public:
+    ByteReader(const char* data, size_t size)
+        : cursor(reinterpret_cast<const unsigned char*>(data)), end(cursor + size), ok(true) {}
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (cursor >= end) {
+                break;
+            }
+            unsigned char byte = *cursor++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        ok = false;
+        return 0;
+    }
+
+    int64_t signedVarint() {
+        uint64_t value = varint();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    int integer() {
+        return static_cast<int>(signedVarint());
+    }
+
+    // Valid while the decoded buffer is
+    std::string_view string() {
+        uint64_t size = varint();
+        if (!ok || size > static_cast<uint64_t>(end - cursor)) {
+            ok = false;
+            return std::string_view();
+        }
+        std::string_view value(reinterpret_cast<const char*>(cursor), size);
+        cursor += size;
+        return value;
+    }
+
+    uint64_t fixed(int width) {
+        if (end - cursor < width) {
+            ok = false;
+            return 0;
+        }
+        uint64_t value = 0;
+        for (int i = width - 1; i >= 0; i--) {
+            value = (value << 8) | cursor[i];
+        }
+        cursor += width;
+        return value;
+    }
+
+    // Element counts are bounded by the remaining bytes so a corrupt entry
+    // cannot trigger a huge allocation
+    size_t count() {
+        uint64_t value = varint();
+        if (value > static_cast<uint64_t>(end - cursor)) {
+            ok = false;
+            return 0;
+        }
+        return static_cast<size_t>(value);
+    }
+
+    bool finished() const {
+        return ok && cursor == end;
+    }
+
+    bool good() const {
+        return ok;
+    }
+
+private:
+    const unsigned char* cursor;
+    const unsigned char* end;
+    bool ok;
+};
+
+} // namespace devpilot
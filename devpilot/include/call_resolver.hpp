@@ -0,0 +1,78 @@
+#pragma once
+
+#include "arena.hpp"
+#include "parser.hpp"
+#include "symbol.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace devpilot {
+
+struct CallEdge {
+    int64_t caller_id;
+    int64_t callee_id;
+    int64_t file_id;
+    int line_number;
+};
+
+struct UnresolvedCall {
+    int64_t caller_id;
+    std::string callee_name;
+    int64_t file_id;
+    int line_number;
+};
+
+// Binds call sites to function symbol ids once every file has been parsed.
+// Candidates sharing the callee's name are ranked by explicit qualification,
+// enclosing scope, file locality and argument count; calls with no plausible
+// candidate (library code, macros, function pointers) are kept unresolved.
+// Names are interned, so each parse result can be released once it is added.
+class CallResolver {
+public:
+    // Only function symbols are considered as callers or callees
+    void addSymbol(int64_t symbolId, int64_t fileId, const SymbolRecord& symbol);
+    void addCall(int64_t callerId, int64_t fileId, const CallSite& call);
+
+    void resolve(std::vector<CallEdge>& edges, std::vector<UnresolvedCall>& unresolved) const;
+
+    // What was added for a function symbol; empty for any other id
+    std::string_view qualifiedName(int64_t symbolId) const;
+    std::string_view filePath(int64_t symbolId) const;
+    
+    // Heap held for what was added so far, which grows with the corpus until
+    // resolve(); an estimate, without the allocator's own overhead
+    size_t memoryBytes() const;
+
+private:
+    struct Function {
+        int64_t id;
+        int64_t file_id;
+        std::string_view qualified_name;
+        std::string_view parent_scope;
+        std::string_view file_path;
+        std::string_view file_stem;  // Views into file_path
+        int param_count;
+        int required_param_count;
+    };
+
+    struct PendingCall {
+        int64_t caller_id;
+        int64_t file_id;
+        CallSite site;
+    };
+
+    std::vector<Function> functions;
+    std::unordered_map<int64_t, size_t> functionsById;
+    std::unordered_map<std::string_view, std::vector<size_t>> functionsByName;
+    std::vector<PendingCall> calls;
+    StringTable strings;  // Names, scopes and file paths; repeated heavily across files
+
+    static bool precedes(const Function& a, const Function& b);
+    // Returns INT_MIN when the candidate cannot be the target
+    int score(const Function& caller, const Function& candidate, const PendingCall& call) const;
+};
+
+} // namespace devpilot
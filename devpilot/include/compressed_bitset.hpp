@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace devpilot {
+
+// Roaring-style compressed set of 32-bit ids. Values are bucketed by their high
+// 16 bits; each bucket is a sorted array while sparse and a 65536-bit bitmap
+// once it holds more than kArrayMaxSize values.
+class CompressedBitset {
+public:
+    void add(uint32_t value);
+    bool contains(uint32_t value) const;
+    void unionWith(const CompressedBitset& other);
+    uint64_t cardinality() const;
+    bool empty() const;
+
+    // Visit every value in ascending order
+    void forEach(const std::function<void(uint32_t)>& visitor) const;
+    std::vector<uint32_t> toVector() const;
+
+    // Compact little-endian binary form for storage as a BLOB
+    std::string serialize() const;
+    static bool deserialize(const void* data, size_t size, CompressedBitset& out);
+
+private:
+    static constexpr size_t kArrayMaxSize = 4096;
+    static constexpr size_t kBitmapWords = 1024;
+
+    struct Container {
+        uint16_t key;
+        uint32_t count;
+        std::vector<uint16_t> array;   // Sorted values while count <= kArrayMaxSize
+        std::vector<uint64_t> bitmap;  // kBitmapWords words once converted
+
+        bool isBitmap() const { return !bitmap.empty(); }
+        void add(uint16_t low);
+        bool contains(uint16_t low) const;
+        void unionWith(const Container& other);
+        void convertToBitmap();
+    };
+
+    std::vector<Container> containers;  // Sorted by key
+
+    Container* findOrCreate(uint16_t key);
+    const Container* find(uint16_t key) const;
+};
+
+} // namespace devpilot
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace devpilot {
+
+// 64-bit XXH64 of a byte range. Fast enough to run on every indexed file and
+// stable across platforms, so hashes can key data shared between checkouts.
+uint64_t hashContent(const void* data, size_t size, uint64_t seed = 0);
+
+// The same hash computed over input that arrives in pieces
+class ContentHasher {
+public:
+    explicit ContentHasher(uint64_t seed = 0);
+
+    void update(const void* data, size_t size);
+    uint64_t digest() const;
+
+private:
+    uint64_t seed;
+    uint64_t lanes[4];
+    unsigned char buffer[32];  // Input not yet forming a full 32-byte stripe
+    size_t buffered;
+    uint64_t total;
+};
+
+// hashContent of a whole file, read in fixed-size chunks. False when unreadable.
+bool hashFile(const std::string& path, uint64_t seed, uint64_t& hash);
+
+// Fixed-width lowercase hex, suitable for file names
+std::string hashToHex(uint64_t hash);
+
+} // namespace devpilot
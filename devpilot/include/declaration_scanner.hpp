@@ -0,0 +1,137 @@
+#pragma once
+
+#include "lexer.hpp"
+#include "parser.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace devpilot {
+
+// Token-driven declaration extractor used by the fallback parser. It tracks
+// namespace, class and brace nesting so every symbol carries its fully
+// qualified name, enclosing scope and the byte range of its declaration,
+// body included. Function bodies are skipped as a unit.
+// Strings are written to the result's arena; scopes refer to the qualified
+// names already stored there.
+//
+// Tokens of the declaration being read still point into the source. When the
+// source arrives as a sliding window, retainedOffset() is the first byte the
+// scanner still needs, release() gives up what lies before a given offset, and
+// moveWindow() re-points the kept tokens into the next window.
+class DeclarationScanner {
+public:
+    DeclarationScanner(std::string_view filePath, ParseResult& result, bool extractCalls = true);
+
+    void feed(const Token& token);
+
+    size_t retainedOffset() const;
+    void release(size_t offset);
+    void moveWindow(std::string_view window, size_t base);
+
+private:
+    enum class ScopeKind { NAMESPACE, CLASS, FUNCTION, TRANSPARENT, OPAQUE };
+    enum class Pending { NONE, NAMESPACE, CLASS, FUNCTION };
+
+    struct Scope {
+        ScopeKind kind;
+        std::string_view qualified;
+        int symbolIndex = -1;  // The symbol this brace opened, whose range it closes
+    };
+
+    struct PendingCall {
+        CallSite site;
+        int parenDepth;  // Body paren depth inside this call's argument list
+        int commas;
+        bool hasArguments;
+    };
+
+    struct Conditional {
+        bool active;
+        bool taken;  // Some branch of this #if chain has already been parsed
+    };
+
+    std::string_view filePath;
+    ParseResult& result;
+    bool extractCalls;  // False to read declarations only
+    std::string scratch;  // Reused while composing strings before they go to the arena
+
+    std::vector<Scope> scopes;
+    std::vector<Conditional> conditionals;
+    int opaqueDepth;     // Function bodies and other blocks we do not descend into
+    int skipBraceDepth;  // Initializer, enum and member-init braces at declaration level
+
+    // Call extraction inside the current function body
+    int functionSymbolIndex;  // -1 outside a function definition
+    int bodyParenDepth;
+    std::vector<Token> recentBodyTokens;
+    std::vector<PendingCall> pendingCalls;
+
+    // State of the declaration currently being read
+    std::vector<Token> statement;
+    size_t statementStart;
+    int parenDepth;
+    int bracketDepth;
+    int templateDepth;
+    bool expectTemplateArgs;
+    bool sawAssign;
+    bool isEnum;
+    bool noDeclarations;  // typedef, using, friend, static_assert
+    Pending pending;
+
+    // Pending namespace or class
+    std::string pendingName;
+    Token pendingToken;
+    size_t pendingKeywordOffset;  // Where "namespace", "class", "struct" or "union" was
+    int classAngleDepth;
+    bool classBaseClause;
+    bool afterScopeOperator;
+
+    // Pending function
+    std::string functionName;
+    std::string functionQualifier;
+    bool declaratorOpen;
+    bool declaratorClosed;
+    bool inInitList;
+    int identifiersSinceDeclarator;
+    size_t signatureEnd;
+    bool signatureComplete;  // Past "= 0", "= default" or the start of a member-init list
+    bool operatorMode;
+    size_t operatorIndex;
+    std::string operatorName;
+
+    // Parameter counting inside the declarator parentheses
+    int paramCommas;
+    int paramDefaults;
+    int paramTokens;
+    int declaratorAngleDepth;
+    bool paramsVariadic;
+    bool paramsOnlyVoid;
+    int functionParamCount;
+    int functionRequiredParamCount;
+
+    void feedDirective(const Token& token);
+    void feedBody(const Token& token);
+    void feedDeclaration(const Token& token);
+
+    void openBrace(const Token& token);
+    void closeBrace(const Token& token);
+    void endStatement(const Token& token);
+    void resetStatement();
+    void beginCall();
+    void finishCall();
+    void countParameterToken(const Token& token);
+    void beginFunction(size_t nameIndex, std::string_view name, size_t signatureStartOffset);
+
+    void emitNamespace();
+    void emitClass();
+    void emitFunction(bool isDefinition);
+
+    bool isActive() const;
+    std::string_view currentScope() const;
+    std::string_view qualify(std::string_view name);
+    SymbolRecord makeRecord(SymbolType type, std::string_view qualified, size_t nameSize) const;
+    static size_t unqualifiedSize(std::string_view name);
+};
+
+} // namespace devpilot
@@ -0,0 +1,190 @@
+#ifndef DEVPILOT_H
+#define DEVPILOT_H
+
+/*
+ * C interface to devpilot_core, for editors and GUIs that link the indexer
+ * in-process instead of running the devpilot executable.
+ *
+ * Stability: the functions, constants and struct members here keep their
+ * meaning across releases. New struct members are only ever appended, and
+ * result structs are only handed out by pointer, so a client built against
+ * an older header keeps working. DEVPILOT_API_VERSION goes up whenever
+ * something is added; devpilot_api_version() tells which library is loaded.
+ *
+ * Threads: an index handle may be shared by any number of threads, and
+ * their queries run concurrently, each on a connection of its own. A
+ * results object belongs to the thread that uses it; hand it over rather
+ * than share it. Tokens may be cancelled from any thread.
+ *
+ * Memory: results own everything they point to. Strings and structs read
+ * out of a results object are valid until devpilot_results_free() and are
+ * never copied on the way out.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(DEVPILOT_SHARED)
+#  ifdef DEVPILOT_BUILDING
+#    define DEVPILOT_API __declspec(dllexport)
+#  else
+#    define DEVPILOT_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__)
+#  define DEVPILOT_API __attribute__((visibility("default")))
+#else
+#  define DEVPILOT_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEVPILOT_API_VERSION 1
+
+typedef enum devpilot_status {
+    DEVPILOT_OK = 0,
+    DEVPILOT_TRUNCATED = 1,  /* The deadline or token cut the results short */
+    DEVPILOT_INVALID_ARGUMENT = -1,
+    DEVPILOT_OPEN_FAILED = -2,
+    DEVPILOT_INDEX_FAILED = -3,
+    DEVPILOT_SOURCE_MISSING = -4,  /* The symbol's file cannot be opened */
+    DEVPILOT_SOURCE_STALE = -5,    /* The file changed since it was indexed */
+    DEVPILOT_ERROR = -6
+} devpilot_status;
+
+typedef enum devpilot_symbol_kind {
+    DEVPILOT_SYMBOL_FUNCTION = 0,
+    DEVPILOT_SYMBOL_CLASS = 1,
+    DEVPILOT_SYMBOL_VARIABLE = 2,
+    DEVPILOT_SYMBOL_NAMESPACE = 3,
+    DEVPILOT_SYMBOL_UNKNOWN = 4
+} devpilot_symbol_kind;
+
+typedef enum devpilot_log_level {
+    DEVPILOT_LOG_ERROR = 0,
+    DEVPILOT_LOG_WARNING = 1,
+    DEVPILOT_LOG_INFO = 2,
+    DEVPILOT_LOG_DEBUG = 3
+} devpilot_log_level;
+
+typedef struct devpilot_index devpilot_index;
+typedef struct devpilot_results devpilot_results;
+typedef struct devpilot_token devpilot_token;
+
+typedef struct devpilot_symbol {
+    const char* name;
+    const char* qualified_name;  /* e.g. "geometry::Matrix::add" */
+    const char* parent_scope;    /* Empty outside classes and namespaces */
+    const char* file_path;
+    int32_t kind;                /* A devpilot_symbol_kind */
+    int32_t line;
+    int32_t column;
+    int32_t param_count;           /* Functions only; -1 when unknown or variadic */
+    int32_t required_param_count;  /* Parameters without a default argument */
+    uint64_t start_offset;         /* Byte range of the declaration, body included */
+    uint64_t end_offset;
+    uint32_t group;  /* Which key of a batch lookup this answers; 0 otherwise */
+} devpilot_symbol;
+
+typedef struct devpilot_reference {
+    const char* file_path;
+    int32_t line;
+    int32_t column;
+} devpilot_reference;
+
+DEVPILOT_API uint32_t devpilot_api_version(void);
+
+/* The message behind the calling thread's last failed call, or "" */
+DEVPILOT_API const char* devpilot_last_error(void);
+
+/* Messages below `level` are dropped; the rest go to stdout and stderr */
+DEVPILOT_API void devpilot_set_log_level(devpilot_log_level level);
+
+/* Opens the database at db_path, with its shards if `devpilot index
+ * --shards` split it. Nothing is created or migrated: where there is no
+ * index yet, or an older build wrote it, queries fail with
+ * DEVPILOT_OPEN_FAILED until devpilot_index_project() builds one. */
+DEVPILOT_API devpilot_status devpilot_open(const char* db_path, devpilot_index** index);
+/* Every query on the index must have returned; results stay valid */
+DEVPILOT_API void devpilot_close(devpilot_index* index);
+
+/*
+ * Rebuilds the index from the C++ files under project_path. include_paths
+ * (may be NULL when include_count is 0) are searched for #include targets
+ * before the project itself; threads of 0 uses one per core. Queries may
+ * run meanwhile, from any thread or process, and see the previous index
+ * until this commits: the database is written in WAL mode, so readers are
+ * not locked out. The new index is a single database, replacing any shards.
+ */
+DEVPILOT_API devpilot_status devpilot_index_project(devpilot_index* index, const char* project_path,
+                                                    const char* const* include_paths,
+                                                    size_t include_count, uint32_t threads);
+
+/* Cancels, from any thread, every query that was given the token */
+DEVPILOT_API devpilot_token* devpilot_token_create(void);
+DEVPILOT_API void devpilot_token_cancel(devpilot_token* token);
+DEVPILOT_API void devpilot_token_free(devpilot_token* token);
+
+/*
+ * Queries. Each stops after timeout_ms (0 for no deadline) or once `token`
+ * (may be NULL) is cancelled, and then returns DEVPILOT_TRUNCATED with the
+ * results found so far. On success or truncation *results is set and must
+ * be freed; on error it is NULL.
+ */
+
+/* Symbols whose name contains `query`, or matching a qualified name */
+DEVPILOT_API devpilot_status devpilot_search(devpilot_index* index, const char* query,
+                                             uint32_t timeout_ms, const devpilot_token* token,
+                                             devpilot_results** results);
+/* Symbols named exactly as each of `names`, tagged with the name's position as group */
+DEVPILOT_API devpilot_status devpilot_lookup(devpilot_index* index, const char* const* names,
+                                             size_t count, uint32_t timeout_ms,
+                                             const devpilot_token* token, devpilot_results** results);
+/* Symbols declared in each of `files`, tagged with the file's position as group */
+DEVPILOT_API devpilot_status devpilot_outline(devpilot_index* index, const char* const* files,
+                                              size_t count, uint32_t timeout_ms,
+                                              const devpilot_token* token, devpilot_results** results);
+/* Names of the functions that call `name` (strings) */
+DEVPILOT_API devpilot_status devpilot_usages(devpilot_index* index, const char* name,
+                                             uint32_t timeout_ms, const devpilot_token* token,
+                                             devpilot_results** results);
+/* Names of the functions `name` calls (strings) */
+DEVPILOT_API devpilot_status devpilot_callees(devpilot_index* index, const char* name,
+                                              uint32_t timeout_ms, const devpilot_token* token,
+                                              devpilot_results** results);
+/* Every place the identifier `name` appears (references) */
+DEVPILOT_API devpilot_status devpilot_references(devpilot_index* index, const char* name,
+                                                 uint32_t timeout_ms, const devpilot_token* token,
+                                                 devpilot_results** results);
+/* Paths of the files that include `file`, directly or not (strings) */
+DEVPILOT_API devpilot_status devpilot_dependents(devpilot_index* index, const char* file,
+                                                 uint32_t timeout_ms, const devpilot_token* token,
+                                                 devpilot_results** results);
+
+/*
+ * Results. Each accessor returns NULL when i is out of range or the results
+ * hold another kind of item.
+ */
+DEVPILOT_API size_t devpilot_results_count(const devpilot_results* results);
+DEVPILOT_API int devpilot_results_truncated(const devpilot_results* results);
+DEVPILOT_API const devpilot_symbol* devpilot_results_symbol(const devpilot_results* results, size_t i);
+DEVPILOT_API const devpilot_reference* devpilot_results_reference(const devpilot_results* results,
+                                                                  size_t i);
+DEVPILOT_API const char* devpilot_results_string(const devpilot_results* results, size_t i);
+
+/*
+ * The text of symbol i as it stands in its file, body included. The file is
+ * mapped on first use and stays mapped until the results are freed, so
+ * *text is not NUL-terminated; it is *length bytes long.
+ */
+DEVPILOT_API devpilot_status devpilot_results_source(devpilot_results* results, size_t i,
+                                                     const char** text, size_t* length);
+
+DEVPILOT_API void devpilot_results_free(devpilot_results* results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVPILOT_H */
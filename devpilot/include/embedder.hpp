@@ -0,0 +1,61 @@
+#pragma once
+
+#include "sharded_storage.hpp"
+#include "vector_index.hpp"
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace devpilot {
+
+// Turns text into a vector for semantic search. Queries must be embedded by
+// the embedder that built the vectors, which the vector file records by id.
+class Embedder {
+public:
+    virtual ~Embedder() = default;
+
+    // Names the model and its settings
+    virtual std::string id() const = 0;
+    virtual size_t dimensions() const = 0;
+
+    // Writes dimensions() values of unit length, or all zeros when the text
+    // has nothing to go on. May be called from several threads at once.
+    virtual void embed(std::string_view text, float* vector) const = 0;
+};
+
+// Deterministic and model-free: words (identifiers split at camelCase and
+// underscores, lowercased, with plural and tense endings cut) are hashed
+// into signed buckets, weighted by 1 + log of their count. Texts that share
+// words land near each other, which is enough to find "the function that
+// retries HTTP requests" in retryHttpRequest.
+class HashingEmbedder : public Embedder {
+public:
+    explicit HashingEmbedder(size_t dimensions = 256);
+
+    std::string id() const override;
+    size_t dimensions() const override { return size; }
+    void embed(std::string_view text, float* vector) const override;
+
+private:
+    size_t size;
+};
+
+// What is embedded for a symbol: its qualified name and file, then its
+// source text (cut at maxSourceBytes)
+std::string symbolEmbeddingText(const Symbol& symbol, std::string_view source, size_t maxSourceBytes = 4096);
+
+struct EmbedSummary {
+    size_t symbols = 0;
+    size_t missingSources = 0;  // Embedded from their names alone
+    size_t lists = 0;
+    std::chrono::nanoseconds embedTime{0};
+    std::chrono::nanoseconds buildTime{0};
+};
+
+// Embeds every symbol of index, with its source text where the file still
+// matches, into the vector file at path
+bool embedIndex(ShardedStorage& index, const Embedder& embedder, const std::string& path,
+                const VectorBuildOptions& options, EmbedSummary& summary);
+
+} // namespace devpilot
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "work_queue.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace devpilot {
+
+class BufferPool;
+class HeapBudget;
+class IoRing;
+
+// Contents of one file. Files that fit a slot of the reader's buffer pool are
+// read straight into it and the slot is returned when the FileBuffer is
+// destroyed; larger files own a heap buffer, charged to the reader's heap
+// budget until then. Files above the reader's stream limit are not read at
+// all: the buffer is deferred and only knows their size.
+class FileBuffer {
+public:
+    FileBuffer() = default;
+    FileBuffer(FileBuffer&& other) noexcept;
+    FileBuffer& operator=(FileBuffer&& other) noexcept;
+    FileBuffer(const FileBuffer&) = delete;
+    FileBuffer& operator=(const FileBuffer&) = delete;
+    ~FileBuffer();
+
+    bool ok() const;
+    std::string_view contents() const;
+    bool deferred() const;  // Too large to hold; the consumer streams it
+    uint64_t fileSize() const;
+
+private:
+    friend class FileReader;
+
+    BufferPool* pool = nullptr;
+    int slot = -1;
+    HeapBudget* budget = nullptr;
+    size_t charged = 0;
+    char* data = nullptr;
+    size_t size = 0;
+    char* heap = nullptr;
+    size_t heapSize = 0;
+    bool readable = false;
+    bool streamed = false;
+    uint64_t totalSize = 0;
+
+    void release();
+};
+
+struct ReadRequest {
+    std::string path;
+    uint64_t user_data;  // Returned untouched with the completion
+};
+
+struct ReadCompletion {
+    std::string path;
+    uint64_t user_data;
+    FileBuffer buffer;
+};
+
+// Read stage of the indexing pipeline. On Linux it keeps many reads in flight
+// through io_uring, driven by raw syscalls, with the buffer pool registered
+// as fixed buffers; opens are asynchronous too. Where io_uring is missing or
+// disabled, a small pool of threads does blocking reads into the same slots.
+// Either way a full pool stalls the reader until parsers release buffers.
+// Files bigger than a slot share heapLimit bytes between them; a file that
+// would overrun it waits for parsers to release earlier ones, unless it is
+// the only one held.
+class FileReader {
+public:
+    FileReader(size_t bufferCount, size_t bufferSize, unsigned fallbackThreads,
+               uint64_t streamAbove = UINT64_MAX, uint64_t heapLimit = UINT64_MAX);
+    ~FileReader();
+
+    // Receives each completed read; may block to hold the reader back
+    using CompletionSink = std::function<void(ReadCompletion)>;
+
+    // Reads every request until the queue is closed and drained. Completions
+    // are handed over in the order reads finish, not the order they were queued.
+    void run(WorkQueue<ReadRequest>& requests, const CompletionSink& complete);
+
+    // "io_uring" or "threads"
+    const char* backend() const;
+
+    // One blocking read into a heap buffer, deferred like the pipeline's
+    static FileBuffer read(const std::string& path, uint64_t streamAbove = UINT64_MAX);
+
+private:
+    std::unique_ptr<BufferPool> pool;
+    std::unique_ptr<HeapBudget> budget;
+    std::unique_ptr<IoRing> ring;  // Null when io_uring is unavailable
+    unsigned fallbackThreads;
+    uint64_t streamAbove;
+
+    // Without a pool the file goes to the heap, charged to the budget if given
+    static FileBuffer readBlocking(const std::string& path, BufferPool* pool, int slot,
+                                   uint64_t streamAbove, HeapBudget* budget = nullptr);
+    void runThreads(WorkQueue<ReadRequest>& requests, const CompletionSink& complete);
+    // Files too big for a slot are passed to oversize instead of read
+    void runRing(WorkQueue<ReadRequest>& requests, const CompletionSink& complete,
+                 WorkQueue<ReadRequest>& oversize);
+};
+
+} // namespace devpilot
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ignore_rules.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace devpilot {
+
+// Multi-threaded source tree traversal. Directories are listed in parallel
+// (getdents64 in large batches on Linux), .gitignore and .devpilotignore files
+// are compiled once per directory, and every C++ file found is handed to the
+// callback straight away so downstream work can start before the walk ends.
+class FileWalker {
+public:
+    using FileCallback = std::function<void(std::string path)>;
+
+    explicit FileWalker(unsigned threadCount);
+
+    // Blocks until the whole tree has been visited. onFile is called
+    // concurrently from walker threads, in no particular order.
+    void walk(const std::string& root, const FileCallback& onFile);
+
+    static bool isCppSource(std::string_view filename);
+
+    uint64_t directoriesVisited() const;
+    uint64_t entriesIgnored() const;
+
+private:
+    unsigned threadCount;
+    std::atomic<uint64_t> directoryCount;
+    std::atomic<uint64_t> ignoredCount;
+};
+
+} // namespace devpilot
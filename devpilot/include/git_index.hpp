@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace devpilot {
+
+struct GitIndexEntry {
+    std::string path;     // Relative to the work tree root, '/' separated
+    std::string blob_id;  // Hex object id of the staged contents
+    uint32_t mtime_seconds;
+    uint32_t mtime_nanoseconds;
+    uint32_t size;        // Truncated to 32 bits, as git stores it
+};
+
+// Reads the staged file list straight from .git/index (versions 2-4), without
+// running git. Together with a stat() of the work tree file it tells whether a
+// tracked file still holds the blob git recorded, so its contents need not be
+// read or hashed to know what they are.
+class GitIndex {
+public:
+    // Finds the work tree containing path and loads its index. Returns false
+    // outside a git work tree or when the index uses an unsupported layout
+    // (split index); callers then fall back to hashing file contents.
+    bool load(const std::string& path);
+
+    const std::string& workTree() const;
+    size_t size() const;
+
+    // nullptr for untracked files and files outside the work tree
+    const GitIndexEntry* find(const std::string& filePath) const;
+
+    // Same test as git's racy-clean check: size and mtime must match the
+    // index entry, and the file must not have changed within the second the
+    // index itself was written
+    bool isUnchanged(const std::string& filePath, const GitIndexEntry& entry) const;
+
+private:
+    std::string root;
+    std::vector<GitIndexEntry> entries;
+    std::unordered_map<std::string, size_t> entriesByPath;
+    int64_t indexMtimeSeconds = 0;
+
+    bool parse(const std::string& data, size_t hashSize);
+};
+
+} // namespace devpilot
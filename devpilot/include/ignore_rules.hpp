@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace devpilot {
+
+// Patterns from one .gitignore-style file, parsed once when the file is read.
+// Supports comments, "!" negation, trailing "/" for directories, anchoring by
+// an inner "/", and the "*", "?", "[...]" and "**" wildcards.
+class IgnoreRules {
+public:
+    enum class Match { NONE, IGNORED, INCLUDED };
+
+    void addPatterns(std::string_view text);
+    bool empty() const;
+
+    // path is relative to the directory holding the rules; name is its last component.
+    // The last matching pattern decides, as in git.
+    Match match(std::string_view path, std::string_view name, bool isDirectory) const;
+
+private:
+    struct Pattern {
+        std::string glob;
+        bool negated;
+        bool directoryOnly;
+        bool anchored;  // Matched against the whole relative path instead of the name
+        bool literal;   // No wildcards: plain string comparison
+    };
+
+    std::vector<Pattern> patterns;
+};
+
+// Rules in effect for one directory: its own ignore files plus everything
+// inherited from the directories above. Deeper rules take precedence.
+struct IgnoreScope {
+    std::shared_ptr<const IgnoreScope> parent;
+    std::string base;  // Relative to the walk root, "" for the root itself
+    IgnoreRules rules;
+
+    // path is relative to the walk root
+    static bool isIgnored(const IgnoreScope* scope, std::string_view path, std::string_view name,
+                          bool isDirectory);
+};
+
+// VCS metadata and CMake build output, overridable with "!dir/" in a
+// .devpilotignore. Anything else, vendored code included, is indexed unless
+// an ignore file says otherwise.
+IgnoreRules defaultIgnoreRules();
+
+} // namespace devpilot
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "arena.hpp"
+#include "compressed_bitset.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace devpilot {
+
+// Resolves #include spellings to indexed files using the usual lookup order:
+// the including file's directory (quoted form only), then the search paths.
+class IncludeResolver {
+public:
+    explicit IncludeResolver(const std::vector<std::string>& searchPaths);
+
+    void addFile(const std::string& path, uint32_t fileId);
+
+    // Returns 0 when the include cannot be matched to an indexed file
+    uint32_t resolve(std::string_view includerPath, std::string_view spelling,
+                     bool isSystem) const;
+
+    // Heap held for the files added so far; an estimate
+    size_t memoryBytes() const;
+
+private:
+    std::vector<std::string> searchPaths;
+    // Each normalized path is stored once; both maps view into it
+    StringArena paths;
+    std::unordered_map<std::string_view, uint32_t> filesByPath;
+    // Trailing path components -> file id, or 0 when the suffix is ambiguous
+    std::unordered_map<std::string_view, uint32_t> filesBySuffix;
+
+    uint32_t lookup(std::string_view path) const;
+};
+
+// File-level include graph. Edges point from the including file to the included one.
+class IncludeGraph {
+public:
+    void addEdge(uint32_t includer, uint32_t included);
+    size_t edgeCount() const;
+
+    // For every file, the set of files that include it directly or transitively.
+    // Cycles are collapsed into strongly connected components first so each
+    // component's set is computed exactly once, in topological order.
+    std::unordered_map<uint32_t, CompressedBitset> computeReverseClosure() const;
+
+private:
+    std::unordered_map<uint32_t, std::vector<uint32_t>> includes;
+    size_t edges = 0;
+
+    std::vector<std::vector<uint32_t>> stronglyConnectedComponents() const;
+};
+
+} // namespace devpilot
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "sharded_storage.hpp"
+#include "storage.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace devpilot {
+
+// A prebuilt index packed into one relocatable file, so a machine can take
+// the index CI already built instead of parsing the tree itself. Paths are
+// stored relative to the project root and re-rooted at the checkout they
+// are imported into; each file keeps its content hash, and the parse
+// results behind it travel along as parse cache entries.
+//
+// The artifact is written front to back, so it can go to a pipe: a header
+// (magic, format, parser and schema versions), then tagged sections (the
+// manifest, table rows in bounded chunks, parse cache entries), then an end
+// tag and the XXH64 of everything before it.
+
+struct ExportSummary {
+    unsigned shards = 1;
+    size_t files = 0;
+    size_t rows = 0;
+    size_t parseEntries = 0;  // Files whose parse results came along
+    uint64_t bytes = 0;
+};
+
+struct ImportOptions {
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t cacheBytes = 512ull << 20;
+    std::string databasePath = "devpilot.db";
+};
+
+struct ImportSummary {
+    bool restored = false;  // The checkout matched and the index was restored as is
+    unsigned shards = 1;
+    size_t files = 0;
+    size_t changedFiles = 0;
+    size_t addedFiles = 0;
+    size_t removedFiles = 0;
+    size_t seededEntries = 0;  // Parse results stored into the local cache
+    // For re-indexing when the checkout differs: how the index was built,
+    // with its include paths re-rooted
+    std::vector<std::string> includePaths;
+    ShardScheme shardScheme = ShardScheme::DIRECTORY;
+};
+
+// Both report errors through logging.
+
+// Writes the index at databasePath, which must record its project root
+// (indexes built before it was recorded need indexing again)
+bool exportIndex(const std::string& databasePath, std::ostream& out, ExportSummary& summary);
+
+// Reads artifact front to back, a section at a time, and sweeps projectPath
+// comparing content hashes meanwhile. The artifact's parse results are
+// seeded into the local parse cache either way. The tables are written into
+// storage (the database at options.databasePath) as they arrive, but only
+// committed when the checksum holds and every file matches; otherwise the
+// index is left as it was and summary.restored is false, and re-indexing the
+// project reads only the files that differ.
+bool importIndex(std::istream& artifact, const std::string& projectPath, SqliteStorage& storage,
+                 const ImportOptions& options, ImportSummary& summary);
+
+} // namespace devpilot
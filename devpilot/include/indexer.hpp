@@ -0,0 +1,109 @@
+#pragma once
+
+#include "parser.hpp"
+#include "priority_scheduler.hpp"
+#include "sharded_storage.hpp"
+#include "storage.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace devpilot {
+
+struct IndexOptions {
+    std::vector<std::string> includePaths;
+    bool useCache = true;
+    bool force = false;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t cacheBytes = 512ull << 20;
+    uint64_t maxMemory = 0;  // Bytes; 0 for no budget
+    SizePolicy sizePolicy;
+    std::vector<std::string> openFiles;  // Indexed ahead of everything else
+    // The database being written, for noticing queries against it
+    std::string databasePath = "devpilot.db";
+    // Written as this many databases at once (see sharded_storage.hpp)
+    unsigned shards = 1;
+    ShardScheme shardScheme = ShardScheme::DIRECTORY;
+};
+
+// What one index run did, for the caller to report
+struct IndexSummary {
+    bool upToDate = false;  // The tree was as last indexed; nothing was rewritten
+
+    size_t files = 0;
+    size_t keptFiles = 0;     // Updating in place: left as indexed, unparsed
+    size_t removedFiles = 0;  // Updating in place: gone since the last run
+    uint64_t directories = 0;
+    uint64_t ignoredEntries = 0;
+    bool inGitRepo = false;
+    std::string gitWorkTree;
+    size_t unchangedFiles = 0;  // Stat data matched .git/index
+
+    size_t symbols = 0;
+    size_t includeEdges = 0;
+    size_t unresolvedIncludes = 0;
+    size_t callEdges = 0;
+    size_t unresolvedCalls = 0;
+
+    bool cacheEnabled = false;
+    uint64_t cacheHits = 0;
+    uint64_t cacheMisses = 0;
+    const char* readBackend = "";
+    PriorityStats scheduling[kTaskPriorityCount];
+    uint64_t steals = 0;
+    std::chrono::nanoseconds yieldedTime{0};
+
+    size_t streamedFiles = 0;
+    size_t declarationsOnlyFiles = 0;
+    size_t skippedFiles = 0;
+
+    uint64_t occurrences = 0;
+    size_t occurrenceNames = 0;
+    uint64_t postingBytes = 0;
+    int postingSegments = 0;
+
+    uint64_t memoryFloor = 0;  // Bytes no budget can go below, call resolution included; 0 without a budget
+
+    unsigned shards = 1;
+    std::vector<size_t> shardFiles;  // Files written to each shard
+    size_t crossShardCalls = 0;      // Call edges whose ends sit in different shards
+};
+
+// Single responsibility: Only run the indexing pipeline, from walking the
+// project to committing the database. Reports progress and errors through
+// logging and leaves presenting the summary to the caller.
+class Indexer {
+public:
+    Indexer(CppParser& parser, SqliteStorage& storage) : parser(parser), storage(storage) {}
+
+    // Leaves the storage holding an index of projectPath: updated in place
+    // when it was written with the same settings, unless options.force, and
+    // rebuilt otherwise. False when the project cannot be indexed at all.
+    bool run(const std::string& projectPath, const IndexOptions& options, IndexSummary& summary);
+
+private:
+    CppParser& parser;
+    SqliteStorage& storage;
+
+    // Files up to one slot are read into the reader's shared pool; bigger
+    // ones get their own buffer. 64 x 256 KiB caps pooled reads at 16 MiB;
+    // the bigger files held at once share as much as the largest one read
+    // whole, CppParser::kStreamAbove.
+    static constexpr size_t kReadBufferCount = 64;
+    static constexpr size_t kReadBufferSize = 256 * 1024;
+    static constexpr uint64_t kReadHeapBytes = 8ull << 20;
+
+    // Paths waiting for the reader; beyond this the walker waits
+    static constexpr size_t kReadQueueCapacity = 4096;
+    // Resident memory is sampled every this many written files
+    static constexpr int kMemoryCheckInterval = 64;
+    static constexpr uint64_t kMinPostingsBatchBytes = 1ull << 20;
+    // Outside git, files modified this recently are indexed before the rest
+    static constexpr std::chrono::hours kRecentWindow{1};
+};
+
+} // namespace devpilot
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace devpilot {
+
+enum class TokenKind {
+    IDENTIFIER,    // Identifiers and keywords
+    NUMBER,
+    STRING,        // String literals, including raw and prefixed forms
+    CHARACTER,
+    PUNCTUATION,   // Single characters, plus "::" and "->"
+    PREPROCESSOR,  // A whole directive line, continuations included
+    END
+};
+
+struct Token {
+    TokenKind kind;
+    std::string_view text;  // Points into the lexed source
+    int line;               // 1-based
+    int column;             // 1-based, in bytes
+    size_t offset;          // Byte offset of the first character
+};
+
+// True for reserved words that can never name a user symbol
+bool isCppKeyword(std::string_view text);
+
+// Minimal C++ tokenizer for the fallback parser. Comments and whitespace are
+// skipped; literals are returned whole so their contents never look like code.
+//
+// A file too large to hold at once is lexed through a sliding window: the
+// lexer returns END at the end of each window until it is told the window is
+// final, and moveWindow() hands it the next one. A token cut by the window
+// edge is lexed again from its start once more input arrives, so the caller
+// must keep the bytes from resumeOffset() on. Comments, literals and
+// directives longer than the rewind limit are carried over instead: the
+// lexer remembers it is inside one, returns literals and directives truncated
+// at the edge, and skips their remainder in the next window.
+class CppLexer {
+public:
+    explicit CppLexer(std::string_view source, size_t rewindLimit = SIZE_MAX);
+
+    Token next();
+
+    // The window holds bytes [base, base + window.size()) of the file and must
+    // start at or before resumeOffset()
+    void moveWindow(std::string_view window, size_t base, bool final);
+    size_t resumeOffset() const;
+
+private:
+    // Constructs left open at a window edge
+    enum class Carry { NONE, BLOCK_COMMENT, LINE_COMMENT, QUOTED, RAW_STRING, DIRECTIVE };
+
+    std::string_view source;
+    size_t base;  // File offset of source[0]
+    size_t pos;   // Into source
+    int line;
+    size_t lineStart;  // File offset
+    bool atLineStart;  // Only whitespace seen since the last newline
+    bool final;        // The window reaches the end of the file
+    bool starved;      // The current scan ran into the window edge
+    size_t rewindLimit;
+
+    Carry carry;
+    char carryQuote;
+    bool carryEscape;          // QUOTED: the window ended right after a backslash
+    bool carryComment;         // DIRECTIVE: inside a block comment
+    std::string carryTerminator;  // RAW_STRING: ")delim\""
+
+    bool atEnd(size_t ahead = 0);
+    char peek(size_t ahead = 0);
+    void advance();
+    int column(size_t offset) const;
+    void skipWhitespaceAndComments();
+    bool skipBlockComment();
+    bool skipCarried();
+    Token makeToken(TokenKind kind, size_t start, int startLine, int startColumn) const;
+    Token endOfInput() const;
+
+    Token lexPreprocessor();
+    Token lexIdentifierOrLiteral();
+    Token lexNumber();
+    Token lexQuoted(size_t start, int startLine, int startColumn);
+    Token lexRawString(size_t start, int startLine, int startColumn);
+    bool skipQuoted();
+    bool skipRawString();
+    bool skipDirective();
+};
+
+} // namespace devpilot
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace devpilot {
+
+// Most severe first; a level shows every message at or above it
+enum class LogLevel {
+    ERROR,
+    WARNING,
+    INFO,     // Progress; the default
+    DEBUG     // Per-file detail, shown with --verbose
+};
+
+// Leveled logging for the indexer's library code. A message below the
+// current level costs one relaxed load. Others are formatted by the calling
+// thread and pushed onto that thread's own lock-free ring; one background
+// thread drains every ring, restores the order the messages were logged in
+// and writes them out (errors and warnings to stderr, the rest to stdout). A
+// message is held back while one logged before it is still being pushed.
+namespace logging {
+
+namespace detail {
+extern std::atomic<int> threshold;
+void submit(LogLevel level, std::string message);
+} // namespace detail
+
+void setLevel(LogLevel level);
+
+// Sends every message to stderr, for commands whose stdout carries data
+void writeAllToStderr();
+
+inline bool enabled(LogLevel level) {
+    return static_cast<int>(level) <= detail::threshold.load(std::memory_order_relaxed);
+}
+
+// Blocks until everything logged so far has been written. Commands call it
+// before printing their own output, so the two do not interleave.
+void flush();
+
+template <typename... Parts>
+void write(LogLevel level, Parts&&... parts) {
+    if (enabled(level)) {
+        std::ostringstream message;
+        (message << ... << std::forward<Parts>(parts));
+        detail::submit(level, message.str());
+    }
+}
+
+template <typename... Parts>
+void error(Parts&&... parts) {
+    write(LogLevel::ERROR, std::forward<Parts>(parts)...);
+}
+
+template <typename... Parts>
+void warning(Parts&&... parts) {
+    write(LogLevel::WARNING, std::forward<Parts>(parts)...);
+}
+
+template <typename... Parts>
+void info(Parts&&... parts) {
+    write(LogLevel::INFO, std::forward<Parts>(parts)...);
+}
+
+template <typename... Parts>
+void debug(Parts&&... parts) {
+    write(LogLevel::DEBUG, std::forward<Parts>(parts)...);
+}
+
+} // namespace logging
+} // namespace devpilot
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace devpilot {
+namespace memory {
+
+// Where heap memory goes during an index run. Allocations are attributed to
+// the subsystem tag the allocating thread has set, and freed under that same
+// tag whichever thread frees them. Counting needs the global allocator hook
+// (src/allocation_hook.cpp, built with -DENABLE_MEMORY_ACCOUNTING=ON);
+// without it, phases still report peak resident memory.
+
+enum class MemoryTag {
+    OTHER,
+    READER,       // Reads of files too big for the (malloc'd) buffer pool
+    PARSER,       // Lexer and scanner state and the parse results they build
+    PARSE_CACHE,  // Encoding and decoding cached parse results
+    SYMBOLS,      // Symbol ids and the call resolver's tables
+    INDEXES       // Occurrence postings, include resolution and graph
+};
+
+constexpr size_t kMemoryTagCount = 6;
+
+const char* memoryTagName(MemoryTag tag);
+
+namespace detail {
+extern thread_local MemoryTag currentTag;
+extern bool hookInstalled;
+extern std::atomic<bool> active;
+
+// Called by the allocator hook; these never allocate. recordAllocation
+// returns the tag to store with the block, or kUncounted.
+constexpr uint32_t kUncounted = 0xFFFFFFFF;
+uint32_t recordAllocation(size_t size);
+void recordFree(uint32_t tag, size_t size);
+} // namespace detail
+
+// Attributes this thread's allocations to `tag` until destroyed
+class TagScope {
+public:
+    explicit TagScope(MemoryTag tag) : previous(detail::currentTag) { detail::currentTag = tag; }
+    ~TagScope() { detail::currentTag = previous; }
+
+    TagScope(const TagScope&) = delete;
+    TagScope& operator=(const TagScope&) = delete;
+
+private:
+    MemoryTag previous;
+};
+
+// True when the allocator hook is linked in, so allocations can be counted
+bool accountingAvailable();
+
+// Starts counting allocations and recording phases. Blocks allocated before
+// this are never counted, not even when freed.
+void enable();
+bool enabled();
+
+struct TagUsage {
+    int64_t liveBytes = 0;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+};
+
+struct Usage {
+    TagUsage tags[kMemoryTagCount];
+    uint64_t sqliteBytes = 0;      // SQLite allocates through malloc, not new
+    uint64_t sqlitePeakBytes = 0;  // Since enable() or the last phase began
+
+    int64_t liveBytes() const;
+    uint64_t allocations() const;
+};
+
+Usage currentUsage();
+
+// One stretch of an index run: the highest resident memory reached during
+// it, and the heap as it was left
+struct PhaseUsage {
+    std::string name;
+    uint64_t peakResidentBytes = 0;
+    uint64_t sqlitePeakBytes = 0;
+    int64_t liveBytes = 0;     // At the end of the phase
+    uint64_t allocations = 0;  // Made during the phase
+};
+
+// Records one phase from construction to destruction. Phases run one after
+// another, on one thread; a no-op until enable().
+class Phase {
+public:
+    explicit Phase(const char* name);
+    ~Phase();
+
+    Phase(const Phase&) = delete;
+    Phase& operator=(const Phase&) = delete;
+
+private:
+    const char* name;
+    uint64_t startAllocations = 0;
+};
+
+std::vector<PhaseUsage> phaseUsage();
+
+} // namespace memory
+} // namespace devpilot
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "parser.hpp"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace devpilot {
+
+struct Occurrence {
+    uint32_t file_id;
+    int line_number;
+    int column_number;
+};
+
+// In-memory inverted index from identifier name to every place it occurs.
+// Each name's posting list is a byte string of varint deltas:
+//   file delta, then line (delta within the same file), then column
+// so a typical occurrence costs three bytes.
+class OccurrenceIndex {
+public:
+    // Files must be added in increasing file id order
+    void addFile(uint32_t fileId, const std::vector<std::string_view>& names,
+                 const std::vector<IdentifierOccurrence>& occurrences);
+
+    size_t nameCount() const;
+    uint64_t occurrenceCount() const;
+    uint64_t encodedBytes() const;
+    uint64_t bufferedBytes() const;  // Encoded but not yet flushed
+    // Heap held for names and their lists whatever is flushed; an estimate
+    size_t memoryBytes() const;
+
+    // Continues an index already in storage: each name keeps the id it was
+    // stored under (ids must come in increasing order), and segments are
+    // numbered on from the next one free
+    void restoreName(uint32_t nameId, std::string_view name);
+    void startSegment(int next);
+
+    // Hand every non-empty posting list to visitor as the next segment, then
+    // start the lists afresh. Each segment decodes on its own; readers
+    // concatenate segments in order. Name ids are kept across flushes.
+    void flush(const std::function<void(uint32_t nameId, const std::string& name, int segment,
+                                        uint64_t count, const std::string& postings)>& visitor);
+
+    static bool decode(const void* data, size_t size, std::vector<Occurrence>& out);
+
+private:
+    struct PostingList {
+        std::string bytes;
+        uint32_t lastFile = 0;
+        uint32_t lastLine = 0;
+        uint64_t count = 0;
+    };
+
+    std::unordered_map<std::string_view, uint32_t> nameIds;  // Keys view into names
+    std::deque<std::string> names;  // By name id - 1; a deque so keys stay valid
+    std::vector<PostingList> postings;
+    uint64_t totalOccurrences = 0;
+    uint64_t totalBytes = 0;
+    uint64_t pendingBytes = 0;
+    size_t nameBytes = 0;
+    int segment = 0;
+
+    static size_t entryBytes(const std::string& name);
+};
+
+} // namespace devpilot
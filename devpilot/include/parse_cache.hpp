@@ -0,0 +1,71 @@
+#pragma once
+
+#include "parser.hpp"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace devpilot {
+
+// Persistent store of parse results addressed by a hash of the file contents,
+// shared by every checkout on the machine. Identical files in other worktrees
+// or vendored copies are read back instead of being parsed again.
+//
+// Each entry is one small file, <dir>/<first two hex digits>/<hash>, holding a
+// header (magic, parser version, payload size and hash) and the varint-encoded
+// ParseResult. Entries carry no file path, so a hit is valid at any location.
+// Git blob ids map onto the same entries through tiny alias files, which lets
+// a branch switch reuse results for every blob indexed before.
+// Recency is the entry's modification time, which a hit refreshes; evict()
+// removes the least recently used entries once the store exceeds its budget.
+// load() and store() may be called from several threads at once.
+class ParseCache {
+public:
+    ParseCache(const std::string& directory, uint64_t maxBytes);
+
+    // $DEVPILOT_CACHE_DIR, else $XDG_CACHE_HOME/devpilot, else ~/.cache/devpilot
+    static std::string defaultDirectory();
+
+    // Cache key for a file: its hashContent(), rehashed with the parser
+    // version and the depth it was parsed to
+    static uint64_t key(uint64_t contentHash, ParseDepth depth = ParseDepth::FULL);
+
+    bool enabled() const;
+
+    // On a hit fills result, stamping filePath onto every symbol
+    bool load(uint64_t key, std::string_view filePath, ParseResult& result);
+    void store(uint64_t key, const ParseResult& result);
+
+    // The raw entry, header included, for carrying it to another machine.
+    // storeEntry() rejects entries that fail the header checks.
+    bool loadEntry(uint64_t key, std::string& entry);
+    bool storeEntry(uint64_t key, const std::string& entry);
+
+    // Git blob id -> cache key, so a clean tracked file can be looked up
+    // without reading it. Stored under <dir>/git/.
+    bool loadBlobKey(const std::string& blobId, uint64_t& key);
+    void storeBlobKey(const std::string& blobId, uint64_t key);
+
+    // Trim least recently used entries until the store fits in maxBytes
+    void evict();
+
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+private:
+    std::string directory;
+    uint64_t maxBytes;
+    bool usable;
+    std::atomic<uint64_t> hitCount;
+    std::atomic<uint64_t> missCount;
+
+    static uint64_t keySeed(ParseDepth depth);
+    std::string pathFor(uint64_t key) const;
+    std::string blobPathFor(const std::string& blobId) const;
+    bool readEntry(uint64_t key, std::string& entry);
+    bool writeAtomically(const std::string& path, const std::string& header,
+                         const std::string& payload);
+};
+
+} // namespace devpilot
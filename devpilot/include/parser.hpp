@@ -1,7 +1,10 @@
 #pragma once
 
+#include "arena.hpp"
 #include "symbol.hpp"
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 // Forward declarations for TreeSitter
@@ -11,13 +14,86 @@ typedef struct TSNode TSNode;
 
 namespace devpilot {
 
+// String members of the records below are views into ParseResult::arena
+
+struct IncludeDirective {
+    std::string_view path;    // Spelling between the quotes or angle brackets
+    bool is_system;      // <...> form
+    int line_number;
+};
+
+struct IdentifierOccurrence {
+    uint32_t name_index;  // Into ParseResult::identifier_names
+    int line_number;
+    int column_number;
+};
+
+// A call expression inside a function body, before resolution to a symbol
+struct CallSite {
+    uint32_t caller_index;  // Into ParseResult::symbols (the enclosing definition)
+    std::string_view callee_name;
+    std::string_view qualifier;  // Written scope, e.g. "geometry::Matrix" for geometry::Matrix::add(...)
+    bool is_member;         // Called through "." or "->"
+    int arg_count;
+    int line_number;
+    int column_number;
+};
+
+// Everything extracted from a single file in one parse. Move-only: the arena
+// owns every string the records point at, except file paths, which refer to
+// the path passed to the parser.
+struct ParseResult {
+    StringArena arena;
+    std::vector<SymbolRecord> symbols;
+    std::vector<IncludeDirective> includes;
+    std::vector<CallSite> calls;
+    std::vector<std::string_view> identifier_names;  // Distinct identifiers in this file
+    std::vector<IdentifierOccurrence> occurrences;  // Every non-keyword identifier, in source order
+    uint64_t content_hash = 0;  // hashContent() of the file, which symbol offsets refer to
+};
+
+// How much of a file is indexed
+enum class ParseDepth {
+    FULL,          // Declarations, calls and identifier occurrences
+    DECLARATIONS,  // Declarations and includes only
+    SKIP           // Nothing; the file is still recorded
+};
+
+// Per-file depth by size, so huge generated sources can be indexed lightly.
+// A limit of 0 never applies.
+struct SizePolicy {
+    uint64_t declarationsAbove = 16ull << 20;
+    uint64_t skipAbove = 0;
+
+    ParseDepth depthFor(uint64_t size) const;
+};
+
 class CppParser {
 public:
     CppParser();
     ~CppParser();
     
+    // Bump whenever the same source would produce a different ParseResult,
+    // so results cached by content hash are not reused across versions
+    static constexpr uint32_t kVersion = 3;
+    
+    // Files above this size are parsed as a stream of chunks of this size
+    static constexpr size_t kStreamAbove = 8 << 20;
+    static constexpr size_t kStreamChunkSize = 1 << 20;
+    
     // Single responsibility: Only parse C++ files using TreeSitter
     std::vector<Symbol> parseFile(const std::string& filePath);
+    ParseResult parse(const std::string& filePath);
+    // Symbols refer to filePath, which must outlive the result (see StringTable)
+    ParseResult parseSource(std::string_view source, std::string_view filePath,
+                            ParseDepth depth = ParseDepth::FULL);
+    // Reads the file chunk by chunk, so memory does not grow with its size
+    ParseResult parseStream(const std::string& path, std::string_view filePath,
+                            ParseDepth depth = ParseDepth::FULL,
+                            size_t chunkSize = kStreamChunkSize);
+    
+    // Read file contents (empty when unreadable)
+    std::string readFile(const std::string& filePath);
     
     // Check if parser is properly initialized
     bool isInitialized() const;
@@ -28,9 +104,8 @@ private:
     bool initialized;
     
     // Fallback parser for when TreeSitter C++ grammar is not available
-    std::vector<Symbol> parseWithFallback(const std::string& source, const std::string& filePath);
-    void extractFunctionsFromText(const std::string& source, const std::string& filePath, std::vector<Symbol>& symbols);
-    void extractClassesFromText(const std::string& source, const std::string& filePath, std::vector<Symbol>& symbols);
+    void parseWithFallback(std::string_view source, std::string_view filePath, ParseDepth depth,
+                           ParseResult& result);
     
 #ifdef HAVE_TREE_SITTER
     // TreeSitter parsing methods
@@ -48,9 +123,6 @@ private:
     std::string getNodeType(TSNode node);
     bool isNodeType(TSNode node, const std::string& type);
 #endif
-    
-    // Read file contents
-    std::string readFile(const std::string& filePath);
 };
 
 } // namespace devpilot
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace devpilot {
+
+// Scheduling classes, most urgent first
+enum class TaskPriority {
+    FOREGROUND,  // Asked for by the user (files open in the editor)
+    RECENT,      // Recently changed, so likely to be looked at next
+    BULK         // Everything else; gives way to queries
+};
+
+constexpr size_t kTaskPriorityCount = 3;
+
+inline const char* taskPriorityName(TaskPriority priority) {
+    switch (priority) {
+        case TaskPriority::FOREGROUND: return "foreground";
+        case TaskPriority::RECENT: return "recent";
+        case TaskPriority::BULK: return "bulk";
+    }
+    return "bulk";
+}
+
+// Per-class counters. Latency runs from push() to finished(); throughput is
+// tasks over the span from the class's first push to its last finish.
+struct PriorityStats {
+    uint64_t tasks = 0;
+    std::chrono::nanoseconds totalLatency{0};
+    std::chrono::nanoseconds maxLatency{0};
+    std::chrono::nanoseconds span{0};
+};
+
+// Worker pool queue with priority classes. Each worker owns one deque per
+// class; producers spread tasks over the workers' deques, and a worker takes
+// from its own and steals from the others' when it runs dry. Both take the
+// oldest task, so tasks queued behind one long parse are stolen rather than
+// stranded. A worker always takes from the most urgent class that has work
+// anywhere, and before starting a bulk task it calls the yield hook, which
+// may block while something more important (a query) is running. Like
+// WorkQueue, a capacity bounds the tasks waiting across all deques.
+template <typename T>
+class PriorityScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    PriorityScheduler(unsigned workerCount, size_t capacity) : capacity(capacity) {
+        for (unsigned i = 0; i < std::max(1u, workerCount); i++) {
+            workers.push_back(std::make_unique<Worker>());
+        }
+    }
+
+    // Called without locks; returns once bulk work may proceed, true if it
+    // had to wait for that
+    void setYield(std::function<bool()> hook) { yield = std::move(hook); }
+
+    void push(T item, TaskPriority priority) {
+        size_t level = static_cast<size_t>(priority);
+        size_t target;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            space.wait(lock, [this] { return capacity == 0 || waiting + pushing < capacity || closed; });
+            pushing++;
+            target = nextWorker++ % workers.size();
+        }
+        Clock::time_point now = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(workers[target]->mutex);
+            workers[target]->tasks[level].push_back({std::move(item), now});
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pushing--;
+            waiting++;
+            queued[level]++;
+            if (!started[level]) {
+                started[level] = true;
+                firstPush[level] = now;
+            }
+        }
+        available.notify_one();
+    }
+
+    // Returns false once the scheduler is closed and drained. The task counts
+    // as running on this worker until its finished() call.
+    bool pop(unsigned worker, T& item) {
+        size_t level = 0;
+        bool yielded = false;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                available.wait(lock, [this] { return waiting != 0 || closed; });
+                if (waiting == 0) {
+                    return false;
+                }
+                level = 0;
+                while (queued[level] == 0) {
+                    level++;
+                }
+                if (level != static_cast<size_t>(TaskPriority::BULK) || yielded || !yield) {
+                    // Reserved: an item of this class is now guaranteed to be ours
+                    queued[level]--;
+                    waiting--;
+                    break;
+                }
+            }
+            // Urgent work that arrives while this waits is picked up on the retry
+            Clock::time_point start = Clock::now();
+            if (yield()) {
+                yieldTime.fetch_add((Clock::now() - start).count(), std::memory_order_relaxed);
+            }
+            yielded = true;
+        }
+        space.notify_one();
+
+        Worker& own = *workers[worker % workers.size()];
+        Task task;
+        bool found = take(own, level, task);
+        for (size_t i = 1; !found && i < workers.size(); i++) {
+            found = take(*workers[(worker + i) % workers.size()], level, task);
+            if (found) {
+                steals.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        item = std::move(task.item);
+        own.running = level;
+        own.queuedAt = task.queuedAt;
+        return true;
+    }
+
+    void finished(unsigned worker) {
+        Worker& own = *workers[worker % workers.size()];
+        Clock::time_point now = Clock::now();
+        std::chrono::nanoseconds latency = now - own.queuedAt;
+        std::lock_guard<std::mutex> lock(mutex);
+        PriorityStats& counters = stats[own.running];
+        counters.tasks++;
+        counters.totalLatency += latency;
+        counters.maxLatency = std::max(counters.maxLatency, latency);
+        counters.span = now - firstPush[own.running];
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        available.notify_all();
+        space.notify_all();
+    }
+
+    PriorityStats statsFor(TaskPriority priority) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats[static_cast<size_t>(priority)];
+    }
+    uint64_t stealCount() const { return steals.load(std::memory_order_relaxed); }
+    std::chrono::nanoseconds yieldedTime() const {
+        return std::chrono::nanoseconds(yieldTime.load(std::memory_order_relaxed));
+    }
+
+private:
+    struct Task {
+        T item;
+        Clock::time_point queuedAt;
+    };
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks[kTaskPriorityCount];
+        // The task being run; only its own thread touches these
+        size_t running = 0;
+        Clock::time_point queuedAt;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::function<bool()> yield;
+
+    mutable std::mutex mutex;
+    std::condition_variable available;
+    std::condition_variable space;
+    size_t capacity;
+    size_t queued[kTaskPriorityCount] = {};  // Pushed and not yet reserved, per class
+    size_t waiting = 0;  // Sum of queued
+    size_t pushing = 0;  // Admitted by the capacity check, not yet in a deque
+    size_t nextWorker = 0;
+    bool closed = false;
+    bool started[kTaskPriorityCount] = {};
+    Clock::time_point firstPush[kTaskPriorityCount];
+    PriorityStats stats[kTaskPriorityCount];
+
+    std::atomic<uint64_t> steals{0};
+    std::atomic<int64_t> yieldTime{0};
+
+    static bool take(Worker& worker, size_t level, Task& task) {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        auto& tasks = worker.tasks[level];
+        if (tasks.empty()) {
+            return false;
+        }
+        task = std::move(tasks.front());
+        tasks.pop_front();
+        return true;
+    }
+};
+
+} // namespace devpilot
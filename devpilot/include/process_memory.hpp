@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+namespace devpilot {
+
+// Resident set size of this process in bytes; 0 where it cannot be read
+uint64_t currentResidentBytes();
+
+// Highest resident set size reached so far, in bytes; 0 where unsupported
+uint64_t peakResidentBytes();
+
+// Highest resident set size since the last resetResidentHighWater(), for
+// measuring one phase of a run; peakResidentBytes() where that cannot be reset
+uint64_t residentHighWaterBytes();
+bool resetResidentHighWater();
+
+} // namespace devpilot
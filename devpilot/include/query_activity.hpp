@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+namespace devpilot {
+
+// Lets background indexing give way to queries answered by another process
+// on the same database. Queries hold a shared lock on "<database>-query"
+// while they run; indexing checks it before each bulk file and waits while
+// any query holds it. Where file locks are unavailable both sides are no-ops.
+class QueryActivity {
+public:
+    explicit QueryActivity(const std::string& databasePath);
+    ~QueryActivity();
+    QueryActivity(const QueryActivity&) = delete;
+    QueryActivity& operator=(const QueryActivity&) = delete;
+
+    // Query side: bracket each query
+    void beginQuery();
+    void endQuery();
+
+    // Indexing side: returns at once when no query runs, else after they all
+    // finish; true if it had to wait. Safe to call from several threads.
+    bool waitForQueries();
+
+private:
+    std::string lockPath;
+    int fd = -1;  // Held by the query side
+};
+
+} // namespace devpilot
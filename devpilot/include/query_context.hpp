@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace devpilot {
+
+// Set from any thread to abandon the queries that watch it
+class CancellationToken {
+public:
+    void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+    bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> cancelled{false};
+};
+
+// Bounds one query by a deadline and/or a cancellation token. Queries that
+// take a context stop as soon as shouldStop() says so and return what they
+// have collected, with `truncated` set so callers can tell partial from empty.
+// A query that fails instead, say on a locked database, sets `failed` and
+// `error`; its results are then not to be trusted, not even as partial.
+// A context belongs to the thread running the query; only the token is shared.
+struct QueryContext {
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point deadline = Clock::time_point::max();
+    const CancellationToken* token = nullptr;
+    bool truncated = false;
+    bool failed = false;
+    std::string error;
+
+    QueryContext() = default;
+    explicit QueryContext(std::chrono::milliseconds timeout, const CancellationToken* token = nullptr);
+
+    // True, and marks the results truncated, once the deadline has passed or
+    // the token was cancelled. Cheap enough to call every few hundred items.
+    bool shouldStop();
+
+    // Records the first error; later ones are usually its consequences
+    void fail(const std::string& message);
+};
+
+// For loops over a query's results: asks the context every `interval` items
+inline bool shouldStopEvery(QueryContext* context, size_t item, size_t interval = 256) {
+    return context && item % interval == 0 && context->shouldStop();
+}
+
+} // namespace devpilot
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "query_context.hpp"
+#include "storage.hpp"
+#include "symbol.hpp"
+#include "work_queue.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace devpilot {
+
+// An index may be split into shards, each a database of its own with its
+// own writer, so indexing writes several at once. The database named on the
+// command line then holds only the manifest (metadata "shard_count" and
+// "shard_scheme"); shard k lives next to it in "<database>.shard<k>".
+//
+// File and symbol ids are interleaved across shards: shard k's local id n
+// is n * count + k everywhere outside that shard, so any id tells which
+// shard owns it. With one shard both are the same number.
+
+enum class ShardScheme {
+    DIRECTORY,  // By top-level directory, which keeps a component's calls together
+    PATH_HASH   // By the hash of the whole path, which balances any tree
+};
+
+constexpr unsigned kMaxShards = 64;
+
+const char* shardSchemeName(ShardScheme scheme);
+bool parseShardScheme(const std::string& name, ShardScheme& scheme);
+
+std::string shardPath(const std::string& databasePath, unsigned shard);
+
+// Deletes shard files from number first on, left over from an index that
+// was split more ways (first = 0 when it is no longer sharded at all)
+void removeShards(const std::string& databasePath, unsigned first);
+
+// relativePath is the file's path below the project root
+unsigned shardFor(std::string_view relativePath, ShardScheme scheme, unsigned count);
+
+inline int64_t globalShardId(int64_t localId, unsigned shard, unsigned count) {
+    return localId * count + shard;
+}
+inline unsigned shardOfId(int64_t globalId, unsigned count) {
+    return static_cast<unsigned>(globalId % count);
+}
+inline int64_t localShardId(int64_t globalId, unsigned count) {
+    return globalId / count;
+}
+
+// Single responsibility: Only answer queries over every shard of an index.
+// The query methods match SqliteStorage's. Each shard has a connection and
+// a thread of its own; a query runs on all of them at once and the sorted
+// per-shard results are merged. An unsharded index is queried directly on
+// the calling thread. Like SqliteStorage, one instance serves one thread at
+// a time.
+class ShardedStorage {
+public:
+    ShardedStorage() = default;
+    ~ShardedStorage();
+
+    ShardedStorage(const ShardedStorage&) = delete;
+    ShardedStorage& operator=(const ShardedStorage&) = delete;
+
+    // Opens the database at dbPath and, if it is a manifest, its shards,
+    // all read-only. Fails without creating anything when there is no
+    // current index; openError() then says what to do.
+    bool open(const std::string& dbPath);
+    void close();
+    SqliteStorage::OpenFailure openFailure() const { return failure; }
+    const std::string& openError() const { return failureMessage; }
+    unsigned shardCount() const { return static_cast<unsigned>(shards.size()); }
+    uint64_t indexStamp() const { return stamp; }
+
+    std::vector<Symbol> searchSymbols(const std::string& query, QueryContext* context = nullptr);
+    std::vector<std::vector<Symbol>> lookupSymbols(const std::vector<std::string>& names,
+                                                   QueryContext* context = nullptr);
+    std::vector<std::vector<Symbol>> getSymbolsInFiles(const std::vector<std::string>& filePaths,
+                                                       QueryContext* context = nullptr);
+    std::vector<std::string> getSymbolUsages(const std::string& symbolName,
+                                             QueryContext* context = nullptr);
+    std::vector<std::string> getSymbolCallees(const std::string& symbolName,
+                                              QueryContext* context = nullptr);
+    std::vector<int64_t> findFiles(const std::string& filePath, QueryContext* context = nullptr);
+    std::string getFilePath(int64_t fileId);
+    std::vector<std::string> getTransitiveDependents(int64_t fileId, QueryContext* context = nullptr);
+    std::vector<SymbolReference> getReferences(const std::string& name,
+                                               QueryContext* context = nullptr);
+    
+    // By global id. The scan goes shard by shard on the calling thread.
+    bool scanSymbols(const std::function<void(int64_t id, const Symbol& symbol)>& onSymbol);
+    bool getSymbol(int64_t id, Symbol& symbol);
+
+private:
+    struct Shard {
+        SqliteStorage storage;
+        WorkQueue<std::function<void()>> tasks;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    uint64_t stamp = 0;  // The manifest's, for a sharded index
+    SqliteStorage::OpenFailure failure = SqliteStorage::OpenFailure::NONE;
+    std::string failureMessage;
+
+    SqliteStorage& owner(int64_t globalId) { return shards[shardOfId(globalId, shardCount())]->storage; }
+
+    // Runs query on every shard, each with its own copy of context, and
+    // returns the results by shard
+    template <typename Result>
+    std::vector<Result> fanOut(const std::function<Result(SqliteStorage&, QueryContext*)>& query,
+                               QueryContext* context);
+};
+
+} // namespace devpilot
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "symbol.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace devpilot {
+
+enum class SnippetStatus {
+    OK,
+    MISSING,  // The file cannot be opened
+    STALE     // The file changed since it was indexed, so the offsets are meaningless
+};
+
+// Reads symbol text back from the source files on demand. The index stores
+// only each declaration's byte range and its file's content hash; a file is
+// mapped and hashed the first time one of its symbols is asked for, and kept
+// mapped for the reader's lifetime so further symbols from it cost nothing.
+class SnippetReader {
+public:
+    SnippetReader() = default;
+    ~SnippetReader();
+    SnippetReader(const SnippetReader&) = delete;
+    SnippetReader& operator=(const SnippetReader&) = delete;
+
+    // The whole declaration as written, body included
+    SnippetStatus text(const Symbol& symbol, std::string_view& text);
+
+    // The declaration up to its body or initializer, on one line
+    SnippetStatus signature(const Symbol& symbol, std::string& signature);
+
+private:
+    struct MappedFile {
+        const char* data = nullptr;
+        size_t size = 0;
+        bool mapped = false;  // Else data is owned by contents
+        std::string contents;
+        SnippetStatus status = SnippetStatus::MISSING;
+        uint64_t hash = 0;
+    };
+    std::unordered_map<std::string, MappedFile> files;
+
+    const MappedFile& open(const std::string& path);
+};
+
+// Cuts a declaration's text before its body (or initializer, member-init list
+// or "= 0"), collapsing whitespace so multi-line declarations read as one line
+std::string signatureOf(SymbolType type, std::string_view declaration);
+
+} // namespace devpilot
@@ -1,7 +1,12 @@
 #pragma once
 
+#include "query_context.hpp"
 #include "symbol.hpp"
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 
@@ -11,54 +16,209 @@ struct sqlite3_stmt;
 
 namespace devpilot {
 
+struct CallSite;
+struct IncludeDirective;
+
 class SqliteStorage {
 public:
     SqliteStorage();
     ~SqliteStorage();
     
+    // Writers create the schema or bring it up to date (PRAGMA user_version
+    // says which). Readers open a current database read-only, with no DDL
+    // and with memory-mapped reads; storing through them fails. A reader
+    // never creates or migrates a database: it fails, saying why.
+    enum class OpenMode { READ_WRITE, READ_ONLY };
+    
+    // Why the last initialize() failed
+    enum class OpenFailure {
+        NONE,
+        NO_INDEX,  // Nothing indexed at the path yet
+        OUTDATED,  // Written by an older devpilot; re-indexing rebuilds it
+        ERROR      // Unreadable or not a database
+    };
+    
+    // Bumped whenever createTables() changes what it creates. A database at
+    // this version is opened without running any DDL.
+    static constexpr int kSchemaVersion = 4;
+    
     // Single responsibility: Only handle SQLite database operations
-    bool initialize(const std::string& dbPath);
+    bool initialize(const std::string& dbPath, OpenMode mode = OpenMode::READ_WRITE);
     void close();
     
-    // Symbol operations
-    bool storeSymbol(const Symbol& symbol);
-    std::vector<Symbol> searchSymbols(const std::string& query);
-    std::vector<Symbol> getSymbolsInFile(const std::string& filePath);
-    std::vector<Symbol> getAllSymbols();
+    // Queries take an optional context with a deadline and cancellation
+    // token; when it runs out they return the rows found so far and set
+    // context->truncated.
+    
+    // Symbol operations (storeSymbol returns the new row id, 0 on failure)
+    int64_t storeSymbol(const SymbolRecord& symbol);
+    std::vector<Symbol> searchSymbols(const std::string& query, QueryContext* context = nullptr);
+    std::vector<Symbol> getSymbolsInFile(const std::string& filePath, QueryContext* context = nullptr);
+    std::vector<Symbol> getAllSymbols(QueryContext* context = nullptr);
+    
+    // Every symbol with its row id, in id order, without holding them all
+    bool scanSymbols(const std::function<void(int64_t id, const Symbol& symbol)>& onSymbol);
+    bool getSymbol(int64_t id, Symbol& symbol);
+    
+    // Batch lookups resolve every key in one join against a temp table and
+    // return one group per key, in key order. Names match exactly, or like
+    // searchSymbols() when qualified; file paths as getSymbolsInFile().
+    std::vector<std::vector<Symbol>> lookupSymbols(const std::vector<std::string>& names,
+                                                   QueryContext* context = nullptr);
+    std::vector<std::vector<Symbol>> getSymbolsInFiles(const std::vector<std::string>& filePaths,
+                                                       QueryContext* context = nullptr);
+    
+    // Call graph operations (for usage tracking). Names may be qualified.
+    bool storeCallEdge(int64_t callerId, int64_t calleeId, int64_t fileId, int line);
+    bool storeUnresolvedCall(int64_t callerId, const std::string& calleeName, int64_t fileId, int line);
+    std::vector<std::string> getSymbolUsages(const std::string& symbolName,
+                                             QueryContext* context = nullptr);
+    std::vector<std::string> getSymbolCallees(const std::string& symbolName,
+                                              QueryContext* context = nullptr);
+    
+    // A call between symbols in two shards of a sharded index is stored in
+    // both, naming the far end, so either shard answers on its own:
+    // outgoing when symbolId (of this shard) is the caller
+    bool storeRemoteCall(int64_t symbolId, bool outgoing, const std::string& remoteName,
+                         const std::string& filePath, int line);
+    
+    // File graph operations (for dependency tracking). storeFile returns the
+    // file's id: fileId when given, else a new one. blobId is the git object
+    // the file was read as, empty when it was not clean in the git index.
+    int64_t storeFile(const std::string& filePath, uint64_t contentHash, int64_t fileId = 0,
+                      std::string_view blobId = std::string_view());
+    bool setFileBlob(int64_t fileId, std::string_view blobId);
+    bool storeInclude(int64_t includerId, int64_t includedId, int line);
+    bool storeReverseDependencies(int64_t fileId, const std::string& serializedBitset);
+    std::vector<int64_t> findFiles(const std::string& filePath, QueryContext* context = nullptr);
+    std::string getFilePath(int64_t fileId);  // Empty once the file is gone
+    std::vector<std::string> getTransitiveDependents(int64_t fileId, QueryContext* context = nullptr);
+    std::vector<uint32_t> getTransitiveDependentIds(int64_t fileId, QueryContext* context = nullptr);
+    
+    // Identifier occurrence postings (for find-references). References come
+    // sorted by path, line and column; occurrences in files deleted since
+    // their segment was written are left out.
+    bool storePostings(int64_t nameId, const std::string& name, int segment,
+                       int64_t occurrenceCount, const std::string& postings);
+    std::vector<SymbolReference> getReferences(const std::string& name,
+                                               QueryContext* context = nullptr);
+    
+    // What a file was parsed into that resolution needs again when only
+    // other files change: its include directives and call sites, the
+    // caller as a symbol id
+    bool storeIncludeDirective(int64_t fileId, const IncludeDirective& include);
+    bool storeCallSite(int64_t callerId, int64_t fileId, const CallSite& call);
+    
+    // For updating an index in place: a file's own rows (its file row,
+    // symbols, include directives and call sites) are deleted together, and
+    // the scans read back what the files left alone contributed. Views last
+    // until the callback returns.
+    bool deleteFile(int64_t fileId, const std::string& filePath);
+    bool scanFiles(const std::function<void(int64_t id, std::string_view path, uint64_t contentHash,
+                                            std::string_view blobId)>& onFile);
+    bool scanIncludeDirectives(const std::function<void(int64_t fileId, const IncludeDirective&)>& onInclude);
+    bool scanCallSites(const std::function<void(int64_t callerId, int64_t fileId, const CallSite&)>& onCall);
+    bool scanIdentifiers(const std::function<void(int64_t nameId, std::string_view name)>& onName);
+    int nextPostingSegment();  // 0 when there are no postings
+    
+    // Index metadata (key/value, cleared with the rest of the database)
+    bool setMetadata(const std::string& key, const std::string& value);
+    std::string getMetadata(const std::string& key);
+    
+    // A random number replaced whenever the index is rewritten, so files
+    // derived from it (the vector index) can tell they are stale; 0 if never
+    bool stampIndex();
+    uint64_t indexStamp();
+    
+    // Model summaries by the hash of the text summarized and the backend
+    // that wrote them. Not part of the index: clearing it keeps them.
+    bool getSummary(uint64_t bodyHash, const std::string& backend, std::string& summary);
+    bool storeSummary(uint64_t bodyHash, const std::string& backend, const std::string& summary);
+    
+    // Whole-table copies, for moving an index between machines. A value is
+    // what SQLite stored; its bytes last until the callback returns.
+    struct TableValue {
+        enum class Type { NULL_VALUE, INTEGER, TEXT, BLOB };
+        Type type = Type::NULL_VALUE;
+        int64_t integer = 0;
+        std::string_view bytes;
+    };
+    struct IndexTable {
+        const char* name;
+        std::vector<const char*> columns;
+    };
+    
+    // Every table of an index but metadata, in the order to copy them
+    static const std::vector<IndexTable>& indexTables();
+    static const IndexTable* findIndexTable(std::string_view name);
+    bool readTable(const IndexTable& table,
+                   const std::function<void(const std::vector<TableValue>&)>& onRow);
+    // Inserts rows until nextRow returns false, which it may also do on
+    // error. Meant for loading a whole table in one call.
+    bool writeRows(const IndexTable& table, const std::function<bool(std::vector<TableValue>&)>& nextRow);
+    // Leaves the table holding exactly the rows given, as a set: rows it
+    // already has are left alone, and only the others are deleted or
+    // inserted. For derived tables that mostly stay the same between runs.
+    bool syncRows(const IndexTable& table, const std::function<bool(std::vector<TableValue>&)>& nextRow);
     
-    // Call relationship operations (for usage tracking)
-    bool storeCallRelationship(const std::string& caller, const std::string& callee,
-                              const std::string& file, int line);
-    std::vector<std::string> getSymbolUsages(const std::string& symbolName);
-    std::vector<std::string> getSymbolCallees(const std::string& symbolName);
+    // Transactions (bulk indexing)
+    bool beginTransaction();
+    bool commitTransaction();
+    bool rollbackTransaction();
     
     // Database management
     bool clearDatabase();
     bool isInitialized() const;
+    bool isReadOnly() const { return readOnly; }
+    OpenFailure openFailure() const { return failure; }
+    const std::string& openError() const { return failureMessage; }  // What to do about it
     
 private:
     sqlite3* db;
     bool initialized;
+    bool readOnly;
+    OpenFailure failure = OpenFailure::NONE;
+    std::string failureMessage;
     
-    // Prepared statements for performance
-    sqlite3_stmt* insertSymbolStmt;
-    sqlite3_stmt* searchSymbolStmt;
-    sqlite3_stmt* getSymbolsInFileStmt;
-    sqlite3_stmt* insertCallStmt;
-    sqlite3_stmt* getUsagesStmt;
+    // Every statement this class runs. Each is prepared the first time it is
+    // needed and kept, so a command pays only for the queries it makes.
+    enum class Statement {
+        INSERT_SYMBOL, SEARCH_SYMBOLS, SEARCH_QUALIFIED, SYMBOLS_IN_FILE, ALL_SYMBOLS,
+        SCAN_SYMBOLS, GET_SYMBOL,
+        INSERT_LOOKUP_KEY, LOOKUP_SYMBOLS, LOOKUP_FILES,
+        INSERT_CALL, INSERT_UNRESOLVED_CALL, INSERT_REMOTE_CALL, GET_USAGES, GET_CALLEES,
+        INSERT_FILE, SET_FILE_BLOB, INSERT_INCLUDE, INSERT_RDEPS, FIND_FILES, GET_FILE_PATH,
+        GET_DEPENDENTS, SCAN_FILES,
+        INSERT_IDENTIFIER, INSERT_POSTINGS, GET_POSTINGS, SCAN_IDENTIFIERS, NEXT_SEGMENT,
+        INSERT_DIRECTIVE, INSERT_CALL_SITE, SCAN_DIRECTIVES, SCAN_CALL_SITES,
+        DELETE_FILE, DELETE_FILE_SYMBOLS, DELETE_FILE_DIRECTIVES, DELETE_FILE_CALL_SITES,
+        SET_METADATA, GET_METADATA,
+        GET_SUMMARY, SET_SUMMARY,
+        COUNT
+    };
+    std::array<sqlite3_stmt*, static_cast<size_t>(Statement::COUNT)> statements;
     
     // Database setup
     void createTables();
-    void prepareStatements();
+    int schemaVersion();
+    bool failOpen(OpenFailure reason, const std::string& dbPath, const std::string& detail = "");
     void cleanupStatements();
     
     // Helper methods
+    static std::string statementSql(Statement which);
+    sqlite3_stmt* statement(Statement which);  // Reset and ready to bind; null on failure
     sqlite3_stmt* prepareStatement(const std::string& sql);
     Symbol createSymbolFromRow(sqlite3_stmt* stmt);
+    std::vector<std::vector<Symbol>> runBatchLookup(Statement which,
+                                                    const std::vector<std::string>& keys,
+                                                    bool qualifiedKeys, QueryContext* context);
     bool executeStatement(sqlite3_stmt* stmt);
+    bool executeSql(const char* sql, const std::string& operation);
+    bool hasColumn(const std::string& table, const std::string& column);
     
     // Error handling
     void logError(const std::string& operation);
+    bool finishQuery(int result, QueryContext* context, const std::string& operation);
 };
 
 } // namespace devpilot
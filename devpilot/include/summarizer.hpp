@@ -0,0 +1,128 @@
+#pragma once
+
+#include "storage.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace devpilot {
+
+struct SummaryRequest {
+    std::string name;  // Qualified name, for the prompt
+    std::string body;  // The definition as written
+};
+
+// Where summaries come from. A backend sees one batch at a time, from one
+// thread, and answers every request in it.
+class SummaryBackend {
+public:
+    virtual ~SummaryBackend() = default;
+
+    // Names the model and its settings; summaries are cached per backend
+    virtual std::string id() const = 0;
+
+    // One summary per request, in order; false when the model failed
+    virtual bool summarize(const std::vector<const SummaryRequest*>& batch,
+                           std::vector<std::string>& summaries) = 0;
+};
+
+// Runs a local executable (a llama.cpp runner behind a small wrapper, or a
+// stub for tests) through /bin/sh and keeps it running between batches. It
+// reads a batch as
+//   batch <count>\n
+//   <index>\t<name>\t<body bytes>\n<body>\n     (count times)
+// and, having read the whole batch, answers each request with one line, in
+// any order:
+//   <index>\t<summary>\n
+// If it exits or answers garbage, the batch fails and the next batch starts
+// it again.
+class ProcessBackend : public SummaryBackend {
+public:
+    explicit ProcessBackend(std::string command);
+    ~ProcessBackend() override;
+
+    ProcessBackend(const ProcessBackend&) = delete;
+    ProcessBackend& operator=(const ProcessBackend&) = delete;
+
+    std::string id() const override;
+    bool summarize(const std::vector<const SummaryRequest*>& batch,
+                   std::vector<std::string>& summaries) override;
+
+private:
+    std::string command;
+    int pid;
+    int socket;  // Both directions of the child's stdin and stdout
+    std::string received;
+
+    bool start();
+    void stop();
+    bool readLine(std::string& line);
+};
+
+struct SummarizerStats {
+    uint64_t requests = 0;
+    uint64_t cacheHits = 0;     // Found in the summaries table
+    uint64_t deduplicated = 0;  // Same body as a request already waiting or in flight
+    uint64_t summarized = 0;    // Answered by the model
+    uint64_t failed = 0;        // Sent to the model, which failed on them
+    uint64_t batches = 0;
+    size_t queueDepth = 0;      // Bodies waiting for the model right now
+    size_t maxQueueDepth = 0;
+    std::chrono::nanoseconds backendTime{0};
+};
+
+// Single responsibility: Only turn function bodies into summaries as cheaply
+// as possible. A body is looked up by its content hash in the summaries
+// table first; identical bodies asked for at once, by one caller or several,
+// go to the model once; the rest wait in a queue that one thread drains into
+// batches of up to batchSize, so a model call is shared by many requests.
+// New summaries are stored as each batch returns.
+class Summarizer {
+public:
+    Summarizer(SqliteStorage& cache, SummaryBackend& backend, size_t batchSize = 8);
+    ~Summarizer();
+
+    Summarizer(const Summarizer&) = delete;
+    Summarizer& operator=(const Summarizer&) = delete;
+
+    // Blocks until every request is answered; a summary is empty when the
+    // model failed on it. May be called from several threads at once.
+    std::vector<std::string> summarize(const std::vector<SummaryRequest>& requests);
+
+    SummarizerStats stats();
+
+private:
+    struct Job {
+        uint64_t hash;
+        SummaryRequest request;
+        std::promise<std::string> result;
+    };
+
+    SqliteStorage& cache;
+    SummaryBackend& backend;
+    std::string backendId;
+    size_t batchSize;
+
+    std::mutex cacheMutex;  // The storage serves one thread at a time
+
+    std::mutex mutex;  // Guards everything below
+    std::condition_variable available;
+    std::deque<std::unique_ptr<Job>> queue;
+    std::unordered_map<uint64_t, std::shared_future<std::string>> inFlight;
+    bool stopping;
+    SummarizerStats counters;
+    std::thread worker;
+
+    void run();
+};
+
+} // namespace devpilot
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace devpilot {
@@ -19,14 +21,23 @@ struct Symbol {
     std::string file_path;
     int line_number;
     int column_number;
-    std::string signature;
     std::string parent_scope;  // For methods inside classes
+    std::string qualified_name;  // e.g. "geometry::Matrix::add"
+    int param_count = -1;           // Functions only; -1 when unknown or variadic
+    int required_param_count = -1;  // Parameters without a default argument
+    
+    // Byte range of the whole declaration, body included, and the hash of the
+    // file it was read from. The text itself is fetched from the file on demand
+    // (see SnippetReader), which notices when the file has changed since.
+    uint64_t start_offset = 0;
+    uint64_t end_offset = 0;
+    uint64_t file_hash = 0;
     
     Symbol() = default;
     Symbol(const std::string& name, SymbolType type, const std::string& file_path,
-           int line, int column, const std::string& signature = "")
+           int line, int column)
         : name(name), type(type), file_path(file_path), 
-          line_number(line), column_number(column), signature(signature) {}
+          line_number(line), column_number(column) {}
     
     bool operator==(const Symbol& other) const {
         return name == other.name && 
@@ -36,6 +47,32 @@ struct Symbol {
     }
 };
 
+// Symbol as produced by the parser. The strings point into the parse result's
+// arena and the shared path table rather than owning copies, so building one
+// allocates nothing of its own; toSymbol() makes an owning copy.
+struct SymbolRecord {
+    std::string_view name;
+    SymbolType type = SymbolType::UNKNOWN;
+    std::string_view file_path;
+    int line_number = 0;
+    int column_number = 0;
+    std::string_view parent_scope;
+    std::string_view qualified_name;
+    int param_count = -1;
+    int required_param_count = -1;
+    uint64_t start_offset = 0;
+    uint64_t end_offset = 0;
+    
+    Symbol toSymbol() const;
+};
+
+// A single place where an identifier appears in source
+struct SymbolReference {
+    std::string file_path;
+    int line_number;
+    int column_number;
+};
+
 // Convert SymbolType to string for display
 std::string symbolTypeToString(SymbolType type);
 
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace devpilot {
+namespace trace {
+
+// Scoped timers and counters for finding out where an index run spends its
+// time. Each thread appends to its own buffer without locking; buffers are
+// merged only when summarize() or writeChromeTrace() is called, which must
+// happen after the instrumented threads have finished. Until enable() is
+// called every hook is a relaxed load and a branch.
+
+enum class Counter {
+    BYTES_READ,           // File contents handed to the parsers
+    FILES_PARSED,
+    SYMBOLS_EMITTED,
+    CALLS_EMITTED,        // Call sites found by the parser
+    INCLUDES_EMITTED,     // #include directives found by the parser
+    OCCURRENCES_EMITTED,  // Identifier occurrences found by the parser
+    ROWS_WRITTEN          // Rows inserted into SQLite
+};
+
+constexpr size_t kCounterCount = 7;
+
+const char* counterName(Counter counter);
+
+namespace detail {
+extern std::atomic<bool> active;
+void recordSpan(const char* name, std::chrono::steady_clock::time_point start);
+void addCount(Counter counter, uint64_t amount);
+} // namespace detail
+
+// Starts recording; call before the threads to be traced are started
+void enable();
+
+inline bool enabled() {
+    return detail::active.load(std::memory_order_relaxed);
+}
+
+// Names the calling thread in the trace ("parse 3"); a no-op when disabled
+void setThreadName(const std::string& name);
+
+inline void count(Counter counter, uint64_t amount = 1) {
+    if (enabled()) {
+        detail::addCount(counter, amount);
+    }
+}
+
+// Records the time from construction to destruction as one span. The name
+// must outlive the trace, which in practice means a string literal.
+class Scope {
+public:
+    explicit Scope(const char* name) : name(enabled() ? name : nullptr) {
+        if (this->name) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+    ~Scope() {
+        if (name) {
+            detail::recordSpan(name, start);
+        }
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Spans of one name, merged over all threads
+struct SpanSummary {
+    std::string name;
+    uint64_t count = 0;
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds max{0};
+};
+
+struct Summary {
+    std::vector<SpanSummary> spans;  // In order of first appearance
+    uint64_t counters[kCounterCount] = {};
+};
+
+Summary summarize();
+
+// Writes every span as a complete event in Chrome's trace event format, for
+// chrome://tracing or Perfetto. Returns false if the file cannot be written.
+bool writeChromeTrace(const std::string& path);
+
+} // namespace trace
+} // namespace devpilot
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace devpilot {
+
+// Nearest-neighbour search over symbol embeddings, kept beside the database
+// in "<database>.vectors" and memory-mapped for queries.
+//
+// Each vector is quantized to int8 with a scale of its own (its largest
+// component maps to 127) and padded to a multiple of 32 bytes, so a row is
+// whole SIMD registers. Rows are grouped by inverted list (IVF): k-means
+// splits the vectors into lists around centroids, each list's rows are
+// stored contiguously, and a query scans only the lists whose centroids are
+// nearest to it. Scores are inner products, i.e. cosine similarity for the
+// unit-length vectors embedders produce.
+//
+// The file is native-endian and derived: rebuild it rather than copy it.
+
+std::string vectorPath(const std::string& databasePath);
+
+// Inner product of two int8 rows, with AVX2 or NEON where the CPU has it
+int32_t dotProductInt8(const int8_t* a, const int8_t* b, size_t size);
+const char* dotProductKernel();  // "avx2", "neon" or "scalar", for reports
+
+struct VectorMatch {
+    int64_t id;
+    float score;
+};
+
+struct VectorBuildOptions {
+    size_t lists = 0;  // 0 for about the square root of the vector count
+    unsigned iterations = 8;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+};
+
+// Collects quantized vectors in memory and writes the file in one go
+class VectorIndexBuilder {
+public:
+    explicit VectorIndexBuilder(size_t dimensions);
+
+    void add(int64_t id, const float* vector);
+    size_t size() const { return ids.size(); }
+
+    // Clusters the vectors and replaces the file at path (through a rename,
+    // so readers see the old file or the new one). Reports through logging.
+    bool write(const std::string& path, const std::string& embedderId, uint64_t indexStamp,
+               const VectorBuildOptions& options, size_t& lists);
+
+private:
+    size_t dimensions;
+    size_t stride;
+    std::vector<int64_t> ids;
+    std::vector<float> scales;
+    std::vector<int8_t> codes;  // size() * stride
+};
+
+// Single responsibility: Only answer nearest-neighbour queries over a vector
+// file. Read-only once open; any number of threads may search at once.
+class VectorIndex {
+public:
+    VectorIndex() = default;
+    ~VectorIndex();
+
+    VectorIndex(const VectorIndex&) = delete;
+    VectorIndex& operator=(const VectorIndex&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    size_t size() const { return count; }
+    size_t dimensions() const { return dims; }
+    size_t lists() const { return listCount; }
+    const std::string& embedderId() const { return embedder; }
+    uint64_t indexStamp() const { return stamp; }
+
+    // The k best matches, best first, from the probes lists nearest to query
+    // (dimensions() floats). Probing every list gives what searchExact does.
+    std::vector<VectorMatch> search(const float* query, size_t k, size_t probes) const;
+
+    // Scores every vector: the reference the inverted lists are checked against
+    std::vector<VectorMatch> searchExact(const float* query, size_t k) const;
+
+private:
+    void* mapping = nullptr;
+    size_t mappedBytes = 0;
+    size_t count = 0;
+    size_t dims = 0;
+    size_t stride = 0;
+    size_t listCount = 0;
+    std::string embedder;
+    uint64_t stamp = 0;
+
+    const float* centroids = nullptr;     // listCount * dims
+    const uint64_t* listStarts = nullptr; // listCount + 1 row numbers
+    const int64_t* ids = nullptr;
+    const float* scales = nullptr;
+    const int8_t* codes = nullptr;
+
+    std::vector<VectorMatch> scan(const float* query, size_t k, const size_t* lists, size_t probes) const;
+};
+
+} // namespace devpilot
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace devpilot {
+
+// Multi-producer, multi-consumer FIFO connecting pipeline stages. Consumers
+// block until an item arrives or the producers call close(). With a capacity,
+// producers block while the queue is full, so a fast stage cannot run ahead
+// of a slow one and buffer unbounded work. Items may be pushed into one of
+// several lanes: consumers drain lane 0 first, and FIFO order holds within a
+// lane. The capacity covers all lanes together.
+template <typename T>
+class WorkQueue {
+public:
+    explicit WorkQueue(size_t capacity = 0, size_t laneCount = 1)
+        : capacity(capacity), lanes(laneCount == 0 ? 1 : laneCount) {}
+
+    void push(T item, size_t lane = 0) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            space.wait(lock, [this] { return capacity == 0 || count < capacity || closed; });
+            lanes[lane < lanes.size() ? lane : lanes.size() - 1].push_back(std::move(item));
+            count++;
+        }
+        available.notify_one();
+    }
+
+    // 0 removes the limit. Shrinking does not drop queued items; producers
+    // simply wait until the queue drains below the new capacity.
+    void setCapacity(size_t newCapacity) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            capacity = newCapacity;
+        }
+        space.notify_all();
+    }
+
+    // Returns false once the queue is closed and drained
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        available.wait(lock, [this] { return count != 0 || closed; });
+        if (count == 0) {
+            return false;
+        }
+        takeFirst(item);
+        lock.unlock();
+        space.notify_one();
+        return true;
+    }
+
+    // Non-blocking pop; false when nothing is queued right now
+    bool tryPop(T& item) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (count == 0) {
+            return false;
+        }
+        takeFirst(item);
+        space.notify_one();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        available.notify_all();
+        space.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable available;
+    std::condition_variable space;
+    size_t capacity;
+    std::vector<std::deque<T>> lanes;
+    size_t count = 0;  // Across all lanes
+    bool closed = false;
+
+    // Called with the lock held and count != 0
+    void takeFirst(T& item) {
+        for (auto& lane : lanes) {
+            if (!lane.empty()) {
+                item = std::move(lane.front());
+                lane.pop_front();
+                count--;
+                return;
+            }
+        }
+    }
+};
+
+} // namespace devpilot
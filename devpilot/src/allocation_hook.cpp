@@ -0,0 +1,99 @@
+#include "memory_accounting.hpp"
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Single responsibility: Only route global new and delete through the
+// allocation counters. Linked into the executables only when configured
+// with -DENABLE_MEMORY_ACCOUNTING=ON, since every block carries a header.
+
+namespace {
+
+using devpilot::memory::detail::recordAllocation;
+using devpilot::memory::detail::recordFree;
+
+// Sits right before the pointer handed out; `offset` leads back to the
+// start of the underlying malloc block
+struct Header {
+    uint64_t size;
+    uint32_t tag;
+    uint32_t offset;
+};
+static_assert(sizeof(Header) == 16, "headers must keep malloc's 16-byte alignment");
+
+const bool installed = (devpilot::memory::detail::hookInstalled = true);
+
+void* allocate(size_t size, size_t alignment) {
+    size_t prefix = alignment > sizeof(Header) ? alignment : sizeof(Header);
+    void* base = nullptr;
+    if (alignment > alignof(std::max_align_t)) {
+        if (posix_memalign(&base, alignment, prefix + size) != 0) {
+            return nullptr;
+        }
+    } else {
+        base = std::malloc(prefix + size);
+        if (!base) {
+            return nullptr;
+        }
+    }
+    char* pointer = static_cast<char*>(base) + prefix;
+    Header* header = reinterpret_cast<Header*>(pointer) - 1;
+    header->size = size;
+    header->offset = static_cast<uint32_t>(prefix);
+    header->tag = recordAllocation(size);
+    return pointer;
+}
+
+void* allocateOrThrow(size_t size, size_t alignment) {
+    while (true) {
+        if (void* pointer = allocate(size, alignment)) {
+            return pointer;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void release(void* pointer) {
+    if (!pointer) {
+        return;
+    }
+    Header* header = static_cast<Header*>(pointer) - 1;
+    recordFree(header->tag, header->size);
+    std::free(static_cast<char*>(pointer) - header->offset);
+}
+
+} // namespace
+
+void* operator new(size_t size) { return allocateOrThrow(size, 0); }
+void* operator new[](size_t size) { return allocateOrThrow(size, 0); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) {
+    return allocateOrThrow(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return allocateOrThrow(size, static_cast<size_t>(alignment));
+}
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept { release(pointer); }
+void operator delete[](void* pointer) noexcept { release(pointer); }
+void operator delete(void* pointer, size_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { release(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { release(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { release(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { release(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { release(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { release(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { release(pointer); }
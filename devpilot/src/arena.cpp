@@ -0,0 +1,103 @@
+#include "arena.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace devpilot {
+
+// Single responsibility: Only own the memory behind parse result strings
+
+StringArena::StringArena(StringArena&& other) noexcept {
+    *this = std::move(other);
+}
+
+StringArena& StringArena::operator=(StringArena&& other) noexcept {
+    if (this != &other) {
+        chunks = std::move(other.chunks);
+        cursor = other.cursor;
+        remaining = other.remaining;
+        nextChunkSize = other.nextChunkSize;
+        reserved = other.reserved;
+        other.chunks.clear();
+        other.reset();
+    }
+    return *this;
+}
+
+char* StringArena::allocate(size_t size) {
+    if (size > remaining) {
+        // Oversized requests get a chunk of their own and leave the current
+        // chunk's free space for later copies
+        if (size > nextChunkSize) {
+            chunks.emplace_back(new char[size]);
+            reserved += size;
+            return chunks.back().get();
+        }
+        chunks.emplace_back(new char[nextChunkSize]);
+        cursor = chunks.back().get();
+        remaining = nextChunkSize;
+        reserved += nextChunkSize;
+        nextChunkSize = std::min(nextChunkSize * 2, kMaxChunkSize);
+    }
+    char* block = cursor;
+    cursor += size;
+    remaining -= size;
+    return block;
+}
+
+std::string_view StringArena::copy(std::string_view text) {
+    if (text.empty()) {
+        return std::string_view();
+    }
+    char* block = allocate(text.size());
+    std::memcpy(block, text.data(), text.size());
+    return std::string_view(block, text.size());
+}
+
+std::string_view StringArena::concat(std::string_view a, std::string_view b, std::string_view c) {
+    size_t size = a.size() + b.size() + c.size();
+    if (size == 0) {
+        return std::string_view();
+    }
+    char* block = allocate(size);
+    std::memcpy(block, a.data(), a.size());
+    std::memcpy(block + a.size(), b.data(), b.size());
+    std::memcpy(block + a.size() + b.size(), c.data(), c.size());
+    return std::string_view(block, size);
+}
+
+void StringArena::reset() {
+    chunks.clear();
+    cursor = nullptr;
+    remaining = 0;
+    nextChunkSize = kFirstChunkSize;
+    reserved = 0;
+}
+
+size_t StringArena::bytesReserved() const {
+    return reserved;
+}
+
+std::string_view StringTable::intern(std::string_view text) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = strings.find(text);
+    if (it != strings.end()) {
+        return *it;
+    }
+    std::string_view stored = arena.copy(text);
+    strings.insert(stored);
+    return stored;
+}
+
+size_t StringTable::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return strings.size();
+}
+
+size_t StringTable::bytesReserved() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    // A hash node holds the view, the next pointer and the cached hash
+    return arena.bytesReserved() + strings.size() * (sizeof(std::string_view) + 2 * sizeof(void*)) +
+           strings.bucket_count() * sizeof(void*);
+}
+
+} // namespace devpilot
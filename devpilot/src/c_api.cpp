@@ -0,0 +1,500 @@
+#include "devpilot.h"
+#include "indexer.hpp"
+#include "logger.hpp"
+#include "parser.hpp"
+#include "query_activity.hpp"
+#include "query_context.hpp"
+#include "source_snippet.hpp"
+#include "sharded_storage.hpp"
+#include "storage.hpp"
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Single responsibility: Only translate the C interface to the C++ one.
+// Nothing may throw across it, so every entry point catches.
+
+using namespace devpilot;
+
+namespace {
+
+thread_local std::string lastError;
+
+devpilot_status fail(devpilot_status status, std::string message) {
+    lastError = std::move(message);
+    return status;
+}
+
+// One database connection per concurrent query: SqliteStorage shares its
+// prepared statements, so a connection serves one thread at a time. A
+// sharded index gives each connection one per shard.
+struct Connection {
+    ShardedStorage storage;
+    QueryActivity activity;
+    uint64_t generation;  // The index's generation when this was opened
+
+    Connection(const std::string& path, uint64_t generation) : activity(path), generation(generation) {}
+};
+
+} // namespace
+
+struct devpilot_index {
+    std::string path;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Connection>> idle;
+    // Bumped by each index run; a reindex may shard the database differently,
+    // so connections opened before it are closed rather than reused
+    uint64_t generation = 0;
+};
+
+struct devpilot_token {
+    CancellationToken token;
+};
+
+struct devpilot_results {
+    enum class Kind { SYMBOLS, STRINGS, REFERENCES };
+
+    Kind kind = Kind::SYMBOLS;
+    bool truncated = false;
+    // The queries' own results, moved in; the C views point into them
+    std::vector<Symbol> symbols;
+    std::vector<devpilot_symbol> symbolViews;
+    std::vector<std::string> strings;
+    std::vector<SymbolReference> references;
+    std::vector<devpilot_reference> referenceViews;
+    SnippetReader snippets;
+
+    void addSymbols(std::vector<Symbol> found, uint32_t group) {
+        if (symbols.empty()) {
+            symbols = std::move(found);
+        } else {
+            symbols.reserve(symbols.size() + found.size());
+            for (auto& symbol : found) {
+                symbols.push_back(std::move(symbol));
+            }
+        }
+        groups.resize(symbols.size(), group);
+    }
+
+    // Once every symbol is in place, as views hold pointers into them
+    void finishSymbols() {
+        symbolViews.reserve(symbols.size());
+        for (size_t i = 0; i < symbols.size(); i++) {
+            const Symbol& symbol = symbols[i];
+            devpilot_symbol view;
+            view.name = symbol.name.c_str();
+            view.qualified_name = symbol.qualified_name.c_str();
+            view.parent_scope = symbol.parent_scope.c_str();
+            view.file_path = symbol.file_path.c_str();
+            view.kind = static_cast<int32_t>(symbol.type);
+            view.line = symbol.line_number;
+            view.column = symbol.column_number;
+            view.param_count = symbol.param_count;
+            view.required_param_count = symbol.required_param_count;
+            view.start_offset = symbol.start_offset;
+            view.end_offset = symbol.end_offset;
+            view.group = groups[i];
+            symbolViews.push_back(view);
+        }
+        groups.clear();
+    }
+
+    void finishReferences() {
+        referenceViews.reserve(references.size());
+        for (const auto& reference : references) {
+            referenceViews.push_back({reference.file_path.c_str(), reference.line_number,
+                                      reference.column_number});
+        }
+    }
+
+private:
+    std::vector<uint32_t> groups;
+};
+
+namespace {
+
+static_assert(static_cast<int>(SymbolType::FUNCTION) == DEVPILOT_SYMBOL_FUNCTION &&
+              static_cast<int>(SymbolType::CLASS) == DEVPILOT_SYMBOL_CLASS &&
+              static_cast<int>(SymbolType::VARIABLE) == DEVPILOT_SYMBOL_VARIABLE &&
+              static_cast<int>(SymbolType::NAMESPACE) == DEVPILOT_SYMBOL_NAMESPACE &&
+              static_cast<int>(SymbolType::UNKNOWN) == DEVPILOT_SYMBOL_UNKNOWN,
+              "devpilot_symbol_kind mirrors SymbolType");
+
+// Hands a thread an idle connection, opening another when all are busy,
+// and takes it back afterwards
+class Lease {
+public:
+    explicit Lease(devpilot_index& index) : index(index) {
+        uint64_t generation;
+        {
+            std::lock_guard<std::mutex> lock(index.mutex);
+            if (!index.idle.empty()) {
+                connection = std::move(index.idle.back());
+                index.idle.pop_back();
+                return;
+            }
+            generation = index.generation;
+        }
+        auto opened = std::make_unique<Connection>(index.path, generation);
+        if (opened->storage.open(index.path)) {
+            connection = std::move(opened);
+        } else {
+            error = opened->storage.openError();
+        }
+    }
+
+    ~Lease() {
+        if (connection) {
+            std::lock_guard<std::mutex> lock(index.mutex);
+            if (connection->generation == index.generation) {
+                index.idle.push_back(std::move(connection));
+            }
+        }
+    }
+
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+
+    Connection* get() const { return connection.get(); }
+    const std::string& openError() const { return error; }  // When get() is null
+
+private:
+    devpilot_index& index;
+    std::unique_ptr<Connection> connection;
+    std::string error;
+};
+
+// Runs `query(storage, context, results)` on a leased connection
+template <typename Query>
+devpilot_status runQuery(devpilot_index* index, uint32_t timeoutMs, const devpilot_token* token,
+                         devpilot_results** results, Query query) {
+    if (results) {
+        *results = nullptr;
+    }
+    if (!index || !results) {
+        return fail(DEVPILOT_INVALID_ARGUMENT, "index and results must not be NULL");
+    }
+    try {
+        Lease lease(*index);
+        if (!lease.get()) {
+            return fail(DEVPILOT_OPEN_FAILED, lease.openError());
+        }
+        auto found = std::make_unique<devpilot_results>();
+        QueryContext context(std::chrono::milliseconds(timeoutMs), token ? &token->token : nullptr);
+        // A token cancelled before the query starts saves running it at all
+        if (!context.shouldStop()) {
+            lease.get()->activity.beginQuery();
+            try {
+                query(lease.get()->storage, context, *found);
+            } catch (...) {
+                lease.get()->activity.endQuery();
+                throw;
+            }
+            lease.get()->activity.endQuery();
+        }
+        if (context.failed) {
+            return fail(DEVPILOT_ERROR, "Query failed: " + context.error);
+        }
+        found->truncated = context.truncated;
+        *results = found.release();
+        return (*results)->truncated ? DEVPILOT_TRUNCATED : DEVPILOT_OK;
+    } catch (const std::exception& error) {
+        return fail(DEVPILOT_ERROR, error.what());
+    } catch (...) {
+        return fail(DEVPILOT_ERROR, "Unknown error");
+    }
+}
+
+bool validKeys(const char* const* keys, size_t count) {
+    if (count != 0 && !keys) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!keys[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+extern "C" {
+
+uint32_t devpilot_api_version(void) {
+    return DEVPILOT_API_VERSION;
+}
+
+const char* devpilot_last_error(void) {
+    return lastError.c_str();
+}
+
+void devpilot_set_log_level(devpilot_log_level level) {
+    if (level >= DEVPILOT_LOG_ERROR && level <= DEVPILOT_LOG_DEBUG) {
+        logging::setLevel(static_cast<LogLevel>(level));
+    }
+}
+
+devpilot_status devpilot_open(const char* db_path, devpilot_index** index) {
+    if (index) {
+        *index = nullptr;
+    }
+    if (!db_path || !index) {
+        return fail(DEVPILOT_INVALID_ARGUMENT, "db_path and index must not be NULL");
+    }
+    try {
+        auto opened = std::make_unique<devpilot_index>();
+        opened->path = db_path;
+        // Opening one connection up front reports a damaged database here
+        // rather than on the first query. Queries never create or migrate
+        // one: without a current index the handle is still returned, for
+        // devpilot_index_project() to build it.
+        auto connection = std::make_unique<Connection>(opened->path, 0);
+        if (connection->storage.open(opened->path)) {
+            opened->idle.push_back(std::move(connection));
+        } else if (connection->storage.openFailure() == SqliteStorage::OpenFailure::ERROR) {
+            return fail(DEVPILOT_OPEN_FAILED, connection->storage.openError());
+        }
+        *index = opened.release();
+        return DEVPILOT_OK;
+    } catch (const std::exception& error) {
+        return fail(DEVPILOT_ERROR, error.what());
+    } catch (...) {
+        return fail(DEVPILOT_ERROR, "Unknown error");
+    }
+}
+
+void devpilot_close(devpilot_index* index) {
+    delete index;
+}
+
+devpilot_status devpilot_index_project(devpilot_index* index, const char* project_path,
+                                       const char* const* include_paths, size_t include_count,
+                                       uint32_t threads) {
+    if (!index || !project_path || !validKeys(include_paths, include_count)) {
+        return fail(DEVPILOT_INVALID_ARGUMENT, "index, project_path and include paths must not be NULL");
+    }
+    try {
+        IndexOptions options;
+        options.includePaths.assign(include_paths, include_paths + include_count);
+        if (threads != 0) {
+            options.threads = threads;
+        }
+        options.databasePath = index->path;
+
+        // Indexing writes through a connection of its own, never one of the
+        // query pool's, so queries keep running on the old index meanwhile
+        SqliteStorage storage;
+        if (!storage.initialize(index->path)) {
+            return fail(DEVPILOT_OPEN_FAILED, "Cannot open database: " + index->path);
+        }
+        CppParser parser;
+        Indexer indexer(parser, storage);
+        IndexSummary summary;
+        if (!indexer.run(project_path, options, summary)) {
+            return fail(DEVPILOT_INDEX_FAILED, std::string("Cannot index ") + project_path);
+        }
+        // Queries still running keep their connections until they return
+        std::lock_guard<std::mutex> lock(index->mutex);
+        index->generation++;
+        index->idle.clear();
+        return DEVPILOT_OK;
+    } catch (const std::exception& error) {
+        return fail(DEVPILOT_ERROR, error.what());
+    } catch (...) {
+        return fail(DEVPILOT_ERROR, "Unknown error");
+    }
+}
+
+devpilot_token* devpilot_token_create(void) {
+    return new (std::nothrow) devpilot_token();
+}
+
+void devpilot_token_cancel(devpilot_token* token) {
+    if (token) {
+        token->token.cancel();
+    }
+}
+
+void devpilot_token_free(devpilot_token* token) {
+    delete token;
+}
+
+devpilot_status devpilot_search(devpilot_index* index, const char* query, uint32_t timeout_ms,
+                                const devpilot_token* token, devpilot_results** results) {
+    if (!query) {
+        return fail(DEVPILOT_INVALID_ARGUMENT, "query must not be NULL");
+    }
+    return runQuery(index, timeout_ms, token, results,
+                    [query](ShardedStorage& storage, QueryContext& context, devpilot_results& found) {
+        found.addSymbols(storage.searchSymbols(query, &context), 0);
+        found.finishSymbols();
+    });
+}
+
+devpilot_status devpilot_lookup(devpilot_index* index, const char* const* names, size_t count,
+                                uint32_t timeout_ms, const devpilot_token* token,
+                                devpilot_results** results) {
+    if (!validKeys(names, count)) {
+        return fail(DEVPILOT_INVALID_ARGUMENT, "names must not be NULL");
+    }
+    return runQuery(index, timeout_ms, token, results,
+                    [&](ShardedStorage& storage, QueryContext& context, devpilot_results& found) {
+        auto groups = storage.lookupSymbols(std::vector<std::string>(names, names + count), &context);
+        for (size_t group = 0; group < groups.size(); group++) {
+            found.addSymbols(std::move(groups[group]), static_cast<uint32_t>(group));
+        }
+        found.finishSymbols();
+    });
+}
+
+devpilot_status devpilot_outline(devpilot_index* index, const char* const* files, size_t count,
+                                 uint32_t timeout_ms, const devpilot_token* token,
+                                 devpilot_results** results) {
+    if (!validKeys(files, count)) {
+        return fail(DEVPILOT_INVALID_ARGUMENT, "files must not be NULL");
+    }
+    return runQuery(index, timeout_ms, token, results,
+                    [&](ShardedStorage& storage, QueryContext& context, devpilot_results& found) {
+        auto groups = storage.getSymbolsInFiles(std::vector<std::string>(files, files + count), &context);
+        for (size_t group = 0; group < groups.size(); group++) {
+            found.addSymbols(std::move(groups[group]), static_cast<uint32_t>(group));
+        }
+        found.finishSymbols();
+    });
+}
+
+devpilot_status devpilot_usages(devpilot_index* index, const char* name, uint32_t timeout_ms,
+                                const devpilot_token* token, devpilot_results** results) {
+    if (!name) {
+        return fail(DEVPILOT_INVALID_ARGUMENT, "name must not be NULL");
+    }
+    return runQuery(index, timeout_ms, token, results,
+                    [name](ShardedStorage& storage, QueryContext& context, devpilot_results& found) {
+        found.kind = devpilot_results::Kind::STRINGS;
+        found.strings = storage.getSymbolUsages(name, &context);
+    });
+}
+
+devpilot_status devpilot_callees(devpilot_index* index, const char* name, uint32_t timeout_ms,
+                                 const devpilot_token* token, devpilot_results** results) {
+    if (!name) {
+        return fail(DEVPILOT_INVALID_ARGUMENT, "name must not be NULL");
+    }
+    return runQuery(index, timeout_ms, token, results,
+                    [name](ShardedStorage& storage, QueryContext& context, devpilot_results& found) {
+        found.kind = devpilot_results::Kind::STRINGS;
+        found.strings = storage.getSymbolCallees(name, &context);
+    });
+}
+
+devpilot_status devpilot_references(devpilot_index* index, const char* name, uint32_t timeout_ms,
+                                    const devpilot_token* token, devpilot_results** results) {
+    if (!name) {
+        return fail(DEVPILOT_INVALID_ARGUMENT, "name must not be NULL");
+    }
+    return runQuery(index, timeout_ms, token, results,
+                    [name](ShardedStorage& storage, QueryContext& context, devpilot_results& found) {
+        found.kind = devpilot_results::Kind::REFERENCES;
+        found.references = storage.getReferences(name, &context);
+        found.finishReferences();
+    });
+}
+
+devpilot_status devpilot_dependents(devpilot_index* index, const char* file, uint32_t timeout_ms,
+                                    const devpilot_token* token, devpilot_results** results) {
+    if (!file) {
+        return fail(DEVPILOT_INVALID_ARGUMENT, "file must not be NULL");
+    }
+    return runQuery(index, timeout_ms, token, results,
+                    [file](ShardedStorage& storage, QueryContext& context, devpilot_results& found) {
+        found.kind = devpilot_results::Kind::STRINGS;
+        // A partial path may name several files; their dependents are merged
+        std::unordered_set<std::string> seen;
+        for (int64_t fileId : storage.findFiles(file, &context)) {
+            for (auto& dependent : storage.getTransitiveDependents(fileId, &context)) {
+                if (seen.insert(dependent).second) {
+                    found.strings.push_back(std::move(dependent));
+                }
+            }
+        }
+    });
+}
+
+size_t devpilot_results_count(const devpilot_results* results) {
+    if (!results) {
+        return 0;
+    }
+    switch (results->kind) {
+        case devpilot_results::Kind::SYMBOLS: return results->symbolViews.size();
+        case devpilot_results::Kind::STRINGS: return results->strings.size();
+        case devpilot_results::Kind::REFERENCES: return results->referenceViews.size();
+    }
+    return 0;
+}
+
+int devpilot_results_truncated(const devpilot_results* results) {
+    return results && results->truncated ? 1 : 0;
+}
+
+const devpilot_symbol* devpilot_results_symbol(const devpilot_results* results, size_t i) {
+    if (!results || results->kind != devpilot_results::Kind::SYMBOLS ||
+        i >= results->symbolViews.size()) {
+        return nullptr;
+    }
+    return &results->symbolViews[i];
+}
+
+const devpilot_reference* devpilot_results_reference(const devpilot_results* results, size_t i) {
+    if (!results || results->kind != devpilot_results::Kind::REFERENCES ||
+        i >= results->referenceViews.size()) {
+        return nullptr;
+    }
+    return &results->referenceViews[i];
+}
+
+const char* devpilot_results_string(const devpilot_results* results, size_t i) {
+    if (!results || results->kind != devpilot_results::Kind::STRINGS || i >= results->strings.size()) {
+        return nullptr;
+    }
+    return results->strings[i].c_str();
+}
+
+devpilot_status devpilot_results_source(devpilot_results* results, size_t i, const char** text,
+                                        size_t* length) {
+    if (!text || !length || !devpilot_results_symbol(results, i)) {
+        return fail(DEVPILOT_INVALID_ARGUMENT, "No symbol at that index");
+    }
+    try {
+        std::string_view source;
+        switch (results->snippets.text(results->symbols[i], source)) {
+            case SnippetStatus::OK:
+                *text = source.data();
+                *length = source.size();
+                return DEVPILOT_OK;
+            case SnippetStatus::MISSING:
+                return fail(DEVPILOT_SOURCE_MISSING, "Cannot open " + results->symbols[i].file_path);
+            case SnippetStatus::STALE:
+                return fail(DEVPILOT_SOURCE_STALE, results->symbols[i].file_path +
+                            " changed since it was indexed");
+        }
+        return fail(DEVPILOT_ERROR, "Unknown snippet status");
+    } catch (const std::exception& error) {
+        return fail(DEVPILOT_ERROR, error.what());
+    } catch (...) {
+        return fail(DEVPILOT_ERROR, "Unknown error");
+    }
+}
+
+void devpilot_results_free(devpilot_results* results) {
+    delete results;
+}
+
+} // extern "C"
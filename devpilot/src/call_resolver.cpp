@@ -0,0 +1,165 @@
+#include "call_resolver.hpp"
+#include <climits>
+
+namespace devpilot {
+
+// Single responsibility: Only bind parsed call sites to symbol ids
+
+namespace {
+
+bool endsWithScope(std::string_view qualified, std::string_view suffix) {
+    if (qualified.size() == suffix.size()) {
+        return qualified == suffix;
+    }
+    return qualified.size() > suffix.size() + 2 &&
+           qualified.compare(qualified.size() - suffix.size(), suffix.size(), suffix) == 0 &&
+           qualified.compare(qualified.size() - suffix.size() - 2, 2, "::") == 0;
+}
+
+// True when "outer" is "inner" itself or one of its enclosing scopes
+bool enclosesScope(std::string_view outer, std::string_view inner) {
+    if (outer.empty() || outer == inner) {
+        return true;
+    }
+    return inner.size() > outer.size() + 2 && inner.compare(0, outer.size(), outer) == 0 &&
+           inner.compare(outer.size(), 2, "::") == 0;
+}
+
+// "src/widget.cpp" -> "widget"
+std::string_view fileStem(std::string_view path) {
+    size_t slash = path.rfind('/');
+    std::string_view name = slash == std::string_view::npos ? path : path.substr(slash + 1);
+    size_t dot = name.rfind('.');
+    return dot == std::string_view::npos || dot == 0 ? name : name.substr(0, dot);
+}
+
+} // namespace
+
+void CallResolver::addSymbol(int64_t symbolId, int64_t fileId, const SymbolRecord& symbol) {
+    if (symbol.type != SymbolType::FUNCTION) {
+        return;
+    }
+
+    Function function;
+    function.id = symbolId;
+    function.file_id = fileId;
+    function.qualified_name =
+        strings.intern(symbol.qualified_name.empty() ? symbol.name : symbol.qualified_name);
+    function.parent_scope = strings.intern(symbol.parent_scope);
+    function.file_path = strings.intern(symbol.file_path);
+    function.file_stem = fileStem(function.file_path);
+    function.param_count = symbol.param_count;
+    function.required_param_count = symbol.required_param_count;
+
+    functionsById[symbolId] = functions.size();
+    functionsByName[strings.intern(symbol.name)].push_back(functions.size());
+    functions.push_back(function);
+}
+
+void CallResolver::addCall(int64_t callerId, int64_t fileId, const CallSite& call) {
+    PendingCall pending{callerId, fileId, call};
+    pending.site.callee_name = strings.intern(call.callee_name);
+    pending.site.qualifier = strings.intern(call.qualifier);
+    calls.push_back(pending);
+}
+
+std::string_view CallResolver::qualifiedName(int64_t symbolId) const {
+    auto it = functionsById.find(symbolId);
+    return it == functionsById.end() ? std::string_view() : functions[it->second].qualified_name;
+}
+
+std::string_view CallResolver::filePath(int64_t symbolId) const {
+    auto it = functionsById.find(symbolId);
+    return it == functionsById.end() ? std::string_view() : functions[it->second].file_path;
+}
+
+size_t CallResolver::memoryBytes() const {
+    // Hash nodes as in StringTable::bytesReserved(); each function's index
+    // also sits in its name's list
+    size_t node = 2 * sizeof(void*);
+    return functions.capacity() * sizeof(Function) + calls.capacity() * sizeof(PendingCall) +
+           functionsById.size() * (sizeof(std::pair<const int64_t, size_t>) + node) +
+           functionsById.bucket_count() * sizeof(void*) +
+           functionsByName.size() * (sizeof(std::pair<const std::string_view, std::vector<size_t>>) + node) +
+           functionsByName.bucket_count() * sizeof(void*) + functions.size() * sizeof(size_t) +
+           strings.bytesReserved();
+}
+
+void CallResolver::resolve(std::vector<CallEdge>& edges,
+                           std::vector<UnresolvedCall>& unresolved) const {
+    for (const auto& call : calls) {
+        auto caller = functionsById.find(call.caller_id);
+        auto candidates = functionsByName.find(call.site.callee_name);
+
+        const Function* best = nullptr;
+        int bestScore = INT_MIN;
+        if (caller != functionsById.end() && candidates != functionsByName.end()) {
+            for (size_t index : candidates->second) {
+                const Function& candidate = functions[index];
+                int candidateScore = score(functions[caller->second], candidate, call);
+                // Ties go to the first symbol in path order. Files are added in
+                // whatever order they finish parsing, so ids alone are not stable.
+                if (candidateScore > bestScore ||
+                    (candidateScore == bestScore && best && precedes(candidate, *best))) {
+                    bestScore = candidateScore;
+                    best = &candidate;
+                }
+            }
+        }
+
+        if (bestScore >= 0) {
+            edges.push_back({call.caller_id, best->id, call.file_id, call.site.line_number});
+        } else {
+            unresolved.push_back({call.caller_id, std::string(call.site.callee_name), call.file_id,
+                                  call.site.line_number});
+        }
+    }
+}
+
+bool CallResolver::precedes(const Function& a, const Function& b) {
+    // Symbols of one file get ascending ids in source order
+    return a.file_path != b.file_path ? a.file_path < b.file_path : a.id < b.id;
+}
+
+int CallResolver::score(const Function& caller, const Function& candidate,
+                        const PendingCall& call) const {
+    const CallSite& site = call.site;
+    int total = 0;
+
+    // "a::b::f()" must name a scope the candidate actually lives in. Candidates
+    // share the callee's name, so only their enclosing scope needs checking.
+    if (!site.qualifier.empty()) {
+        if (!endsWithScope(candidate.parent_scope, site.qualifier)) {
+            return INT_MIN;
+        }
+        total += 40;
+    } else if (!site.is_member) {
+        // Unqualified calls see the caller's class and enclosing namespaces
+        if (!candidate.parent_scope.empty() && candidate.parent_scope == caller.parent_scope) {
+            total += 50;
+        } else if (enclosesScope(candidate.parent_scope, caller.parent_scope)) {
+            total += 30;
+        } else if (!enclosesScope(candidate.parent_scope, caller.qualified_name)) {
+            // Only reachable through argument-dependent lookup or a using-directive
+            total -= 30;
+        }
+    }
+
+    if (candidate.param_count >= 0) {
+        bool fits = site.arg_count >= candidate.required_param_count &&
+                    site.arg_count <= candidate.param_count;
+        total += fits ? 40 : -40;
+    } else if (site.arg_count >= candidate.required_param_count) {
+        total += 20;  // Variadic
+    }
+
+    if (candidate.file_id == call.file_id) {
+        total += 20;
+    } else if (candidate.file_stem == caller.file_stem) {
+        total += 10;  // widget.hpp declares what widget.cpp calls
+    }
+
+    return total;
+}
+
+} // namespace devpilot
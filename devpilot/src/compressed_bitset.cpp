@@ -0,0 +1,284 @@
+#include "compressed_bitset.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace devpilot {
+
+// Single responsibility: Only implement the compressed id set used for reachability
+
+namespace {
+
+void appendLE(std::string& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+bool readLE(const unsigned char*& cursor, const unsigned char* end, int bytes, uint64_t& value) {
+    if (end - cursor < bytes) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= static_cast<uint64_t>(cursor[i]) << (8 * i);
+    }
+    cursor += bytes;
+    return true;
+}
+
+int popcount64(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    while (word) {
+        word &= word - 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+int countTrailingZeros64(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+    while (!((word >> bit) & 1)) {
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+} // namespace
+
+void CompressedBitset::Container::add(uint16_t low) {
+    if (isBitmap()) {
+        uint64_t mask = 1ULL << (low & 63);
+        uint64_t& word = bitmap[low >> 6];
+        if (!(word & mask)) {
+            word |= mask;
+            count++;
+        }
+        return;
+    }
+
+    auto it = std::lower_bound(array.begin(), array.end(), low);
+    if (it != array.end() && *it == low) {
+        return;
+    }
+    array.insert(it, low);
+    count++;
+
+    if (count > kArrayMaxSize) {
+        convertToBitmap();
+    }
+}
+
+bool CompressedBitset::Container::contains(uint16_t low) const {
+    if (isBitmap()) {
+        return (bitmap[low >> 6] >> (low & 63)) & 1;
+    }
+    return std::binary_search(array.begin(), array.end(), low);
+}
+
+void CompressedBitset::Container::convertToBitmap() {
+    bitmap.assign(kBitmapWords, 0);
+    for (uint16_t low : array) {
+        bitmap[low >> 6] |= 1ULL << (low & 63);
+    }
+    array.clear();
+    array.shrink_to_fit();
+}
+
+void CompressedBitset::Container::unionWith(const Container& other) {
+    if (other.isBitmap() && !isBitmap()) {
+        convertToBitmap();
+    }
+
+    if (isBitmap()) {
+        if (other.isBitmap()) {
+            count = 0;
+            for (size_t i = 0; i < kBitmapWords; i++) {
+                bitmap[i] |= other.bitmap[i];
+                count += popcount64(bitmap[i]);
+            }
+        } else {
+            for (uint16_t low : other.array) {
+                add(low);
+            }
+        }
+        return;
+    }
+
+    // Both are arrays: merge the sorted runs
+    std::vector<uint16_t> merged;
+    merged.reserve(array.size() + other.array.size());
+    std::set_union(array.begin(), array.end(), other.array.begin(), other.array.end(),
+                   std::back_inserter(merged));
+    array.swap(merged);
+    count = static_cast<uint32_t>(array.size());
+
+    if (count > kArrayMaxSize) {
+        convertToBitmap();
+    }
+}
+
+CompressedBitset::Container* CompressedBitset::findOrCreate(uint16_t key) {
+    auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    if (it != containers.end() && it->key == key) {
+        return &*it;
+    }
+
+    Container container;
+    container.key = key;
+    container.count = 0;
+    it = containers.insert(it, std::move(container));
+    return &*it;
+}
+
+const CompressedBitset::Container* CompressedBitset::find(uint16_t key) const {
+    auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    if (it != containers.end() && it->key == key) {
+        return &*it;
+    }
+    return nullptr;
+}
+
+void CompressedBitset::add(uint32_t value) {
+    findOrCreate(static_cast<uint16_t>(value >> 16))->add(static_cast<uint16_t>(value & 0xFFFF));
+}
+
+bool CompressedBitset::contains(uint32_t value) const {
+    const Container* container = find(static_cast<uint16_t>(value >> 16));
+    return container && container->contains(static_cast<uint16_t>(value & 0xFFFF));
+}
+
+void CompressedBitset::unionWith(const CompressedBitset& other) {
+    for (const auto& theirs : other.containers) {
+        Container* mine = findOrCreate(theirs.key);
+        if (mine->count == 0) {
+            *mine = theirs;
+        } else {
+            mine->unionWith(theirs);
+        }
+    }
+}
+
+uint64_t CompressedBitset::cardinality() const {
+    uint64_t total = 0;
+    for (const auto& container : containers) {
+        total += container.count;
+    }
+    return total;
+}
+
+bool CompressedBitset::empty() const {
+    return cardinality() == 0;
+}
+
+void CompressedBitset::forEach(const std::function<void(uint32_t)>& visitor) const {
+    for (const auto& container : containers) {
+        uint32_t high = static_cast<uint32_t>(container.key) << 16;
+        if (container.isBitmap()) {
+            for (size_t i = 0; i < kBitmapWords; i++) {
+                uint64_t word = container.bitmap[i];
+                while (word) {
+                    int bit = countTrailingZeros64(word);
+                    visitor(high | static_cast<uint32_t>(i * 64 + bit));
+                    word &= word - 1;
+                }
+            }
+        } else {
+            for (uint16_t low : container.array) {
+                visitor(high | low);
+            }
+        }
+    }
+}
+
+std::vector<uint32_t> CompressedBitset::toVector() const {
+    std::vector<uint32_t> values;
+    values.reserve(cardinality());
+    forEach([&values](uint32_t value) { values.push_back(value); });
+    return values;
+}
+
+std::string CompressedBitset::serialize() const {
+    std::string out;
+    appendLE(out, containers.size(), 4);
+
+    for (const auto& container : containers) {
+        appendLE(out, container.key, 2);
+        out.push_back(container.isBitmap() ? 1 : 0);
+        appendLE(out, container.count, 4);
+
+        if (container.isBitmap()) {
+            for (uint64_t word : container.bitmap) {
+                appendLE(out, word, 8);
+            }
+        } else {
+            for (uint16_t low : container.array) {
+                appendLE(out, low, 2);
+            }
+        }
+    }
+
+    return out;
+}
+
+bool CompressedBitset::deserialize(const void* data, size_t size, CompressedBitset& out) {
+    out.containers.clear();
+
+    const unsigned char* cursor = static_cast<const unsigned char*>(data);
+    const unsigned char* end = cursor + size;
+    uint64_t containerCount = 0;
+    if (!readLE(cursor, end, 4, containerCount)) {
+        return size == 0;
+    }
+
+    // Every container must be there in full: a truncated BLOB is damage, not
+    // a smaller set, and no count may promise more values than a bucket holds
+    for (uint64_t i = 0; i < containerCount; i++) {
+        uint64_t key = 0, count = 0;
+        if (!readLE(cursor, end, 2, key) || cursor >= end) {
+            return false;
+        }
+        bool isBitmap = *cursor++ != 0;
+        if (!readLE(cursor, end, 4, count) || count > 65536 ||
+            (!isBitmap && (count > kArrayMaxSize || count * 2 > static_cast<uint64_t>(end - cursor)))) {
+            return false;
+        }
+
+        Container container;
+        container.key = static_cast<uint16_t>(key);
+        container.count = static_cast<uint32_t>(count);
+
+        if (isBitmap) {
+            container.bitmap.resize(kBitmapWords);
+            for (auto& word : container.bitmap) {
+                if (!readLE(cursor, end, 8, word)) {
+                    return false;
+                }
+            }
+        } else {
+            container.array.resize(count);
+            for (auto& low : container.array) {
+                uint64_t value = 0;
+                if (!readLE(cursor, end, 2, value)) {
+                    return false;
+                }
+                low = static_cast<uint16_t>(value);
+            }
+        }
+
+        out.containers.push_back(std::move(container));
+    }
+
+    return cursor == end;
+}
+
+} // namespace devpilot
@@ -0,0 +1,185 @@
+#include "content_hash.hpp"
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace devpilot {
+
+// Single responsibility: Only hash byte ranges
+
+namespace {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+uint64_t rotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// Little-endian loads regardless of host byte order
+uint64_t read64(const unsigned char* p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+uint32_t read32(const unsigned char* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t mixRound(uint64_t accumulator, uint64_t input) {
+    accumulator += input * kPrime2;
+    accumulator = rotateLeft(accumulator, 31);
+    return accumulator * kPrime1;
+}
+
+uint64_t mergeRound(uint64_t accumulator, uint64_t value) {
+    accumulator ^= mixRound(0, value);
+    return accumulator * kPrime1 + kPrime4;
+}
+
+uint64_t mergeLanes(const uint64_t lanes[4]) {
+    uint64_t hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) +
+                    rotateLeft(lanes[3], 18);
+    for (int i = 0; i < 4; i++) {
+        hash = mergeRound(hash, lanes[i]);
+    }
+    return hash;
+}
+
+// Folds in the last bytes (fewer than 32) and mixes the result
+uint64_t finalize(uint64_t hash, const unsigned char* p, const unsigned char* end) {
+    while (p + 8 <= end) {
+        hash ^= mixRound(0, read64(p));
+        hash = rotateLeft(hash, 27) * kPrime1 + kPrime4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        hash ^= static_cast<uint64_t>(read32(p)) * kPrime1;
+        hash = rotateLeft(hash, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    while (p < end) {
+        hash ^= static_cast<uint64_t>(*p) * kPrime5;
+        hash = rotateLeft(hash, 11) * kPrime1;
+        p++;
+    }
+
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// Four independent lanes keep the multiplier pipelines busy
+const unsigned char* consumeStripes(uint64_t lanes[4], const unsigned char* p,
+                                    const unsigned char* limit) {
+    do {
+        lanes[0] = mixRound(lanes[0], read64(p));
+        lanes[1] = mixRound(lanes[1], read64(p + 8));
+        lanes[2] = mixRound(lanes[2], read64(p + 16));
+        lanes[3] = mixRound(lanes[3], read64(p + 24));
+        p += 32;
+    } while (p <= limit);
+    return p;
+}
+
+void initLanes(uint64_t lanes[4], uint64_t seed) {
+    lanes[0] = seed + kPrime1 + kPrime2;
+    lanes[1] = seed + kPrime2;
+    lanes[2] = seed;
+    lanes[3] = seed - kPrime1;
+}
+
+} // namespace
+
+uint64_t hashContent(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+    uint64_t hash;
+
+    if (size >= 32) {
+        uint64_t lanes[4];
+        initLanes(lanes, seed);
+        p = consumeStripes(lanes, p, end - 32);
+        hash = mergeLanes(lanes);
+    } else {
+        hash = seed + kPrime5;
+    }
+
+    hash += static_cast<uint64_t>(size);
+    return finalize(hash, p, end);
+}
+
+ContentHasher::ContentHasher(uint64_t seed) : seed(seed), buffered(0), total(0) {
+    initLanes(lanes, seed);
+}
+
+void ContentHasher::update(const void* data, size_t size) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+    total += size;
+
+    if (buffered + size < sizeof(buffer)) {
+        std::memcpy(buffer + buffered, p, size);
+        buffered += size;
+        return;
+    }
+    if (buffered > 0) {
+        size_t fill = sizeof(buffer) - buffered;
+        std::memcpy(buffer + buffered, p, fill);
+        consumeStripes(lanes, buffer, buffer);
+        p += fill;
+        buffered = 0;
+    }
+    if (end - p >= 32) {
+        p = consumeStripes(lanes, p, end - 32);
+    }
+    std::memcpy(buffer, p, static_cast<size_t>(end - p));
+    buffered = static_cast<size_t>(end - p);
+}
+
+uint64_t ContentHasher::digest() const {
+    uint64_t hash = total >= 32 ? mergeLanes(lanes) : seed + kPrime5;
+    hash += total;
+    return finalize(hash, buffer, buffer + buffered);
+}
+
+bool hashFile(const std::string& path, uint64_t seed, uint64_t& hash) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    ContentHasher hasher(seed);
+    std::vector<char> chunk(1 << 20);
+    while (file) {
+        file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        hasher.update(chunk.data(), static_cast<size_t>(file.gcount()));
+    }
+    if (file.bad()) {
+        return false;
+    }
+    hash = hasher.digest();
+    return true;
+}
+
+std::string hashToHex(uint64_t hash) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(16, '0');
+    for (int i = 15; i >= 0; i--) {
+        hex[i] = digits[hash & 0xF];
+        hash >>= 4;
+    }
+    return hex;
+}
+
+} // namespace devpilot
@@ -0,0 +1,781 @@
+#include "declaration_scanner.hpp"
+#include <algorithm>
+#include <cctype>
+#include <unordered_set>
+
+namespace devpilot {
+
+// Single responsibility: Only turn a token stream into scoped declarations
+
+namespace {
+
+// Identifiers that can precede '(' at declaration level without naming a function
+const std::unordered_set<std::string_view>& nonFunctionKeywords() {
+    static const std::unordered_set<std::string_view> keywords = {
+        "if", "for", "while", "switch", "return", "sizeof", "alignof", "alignas", "decltype",
+        "static_assert", "noexcept", "throw", "typeid", "new", "delete", "catch", "case", "do",
+        "else", "explicit", "requires", "defined", "__attribute__", "__declspec", "asm", "__asm__",
+        "void", "bool", "char", "short", "int", "long", "float", "double", "signed", "unsigned",
+        "auto", "const", "volatile", "co_await", "co_return", "co_yield", "_Pragma"};
+    return keywords;
+}
+
+// Identifiers that can precede '(' inside a body without being called
+const std::unordered_set<std::string_view>& nonCallKeywords() {
+    static const std::unordered_set<std::string_view> keywords = {
+        "if", "for", "while", "switch", "return", "sizeof", "alignof", "alignas", "decltype",
+        "static_assert", "noexcept", "throw", "typeid", "catch", "requires", "defined",
+        "__attribute__", "__declspec", "asm", "__asm__", "co_return", "co_await", "co_yield",
+        "_Pragma", "static_cast", "dynamic_cast", "const_cast", "reinterpret_cast"};
+    return keywords;
+}
+
+// Keywords that may directly precede a call, unlike a type name in "Foo x(1)"
+bool introducesExpression(std::string_view text) {
+    return text == "return" || text == "new" || text == "delete" || text == "throw" ||
+           text == "else" || text == "do" || text == "case" || text == "co_await" ||
+           text == "co_return" || text == "co_yield" || text == "and" || text == "or" ||
+           text == "not";
+}
+
+bool isAccessSpecifier(std::string_view text) {
+    return text == "public" || text == "private" || text == "protected" || text == "signals" ||
+           text == "slots" || text == "Q_SIGNALS" || text == "Q_SLOTS";
+}
+
+bool isPunct(const Token& token, const char* text) {
+    return token.kind == TokenKind::PUNCTUATION && token.text == text;
+}
+
+size_t tokenEnd(const Token& token) {
+    return token.offset + token.text.size();
+}
+
+} // namespace
+
+DeclarationScanner::DeclarationScanner(std::string_view filePath, ParseResult& result,
+                                       bool extractCalls)
+    : filePath(filePath), result(result),
+      extractCalls(extractCalls), opaqueDepth(0), skipBraceDepth(0), functionSymbolIndex(-1),
+      bodyParenDepth(0), pendingToken() {
+    resetStatement();
+}
+
+size_t DeclarationScanner::retainedOffset() const {
+    size_t offset = statementStart;
+    if (!statement.empty()) {
+        offset = std::min(offset, statement.front().offset);
+    }
+    if (!recentBodyTokens.empty()) {
+        offset = std::min(offset, recentBodyTokens.front().offset);
+    }
+    return offset;
+}
+
+void DeclarationScanner::release(size_t offset) {
+    bool statementCut = (statementStart != std::string_view::npos && statementStart < offset) ||
+                        (!statement.empty() && statement.front().offset < offset);
+    if (statementCut) {
+        if (sawAssign && pending != Pending::FUNCTION) {
+            // An initializer declares nothing more; only its nesting still matters
+            statement.clear();
+            statementStart = std::string_view::npos;
+            pending = Pending::NONE;
+        } else {
+            // A declaration this long is given up
+            resetStatement();
+        }
+    }
+    size_t kept = 0;
+    while (kept < recentBodyTokens.size() && recentBodyTokens[kept].offset < offset) {
+        kept++;
+    }
+    recentBodyTokens.erase(recentBodyTokens.begin(), recentBodyTokens.begin() + kept);
+}
+
+void DeclarationScanner::moveWindow(std::string_view window, size_t base) {
+    auto relocate = [&](Token& token) {
+        token.text = token.offset >= base ? window.substr(token.offset - base, token.text.size())
+                                          : std::string_view();
+    };
+    for (auto& token : statement) {
+        relocate(token);
+    }
+    for (auto& token : recentBodyTokens) {
+        relocate(token);
+    }
+    relocate(pendingToken);
+}
+
+bool DeclarationScanner::isActive() const {
+    return conditionals.empty() || conditionals.back().active;
+}
+
+std::string_view DeclarationScanner::currentScope() const {
+    return scopes.empty() ? std::string_view() : scopes.back().qualified;
+}
+
+std::string_view DeclarationScanner::qualify(std::string_view name) {
+    std::string_view scope = currentScope();
+    return scope.empty() ? result.arena.copy(name) : result.arena.concat(scope, "::", name);
+}
+
+// "A::B" declares B inside A
+size_t DeclarationScanner::unqualifiedSize(std::string_view name) {
+    size_t lastSeparator = name.rfind("::");
+    return lastSeparator == std::string_view::npos ? name.size() : name.size() - lastSeparator - 2;
+}
+
+void DeclarationScanner::resetStatement() {
+    statement.clear();
+    statementStart = std::string_view::npos;
+    parenDepth = 0;
+    bracketDepth = 0;
+    templateDepth = 0;
+    expectTemplateArgs = false;
+    sawAssign = false;
+    isEnum = false;
+    noDeclarations = false;
+    pending = Pending::NONE;
+
+    pendingName.clear();
+    pendingKeywordOffset = std::string_view::npos;
+    classAngleDepth = 0;
+    classBaseClause = false;
+    afterScopeOperator = false;
+
+    functionName.clear();
+    functionQualifier.clear();
+    declaratorOpen = false;
+    declaratorClosed = false;
+    inInitList = false;
+    identifiersSinceDeclarator = 0;
+    signatureEnd = 0;
+    signatureComplete = false;
+    operatorMode = false;
+    operatorIndex = 0;
+    operatorName.clear();
+
+    paramCommas = 0;
+    paramDefaults = 0;
+    paramTokens = 0;
+    declaratorAngleDepth = 0;
+    paramsVariadic = false;
+    paramsOnlyVoid = false;
+    functionParamCount = -1;
+    functionRequiredParamCount = -1;
+}
+
+void DeclarationScanner::feed(const Token& token) {
+    if (token.kind == TokenKind::PREPROCESSOR) {
+        feedDirective(token);
+        return;
+    }
+    if (token.kind == TokenKind::END || !isActive()) {
+        return;
+    }
+
+    if (opaqueDepth > 0) {
+        feedBody(token);
+        return;
+    }
+
+    if (skipBraceDepth > 0) {
+        if (isPunct(token, "{")) {
+            skipBraceDepth++;
+        } else if (isPunct(token, "}")) {
+            skipBraceDepth--;
+        }
+        return;
+    }
+
+    feedDeclaration(token);
+}
+
+void DeclarationScanner::feedDirective(const Token& token) {
+    std::string_view text = token.text;
+    size_t pos = text.find_first_not_of(" \t", 1);
+    if (pos == std::string_view::npos) {
+        return;
+    }
+    size_t nameEnd = pos;
+    while (nameEnd < text.size() && std::isalpha(static_cast<unsigned char>(text[nameEnd]))) {
+        nameEnd++;
+    }
+    std::string_view directive = text.substr(pos, nameEnd - pos);
+    size_t argStart = text.find_first_not_of(" \t", nameEnd);
+    std::string_view argument = argStart == std::string_view::npos ? "" : text.substr(argStart);
+
+    // Only the first taken branch of each #if chain is parsed, which keeps
+    // braces balanced when branches open alternative definitions
+    if (directive == "if" || directive == "ifdef" || directive == "ifndef") {
+        bool disabled = directive == "if" && argument.substr(0, argument.find_first_of(" \t/")) == "0";
+        bool parentActive = isActive();
+        conditionals.push_back({parentActive && !disabled, !disabled});
+    } else if (directive == "elif" || directive == "else") {
+        if (conditionals.empty()) {
+            return;
+        }
+        bool parentActive = conditionals.size() < 2 || conditionals[conditionals.size() - 2].active;
+        Conditional& current = conditionals.back();
+        current.active = parentActive && !current.taken;
+        current.taken = true;
+    } else if (directive == "endif") {
+        if (!conditionals.empty()) {
+            conditionals.pop_back();
+        }
+    } else if (directive == "include" && isActive()) {
+        if (argument.empty() || (argument[0] != '"' && argument[0] != '<')) {
+            return;
+        }
+        bool isSystem = argument[0] == '<';
+        size_t close = argument.find(isSystem ? '>' : '"', 1);
+        if (close == std::string_view::npos || close == 1) {
+            return;
+        }
+        result.includes.push_back({result.arena.copy(argument.substr(1, close - 1)), isSystem, token.line});
+    }
+}
+
+void DeclarationScanner::feedBody(const Token& token) {
+    if (isPunct(token, "{")) {
+        scopes.push_back({ScopeKind::OPAQUE, currentScope()});
+        opaqueDepth++;
+        recentBodyTokens.clear();
+        return;
+    }
+    if (isPunct(token, "}")) {
+        closeBrace(token);
+        recentBodyTokens.clear();
+        return;
+    }
+    if (functionSymbolIndex < 0 || !extractCalls) {
+        return;
+    }
+
+    // Any token inside an open argument list means that call has arguments
+    if (!isPunct(token, ")")) {
+        for (auto& call : pendingCalls) {
+            if (bodyParenDepth >= call.parenDepth) {
+                call.hasArguments = true;
+            }
+        }
+    }
+
+    if (token.kind == TokenKind::PUNCTUATION) {
+        if (token.text == "(") {
+            beginCall();
+            bodyParenDepth++;
+        } else if (token.text == ")") {
+            if (!pendingCalls.empty() && pendingCalls.back().parenDepth == bodyParenDepth) {
+                finishCall();
+            }
+            if (bodyParenDepth > 0) {
+                bodyParenDepth--;
+            }
+        } else if (token.text == "," && !pendingCalls.empty() &&
+                   pendingCalls.back().parenDepth == bodyParenDepth) {
+            pendingCalls.back().commas++;
+        } else if (token.text == ";") {
+            recentBodyTokens.clear();
+            return;
+        }
+    }
+
+    // Only the tail of the current expression is needed to read qualifiers
+    if (recentBodyTokens.size() >= 64) {
+        recentBodyTokens.erase(recentBodyTokens.begin(), recentBodyTokens.begin() + 32);
+    }
+    recentBodyTokens.push_back(token);
+}
+
+void DeclarationScanner::beginCall() {
+    if (recentBodyTokens.empty()) {
+        return;
+    }
+    size_t index = recentBodyTokens.size() - 1;
+    const Token& name = recentBodyTokens[index];
+    if (name.kind != TokenKind::IDENTIFIER || isCppKeyword(name.text) ||
+        nonCallKeywords().count(name.text)) {
+        return;
+    }
+
+    CallSite site;
+    site.caller_index = static_cast<uint32_t>(functionSymbolIndex);
+    site.callee_name = name.text;
+    site.is_member = false;
+    site.arg_count = 0;
+    site.line_number = name.line;
+    site.column_number = name.column;
+
+    // Walk back over "A::B::" qualifiers, or note member access through "." / "->"
+    scratch.clear();
+    while (index >= 2 && isPunct(recentBodyTokens[index - 1], "::") &&
+           recentBodyTokens[index - 2].kind == TokenKind::IDENTIFIER) {
+        if (!scratch.empty()) {
+            scratch.insert(0, "::");
+        }
+        scratch.insert(0, recentBodyTokens[index - 2].text);
+        index -= 2;
+    }
+    if (index >= 1) {
+        const Token& before = recentBodyTokens[index - 1];
+        if (isPunct(before, ".") || isPunct(before, "->")) {
+            site.is_member = true;
+        } else if (before.kind == TokenKind::IDENTIFIER && !introducesExpression(before.text)) {
+            // "Type name(args)" declares a variable rather than calling a function
+            return;
+        }
+    }
+
+    site.callee_name = result.arena.copy(site.callee_name);
+    site.qualifier = result.arena.copy(scratch);
+    pendingCalls.push_back({site, bodyParenDepth + 1, 0, false});
+}
+
+void DeclarationScanner::finishCall() {
+    PendingCall call = pendingCalls.back();
+    pendingCalls.pop_back();
+    call.site.arg_count = call.hasArguments ? call.commas + 1 : 0;
+    result.calls.push_back(call.site);
+}
+
+void DeclarationScanner::countParameterToken(const Token& token) {
+    paramTokens++;
+    if (paramTokens == 1) {
+        paramsOnlyVoid = token.kind == TokenKind::IDENTIFIER && token.text == "void";
+    } else {
+        paramsOnlyVoid = false;
+    }
+
+    if (token.kind != TokenKind::PUNCTUATION || parenDepth != 1) {
+        return;
+    }
+    if (token.text == "<") {
+        declaratorAngleDepth++;
+    } else if (token.text == ">" && declaratorAngleDepth > 0) {
+        declaratorAngleDepth--;
+    } else if (token.text == "," && declaratorAngleDepth == 0) {
+        paramCommas++;
+    } else if (token.text == "=" && declaratorAngleDepth == 0) {
+        paramDefaults++;
+    } else if (token.text == ".") {
+        paramsVariadic = true;
+    }
+}
+
+void DeclarationScanner::feedDeclaration(const Token& token) {
+    std::string_view text = token.text;
+    bool isIdentifier = token.kind == TokenKind::IDENTIFIER;
+    bool isPunctuation = token.kind == TokenKind::PUNCTUATION;
+
+    // template <...> prefixes are dropped; "class" inside them is not a class
+    if (templateDepth > 0) {
+        if (isPunctuation && text == "<") {
+            templateDepth++;
+        } else if (isPunctuation && text == ">") {
+            templateDepth--;
+        }
+        return;
+    }
+    if (expectTemplateArgs) {
+        expectTemplateArgs = false;
+        if (isPunctuation && text == "<") {
+            templateDepth = 1;
+            return;
+        }
+    }
+
+    if (isPunctuation && parenDepth == 0 && !operatorMode) {
+        if (text == "{") {
+            openBrace(token);
+            return;
+        }
+        if (text == "}") {
+            closeBrace(token);
+            return;
+        }
+        if (text == ";") {
+            endStatement(token);
+            return;
+        }
+    }
+
+    // A macro invocation without a trailing semicolon looks like a function
+    // declarator; a following declaration keyword means it was not one
+    if (isIdentifier && pending == Pending::FUNCTION && declaratorClosed && !inInitList &&
+        (text == "class" || text == "struct" || text == "union" || text == "namespace" ||
+         text == "enum" || text == "template" || text == "typedef" || text == "using")) {
+        resetStatement();
+    }
+
+    if (statementStart == std::string_view::npos) {
+        statementStart = token.offset;
+    }
+
+    if (operatorMode) {
+        // Collect the operator spelling up to the parameter list: "operator()",
+        // "operator==", "operator new[]", "operator bool"
+        if (!(isPunctuation && text == "(" && !operatorName.empty())) {
+            if (!operatorName.empty() && isIdentifier &&
+                !std::ispunct(static_cast<unsigned char>(operatorName.back()))) {
+                operatorName += " ";
+            }
+            operatorName += text;
+            statement.push_back(token);
+            return;
+        }
+        operatorMode = false;
+        pending = Pending::NONE;
+        bool spelledWithWord = std::isalpha(static_cast<unsigned char>(operatorName[0]));
+        beginFunction(operatorIndex, (spelledWithWord ? "operator " : "operator") + operatorName,
+                      statementStart);
+        parenDepth++;
+        statement.push_back(token);
+        return;
+    }
+
+    if (isIdentifier && parenDepth == 0 && bracketDepth == 0) {
+        if (text == "template") {
+            expectTemplateArgs = true;
+            if (statement.empty()) {
+                statementStart = std::string_view::npos;
+            }
+            return;
+        }
+        if (text == "typedef" || text == "using" || text == "friend" || text == "static_assert") {
+            noDeclarations = true;
+        } else if (text == "enum") {
+            isEnum = true;
+        } else if (text == "namespace" && pending == Pending::NONE && !noDeclarations) {
+            pending = Pending::NAMESPACE;
+            pendingToken = token;
+            pendingKeywordOffset = token.offset;
+            statement.push_back(token);
+            return;
+        } else if ((text == "class" || text == "struct" || text == "union") &&
+                   pending == Pending::NONE && !isEnum && !noDeclarations) {
+            pending = Pending::CLASS;
+            pendingKeywordOffset = token.offset;
+            statement.push_back(token);
+            return;
+        } else if (text == "operator" && !sawAssign && !noDeclarations) {
+            operatorMode = true;
+            operatorIndex = statement.size();
+            statement.push_back(token);
+            return;
+        }
+
+        if (pending == Pending::NAMESPACE) {
+            if (text != "inline") {
+                pendingName += text;
+            }
+        } else if (pending == Pending::CLASS && !classBaseClause && classAngleDepth == 0 &&
+                   text != "final" && text != "sealed" && text != "alignas" &&
+                   text != "__declspec" && text != "__attribute__") {
+            if (!afterScopeOperator) {
+                pendingName.clear();
+            }
+            pendingName += text;
+            pendingToken = token;
+            afterScopeOperator = false;
+        } else if (pending == Pending::FUNCTION && declaratorClosed) {
+            identifiersSinceDeclarator++;
+        }
+    }
+
+    if (declaratorOpen && !(isPunctuation && text == ")" && parenDepth == 1)) {
+        countParameterToken(token);
+    }
+
+    if (isPunctuation) {
+        if (text == "(") {
+            bool canDeclare = parenDepth == 0 && bracketDepth == 0 && !sawAssign &&
+                              !noDeclarations && !statement.empty() &&
+                              (pending != Pending::FUNCTION ||
+                               (declaratorClosed && !inInitList && identifiersSinceDeclarator > 0));
+            if (canDeclare) {
+                const Token& previous = statement.back();
+                if (previous.kind == TokenKind::IDENTIFIER &&
+                    !nonFunctionKeywords().count(previous.text)) {
+                    size_t start = statementStart;
+                    if (pending == Pending::FUNCTION) {
+                        // The earlier "declarator" was a macro; the declaration starts after it
+                        for (const auto& candidate : statement) {
+                            if (candidate.offset > signatureEnd) {
+                                start = candidate.offset;
+                                break;
+                            }
+                        }
+                    }
+                    beginFunction(statement.size() - 1, previous.text, start);
+                }
+            }
+            parenDepth++;
+        } else if (text == ")") {
+            if (parenDepth > 0) {
+                parenDepth--;
+            }
+            if (parenDepth == 0 && declaratorOpen) {
+                bool noParameters = paramTokens == 0 || (paramTokens == 1 && paramsOnlyVoid);
+                int fixedParams = noParameters ? 0 : paramCommas + (paramsVariadic ? 0 : 1);
+                functionParamCount = paramsVariadic ? -1 : fixedParams;
+                functionRequiredParamCount = fixedParams - paramDefaults;
+                declaratorOpen = false;
+                declaratorClosed = true;
+                identifiersSinceDeclarator = 0;
+                signatureEnd = tokenEnd(token);
+                statement.push_back(token);
+                return;
+            }
+        } else if (text == "[") {
+            bracketDepth++;
+        } else if (text == "]") {
+            if (bracketDepth > 0) {
+                bracketDepth--;
+            }
+        } else if (parenDepth == 0 && bracketDepth == 0) {
+            if (text == "=") {
+                if (pending == Pending::FUNCTION && declaratorClosed) {
+                    signatureComplete = true;
+                } else {
+                    sawAssign = true;
+                }
+            } else if (text == ":") {
+                if (!statement.empty() && statement.back().kind == TokenKind::IDENTIFIER &&
+                    isAccessSpecifier(statement.back().text)) {
+                    resetStatement();
+                    return;
+                }
+                if (pending == Pending::FUNCTION && declaratorClosed) {
+                    inInitList = true;
+                    signatureComplete = true;
+                } else if (pending == Pending::CLASS) {
+                    classBaseClause = true;
+                }
+            } else if (text == "::") {
+                if (pending == Pending::NAMESPACE) {
+                    pendingName += "::";
+                } else if (pending == Pending::CLASS && !classBaseClause && classAngleDepth == 0) {
+                    pendingName += "::";
+                    afterScopeOperator = true;
+                }
+            } else if (text == "<" && pending == Pending::CLASS && !classBaseClause) {
+                classAngleDepth++;
+            } else if (text == ">" && pending == Pending::CLASS && classAngleDepth > 0) {
+                classAngleDepth--;
+            }
+        }
+    }
+
+    if (pending == Pending::FUNCTION && declaratorClosed && !signatureComplete &&
+        parenDepth == 0) {
+        // Trailing qualifiers (const, noexcept, -> type) belong to the signature
+        signatureEnd = tokenEnd(token);
+    }
+
+    statement.push_back(token);
+}
+
+void DeclarationScanner::beginFunction(size_t nameIndex, std::string_view name,
+                                       size_t signatureStartOffset) {
+    // Built in place: these members keep their capacity between declarations
+    functionName.assign(name);
+    functionQualifier.clear();
+    size_t index = nameIndex;
+
+    if (index > 0 && isPunct(statement[index - 1], "~")) {
+        functionName.insert(0, "~");
+        index--;
+    }
+
+    // Walk back over "A::B<T>::" qualifiers written in front of the name
+    while (index >= 2 && isPunct(statement[index - 1], "::")) {
+        size_t scopeIndex = index - 2;
+        if (isPunct(statement[scopeIndex], ">")) {
+            int depth = 0;
+            while (scopeIndex > 0) {
+                if (isPunct(statement[scopeIndex], ">")) {
+                    depth++;
+                } else if (isPunct(statement[scopeIndex], "<") && --depth == 0) {
+                    break;
+                }
+                scopeIndex--;
+            }
+            if (scopeIndex == 0) {
+                break;
+            }
+            scopeIndex--;
+        }
+        if (statement[scopeIndex].kind != TokenKind::IDENTIFIER) {
+            break;
+        }
+        if (!functionQualifier.empty()) {
+            functionQualifier.insert(0, "::");
+        }
+        functionQualifier.insert(0, statement[scopeIndex].text);
+        index = scopeIndex;
+    }
+
+    pending = Pending::FUNCTION;
+    pendingToken = statement[nameIndex];
+    pendingKeywordOffset = std::string_view::npos;
+    declaratorOpen = true;
+    declaratorClosed = false;
+    inInitList = false;
+    statementStart = signatureStartOffset;
+    paramCommas = 0;
+    paramDefaults = 0;
+    paramTokens = 0;
+    declaratorAngleDepth = 0;
+    paramsVariadic = false;
+    paramsOnlyVoid = false;
+}
+
+void DeclarationScanner::openBrace(const Token& token) {
+    bool memberBraceInit = pending == Pending::FUNCTION && inInitList && !statement.empty() &&
+                           (statement.back().kind == TokenKind::IDENTIFIER ||
+                            isPunct(statement.back(), ">"));
+    if (bracketDepth > 0 || sawAssign || isEnum || memberBraceInit ||
+        (pending == Pending::FUNCTION && !declaratorClosed)) {
+        // Not a scope: skip the braced block but keep reading this declaration
+        skipBraceDepth = 1;
+        statement.push_back(token);
+        return;
+    }
+
+    switch (pending) {
+        case Pending::NAMESPACE:
+            emitNamespace();
+            break;
+        case Pending::CLASS:
+            emitClass();
+            break;
+        case Pending::FUNCTION:
+            emitFunction(true);
+            break;
+        case Pending::NONE:
+            if (statement.empty() || statement[0].text == "extern") {
+                // extern "C" { ... }: declarations inside keep the outer scope
+                scopes.push_back({ScopeKind::TRANSPARENT, currentScope()});
+            } else {
+                // Anything else (an inline friend body, an unrecognised macro) is skipped whole
+                scopes.push_back({ScopeKind::OPAQUE, currentScope()});
+                opaqueDepth++;
+            }
+            break;
+    }
+
+    // Until its closing brace is seen, a definition ends at its opening one
+    if (!scopes.empty() && scopes.back().symbolIndex >= 0) {
+        result.symbols[scopes.back().symbolIndex].end_offset = tokenEnd(token);
+    }
+    resetStatement();
+}
+
+void DeclarationScanner::closeBrace(const Token& token) {
+    if (!scopes.empty()) {
+        ScopeKind kind = scopes.back().kind;
+        if (scopes.back().symbolIndex >= 0) {
+            result.symbols[scopes.back().symbolIndex].end_offset = tokenEnd(token);
+        }
+        scopes.pop_back();
+        if ((kind == ScopeKind::FUNCTION || kind == ScopeKind::OPAQUE) && opaqueDepth > 0) {
+            opaqueDepth--;
+        }
+        if (kind == ScopeKind::FUNCTION) {
+            functionSymbolIndex = -1;
+            pendingCalls.clear();
+        }
+    }
+    if (opaqueDepth == 0) {
+        resetStatement();
+    }
+}
+
+void DeclarationScanner::endStatement(const Token& token) {
+    if (pending == Pending::FUNCTION && declaratorClosed) {
+        emitFunction(false);
+        result.symbols.back().end_offset = tokenEnd(token);
+    }
+    resetStatement();
+}
+
+// The record's name and parent scope are both slices of its qualified name,
+// which ends in the last nameSize characters
+SymbolRecord DeclarationScanner::makeRecord(SymbolType type, std::string_view qualified,
+                                            size_t nameSize) const {
+    SymbolRecord symbol;
+    symbol.type = type;
+    symbol.file_path = filePath;
+    symbol.line_number = pendingToken.line;
+    symbol.column_number = pendingToken.column;
+    // Namespaces and classes start at their keyword, past any macro in front
+    symbol.start_offset = pendingKeywordOffset != std::string_view::npos ? pendingKeywordOffset
+                          : statementStart != std::string_view::npos     ? statementStart
+                                                                         : pendingToken.offset;
+    symbol.end_offset = tokenEnd(pendingToken);
+    symbol.qualified_name = qualified;
+    symbol.name = qualified.substr(qualified.size() - nameSize);
+    if (qualified.size() > nameSize + 2) {
+        symbol.parent_scope = qualified.substr(0, qualified.size() - nameSize - 2);
+    }
+    return symbol;
+}
+
+void DeclarationScanner::emitNamespace() {
+    if (pendingName.empty()) {
+        // Anonymous namespaces do not add a qualification component
+        scopes.push_back({ScopeKind::TRANSPARENT, currentScope()});
+        return;
+    }
+
+    SymbolRecord symbol =
+        makeRecord(SymbolType::NAMESPACE, qualify(pendingName), unqualifiedSize(pendingName));
+    result.symbols.push_back(symbol);
+
+    scopes.push_back({ScopeKind::NAMESPACE, symbol.qualified_name,
+                      static_cast<int>(result.symbols.size() - 1)});
+}
+
+void DeclarationScanner::emitClass() {
+    if (pendingName.empty() || afterScopeOperator) {
+        // Anonymous struct/union: members belong to the enclosing scope
+        scopes.push_back({ScopeKind::TRANSPARENT, currentScope()});
+        return;
+    }
+
+    SymbolRecord symbol =
+        makeRecord(SymbolType::CLASS, qualify(pendingName), unqualifiedSize(pendingName));
+    result.symbols.push_back(symbol);
+
+    scopes.push_back({ScopeKind::CLASS, symbol.qualified_name,
+                      static_cast<int>(result.symbols.size() - 1)});
+}
+
+void DeclarationScanner::emitFunction(bool isDefinition) {
+    scratch.assign(currentScope());
+    if (!functionQualifier.empty()) {
+        scratch += scratch.empty() ? "" : "::";
+        scratch += functionQualifier;
+    }
+    scratch += scratch.empty() ? "" : "::";
+    scratch += functionName;
+
+    SymbolRecord symbol =
+        makeRecord(SymbolType::FUNCTION, result.arena.copy(scratch), functionName.size());
+    symbol.param_count = functionParamCount;
+    symbol.required_param_count = functionRequiredParamCount;
+    result.symbols.push_back(symbol);
+
+    if (isDefinition) {
+        functionSymbolIndex = static_cast<int>(result.symbols.size() - 1);
+        scopes.push_back({ScopeKind::FUNCTION, symbol.qualified_name, functionSymbolIndex});
+        opaqueDepth++;
+        bodyParenDepth = 0;
+        recentBodyTokens.clear();
+        pendingCalls.clear();
+    }
+}
+
+} // namespace devpilot
@@ -0,0 +1,182 @@
+#include "embedder.hpp"
+#include "content_hash.hpp"
+#include "logger.hpp"
+#include "source_snippet.hpp"
+#include "trace.hpp"
+#include <cctype>
+#include <cmath>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace devpilot {
+
+// Single responsibility: Only turn symbols and questions into vectors
+
+namespace {
+
+constexpr uint64_t kWordSeed = 0x6465767069766563ULL;
+
+// Words that say nothing about what code does: English glue, C++ keywords
+// and common types, and path noise
+const std::unordered_set<std::string>& stopWords() {
+    static const std::unordered_set<std::string> words = {
+        "a", "an", "and", "are", "as", "at", "be", "by", "do", "does", "for", "from", "how", "in",
+        "is", "it", "its", "of", "on", "or", "that", "the", "this", "to", "what", "when", "where",
+        "which", "who", "why", "with", "function", "method", "code",
+        "auto", "bool", "char", "class", "const", "constexpr", "default", "define", "delete",
+        "double", "else", "enum", "explicit", "false", "float", "if", "include", "inline", "int",
+        "long", "namespace", "new", "noexcept", "nullptr", "override", "private", "protected",
+        "public", "return", "short", "size_t", "static", "std", "string", "struct", "template",
+        "true", "typename", "unsigned", "using", "virtual", "void", "while",
+        "cc", "cpp", "cxx", "h", "hpp", "hxx", "src"};
+    return words;
+}
+
+// Cuts plural and tense endings, then a final e, so "retries", "retried"
+// and "retrying" all become "retry" and "parse" meets "parsing"
+void stem(std::string& word) {
+    auto endsWith = [&word](const char* suffix, size_t minimum) {
+        size_t length = std::char_traits<char>::length(suffix);
+        return word.size() >= minimum && word.compare(word.size() - length, length, suffix) == 0;
+    };
+    if (endsWith("ies", 5) || endsWith("ied", 5)) {
+        word.replace(word.size() - 3, 3, "y");
+    } else if (endsWith("ing", 6)) {
+        word.resize(word.size() - 3);
+    } else if (endsWith("ed", 5)) {
+        word.resize(word.size() - 2);
+    } else if (endsWith("s", 4) && !endsWith("ss", 4)) {
+        word.resize(word.size() - 1);
+    }
+    if (endsWith("e", 4)) {
+        word.resize(word.size() - 1);
+    }
+}
+
+bool isLower(char c) {
+    return c >= 'a' && c <= 'z';
+}
+
+bool isUpper(char c) {
+    return c >= 'A' && c <= 'Z';
+}
+
+// Calls onWord with each word of text, lowercased: identifiers split at
+// underscores and case changes ("HTTPRequest" is "http" and "request");
+// numbers are dropped
+template <typename OnWord>
+void forEachWord(std::string_view text, OnWord onWord) {
+    size_t i = 0;
+    while (i < text.size()) {
+        if (!std::isalpha(static_cast<unsigned char>(text[i]))) {
+            i++;
+            continue;
+        }
+        size_t start = i++;
+        while (i < text.size() && std::isalpha(static_cast<unsigned char>(text[i]))) {
+            bool lowerToUpper = isLower(text[i - 1]) && isUpper(text[i]);
+            bool acronymEnd = isUpper(text[i - 1]) && isUpper(text[i]) && i + 1 < text.size() &&
+                              isLower(text[i + 1]);
+            if (lowerToUpper || acronymEnd) {
+                break;
+            }
+            i++;
+        }
+        std::string word(text.substr(start, i - start));
+        for (char& c : word) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        onWord(std::move(word));
+    }
+}
+
+} // namespace
+
+HashingEmbedder::HashingEmbedder(size_t dimensions) : size(std::max<size_t>(1, dimensions)) {}
+
+std::string HashingEmbedder::id() const {
+    return "hashing-v1/" + std::to_string(size);
+}
+
+void HashingEmbedder::embed(std::string_view text, float* vector) const {
+    std::unordered_map<std::string, unsigned> counts;
+    const auto& stop = stopWords();
+    forEachWord(text, [&](std::string word) {
+        if (word.size() < 2 || stop.count(word)) {
+            return;
+        }
+        stem(word);
+        counts[word]++;
+    });
+
+    std::fill(vector, vector + size, 0.0f);
+    for (const auto& entry : counts) {
+        uint64_t hash = hashContent(entry.first.data(), entry.first.size(), kWordSeed);
+        float weight = 1.0f + std::log(static_cast<float>(entry.second));
+        vector[hash % size] += (hash >> 63) ? -weight : weight;
+    }
+    double norm = 0;
+    for (size_t i = 0; i < size; i++) {
+        norm += static_cast<double>(vector[i]) * vector[i];
+    }
+    if (norm > 0) {
+        float inverse = static_cast<float>(1.0 / std::sqrt(norm));
+        for (size_t i = 0; i < size; i++) {
+            vector[i] *= inverse;
+        }
+    }
+}
+
+std::string symbolEmbeddingText(const Symbol& symbol, std::string_view source, size_t maxSourceBytes) {
+    std::string text = symbol.qualified_name.empty() ? symbol.name : symbol.qualified_name;
+    text += "\n";
+    text += symbol.file_path;
+    text += "\n";
+    text += source.substr(0, maxSourceBytes);
+    return text;
+}
+
+// Symbols come in id order, which is file by file, so only the current
+// file is kept mapped
+bool embedIndex(ShardedStorage& index, const Embedder& embedder, const std::string& path,
+                const VectorBuildOptions& options, EmbedSummary& summary) {
+    summary = EmbedSummary();
+    VectorIndexBuilder builder(embedder.dimensions());
+    std::vector<float> vector(embedder.dimensions());
+    std::unique_ptr<SnippetReader> snippets;
+    std::string currentFile;
+
+    auto start = std::chrono::steady_clock::now();
+    bool scanned;
+    {
+        trace::Scope scope("embed symbols");
+        scanned = index.scanSymbols([&](int64_t id, const Symbol& symbol) {
+            if (!snippets || symbol.file_path != currentFile) {
+                snippets = std::make_unique<SnippetReader>();
+                currentFile = symbol.file_path;
+            }
+            std::string_view source;
+            if (snippets->text(symbol, source) != SnippetStatus::OK) {
+                source = std::string_view();
+                summary.missingSources++;
+            }
+            embedder.embed(symbolEmbeddingText(symbol, source), vector.data());
+            builder.add(id, vector.data());
+            summary.symbols++;
+        });
+    }
+    auto embedded = std::chrono::steady_clock::now();
+    summary.embedTime = embedded - start;
+    if (!scanned) {
+        logging::error("Cannot read the symbols to embed");
+        return false;
+    }
+
+    bool written = builder.write(path, embedder.id(), index.indexStamp(), options, summary.lists);
+    summary.buildTime = std::chrono::steady_clock::now() - embedded;
+    return written;
+}
+
+} // namespace devpilot
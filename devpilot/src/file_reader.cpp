@@ -0,0 +1,678 @@
+#include "file_reader.hpp"
+#include "memory_accounting.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define DEVPILOT_HAVE_IO_URING 1
+#endif
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define DEVPILOT_HAVE_MMAP 1
+#endif
+
+#if defined(DEVPILOT_HAVE_IO_URING)
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace devpilot {
+
+// Single responsibility: Only read whole files into memory for the parse stage
+
+// Fixed-size slots carved out of one allocation, so the whole pool can be
+// registered with the kernel once
+class BufferPool {
+public:
+    BufferPool(size_t count, size_t slotSize) : slotSize(slotSize), count(count) {
+        memory = static_cast<char*>(std::malloc(count * slotSize));
+        for (size_t i = count; i > 0; i--) {
+            freeSlots.push_back(static_cast<int>(i - 1));
+        }
+    }
+
+    ~BufferPool() {
+        std::free(memory);
+    }
+
+    // Blocks until a parser releases a slot
+    int acquire() {
+        std::unique_lock<std::mutex> lock(mutex);
+        released.wait(lock, [this] { return !freeSlots.empty(); });
+        int slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+
+    int tryAcquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (freeSlots.empty()) {
+            return -1;
+        }
+        int slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+
+    void release(int slot) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeSlots.push_back(slot);
+        }
+        released.notify_one();
+    }
+
+    char* slotData(int slot) const {
+        return memory + static_cast<size_t>(slot) * slotSize;
+    }
+
+    const size_t slotSize;
+    const size_t count;
+    char* memory;
+
+private:
+    std::mutex mutex;
+    std::condition_variable released;
+    std::vector<int> freeSlots;
+};
+
+// Bytes held by heap buffers. A charge waits while it would take the total
+// over the limit; with nothing held it is let through whatever its size, so
+// one file larger than the limit cannot wait forever.
+class HeapBudget {
+public:
+    explicit HeapBudget(uint64_t limit) : limit(limit) {}
+
+    // Blocks until parsers release enough earlier buffers
+    void acquire(size_t bytes) {
+        std::unique_lock<std::mutex> lock(mutex);
+        released.wait(lock, [&] { return held == 0 || held + bytes <= limit; });
+        held += bytes;
+    }
+
+    void release(size_t bytes) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            held -= bytes;
+        }
+        released.notify_all();
+    }
+
+private:
+    const uint64_t limit;
+    uint64_t held = 0;
+    std::mutex mutex;
+    std::condition_variable released;
+};
+
+// Buffers bigger than a slot are mapped directly where possible: malloc
+// keeps a freed block this large for reuse, and resident memory would stop
+// following what the heap budget counts
+static char* allocateHeap(size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+#if defined(DEVPILOT_HAVE_MMAP)
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return memory == MAP_FAILED ? nullptr : static_cast<char*>(memory);
+#else
+    return static_cast<char*>(std::malloc(size));
+#endif
+}
+
+static void freeHeap(char* memory, size_t size) {
+    if (!memory) {
+        return;
+    }
+#if defined(DEVPILOT_HAVE_MMAP)
+    munmap(memory, size);
+#else
+    (void)size;
+    std::free(memory);
+#endif
+}
+
+FileBuffer::FileBuffer(FileBuffer&& other) noexcept {
+    *this = std::move(other);
+}
+
+FileBuffer& FileBuffer::operator=(FileBuffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool = other.pool;
+        slot = other.slot;
+        budget = other.budget;
+        charged = other.charged;
+        size = other.size;
+        readable = other.readable;
+        streamed = other.streamed;
+        totalSize = other.totalSize;
+        heap = other.heap;
+        heapSize = other.heapSize;
+        data = other.data;
+        other.heap = nullptr;
+        other.heapSize = 0;
+        other.pool = nullptr;
+        other.slot = -1;
+        other.budget = nullptr;
+        other.charged = 0;
+        other.data = nullptr;
+        other.size = 0;
+        other.readable = false;
+        other.streamed = false;
+        other.totalSize = 0;
+    }
+    return *this;
+}
+
+FileBuffer::~FileBuffer() {
+    release();
+}
+
+void FileBuffer::release() {
+    if (pool && slot >= 0) {
+        pool->release(slot);
+    }
+    freeHeap(heap, heapSize);
+    if (budget && charged > 0) {
+        budget->release(charged);
+    }
+    pool = nullptr;
+    slot = -1;
+    heap = nullptr;
+    heapSize = 0;
+    budget = nullptr;
+    charged = 0;
+}
+
+bool FileBuffer::ok() const {
+    return readable;
+}
+
+std::string_view FileBuffer::contents() const {
+    return std::string_view(data, size);
+}
+
+bool FileBuffer::deferred() const {
+    return streamed;
+}
+
+uint64_t FileBuffer::fileSize() const {
+    return totalSize;
+}
+
+// Blocking read used by the fallback threads
+FileBuffer FileReader::readBlocking(const std::string& path, BufferPool* pool, int slot,
+                                    uint64_t streamAbove, HeapBudget* budget) {
+    FileBuffer buffer;
+    auto releaseSlot = [&]() {
+        if (pool && slot >= 0) {
+            pool->release(slot);
+        }
+        slot = -1;
+    };
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        releaseSlot();
+        return buffer;
+    }
+    std::streamoff length = file.tellg();
+    file.seekg(0);
+    if (length < 0) {
+        releaseSlot();
+        return buffer;
+    }
+
+    size_t size = static_cast<size_t>(length);
+    buffer.totalSize = size;
+    if (size > streamAbove) {
+        releaseSlot();
+        buffer.streamed = true;
+        return buffer;
+    }
+    char* target = nullptr;
+    if (pool && slot >= 0 && size <= pool->slotSize) {
+        target = pool->slotData(slot);
+    } else {
+        releaseSlot();
+        if (budget) {
+            budget->acquire(size);
+            buffer.budget = budget;
+            buffer.charged = size;
+        }
+        buffer.heap = allocateHeap(size);
+        buffer.heapSize = size;
+        if (!buffer.heap && size > 0) {
+            return buffer;
+        }
+        target = buffer.heap;
+    }
+    file.read(target, static_cast<std::streamsize>(size));
+
+    buffer.pool = slot >= 0 ? pool : nullptr;
+    buffer.slot = slot;
+    buffer.data = target;
+    buffer.size = static_cast<size_t>(file.gcount());
+    buffer.readable = true;
+    return buffer;
+}
+
+FileBuffer FileReader::read(const std::string& path, uint64_t streamAbove) {
+    return readBlocking(path, nullptr, -1, streamAbove);
+}
+
+#if defined(DEVPILOT_HAVE_IO_URING)
+
+// Minimal io_uring driver over the raw syscalls: one submission and one
+// completion ring mapped into memory, no liburing
+class IoRing {
+public:
+    static std::unique_ptr<IoRing> create(unsigned entries, BufferPool& pool) {
+        std::unique_ptr<IoRing> ring(new IoRing());
+        if (!ring->setup(entries, pool)) {
+            return nullptr;
+        }
+        return ring;
+    }
+
+    ~IoRing() {
+        if (sqes) {
+            munmap(sqes, params.sq_entries * sizeof(io_uring_sqe));
+        }
+        if (cqRing && cqRing != sqRing) {
+            munmap(cqRing, cqRingSize);
+        }
+        if (sqRing) {
+            munmap(sqRing, sqRingSize);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    unsigned capacity() const {
+        return params.sq_entries;
+    }
+
+    bool fixedBuffers() const {
+        return buffersRegistered;
+    }
+
+    // Caller guarantees fewer than capacity() operations are outstanding
+    io_uring_sqe* nextSqe() {
+        unsigned index = localTail & *sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqArray[index] = index;
+        localTail++;
+        pendingSubmissions++;
+        return sqe;
+    }
+
+    // Publishes queued entries to the kernel and waits for at least one completion
+    bool submitAndWait() {
+        __atomic_store_n(sqTail, localTail, __ATOMIC_RELEASE);
+        while (true) {
+            long result = syscall(__NR_io_uring_enter, fd, pendingSubmissions, 1,
+                                  IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (result >= 0) {
+                pendingSubmissions -= static_cast<unsigned>(result);
+                return true;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                return false;
+            }
+        }
+    }
+
+    template <typename Visitor>
+    void drainCompletions(Visitor&& visit) {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            const io_uring_cqe& cqe = cqes[head & *cqMask];
+            visit(cqe.user_data, cqe.res);
+            head++;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+
+private:
+    int fd = -1;
+    io_uring_params params{};
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned localTail = 0;
+    unsigned pendingSubmissions = 0;
+    bool buffersRegistered = false;
+
+    bool setup(unsigned entries, BufferPool& pool) {
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            return false;  // ENOSYS, or disabled by seccomp or kernel.io_uring_disabled
+        }
+        // Asynchronous openat arrived in the same release as this feature flag
+        if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+            return false;
+        }
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMap) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                      IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            sqRing = nullptr;
+            return false;
+        }
+        cqRing = singleMap ? sqRing
+                           : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            cqRing = nullptr;
+            return false;
+        }
+        void* sqeMemory = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe),
+                               PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqeMemory == MAP_FAILED) {
+            return false;
+        }
+        sqes = static_cast<io_uring_sqe*>(sqeMemory);
+
+        char* sq = static_cast<char*>(sqRing);
+        char* cq = static_cast<char*>(cqRing);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        localTail = *sqTail;
+
+        // Pinning the pool lets reads skip per-operation page mapping. It can
+        // fail under a low RLIMIT_MEMLOCK; plain reads into the slots still work.
+        std::vector<iovec> iovecs(pool.count);
+        for (size_t i = 0; i < pool.count; i++) {
+            iovecs[i].iov_base = pool.slotData(static_cast<int>(i));
+            iovecs[i].iov_len = pool.slotSize;
+        }
+        buffersRegistered = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS,
+                                    iovecs.data(), static_cast<unsigned>(iovecs.size())) == 0;
+        return true;
+    }
+};
+
+#else
+
+class IoRing {};
+
+#endif
+
+FileReader::FileReader(size_t bufferCount, size_t bufferSize, unsigned fallbackThreads,
+                       uint64_t streamAbove, uint64_t heapLimit)
+    : pool(new BufferPool(bufferCount == 0 ? 1 : bufferCount, bufferSize == 0 ? 4096 : bufferSize)),
+      budget(new HeapBudget(heapLimit)),
+      fallbackThreads(fallbackThreads == 0 ? 1 : fallbackThreads), streamAbove(streamAbove) {
+#if defined(DEVPILOT_HAVE_IO_URING)
+    if (!std::getenv("DEVPILOT_NO_IO_URING")) {
+        ring = IoRing::create(static_cast<unsigned>(std::min<size_t>(pool->count, 256)), *pool);
+    }
+#endif
+}
+
+FileReader::~FileReader() = default;
+
+const char* FileReader::backend() const {
+    return ring ? "io_uring" : "threads";
+}
+
+void FileReader::run(WorkQueue<ReadRequest>& requests, const CompletionSink& complete) {
+    memory::TagScope tag(memory::MemoryTag::READER);
+    if (ring) {
+        // Waiting for heap budget would stall every read in the ring, so a
+        // thread of its own reads the files bigger than a slot
+        WorkQueue<ReadRequest> oversize;
+        std::thread oversizeReader([&]() {
+            memory::TagScope tag(memory::MemoryTag::READER);
+            ReadRequest request;
+            while (oversize.pop(request)) {
+                FileBuffer buffer = readBlocking(request.path, nullptr, -1, streamAbove, budget.get());
+                complete({std::move(request.path), request.user_data, std::move(buffer)});
+            }
+        });
+        runRing(requests, complete, oversize);
+        oversize.close();
+        oversizeReader.join();
+    } else {
+        runThreads(requests, complete);
+    }
+}
+
+void FileReader::runThreads(WorkQueue<ReadRequest>& requests, const CompletionSink& complete) {
+    auto worker = [&]() {
+        memory::TagScope tag(memory::MemoryTag::READER);
+        ReadRequest request;
+        while (requests.pop(request)) {
+            int slot = pool->acquire();
+            FileBuffer buffer = readBlocking(request.path, pool.get(), slot, streamAbove, budget.get());
+            complete({std::move(request.path), request.user_data, std::move(buffer)});
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < fallbackThreads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+#if defined(DEVPILOT_HAVE_IO_URING)
+
+void FileReader::runRing(WorkQueue<ReadRequest>& requests, const CompletionSink& complete,
+                         WorkQueue<ReadRequest>& oversize) {
+    // One in-flight file: opened asynchronously, then read until complete
+    struct Operation {
+        ReadRequest request;
+        int fd = -1;
+        int slot = -1;
+        char* target = nullptr;
+        size_t size = 0;
+        size_t offset = 0;
+        bool opening = true;
+        bool deferred = false;  // Above the stream limit: only its size is reported
+    };
+
+    std::vector<std::unique_ptr<Operation>> operations(ring->capacity());
+    std::vector<size_t> freeIndexes;
+    for (size_t i = operations.size(); i > 0; i--) {
+        freeIndexes.push_back(i - 1);
+    }
+    size_t inFlight = 0;
+    bool inputDone = false;
+
+    auto retire = [&](size_t index) {
+        std::unique_ptr<Operation> operation = std::move(operations[index]);
+        freeIndexes.push_back(index);
+        inFlight--;
+        if (operation->fd >= 0) {
+            close(operation->fd);
+        }
+        return operation;
+    };
+
+    auto finish = [&](size_t index, bool readable) {
+        std::unique_ptr<Operation> operation = retire(index);
+
+        FileBuffer buffer;
+        buffer.readable = readable;
+        buffer.streamed = operation->deferred;
+        buffer.totalSize = operation->size;
+        if (readable) {
+            buffer.pool = pool.get();
+            buffer.slot = operation->slot;
+            buffer.data = operation->target;
+        } else {
+            pool->release(operation->slot);
+        }
+        buffer.size = readable ? operation->offset : 0;
+        complete({std::move(operation->request.path), operation->request.user_data,
+                  std::move(buffer)});
+    };
+
+    auto queueRead = [&](size_t index) {
+        Operation& operation = *operations[index];
+        io_uring_sqe* sqe = ring->nextSqe();
+        bool fixed = operation.slot >= 0 && ring->fixedBuffers();
+        sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->fd = operation.fd;
+        sqe->addr = reinterpret_cast<uint64_t>(operation.target + operation.offset);
+        sqe->len = static_cast<unsigned>(std::min<size_t>(operation.size - operation.offset, 1u << 30));
+        sqe->off = operation.offset;
+        sqe->buf_index = fixed ? static_cast<uint16_t>(operation.slot) : 0;
+        sqe->user_data = index;
+    };
+
+    while (true) {
+        // Keep as many opens and reads in flight as slots allow. With nothing
+        // outstanding it is safe to block for input or a free buffer.
+        while (!inputDone && !freeIndexes.empty()) {
+            int slot = inFlight == 0 ? pool->acquire() : pool->tryAcquire();
+            if (slot < 0) {
+                break;
+            }
+            ReadRequest request;
+            bool popped = inFlight == 0 ? requests.pop(request) : requests.tryPop(request);
+            if (!popped) {
+                pool->release(slot);
+                inputDone = inFlight == 0;
+                break;
+            }
+
+            size_t index = freeIndexes.back();
+            freeIndexes.pop_back();
+            operations[index].reset(new Operation());
+            Operation& operation = *operations[index];
+            operation.request = std::move(request);
+            operation.slot = slot;
+            inFlight++;
+
+            io_uring_sqe* sqe = ring->nextSqe();
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<uint64_t>(operation.request.path.c_str());
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            sqe->user_data = index;
+        }
+
+        if (inFlight == 0) {
+            if (inputDone) {
+                return;
+            }
+            continue;
+        }
+
+        if (!ring->submitAndWait()) {
+            // The ring broke mid-run: finish what is outstanding synchronously
+            for (size_t index = 0; index < operations.size(); index++) {
+                if (operations[index]) {
+                    finish(index, false);
+                }
+            }
+            ring.reset();
+            runThreads(requests, complete);
+            return;
+        }
+
+        ring->drainCompletions([&](uint64_t userData, int result) {
+            size_t index = static_cast<size_t>(userData);
+            Operation& operation = *operations[index];
+
+            if (operation.opening) {
+                operation.opening = false;
+                struct stat info;
+                if (result < 0 || fstat(result, &info) != 0) {
+                    operation.fd = result;
+                    finish(index, false);
+                    return;
+                }
+                operation.fd = result;
+                operation.size = static_cast<size_t>(info.st_size);
+                if (operation.size > streamAbove) {
+                    operation.deferred = true;
+                    finish(index, false);
+                    return;
+                }
+                if (operation.size > pool->slotSize) {
+                    std::unique_ptr<Operation> handed = retire(index);
+                    pool->release(handed->slot);
+                    oversize.push(std::move(handed->request));
+                    return;
+                }
+                operation.target = pool->slotData(operation.slot);
+                if (operation.size == 0) {
+                    finish(index, true);
+                } else {
+                    queueRead(index);
+                }
+                return;
+            }
+
+            if (result < 0) {
+                finish(index, false);
+                return;
+            }
+            operation.offset += static_cast<size_t>(result);
+            // Short reads continue where they stopped; zero means the file shrank
+            if (result == 0 || operation.offset >= operation.size) {
+                finish(index, true);
+            } else {
+                queueRead(index);
+            }
+        });
+    }
+}
+
+#else
+
+void FileReader::runRing(WorkQueue<ReadRequest>& requests, const CompletionSink& complete,
+                         WorkQueue<ReadRequest>&) {
+    runThreads(requests, complete);
+}
+
+#endif
+
+} // namespace devpilot
@@ -0,0 +1,260 @@
+#include "file_walker.hpp"
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace devpilot {
+
+// Single responsibility: Only discover C++ source files under a directory
+
+namespace {
+
+enum class EntryType { FILE, DIRECTORY, OTHER };
+
+struct DirectoryEntry {
+    std::string name;
+    EntryType type;
+};
+
+struct DirectoryTask {
+    std::string path;      // As passed to the callback: root-prefixed
+    std::string relative;  // Relative to the walk root, "" for the root
+    std::shared_ptr<const IgnoreScope> scope;
+};
+
+#if defined(__linux__)
+
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+// Classify through stat when d_type is missing or a symlink. Links to files
+// are followed; links to directories are not, which rules out cycles.
+EntryType statType(int directoryFd, const char* name) {
+    struct stat info;
+    if (fstatat(directoryFd, name, &info, 0) != 0) {
+        return EntryType::OTHER;
+    }
+    if (S_ISREG(info.st_mode)) {
+        return EntryType::FILE;
+    }
+    if (S_ISDIR(info.st_mode)) {
+        struct stat linkInfo;
+        bool isLink = fstatat(directoryFd, name, &linkInfo, AT_SYMLINK_NOFOLLOW) == 0 &&
+                      S_ISLNK(linkInfo.st_mode);
+        return isLink ? EntryType::OTHER : EntryType::DIRECTORY;
+    }
+    return EntryType::OTHER;
+}
+
+// One getdents64 call returns as many entries as fit in the buffer, instead
+// of one libc call (and possibly one stat) per entry
+bool listDirectory(const std::string& path, std::vector<DirectoryEntry>& entries) {
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    alignas(LinuxDirent64) char buffer[64 * 1024];
+    while (true) {
+        long bytes = syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+        if (bytes <= 0) {
+            break;
+        }
+        for (long offset = 0; offset < bytes;) {
+            auto* entry = reinterpret_cast<LinuxDirent64*>(buffer + offset);
+            offset += entry->d_reclen;
+
+            const char* name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+            EntryType type;
+            switch (entry->d_type) {
+                case DT_REG: type = EntryType::FILE; break;
+                case DT_DIR: type = EntryType::DIRECTORY; break;
+                case DT_LNK:
+                case DT_UNKNOWN: type = statType(fd, name); break;
+                default: type = EntryType::OTHER; break;
+            }
+            entries.push_back({name, type});
+        }
+    }
+
+    close(fd);
+    return true;
+}
+
+#else
+
+bool listDirectory(const std::string& path, std::vector<DirectoryEntry>& entries) {
+    std::error_code error;
+    std::filesystem::directory_iterator it(path, error);
+    if (error) {
+        return false;
+    }
+    for (; it != std::filesystem::directory_iterator(); it.increment(error)) {
+        if (error) {
+            break;
+        }
+        EntryType type = EntryType::OTHER;
+        std::error_code typeError;
+        if (it->is_regular_file(typeError)) {
+            type = EntryType::FILE;
+        } else if (it->is_directory(typeError) && !it->is_symlink(typeError)) {
+            type = EntryType::DIRECTORY;
+        }
+        entries.push_back({it->path().filename().string(), type});
+    }
+    return true;
+}
+
+#endif
+
+std::string readIgnoreFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+} // namespace
+
+FileWalker::FileWalker(unsigned threadCount)
+    : threadCount(threadCount == 0 ? 1 : threadCount), directoryCount(0), ignoredCount(0) {
+}
+
+bool FileWalker::isCppSource(std::string_view filename) {
+    size_t dot = filename.rfind('.');
+    if (dot == std::string_view::npos) {
+        return false;
+    }
+    std::string_view extension = filename.substr(dot + 1);
+    return extension == "cpp" || extension == "hpp" || extension == "h" || extension == "cc" ||
+           extension == "cxx" || extension == "hxx";
+}
+
+void FileWalker::walk(const std::string& root, const FileCallback& onFile) {
+    std::string rootPath = root;
+    while (rootPath.size() > 1 && rootPath.back() == '/') {
+        rootPath.pop_back();
+    }
+
+    auto defaults = std::make_shared<IgnoreScope>();
+    defaults->rules = defaultIgnoreRules();
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<DirectoryTask> pending;
+    unsigned busy = 0;  // Threads currently listing a directory
+    pending.push_back({rootPath, "", defaults});
+
+    auto worker = [&]() {
+        std::vector<DirectoryEntry> entries;
+        std::vector<DirectoryTask> discovered;
+
+        while (true) {
+            DirectoryTask task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return !pending.empty() || busy == 0; });
+                if (pending.empty()) {
+                    return;  // Nothing queued and nobody left to queue more
+                }
+                task = std::move(pending.front());
+                pending.pop_front();
+                busy++;
+            }
+
+            entries.clear();
+            discovered.clear();
+            listDirectory(task.path, entries);
+            directoryCount++;
+
+            // This directory's own ignore files apply to everything below it
+            std::shared_ptr<const IgnoreScope> scope = task.scope;
+            for (const char* ignoreFile : {".gitignore", ".devpilotignore"}) {
+                for (const auto& entry : entries) {
+                    if (entry.type == EntryType::FILE && entry.name == ignoreFile) {
+                        std::string text = readIgnoreFile(task.path + "/" + entry.name);
+                        auto local = std::make_shared<IgnoreScope>();
+                        local->parent = scope;
+                        local->base = task.relative;
+                        local->rules.addPatterns(text);
+                        if (!local->rules.empty()) {
+                            scope = local;
+                        }
+                    }
+                }
+            }
+
+            for (const auto& entry : entries) {
+                if (entry.type == EntryType::OTHER ||
+                    (entry.type == EntryType::FILE && !isCppSource(entry.name))) {
+                    continue;
+                }
+                std::string relative =
+                    task.relative.empty() ? entry.name : task.relative + "/" + entry.name;
+                bool isDirectory = entry.type == EntryType::DIRECTORY;
+                if (IgnoreScope::isIgnored(scope.get(), relative, entry.name, isDirectory)) {
+                    ignoredCount++;
+                    continue;
+                }
+
+                std::string path = task.path + "/" + entry.name;
+                if (isDirectory) {
+                    discovered.push_back({std::move(path), std::move(relative), scope});
+                } else {
+                    onFile(std::move(path));
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto& child : discovered) {
+                    pending.push_back(std::move(child));
+                }
+                busy--;
+            }
+            wake.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+uint64_t FileWalker::directoriesVisited() const {
+    return directoryCount;
+}
+
+uint64_t FileWalker::entriesIgnored() const {
+    return ignoredCount;
+}
+
+} // namespace devpilot
@@ -0,0 +1,288 @@
+#include "git_index.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace devpilot {
+
+// Single responsibility: Only read git's staging index and compare it to the work tree
+
+namespace {
+
+constexpr size_t kEntryFixedSize = 62;  // Stat fields (40) + SHA-1 (20) + flags (2)
+constexpr uint16_t kExtendedFlag = 0x4000;
+constexpr uint16_t kStageMask = 0x3000;
+constexpr uint16_t kSkipWorktreeFlag = 0x4000;  // In the extended flags word
+constexpr uint32_t kModeTypeMask = 0170000;
+constexpr uint32_t kModeRegularFile = 0100000;
+
+std::string readWholeFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return std::string();
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+uint32_t readBigEndian32(const unsigned char* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+uint16_t readBigEndian16(const unsigned char* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+std::string toHex(const unsigned char* bytes, size_t size) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(size * 2, '0');
+    for (size_t i = 0; i < size; i++) {
+        hex[2 * i] = digits[bytes[i] >> 4];
+        hex[2 * i + 1] = digits[bytes[i] & 0xF];
+    }
+    return hex;
+}
+
+std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+}
+
+// Repositories created with --object-format=sha256 use 32-byte object ids
+bool usesSha256(const std::filesystem::path& gitDir) {
+    std::filesystem::path commonDir = gitDir;
+    std::string common = trim(readWholeFile(gitDir / "commondir"));
+    if (!common.empty()) {
+        commonDir = std::filesystem::path(common).is_absolute() ? std::filesystem::path(common)
+                                                                : gitDir / common;
+    }
+
+    std::string config = readWholeFile(commonDir / "config");
+    config.erase(std::remove_if(config.begin(), config.end(),
+                                [](unsigned char c) { return std::isspace(c); }),
+                 config.end());
+    std::transform(config.begin(), config.end(), config.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return config.find("objectformat=sha256") != std::string::npos;
+}
+
+} // namespace
+
+bool GitIndex::load(const std::string& path) {
+    std::error_code error;
+    std::filesystem::path current = std::filesystem::absolute(path, error).lexically_normal();
+    if (error) {
+        return false;
+    }
+
+    // Walk up to the nearest .git, which is a directory in a normal clone and a
+    // "gitdir: <path>" file in linked worktrees and submodules
+    std::filesystem::path gitDir;
+    while (true) {
+        std::filesystem::path candidate = current / ".git";
+        if (std::filesystem::is_directory(candidate, error)) {
+            gitDir = candidate;
+            break;
+        }
+        if (std::filesystem::is_regular_file(candidate, error)) {
+            std::string link = trim(readWholeFile(candidate));
+            if (link.compare(0, 7, "gitdir:") != 0) {
+                return false;
+            }
+            std::filesystem::path target = trim(link.substr(7));
+            gitDir = target.is_absolute() ? target : current / target;
+            break;
+        }
+        if (!current.has_relative_path()) {
+            return false;
+        }
+        current = current.parent_path();
+    }
+
+    std::filesystem::path indexPath = gitDir / "index";
+    struct stat indexStat;
+    if (::stat(indexPath.string().c_str(), &indexStat) != 0) {
+        return false;
+    }
+
+    std::string data = readWholeFile(indexPath);
+    entries.clear();
+    entriesByPath.clear();
+    if (!parse(data, usesSha256(gitDir) ? 32 : 20)) {
+        entries.clear();
+        entriesByPath.clear();
+        return false;
+    }
+
+    root = current.generic_string();
+    indexMtimeSeconds = static_cast<int64_t>(indexStat.st_mtime);
+    return true;
+}
+
+bool GitIndex::parse(const std::string& data, size_t hashSize) {
+    const unsigned char* begin = reinterpret_cast<const unsigned char*>(data.data());
+    const unsigned char* end = begin + data.size();
+    if (data.size() < 12 + hashSize || data.compare(0, 4, "DIRC") != 0) {
+        return false;
+    }
+    // The trailing checksum is not verified: git itself rewrites a damaged
+    // index, and a wrong blob id here only costs a cache miss
+    end -= hashSize;
+
+    uint32_t version = readBigEndian32(begin + 4);
+    uint32_t count = readBigEndian32(begin + 8);
+    if (version < 2 || version > 4) {
+        return false;
+    }
+
+    const unsigned char* cursor = begin + 12;
+    size_t entryFixedSize = kEntryFixedSize - 20 + hashSize;
+    std::string previousPath;
+    entries.reserve(count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        const unsigned char* entryStart = cursor;
+        if (static_cast<size_t>(end - cursor) < entryFixedSize) {
+            return false;
+        }
+
+        uint32_t mtimeSeconds = readBigEndian32(cursor + 8);
+        uint32_t mtimeNanoseconds = readBigEndian32(cursor + 12);
+        uint32_t mode = readBigEndian32(cursor + 24);
+        uint32_t size = readBigEndian32(cursor + 36);
+        std::string blobId = toHex(cursor + 40, hashSize);
+        uint16_t flags = readBigEndian16(cursor + 40 + hashSize);
+        cursor += entryFixedSize;
+
+        uint16_t extendedFlags = 0;
+        if (flags & kExtendedFlag) {
+            if (version < 3 || end - cursor < 2) {
+                return false;
+            }
+            extendedFlags = readBigEndian16(cursor);
+            cursor += 2;
+        }
+
+        std::string path;
+        if (version == 4) {
+            // Path is the previous path minus N trailing bytes, plus a suffix
+            uint64_t strip = 0;
+            unsigned char byte;
+            do {
+                if (cursor >= end) {
+                    return false;
+                }
+                byte = *cursor++;
+                strip = (strip << 7) | (byte & 0x7F);
+                if (byte & 0x80) {
+                    strip++;
+                }
+            } while (byte & 0x80);
+            if (strip > previousPath.size()) {
+                return false;
+            }
+            path = previousPath.substr(0, previousPath.size() - strip);
+        }
+
+        const unsigned char* terminator = std::find(cursor, end, '\0');
+        if (terminator == end) {
+            return false;
+        }
+        path.append(reinterpret_cast<const char*>(cursor), terminator - cursor);
+        cursor = terminator + 1;
+
+        if (version < 4) {
+            // Entries are NUL-padded to a multiple of eight bytes
+            size_t length = cursor - entryStart;
+            cursor = entryStart + ((length + 7) & ~static_cast<size_t>(7));
+            if (cursor > end) {
+                return false;
+            }
+        }
+        previousPath = path;
+
+        // Merge conflicts, sparse checkout placeholders, symlinks and
+        // submodules do not describe a file in the work tree
+        bool usable = (flags & kStageMask) == 0 && !(extendedFlags & kSkipWorktreeFlag) &&
+                      (mode & kModeTypeMask) == kModeRegularFile;
+        if (usable) {
+            entriesByPath[path] = entries.size();
+            entries.push_back({std::move(path), std::move(blobId), mtimeSeconds, mtimeNanoseconds,
+                               size});
+        }
+    }
+
+    // Extensions follow the entries. A split index keeps most entries in a
+    // separate shared file, which is not read here.
+    while (end - cursor >= 8) {
+        uint32_t extensionSize = readBigEndian32(cursor + 4);
+        if (std::equal(cursor, cursor + 4, "link")) {
+            return false;
+        }
+        if (extensionSize > static_cast<size_t>(end - cursor) - 8) {
+            return false;
+        }
+        cursor += 8 + extensionSize;
+    }
+
+    return true;
+}
+
+const std::string& GitIndex::workTree() const {
+    return root;
+}
+
+size_t GitIndex::size() const {
+    return entries.size();
+}
+
+const GitIndexEntry* GitIndex::find(const std::string& filePath) const {
+    if (root.empty()) {
+        return nullptr;
+    }
+
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(filePath, error).lexically_normal();
+    if (error) {
+        return nullptr;
+    }
+    std::string relative = absolute.lexically_relative(root).generic_string();
+    if (relative.empty() || relative.compare(0, 2, "..") == 0) {
+        return nullptr;
+    }
+
+    auto it = entriesByPath.find(relative);
+    return it == entriesByPath.end() ? nullptr : &entries[it->second];
+}
+
+bool GitIndex::isUnchanged(const std::string& filePath, const GitIndexEntry& entry) const {
+    struct stat fileStat;
+    if (::stat(filePath.c_str(), &fileStat) != 0) {
+        return false;
+    }
+
+    if (static_cast<uint32_t>(fileStat.st_size) != entry.size ||
+        static_cast<uint32_t>(fileStat.st_mtime) != entry.mtime_seconds) {
+        return false;
+    }
+#if defined(__linux__)
+    if (static_cast<uint32_t>(fileStat.st_mtim.tv_nsec) != entry.mtime_nanoseconds) {
+        return false;
+    }
+#elif defined(__APPLE__)
+    if (static_cast<uint32_t>(fileStat.st_mtimespec.tv_nsec) != entry.mtime_nanoseconds) {
+        return false;
+    }
+#endif
+
+    // A write in the same second as the index may not be reflected in the entry
+    return static_cast<int64_t>(fileStat.st_mtime) < indexMtimeSeconds;
+}
+
+} // namespace devpilot
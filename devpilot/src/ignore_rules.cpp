@@ -0,0 +1,204 @@
+#include "ignore_rules.hpp"
+
+namespace devpilot {
+
+// Single responsibility: Only parse and evaluate ignore patterns
+
+namespace {
+
+bool hasWildcard(std::string_view glob) {
+    return glob.find_first_of("*?[\\") != std::string_view::npos;
+}
+
+// Matches a "[...]" class starting at glob[pos]; advances pos past the class
+bool matchClass(std::string_view glob, size_t& pos, char c) {
+    size_t i = pos + 1;
+    bool negated = i < glob.size() && (glob[i] == '!' || glob[i] == '^');
+    if (negated) {
+        i++;
+    }
+
+    bool matched = false;
+    bool first = true;
+    for (; i < glob.size() && (glob[i] != ']' || first); i++) {
+        first = false;
+        char low = glob[i];
+        if (low == '\\' && i + 1 < glob.size()) {
+            low = glob[++i];
+        }
+        char high = low;
+        if (i + 2 < glob.size() && glob[i + 1] == '-' && glob[i + 2] != ']') {
+            high = glob[i + 2];
+            i += 2;
+        }
+        if (c >= low && c <= high) {
+            matched = true;
+        }
+    }
+    if (i >= glob.size()) {
+        // Unterminated class: treat "[" as a literal
+        pos++;
+        return c == '[';
+    }
+    pos = i + 1;
+    return matched != negated;
+}
+
+bool globMatch(std::string_view glob, std::string_view text) {
+    size_t g = 0;
+    size_t t = 0;
+    // Backtracking point for the most recent single "*"
+    size_t starGlob = std::string_view::npos;
+    size_t starText = 0;
+
+    while (t < text.size() || g < glob.size()) {
+        if (g < glob.size()) {
+            char p = glob[g];
+            if (p == '*' && g + 1 < glob.size() && glob[g + 1] == '*' &&
+                (g == 0 || glob[g - 1] == '/')) {
+                // "**" spans directories: "**/" matches zero or more leading
+                // components, a trailing "**" matches everything below
+                size_t rest = g + 2;
+                if (rest == glob.size()) {
+                    return true;
+                }
+                if (glob[rest] == '/') {
+                    std::string_view tail = glob.substr(rest + 1);
+                    for (size_t i = t; i <= text.size(); i++) {
+                        if ((i == t || text[i - 1] == '/') && globMatch(tail, text.substr(i))) {
+                            return true;
+                        }
+                    }
+                    return false;
+                }
+            }
+            if (p == '*') {
+                starGlob = g++;
+                starText = t;
+                continue;
+            }
+            if (t < text.size()) {
+                char c = text[t];
+                if (p == '?' && c != '/') {
+                    g++;
+                    t++;
+                    continue;
+                }
+                if (p == '[' && c != '/') {
+                    size_t next = g;
+                    if (matchClass(glob, next, c)) {
+                        g = next;
+                        t++;
+                        continue;
+                    }
+                } else if (p == '\\' && g + 1 < glob.size()) {
+                    if (glob[g + 1] == c) {
+                        g += 2;
+                        t++;
+                        continue;
+                    }
+                } else if (p == c && p != '?') {
+                    g++;
+                    t++;
+                    continue;
+                }
+            }
+        }
+        // Let the last "*" absorb one more character, but never a "/"
+        if (starGlob != std::string_view::npos && starText < text.size() && text[starText] != '/') {
+            g = starGlob + 1;
+            t = ++starText;
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+void IgnoreRules::addPatterns(std::string_view text) {
+    size_t lineStart = 0;
+    while (lineStart <= text.size()) {
+        size_t lineEnd = text.find('\n', lineStart);
+        if (lineEnd == std::string_view::npos) {
+            lineEnd = text.size();
+        }
+        std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) {
+            line.remove_suffix(1);
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        Pattern pattern;
+        pattern.negated = line[0] == '!';
+        if (pattern.negated) {
+            line.remove_prefix(1);
+        } else if (line[0] == '\\' && line.size() > 1 && (line[1] == '#' || line[1] == '!')) {
+            line.remove_prefix(1);
+        }
+        pattern.directoryOnly = !line.empty() && line.back() == '/';
+        if (pattern.directoryOnly) {
+            line.remove_suffix(1);
+        }
+        pattern.anchored = line.find('/') != std::string_view::npos;
+        if (!line.empty() && line[0] == '/') {
+            line.remove_prefix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+        pattern.glob = std::string(line);
+        pattern.literal = !hasWildcard(line);
+        patterns.push_back(std::move(pattern));
+    }
+}
+
+bool IgnoreRules::empty() const {
+    return patterns.empty();
+}
+
+IgnoreRules::Match IgnoreRules::match(std::string_view path, std::string_view name,
+                                      bool isDirectory) const {
+    for (auto it = patterns.rbegin(); it != patterns.rend(); ++it) {
+        const Pattern& pattern = *it;
+        if (pattern.directoryOnly && !isDirectory) {
+            continue;
+        }
+        std::string_view subject = pattern.anchored ? path : name;
+        bool matched = pattern.literal ? subject == pattern.glob : globMatch(pattern.glob, subject);
+        if (matched) {
+            return pattern.negated ? Match::INCLUDED : Match::IGNORED;
+        }
+    }
+    return Match::NONE;
+}
+
+bool IgnoreScope::isIgnored(const IgnoreScope* scope, std::string_view path, std::string_view name,
+                            bool isDirectory) {
+    for (; scope; scope = scope->parent.get()) {
+        std::string_view relative = path;
+        if (!scope->base.empty()) {
+            relative.remove_prefix(scope->base.size() + 1);
+        }
+        IgnoreRules::Match match = scope->rules.match(relative, name, isDirectory);
+        if (match != IgnoreRules::Match::NONE) {
+            return match == IgnoreRules::Match::IGNORED;
+        }
+    }
+    return false;
+}
+
+IgnoreRules defaultIgnoreRules() {
+    IgnoreRules rules;
+    rules.addPatterns(
+        ".git/\n.hg/\n.svn/\n"
+        "build/\ncmake-build-*/\nCMakeFiles/\n_deps/\n");
+    return rules;
+}
+
+} // namespace devpilot
@@ -0,0 +1,189 @@
+#include "include_graph.hpp"
+#include <algorithm>
+#include <filesystem>
+
+namespace devpilot {
+
+// Single responsibility: Only resolve includes and compute file reachability
+
+namespace {
+
+std::string normalizePath(const std::filesystem::path& path) {
+    return path.lexically_normal().generic_string();
+}
+
+} // namespace
+
+IncludeResolver::IncludeResolver(const std::vector<std::string>& searchPaths) {
+    for (const auto& searchPath : searchPaths) {
+        this->searchPaths.push_back(normalizePath(searchPath));
+    }
+}
+
+void IncludeResolver::addFile(const std::string& path, uint32_t fileId) {
+    std::string_view normalized = paths.copy(normalizePath(path));
+    filesByPath[normalized] = fileId;
+
+    // Register every trailing component sequence ("b.h", "a/b.h", ...) so an
+    // include can still be matched when no search path was configured for it
+    size_t pos = normalized.size();
+    while ((pos = normalized.rfind('/', pos - 1)) != std::string_view::npos) {
+        std::string_view suffix = normalized.substr(pos + 1);
+        auto inserted = filesBySuffix.emplace(suffix, fileId);
+        if (!inserted.second && inserted.first->second != fileId) {
+            inserted.first->second = 0;
+        }
+        if (pos == 0) {
+            break;
+        }
+    }
+}
+
+uint32_t IncludeResolver::lookup(std::string_view path) const {
+    auto it = filesByPath.find(path);
+    return it != filesByPath.end() ? it->second : 0;
+}
+
+uint32_t IncludeResolver::resolve(std::string_view includerPath, std::string_view spelling,
+                                  bool isSystem) const {
+    if (!isSystem) {
+        std::filesystem::path includerDir = std::filesystem::path(includerPath).parent_path();
+        if (uint32_t id = lookup(normalizePath(includerDir / spelling))) {
+            return id;
+        }
+    }
+
+    for (const auto& searchPath : searchPaths) {
+        if (uint32_t id = lookup(normalizePath(std::filesystem::path(searchPath) / spelling))) {
+            return id;
+        }
+    }
+
+    // Last resort: a unique indexed file whose trailing components match
+    auto it = filesBySuffix.find(normalizePath(spelling));
+    return it != filesBySuffix.end() ? it->second : 0;
+}
+
+size_t IncludeResolver::memoryBytes() const {
+    // Hash nodes as in StringTable::bytesReserved()
+    size_t node = sizeof(std::pair<const std::string_view, uint32_t>) + 2 * sizeof(void*);
+    return paths.bytesReserved() + (filesByPath.size() + filesBySuffix.size()) * node +
+           (filesByPath.bucket_count() + filesBySuffix.bucket_count()) * sizeof(void*);
+}
+
+void IncludeGraph::addEdge(uint32_t includer, uint32_t included) {
+    includes[includer].push_back(included);
+    includes.emplace(included, std::vector<uint32_t>());
+    edges++;
+}
+
+size_t IncludeGraph::edgeCount() const {
+    return edges;
+}
+
+std::vector<std::vector<uint32_t>> IncludeGraph::stronglyConnectedComponents() const {
+    // Iterative Tarjan: deep include chains must not overflow the call stack
+    struct Frame {
+        uint32_t node;
+        size_t nextEdge;
+    };
+
+    std::unordered_map<uint32_t, uint32_t> index;
+    std::unordered_map<uint32_t, uint32_t> lowLink;
+    std::unordered_map<uint32_t, bool> onStack;
+    std::vector<uint32_t> stack;
+    std::vector<std::vector<uint32_t>> components;
+    uint32_t nextIndex = 0;
+
+    for (const auto& entry : includes) {
+        if (index.count(entry.first)) {
+            continue;
+        }
+
+        std::vector<Frame> frames{{entry.first, 0}};
+        index[entry.first] = lowLink[entry.first] = nextIndex++;
+        stack.push_back(entry.first);
+        onStack[entry.first] = true;
+
+        while (!frames.empty()) {
+            Frame& frame = frames.back();
+            const auto& targets = includes.at(frame.node);
+
+            if (frame.nextEdge < targets.size()) {
+                uint32_t target = targets[frame.nextEdge++];
+                if (!index.count(target)) {
+                    index[target] = lowLink[target] = nextIndex++;
+                    stack.push_back(target);
+                    onStack[target] = true;
+                    frames.push_back({target, 0});
+                } else if (onStack[target]) {
+                    lowLink[frame.node] = std::min(lowLink[frame.node], index[target]);
+                }
+                continue;
+            }
+
+            uint32_t node = frame.node;
+            frames.pop_back();
+            if (!frames.empty()) {
+                uint32_t parent = frames.back().node;
+                lowLink[parent] = std::min(lowLink[parent], lowLink[node]);
+            }
+
+            if (lowLink[node] == index[node]) {
+                std::vector<uint32_t> component;
+                uint32_t member;
+                do {
+                    member = stack.back();
+                    stack.pop_back();
+                    onStack[member] = false;
+                    component.push_back(member);
+                } while (member != node);
+                components.push_back(std::move(component));
+            }
+        }
+    }
+
+    // Tarjan emits a component only after everything it includes, so reversing
+    // yields includers before the files they include
+    std::reverse(components.begin(), components.end());
+    return components;
+}
+
+std::unordered_map<uint32_t, CompressedBitset> IncludeGraph::computeReverseClosure() const {
+    std::unordered_map<uint32_t, CompressedBitset> closure;
+    auto components = stronglyConnectedComponents();
+
+    for (const auto& component : components) {
+        // Every member of a cycle transitively includes every other member
+        CompressedBitset shared;
+        if (component.size() > 1) {
+            for (uint32_t member : component) {
+                shared.add(member);
+            }
+        }
+        for (uint32_t member : component) {
+            shared.unionWith(closure[member]);
+        }
+
+        for (uint32_t member : component) {
+            closure[member] = shared;
+        }
+
+        // Push this component's dependents down to the files it includes
+        CompressedBitset propagated = shared;
+        for (uint32_t member : component) {
+            propagated.add(member);
+        }
+        for (uint32_t member : component) {
+            for (uint32_t target : includes.at(member)) {
+                if (std::find(component.begin(), component.end(), target) == component.end()) {
+                    closure[target].unionWith(propagated);
+                }
+            }
+        }
+    }
+
+    return closure;
+}
+
+} // namespace devpilot
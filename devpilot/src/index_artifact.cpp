@@ -0,0 +1,739 @@
+#include "index_artifact.hpp"
+#include "byte_codec.hpp"
+#include "content_hash.hpp"
+#include "file_walker.hpp"
+#include "logger.hpp"
+#include "parse_cache.hpp"
+#include "parser.hpp"
+#include "work_queue.hpp"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+namespace devpilot {
+
+// Single responsibility: Only pack an index into an artifact and unpack it against a checkout
+
+namespace {
+
+const char kMagic[4] = {'D', 'P', 'X', '1'};
+constexpr uint64_t kFormatVersion = 1;
+constexpr size_t kChecksumSize = 8;
+
+enum class Section : uint64_t {
+    END = 0,
+    MANIFEST = 1,       // Shard count and scheme, include paths
+    ROWS = 2,           // Rows of one table of one database
+    PARSE_RESULTS = 3   // Parse cache entries by key
+};
+
+// Sections are cut at about this size, so the writer holds no more
+constexpr size_t kSectionBytes = 1 << 20;
+
+// How a value is stored. Paths under the project root lose the root.
+enum class ValueTag : uint64_t { NULL_VALUE, INTEGER, TEXT, BLOB, RELATIVE_PATH };
+
+using TableValue = SqliteStorage::TableValue;
+using IndexTable = SqliteStorage::IndexTable;
+
+bool isPathColumn(std::string_view table, std::string_view column) {
+    return column == "file_path" || (table == "files" && column == "path");
+}
+
+std::vector<bool> pathColumns(const IndexTable& table) {
+    std::vector<bool> paths;
+    for (const char* column : table.columns) {
+        paths.push_back(isPathColumn(table.name, column));
+    }
+    return paths;
+}
+
+size_t columnIndex(const IndexTable& table, std::string_view column) {
+    for (size_t i = 0; i < table.columns.size(); i++) {
+        if (column == table.columns[i]) {
+            return i;
+        }
+    }
+    return table.columns.size();
+}
+
+// Walked paths are "<root>/<relative>", with the root as given minus trailing slashes
+std::string rootPrefix(std::string root) {
+    while (root.size() > 1 && root.back() == '/') {
+        root.pop_back();
+    }
+    return root + "/";
+}
+
+void writeValue(ByteWriter& out, const TableValue& value, bool pathColumn, std::string_view prefix) {
+    switch (value.type) {
+    case TableValue::Type::NULL_VALUE:
+        out.varint(static_cast<uint64_t>(ValueTag::NULL_VALUE));
+        break;
+    case TableValue::Type::INTEGER:
+        out.varint(static_cast<uint64_t>(ValueTag::INTEGER));
+        out.signedVarint(value.integer);
+        break;
+    case TableValue::Type::TEXT:
+        if (pathColumn && value.bytes.compare(0, prefix.size(), prefix) == 0) {
+            out.varint(static_cast<uint64_t>(ValueTag::RELATIVE_PATH));
+            out.string(value.bytes.substr(prefix.size()));
+        } else {
+            out.varint(static_cast<uint64_t>(ValueTag::TEXT));
+            out.string(value.bytes);
+        }
+        break;
+    case TableValue::Type::BLOB:
+        out.varint(static_cast<uint64_t>(ValueTag::BLOB));
+        out.string(value.bytes);
+        break;
+    }
+}
+
+// A re-rooted path is built in scratch, which the value then points into
+bool readValue(ByteReader& in, TableValue& value, std::string& scratch, std::string_view prefix) {
+    switch (static_cast<ValueTag>(in.varint())) {
+    case ValueTag::NULL_VALUE:
+        value.type = TableValue::Type::NULL_VALUE;
+        break;
+    case ValueTag::INTEGER:
+        value.type = TableValue::Type::INTEGER;
+        value.integer = in.signedVarint();
+        break;
+    case ValueTag::TEXT:
+        value.type = TableValue::Type::TEXT;
+        value.bytes = in.string();
+        break;
+    case ValueTag::BLOB:
+        value.type = TableValue::Type::BLOB;
+        value.bytes = in.string();
+        break;
+    case ValueTag::RELATIVE_PATH:
+        scratch.assign(prefix);
+        scratch.append(in.string());
+        value.type = TableValue::Type::TEXT;
+        value.bytes = scratch;
+        break;
+    default:
+        return false;
+    }
+    return in.good();
+}
+
+// Hashes everything it writes, for the trailing checksum
+class ArtifactWriter {
+public:
+    explicit ArtifactWriter(std::ostream& out) : out(out), written(0) {}
+
+    void write(const std::string& bytes) {
+        hasher.update(bytes.data(), bytes.size());
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        written += bytes.size();
+    }
+
+    void section(Section tag, const std::string& payload) {
+        ByteWriter head;
+        head.varint(static_cast<uint64_t>(tag));
+        head.varint(payload.size());
+        write(head.bytes);
+        write(payload);
+    }
+
+    bool finish() {
+        ByteWriter end;
+        end.varint(static_cast<uint64_t>(Section::END));
+        write(end.bytes);
+        ByteWriter checksum;
+        checksum.fixed(hasher.digest(), kChecksumSize);
+        out.write(checksum.bytes.data(), kChecksumSize);
+        written += kChecksumSize;
+        out.flush();
+        return static_cast<bool>(out);
+    }
+
+    uint64_t bytes() const {
+        return written;
+    }
+
+private:
+    std::ostream& out;
+    ContentHasher hasher;
+    uint64_t written;
+};
+
+// Opens the index at databasePath and each of its shards, read-only
+bool openDatabases(const std::string& databasePath, SqliteStorage& main,
+                   std::vector<std::unique_ptr<SqliteStorage>>& shards) {
+    if (!main.initialize(databasePath, SqliteStorage::OpenMode::READ_ONLY)) {
+        logging::error(main.openError());
+        return false;
+    }
+    unsigned count = 1;
+    try {
+        count = static_cast<unsigned>(std::stoul(main.getMetadata("shard_count")));
+    } catch (const std::exception&) {
+        count = 1;
+    }
+    for (unsigned k = 0; count > 1 && count <= kMaxShards && k < count; k++) {
+        auto shard = std::make_unique<SqliteStorage>();
+        if (!shard->initialize(shardPath(databasePath, k), SqliteStorage::OpenMode::READ_ONLY)) {
+            logging::error("Cannot open shard ", k, " of ", databasePath);
+            return false;
+        }
+        shards.push_back(std::move(shard));
+    }
+    return true;
+}
+
+// The manifest comes first, so the rows after it know their databases
+struct Manifest {
+    unsigned shards = 1;
+    ShardScheme shardScheme = ShardScheme::DIRECTORY;
+    std::vector<std::pair<bool, std::string>> includePaths;  // Relative?, path
+};
+
+bool readManifest(std::string_view payload, Manifest& manifest) {
+    ByteReader in(payload.data(), payload.size());
+    uint64_t shards = in.varint();
+    std::string scheme(in.string());
+    if (shards < 1 || shards > kMaxShards || !parseShardScheme(scheme, manifest.shardScheme)) {
+        return false;
+    }
+    manifest.shards = static_cast<unsigned>(shards);
+    manifest.includePaths.resize(in.count());
+    for (auto& includePath : manifest.includePaths) {
+        includePath.first = in.varint() != 0;
+        includePath.second = std::string(in.string());
+    }
+    return in.finished();
+}
+
+// One ROWS section, pointing into its payload
+struct RowChunk {
+    unsigned database = 0;
+    const IndexTable* table = nullptr;
+    size_t rows = 0;
+    std::string_view data;
+};
+
+bool readRows(std::string_view payload, unsigned shards, RowChunk& chunk) {
+    ByteReader in(payload.data(), payload.size());
+    uint64_t database = in.varint();
+    chunk.table = SqliteStorage::findIndexTable(in.string());
+    uint64_t columns = in.varint();
+    chunk.rows = in.count();
+    chunk.data = in.string();
+    // Tables and columns must be this build's, which the schema version implies
+    if (!in.finished() || !chunk.table || columns != chunk.table->columns.size() || database >= shards) {
+        return false;
+    }
+    chunk.database = static_cast<unsigned>(database);
+    return true;
+}
+
+// Reads what ArtifactWriter wrote, front to back, hashing it for the
+// trailing checksum. Only the section being decoded is held in memory.
+class ArtifactReader {
+public:
+    explicit ArtifactReader(std::istream& in) : in(in) {}
+
+    // The magic and versions
+    bool header() {
+        char magic[sizeof(kMagic)];
+        if (!read(magic, sizeof(magic)) || !std::equal(kMagic, kMagic + sizeof(kMagic), magic)) {
+            logging::error("Not a devpilot index artifact");
+            return false;
+        }
+        uint64_t format = 0;
+        uint64_t parserVersion = 0;
+        uint64_t schemaVersion = 0;
+        if (!varint(format) || !varint(parserVersion) || !varint(schemaVersion)) {
+            logging::error("Index artifact is malformed");
+            return false;
+        }
+        if (format != kFormatVersion || parserVersion != CppParser::kVersion ||
+            schemaVersion != static_cast<uint64_t>(SqliteStorage::kSchemaVersion)) {
+            logging::error("Index artifact was written by another version of devpilot "
+                           "(format ", format, ", parser ", parserVersion, ", schema ", schemaVersion, ")");
+            return false;
+        }
+        return true;
+    }
+
+    // The next section's tag and payload (none for END). The payload is read
+    // in bounded pieces, so a damaged length runs out of input long before
+    // it could exhaust memory.
+    bool section(Section& tag, std::string& payload) {
+        uint64_t value = 0;
+        if (!varint(value)) {
+            return false;
+        }
+        tag = static_cast<Section>(value);
+        payload.clear();
+        uint64_t size = 0;
+        if (tag == Section::END) {
+            return true;
+        }
+        if (!varint(size)) {
+            return false;
+        }
+        while (payload.size() < size) {
+            size_t offset = payload.size();
+            size_t piece = static_cast<size_t>(std::min<uint64_t>(size - offset, kSectionBytes));
+            payload.resize(offset + piece);
+            if (!read(&payload[offset], piece)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // After END: the checksum of everything before it, and nothing more
+    bool finish() {
+        char checksum[kChecksumSize];
+        in.read(checksum, kChecksumSize);
+        if (static_cast<size_t>(in.gcount()) != kChecksumSize ||
+            ByteReader(checksum, kChecksumSize).fixed(kChecksumSize) != hasher.digest()) {
+            logging::error("Index artifact is damaged (checksum mismatch)");
+            return false;
+        }
+        if (in.peek() != std::char_traits<char>::eof()) {
+            logging::error("Index artifact is malformed");
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::istream& in;
+    ContentHasher hasher;
+
+    bool read(char* data, size_t size) {
+        in.read(data, static_cast<std::streamsize>(size));
+        if (static_cast<size_t>(in.gcount()) != size) {
+            return false;
+        }
+        hasher.update(data, size);
+        return true;
+    }
+
+    bool varint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            char byte;
+            if (!read(&byte, 1)) {
+                return false;
+            }
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// The databases an import writes, the main one and any shards. Rows go in
+// as they are read, inside one transaction per database that is committed
+// only once the whole artifact has checked out; rolling back leaves the
+// previous index as it was.
+class ImportDatabases {
+public:
+    explicit ImportDatabases(SqliteStorage& storage) : storage(storage) {}
+
+    bool open(unsigned shards, const std::string& databasePath) {
+        if (shards == 1) {
+            databases.push_back(&storage);
+        }
+        for (unsigned k = 0; shards > 1 && k < shards; k++) {
+            owned.push_back(std::make_unique<SqliteStorage>());
+            if (!owned.back()->initialize(shardPath(databasePath, k))) {
+                logging::error("Cannot open shard ", k, " of ", databasePath);
+                return false;
+            }
+            databases.push_back(owned.back().get());
+        }
+        storage.beginTransaction();
+        storage.clearDatabase();
+        for (auto& shard : owned) {
+            shard->beginTransaction();
+            shard->clearDatabase();
+        }
+        return true;
+    }
+
+    SqliteStorage& operator[](unsigned database) {
+        return *databases[database];
+    }
+
+    void rollback() {
+        for (auto& shard : owned) {
+            shard->rollbackTransaction();
+        }
+        storage.rollbackTransaction();
+    }
+
+    // The shards first, then the manifest
+    void commit(const Manifest& manifest, const ImportSummary& summary, std::string_view prefix,
+                const std::string& databasePath) {
+        for (auto& shard : owned) {
+            shard->commitTransaction();
+        }
+        if (manifest.shards > 1) {
+            storage.setMetadata("shard_count", std::to_string(manifest.shards));
+            storage.setMetadata("shard_scheme", shardSchemeName(manifest.shardScheme));
+        }
+        std::string includePaths;
+        for (const auto& includePath : summary.includePaths) {
+            includePaths += includePath + "\n";
+        }
+        storage.setMetadata("project_root", std::string(prefix.substr(0, prefix.size() - 1)));
+        storage.setMetadata("include_paths", includePaths);
+        storage.stampIndex();
+        storage.commitTransaction();
+        removeShards(databasePath, manifest.shards > 1 ? manifest.shards : 0);
+    }
+
+private:
+    SqliteStorage& storage;
+    std::vector<std::unique_ptr<SqliteStorage>> owned;
+    std::vector<SqliteStorage*> databases;
+};
+
+using RowCallback = std::function<void(const IndexTable& table, const std::vector<TableValue>& row)>;
+
+// Writes the ROWS section in payload and the ones after it for the same
+// table of the same database in one writeRows() call, reading sections as
+// the rows run out. The section after the run is left in tag and payload.
+// A re-rooted path is built in scratch, one string per column.
+bool restoreRows(ArtifactReader& reader, Section& tag, std::string& payload, unsigned shards,
+                 ImportDatabases& databases, std::string_view prefix, std::vector<std::string>& scratch,
+                 const RowCallback& onRow) {
+    RowChunk head;
+    if (!readRows(payload, shards, head)) {
+        return false;
+    }
+    RowChunk chunk = head;
+    ByteReader in(chunk.data.data(), chunk.data.size());
+    bool complete = true;
+    bool written = databases[head.database].writeRows(*head.table, [&](std::vector<TableValue>& row) {
+        while (chunk.rows == 0) {
+            complete = in.finished() && reader.section(tag, payload);
+            if (!complete || tag != Section::ROWS) {
+                return false;
+            }
+            RowChunk next;
+            complete = readRows(payload, shards, next);
+            if (!complete || next.table != head.table || next.database != head.database) {
+                return false;
+            }
+            chunk = next;
+            in = ByteReader(chunk.data.data(), chunk.data.size());
+        }
+        chunk.rows--;
+        for (size_t i = 0; i < row.size(); i++) {
+            if (!readValue(in, row[i], scratch[i], prefix)) {
+                complete = false;
+                return false;
+            }
+        }
+        onRow(*head.table, row);
+        return true;
+    });
+    if (!written || !complete) {
+        logging::error("Cannot restore table ", head.table->name);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool exportIndex(const std::string& databasePath, std::ostream& out, ExportSummary& summary) {
+    summary = ExportSummary();
+    SqliteStorage main;
+    std::vector<std::unique_ptr<SqliteStorage>> shards;
+    if (!openDatabases(databasePath, main, shards)) {
+        return false;
+    }
+    std::string root = main.getMetadata("project_root");
+    if (root.empty()) {
+        logging::error("The index does not record its project root; index the project again to export it");
+        return false;
+    }
+    std::string prefix = rootPrefix(root);
+    std::vector<SqliteStorage*> databases;
+    if (shards.empty()) {
+        databases.push_back(&main);
+    }
+    for (auto& shard : shards) {
+        databases.push_back(shard.get());
+    }
+    summary.shards = static_cast<unsigned>(databases.size());
+
+    ArtifactWriter writer(out);
+    ByteWriter header;
+    header.bytes.append(kMagic, sizeof(kMagic));
+    header.varint(kFormatVersion);
+    header.varint(CppParser::kVersion);
+    header.varint(SqliteStorage::kSchemaVersion);
+    writer.write(header.bytes);
+
+    // Include paths under the root travel relative to it, like file paths
+    ByteWriter manifest;
+    manifest.varint(databases.size());
+    std::string scheme = main.getMetadata("shard_scheme");
+    manifest.string(scheme.empty() ? shardSchemeName(ShardScheme::DIRECTORY) : scheme);
+    std::vector<std::string> includePaths;
+    std::string includeList = main.getMetadata("include_paths");
+    for (size_t start = 0, end; (end = includeList.find('\n', start)) != std::string::npos; start = end + 1) {
+        includePaths.push_back(includeList.substr(start, end - start));
+    }
+    manifest.varint(includePaths.size());
+    for (const auto& includePath : includePaths) {
+        bool relative = includePath.compare(0, prefix.size(), prefix) == 0;
+        manifest.varint(relative ? 1 : 0);
+        manifest.string(relative ? includePath.substr(prefix.size()) : includePath);
+    }
+    writer.section(Section::MANIFEST, manifest.bytes);
+
+    std::vector<uint64_t> contentHashes;
+    for (size_t database = 0; database < databases.size(); database++) {
+        for (const auto& table : SqliteStorage::indexTables()) {
+            std::vector<bool> paths = pathColumns(table);
+            bool files = std::string_view(table.name) == "files";
+            size_t hashColumn = columnIndex(table, "content_hash");
+            ByteWriter rows;
+            size_t rowCount = 0;
+            auto flush = [&]() {
+                if (rowCount == 0) {
+                    return;
+                }
+                ByteWriter chunk;
+                chunk.varint(database);
+                chunk.string(table.name);
+                chunk.varint(table.columns.size());
+                chunk.varint(rowCount);
+                chunk.string(rows.bytes);
+                writer.section(Section::ROWS, chunk.bytes);
+                summary.rows += rowCount;
+                rows.bytes.clear();
+                rowCount = 0;
+            };
+            bool read = databases[database]->readTable(table, [&](const std::vector<TableValue>& row) {
+                for (size_t i = 0; i < row.size(); i++) {
+                    writeValue(rows, row[i], paths[i], prefix);
+                }
+                if (files) {
+                    contentHashes.push_back(static_cast<uint64_t>(row[hashColumn].integer));
+                    summary.files++;
+                }
+                rowCount++;
+                if (rows.bytes.size() >= kSectionBytes) {
+                    flush();
+                }
+            });
+            if (!read) {
+                logging::error("Cannot read table ", table.name, " of ", databasePath);
+                return false;
+            }
+            flush();
+        }
+    }
+
+    // Files indexed from the cache have an entry at whichever depth they were
+    // parsed to; skipped files (hash 0) and evicted entries have none
+    ParseCache cache(ParseCache::defaultDirectory(), UINT64_MAX);
+    std::unordered_set<uint64_t> exported;
+    ByteWriter entries;
+    size_t entryCount = 0;
+    auto flushEntries = [&]() {
+        if (entryCount == 0) {
+            return;
+        }
+        ByteWriter chunk;
+        chunk.varint(entryCount);
+        chunk.bytes += entries.bytes;
+        writer.section(Section::PARSE_RESULTS, chunk.bytes);
+        entries.bytes.clear();
+        entryCount = 0;
+    };
+    for (uint64_t contentHash : contentHashes) {
+        if (contentHash == 0 || !cache.enabled()) {
+            continue;
+        }
+        for (ParseDepth depth : {ParseDepth::FULL, ParseDepth::DECLARATIONS}) {
+            uint64_t key = ParseCache::key(contentHash, depth);
+            std::string entry;
+            if (exported.count(key) == 0 && cache.loadEntry(key, entry)) {
+                exported.insert(key);
+                entries.fixed(key, 8);
+                entries.string(entry);
+                entryCount++;
+                summary.parseEntries++;
+                break;
+            }
+        }
+        if (entries.bytes.size() >= kSectionBytes) {
+            flushEntries();
+        }
+    }
+    flushEntries();
+
+    bool written = writer.finish();
+    summary.bytes = writer.bytes();
+    if (!written) {
+        logging::error("Cannot write index artifact");
+    }
+    return written;
+}
+
+bool importIndex(std::istream& artifact, const std::string& projectPath, SqliteStorage& storage,
+                 const ImportOptions& options, ImportSummary& summary) {
+    summary = ImportSummary();
+    if (!std::filesystem::is_directory(projectPath)) {
+        logging::error("Error: Path is not a directory: ", projectPath);
+        return false;
+    }
+    ArtifactReader reader(artifact);
+    if (!reader.header()) {
+        return false;
+    }
+    Manifest manifest;
+    Section tag = Section::END;
+    std::string payload;
+    if (!reader.section(tag, payload) || tag != Section::MANIFEST || !readManifest(payload, manifest)) {
+        logging::error("Index artifact is malformed");
+        return false;
+    }
+    std::string prefix = rootPrefix(projectPath);
+    summary.shards = manifest.shards;
+    summary.shardScheme = manifest.shardScheme;
+    for (const auto& includePath : manifest.includePaths) {
+        summary.includePaths.push_back(includePath.first ? prefix + includePath.second : includePath.second);
+    }
+
+    ImportDatabases databases(storage);
+    if (!databases.open(manifest.shards, options.databasePath)) {
+        databases.rollback();
+        return false;
+    }
+
+    // While the sections are read, sweep threads hash every file the index
+    // lists and seed the parse results into the local cache; the queue's
+    // capacity bounds the sections waiting. Files the index recorded without
+    // a hash (skipped for size) only need to exist.
+    ParseCache cache(ParseCache::defaultDirectory(), options.cacheBytes);
+    WorkQueue<std::function<void()>> tasks(options.threads * 4);
+    std::atomic<size_t> changed(0);
+    std::atomic<size_t> removed(0);
+    std::atomic<size_t> seeded(0);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < options.threads; i++) {
+        threads.emplace_back([&tasks]() {
+            std::function<void()> task;
+            while (tasks.pop(task)) {
+                task();
+            }
+        });
+    }
+
+    // Every file the index lists, as it would be walked here
+    const IndexTable* filesTable = SqliteStorage::findIndexTable("files");
+    size_t pathColumn = columnIndex(*filesTable, "path");
+    size_t hashColumn = columnIndex(*filesTable, "content_hash");
+    std::unordered_set<std::string> listed;
+    auto onRow = [&](const IndexTable& table, const std::vector<TableValue>& row) {
+        if (&table != filesTable) {
+            return;
+        }
+        std::string path(row[pathColumn].bytes);
+        uint64_t expected = static_cast<uint64_t>(row[hashColumn].integer);
+        listed.insert(path);
+        tasks.push([path, expected, &changed, &removed]() {
+            uint64_t contentHash = 0;
+            if (!hashFile(path, 0, contentHash)) {
+                removed++;
+            } else if (expected != 0 && contentHash != expected) {
+                changed++;
+            }
+        });
+    };
+
+    size_t columns = 0;
+    for (const auto& table : SqliteStorage::indexTables()) {
+        columns = std::max(columns, table.columns.size());
+    }
+    std::vector<std::string> scratch(columns);
+    bool valid = reader.section(tag, payload);
+    while (valid && tag != Section::END) {
+        if (tag == Section::ROWS) {
+            valid = restoreRows(reader, tag, payload, manifest.shards, databases, prefix, scratch, onRow);
+            continue;
+        }
+        if (tag == Section::MANIFEST) {
+            valid = false;
+            break;
+        }
+        if (tag == Section::PARSE_RESULTS && cache.enabled()) {
+            tasks.push([section = std::move(payload), &cache, &seeded]() {
+                ByteReader in(section.data(), section.size());
+                for (size_t n = in.count(); n > 0 && in.good(); n--) {
+                    uint64_t key = in.fixed(8);
+                    std::string_view entry = in.string();
+                    if (in.good() && cache.storeEntry(key, std::string(entry))) {
+                        seeded++;
+                    }
+                }
+            });
+            payload = std::string();
+        }
+        // Other tags were added by a later format that kept compatibility
+        valid = reader.section(tag, payload);
+    }
+    if (!valid) {
+        logging::error("Index artifact is malformed");
+    } else {
+        valid = reader.finish();
+    }
+
+    // Files the index lacks turn up in a walk of the tree
+    std::atomic<size_t> added(0);
+    if (valid) {
+        FileWalker walker(options.threads);
+        walker.walk(projectPath, [&](std::string path) {
+            if (listed.count(path) == 0) {
+                added++;
+            }
+        });
+    }
+    tasks.close();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    cache.evict();
+    if (!valid) {
+        databases.rollback();
+        return false;
+    }
+
+    summary.files = listed.size();
+    summary.changedFiles = changed;
+    summary.addedFiles = added;
+    summary.removedFiles = removed;
+    summary.seededEntries = seeded;
+    if (summary.changedFiles + summary.addedFiles + summary.removedFiles > 0) {
+        databases.rollback();
+        return true;  // The caller re-indexes, mostly from the seeded cache
+    }
+    databases.commit(manifest, summary, prefix, options.databasePath);
+    summary.restored = true;
+    return true;
+}
+
+} // namespace devpilot
@@ -0,0 +1,949 @@
+#include "indexer.hpp"
+#include "call_resolver.hpp"
+#include "content_hash.hpp"
+#include "file_reader.hpp"
+#include "file_walker.hpp"
+#include "git_index.hpp"
+#include "include_graph.hpp"
+#include "logger.hpp"
+#include "memory_accounting.hpp"
+#include "occurrence_index.hpp"
+#include "parse_cache.hpp"
+#include "process_memory.hpp"
+#include "query_activity.hpp"
+#include "sharded_storage.hpp"
+#include "trace.hpp"
+#include "work_queue.hpp"
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_set>
+
+namespace devpilot {
+
+namespace {
+
+// What the index held for a path before this run, when it is updated in place
+struct StoredFile {
+    int64_t id = 0;
+    uint64_t contentHash = 0;
+    std::string_view blobId;
+    bool found = false;      // Walked again this run
+    bool rewritten = false;  // Its rows were deleted: written anew or gone
+};
+
+struct ParsedFile {
+    std::string_view path;
+    std::string_view blobId;  // When clean in the git index
+    StoredFile* stored = nullptr;
+    bool unchanged = false;  // Read, but the same as stored: nothing to write
+    ParseResult result;
+};
+
+// One shard's share of the write stage
+struct ShardWriter {
+    SqliteStorage* storage = nullptr;
+    std::unique_ptr<SqliteStorage> owned;  // Unless the shard is the index itself
+    OccurrenceIndex occurrences;
+    int postingSegments = 0;
+    std::atomic<size_t> nameBytes{0};  // occurrences.memoryBytes(), for other threads
+    int64_t nextFileId = 1;  // Local; see globalShardId()
+    size_t files = 0;
+    WorkQueue<ParsedFile> queue;
+    std::thread thread;
+};
+
+} // namespace
+
+bool Indexer::run(const std::string& projectPath, const IndexOptions& options, IndexSummary& summary) {
+    summary = IndexSummary();
+    if (!std::filesystem::exists(projectPath)) {
+        logging::error("Error: Path does not exist: ", projectPath);
+        return false;
+    }
+    
+    if (!parser.isInitialized()) {
+        logging::error("Error: Parser not initialized");
+        return false;
+    }
+    
+    // No budget can go below what the process already holds plus the
+    // reader's buffers and one postings batch; a smaller one is overrun.
+    // What the run holds until it ends comes on top (see checkFloor below).
+    uint64_t baseFloor = 0;
+    bool floorWarned = false;
+    if (options.maxMemory != 0) {
+        baseFloor = currentResidentBytes() + kReadBufferCount * kReadBufferSize + kReadHeapBytes +
+                    kMinPostingsBatchBytes;
+        summary.memoryFloor = baseFloor;
+        if (summary.memoryFloor > options.maxMemory) {
+            logging::warning("Memory budget of ", options.maxMemory >> 20,
+                             " MiB is below what indexing needs (", (summary.memoryFloor >> 20) + 1,
+                             " MiB); peak memory will exceed it");
+            floorWarned = true;
+        }
+    }
+    
+    // Explicit -I directories first, then the project root and its include/ directory
+    std::vector<std::string> searchPaths = options.includePaths;
+    searchPaths.push_back(projectPath);
+    searchPaths.push_back((std::filesystem::path(projectPath) / "include").string());
+    
+    // In a git work tree, files whose stat data still matches .git/index are
+    // known by blob id and can be served from the parse cache without a read
+    GitIndex gitIndex;
+    bool inGitRepo = gitIndex.load(projectPath);
+    ParseCache parseCache(options.useCache ? ParseCache::defaultDirectory() : std::string(),
+                          options.cacheBytes);
+    
+    // Shards are opened before any pipeline thread starts, so failing here
+    // leaves nothing running. Unsharded, the one writer uses storage itself.
+    unsigned shardCount = std::clamp(options.shards, 1u, kMaxShards);
+    std::vector<std::unique_ptr<ShardWriter>> shards;
+    for (unsigned k = 0; k < shardCount; k++) {
+        auto shard = std::make_unique<ShardWriter>();
+        if (shardCount == 1) {
+            shard->storage = &storage;
+        } else {
+            shard->owned = std::make_unique<SqliteStorage>();
+            if (!shard->owned->initialize(shardPath(options.databasePath, k))) {
+                logging::error("Error: Cannot open shard ", k, " of ", options.databasePath);
+                return false;
+            }
+            shard->storage = shard->owned.get();
+        }
+        shards.push_back(std::move(shard));
+    }
+    std::string_view projectRoot = projectPath;  // Walked paths start with it
+    
+    // An index written with the same settings is updated in place: only the
+    // rows of paths added, changed or removed since are deleted or written.
+    // Anything else decides what every file parses into, so rebuilds it.
+    std::string settings = std::to_string(CppParser::kVersion) + "\n";
+    for (const auto& searchPath : searchPaths) {
+        settings += searchPath + "\n";
+    }
+    settings += std::to_string(options.sizePolicy.declarationsAbove) + " " +
+                std::to_string(options.sizePolicy.skipAbove) + "\n";
+    if (shardCount > 1) {
+        settings += std::to_string(shardCount) + " shards by " + shardSchemeName(options.shardScheme) + "\n";
+    }
+    
+    StringTable paths;  // Parse results and stored files point at their path here
+    StringArena blobIds;
+    std::unordered_map<std::string_view, StoredFile> stored;
+    size_t retiredFiles = 0;
+    bool update = !options.force && storage.getMetadata("index_settings") == settings;
+    if (update) {
+        std::string retired = storage.getMetadata("retired_files");
+        retiredFiles = retired.empty() ? 0 : std::stoull(retired);
+        for (unsigned k = 0; k < shardCount; k++) {
+            ShardWriter& shard = *shards[k];
+            shard.storage->scanFiles([&](int64_t id, std::string_view path, uint64_t contentHash,
+                                         std::string_view blobId) {
+                stored[paths.intern(path)] = {id, contentHash, blobIds.copy(blobId)};
+                shard.nextFileId = std::max(shard.nextFileId, localShardId(id, shardCount) + 1);
+            });
+            // Ids are never reused: postings of deleted files still name theirs
+            std::string next = shard.storage->getMetadata("next_file_id");
+            if (!next.empty()) {
+                shard.nextFileId = std::max<int64_t>(shard.nextFileId, std::stoll(next));
+            }
+        }
+        // Those postings are only left out of queries, so once files rewritten
+        // or removed outnumber the live ones the index is rebuilt instead
+        update = retiredFiles <= stored.size();
+    }
+    if (update) {
+        for (auto& shard : shards) {
+            shard->storage->scanIdentifiers([&shard](int64_t nameId, std::string_view name) {
+                shard->occurrences.restoreName(static_cast<uint32_t>(nameId), name);
+            });
+            shard->occurrences.startSegment(shard->storage->nextPostingSegment());
+            shard->nameBytes = shard->occurrences.memoryBytes();
+        }
+    } else {
+        stored.clear();
+        for (auto& shard : shards) {
+            shard->nextFileId = 1;
+        }
+    }
+    
+    // Stages are connected by bounded queues, so a walker or reader that runs
+    // ahead blocks instead of buffering the tree: memory in flight depends on
+    // the thread count, not on the size of the repository
+    WorkQueue<ParsedFile> parsedFiles(options.threads * 2);
+    std::atomic<size_t> unchangedCount(0);
+    std::atomic<size_t> keptCount(0);
+    std::atomic<size_t> streamedCount(0);
+    std::atomic<size_t> declarationsOnlyCount(0);
+    std::atomic<size_t> skippedCount(0);
+    std::atomic<unsigned> activeParsers(options.threads);
+    
+    // Updating, the tree is walked before anything else: a path clean in the
+    // git index under the blob id it was indexed as is left alone unread, and
+    // when nothing was added, changed or removed the run ends here. Only the
+    // other paths go down the pipeline, with their blob when clean.
+    FileWalker walker(options.threads);
+    struct ChangedPath {
+        std::string path;
+        const GitIndexEntry* blob;
+    };
+    std::vector<ChangedPath> changedPaths;
+    if (update) {
+        trace::Scope scope("walk");
+        std::mutex changedMutex;
+        std::atomic<size_t> foundCount(0);
+        walker.walk(projectPath, [&](std::string path) {
+            auto it = stored.find(path);
+            StoredFile* file = it != stored.end() ? &it->second : nullptr;
+            if (file) {
+                file->found = true;
+                foundCount++;
+            }
+            const GitIndexEntry* blob = inGitRepo ? gitIndex.find(path) : nullptr;
+            if (blob && gitIndex.isUnchanged(path, *blob)) {
+                unchangedCount++;
+                if (file && file->blobId == blob->blob_id) {
+                    keptCount++;
+                    return;
+                }
+            } else {
+                blob = nullptr;
+            }
+            std::lock_guard<std::mutex> lock(changedMutex);
+            changedPaths.push_back({std::move(path), blob});
+        });
+        if (changedPaths.empty() && foundCount == stored.size()) {
+            summary.upToDate = true;
+            summary.files = keptCount;
+            summary.keptFiles = keptCount;
+            summary.directories = walker.directoriesVisited();
+            summary.ignoredEntries = walker.entriesIgnored();
+            summary.inGitRepo = inGitRepo;
+            summary.gitWorkTree = gitIndex.workTree();
+            summary.unchangedFiles = unchangedCount;
+            return true;
+        }
+    }
+    
+    // What the walker already learned about a file, carried through the
+    // reader as the request's user data
+    struct PendingFile {
+        const GitIndexEntry* blob = nullptr;
+        uint64_t cacheKey = 0;
+        bool keyKnown = false;  // Blob alias found: try the cache before reading
+        TaskPriority priority = TaskPriority::BULK;
+    };
+    
+    // Files the user has open come first, then files changed since the last
+    // commit (or, outside git, recently modified), then the rest. The read
+    // queue keeps one lane per class; the parsers share a work-stealing
+    // scheduler whose bulk work waits while another process answers a query.
+    WorkQueue<ReadRequest> readQueue(kReadQueueCapacity, kTaskPriorityCount);
+    PriorityScheduler<ReadCompletion> readFiles(options.threads, options.threads * 2);
+    std::optional<memory::Phase> pipelinePhase;
+    pipelinePhase.emplace("parse and write");
+    QueryActivity queryActivity(options.databasePath);
+    readFiles.setYield([&queryActivity]() { return queryActivity.waitForQueries(); });
+    
+    std::filesystem::path workingDirectory = std::filesystem::current_path();
+    std::unordered_set<std::string> openFiles;
+    for (const auto& openFile : options.openFiles) {
+        openFiles.insert((workingDirectory / openFile).lexically_normal().string());
+    }
+    auto recentlyModified = [](const std::string& path) {
+        std::error_code error;
+        auto modified = std::filesystem::last_write_time(path, error);
+        return !error && modified > std::filesystem::file_time_type::clock::now() - kRecentWindow;
+    };
+    
+    // Identical contents parse identically, wherever the file lives. A blob
+    // indexed on any branch before is found without reading the file. A file
+    // whose contents are still the ones indexed is not parsed at all.
+    auto parseWorker = [&](unsigned worker) {
+        trace::setThreadName("parse " + std::to_string(worker));
+        ReadCompletion read;
+        while (readFiles.pop(worker, read)) {
+            std::unique_ptr<PendingFile> pending(reinterpret_cast<PendingFile*>(read.user_data));
+            std::string_view file = paths.intern(read.path);
+            const GitIndexEntry* blob = pending->blob;
+            ParsedFile parsed;
+            parsed.path = file;
+            auto storedFile = stored.find(file);
+            if (storedFile != stored.end()) {
+                parsed.stored = &storedFile->second;
+            }
+            if (blob) {
+                parsed.blobId = blob->blob_id;
+            }
+            
+            bool cached = pending->keyKnown && parseCache.load(pending->cacheKey, file, parsed.result);
+            if (cached) {
+                parsed.unchanged = parsed.stored && parsed.result.content_hash == parsed.stored->contentHash;
+            } else {
+                // A stale alias leaves the file unread; fetch it here
+                if (!read.buffer.ok() && !read.buffer.deferred() && pending->keyKnown) {
+                    read.buffer = FileReader::read(read.path, CppParser::kStreamAbove);
+                }
+                std::string_view source = read.buffer.contents();
+                bool streamed = read.buffer.deferred();
+                uint64_t size = streamed ? read.buffer.fileSize() : source.size();
+                ParseDepth depth = options.sizePolicy.depthFor(size);
+                trace::count(trace::Counter::BYTES_READ, size);
+                
+                if (depth == ParseDepth::SKIP) {
+                    // Recorded without symbols or a content hash
+                    parsed.unchanged = parsed.stored && parsed.stored->contentHash == 0;
+                    skippedCount++;
+                } else {
+                    // Files too large to hold are hashed, then parsed, a chunk at a
+                    // time. An empty file reads fine and simply has no symbols.
+                    uint64_t contentHash = 0;
+                    bool readable = read.buffer.ok();
+                    {
+                        trace::Scope scope("hash");
+                        if (streamed) {
+                            readable = hashFile(read.path, 0, contentHash);
+                            streamedCount++;
+                        } else {
+                            contentHash = hashContent(source.data(), source.size());
+                        }
+                    }
+                    uint64_t cacheKey = ParseCache::key(contentHash, depth);
+                    if (depth == ParseDepth::DECLARATIONS) {
+                        declarationsOnlyCount++;
+                    }
+                    if (!readable) {
+                        logging::error("Could not read file: ", read.path);
+                    } else if (parsed.stored && parsed.stored->contentHash == contentHash) {
+                        parsed.unchanged = true;
+                    } else {
+                        if (!parseCache.load(cacheKey, file, parsed.result)) {
+                            parsed.result = streamed ? parser.parseStream(read.path, file, depth)
+                                                     : parser.parseSource(source, file, depth);
+                            parsed.result.content_hash = contentHash;
+                            parseCache.store(cacheKey, parsed.result);
+                        }
+                        // Aliases only ever name full parses (see the walker)
+                        if (blob && depth == ParseDepth::FULL) {
+                            parseCache.storeBlobKey(blob->blob_id, cacheKey);
+                        }
+                    }
+                }
+            }
+            read.buffer = FileBuffer();  // Hand the slot back to the reader early
+            readFiles.finished(worker);
+            parsedFiles.push(std::move(parsed));
+        }
+        if (--activeParsers == 0) {
+            parsedFiles.close();
+        }
+    };
+    
+    // Four overlapping stages: walker threads list directories, the reader
+    // keeps many file reads in flight, parse workers take each buffer as soon
+    // as it completes, and this thread writes each result as it arrives.
+    // Files already known to the cache skip the reader.
+    std::vector<std::thread> parseThreads;
+    for (unsigned i = 0; i < options.threads; i++) {
+        parseThreads.emplace_back(parseWorker, i);
+    }
+    FileReader reader(kReadBufferCount, kReadBufferSize, options.threads, CppParser::kStreamAbove,
+                      kReadHeapBytes);
+    std::thread readerThread([&]() {
+        trace::setThreadName("reader");
+        trace::Scope scope("read files");
+        reader.run(readQueue, [&](ReadCompletion read) {
+            TaskPriority priority = reinterpret_cast<PendingFile*>(read.user_data)->priority;
+            readFiles.push(std::move(read), priority);
+        });
+        readFiles.close();  // The walker closed readQueue, so it pushes nothing more
+    });
+    
+    // blob is given when the file's stat data matches .git/index
+    auto route = [&](std::string path, const GitIndexEntry* blob) {
+        auto pending = std::make_unique<PendingFile>();
+        if (!openFiles.empty() &&
+            openFiles.count((workingDirectory / path).lexically_normal().string()) != 0) {
+            pending->priority = TaskPriority::FOREGROUND;
+        } else if (inGitRepo ? !blob : recentlyModified(path)) {
+            pending->priority = TaskPriority::RECENT;
+        }
+        if (blob) {
+            pending->blob = blob;
+            // Aliases name full parses only, so a file indexed more lightly is read
+            pending->keyKnown = options.sizePolicy.depthFor(blob->size) == ParseDepth::FULL &&
+                                parseCache.loadBlobKey(blob->blob_id, pending->cacheKey);
+        }
+        
+        bool keyKnown = pending->keyKnown;
+        TaskPriority priority = pending->priority;
+        uint64_t userData = reinterpret_cast<uintptr_t>(pending.release());
+        if (keyKnown) {
+            readFiles.push({std::move(path), userData, FileBuffer()}, priority);
+        } else {
+            readQueue.push({std::move(path), userData}, static_cast<size_t>(priority));
+        }
+    };
+    std::thread walkerThread([&]() {
+        trace::setThreadName("walker");
+        if (update) {
+            for (auto& changed : changedPaths) {
+                route(std::move(changed.path), changed.blob);
+            }
+        } else {
+            trace::Scope scope("walk");
+            walker.walk(projectPath, [&](std::string path) {
+                const GitIndexEntry* blob = inGitRepo ? gitIndex.find(path) : nullptr;
+                if (blob && gitIndex.isUnchanged(path, *blob)) {
+                    unchangedCount++;
+                } else {
+                    blob = nullptr;
+                }
+                route(std::move(path), blob);
+            });
+        }
+        readQueue.close();
+    });
+    
+    storage.beginTransaction();
+    for (auto& shard : shards) {
+        if (shard->owned) {
+            shard->storage->beginTransaction();
+        }
+    }
+    if (!update) {
+        storage.clearDatabase();
+        for (auto& shard : shards) {
+            if (shard->owned) {
+                shard->storage->clearDatabase();
+            }
+        }
+    }
+    
+    int fileCount = 0;
+    std::atomic<size_t> symbolCount(0);
+    
+    // What every shard's writer adds to is shared and guarded by one mutex;
+    // the database writes themselves happen outside it
+    std::mutex sharedMutex;
+    IncludeResolver resolver(searchPaths);
+    
+    struct PendingIncludes {
+        uint32_t fileId;
+        std::string_view filePath;
+        std::vector<IncludeDirective> includes;
+    };
+    std::vector<PendingIncludes> pendingIncludes;
+    size_t pendingIncludeBytes = 0;
+    StringTable spellings;  // Include spellings outlive the results they came from
+    CallResolver callResolver;
+    
+    // Under a memory budget, postings go to storage in segments rather than
+    // all at the end. Whenever the process nears the budget, the segment size
+    // halves and fewer parsed files may wait for the writers. Shards split
+    // the budget between them.
+    std::atomic<uint64_t> postingsBatchBytes(UINT64_MAX);
+    uint64_t highWaterBytes = options.maxMemory / 4 * 3;
+    if (options.maxMemory != 0) {
+        postingsBatchBytes = std::max(options.maxMemory / 8, kMinPostingsBatchBytes);
+    }
+    auto flushPostings = [](ShardWriter& shard) {
+        trace::Scope scope("write postings");
+        memory::TagScope tag(memory::MemoryTag::INDEXES);
+        shard.occurrences.flush([&shard](uint32_t nameId, const std::string& name, int segment,
+                                         uint64_t count, const std::string& postings) {
+            shard.storage->storePostings(nameId, name, segment, static_cast<int64_t>(count), postings);
+        });
+        shard.postingSegments++;
+    };
+    
+    // Each result is written and released before the next is taken; only
+    // interned names, include spellings and posting bytes stay behind. Ids
+    // are global (see sharded_storage.hpp), so the resolvers see one index.
+    // A changed file's old rows are deleted first; its new ones get a new id.
+    auto writeFile = [&](ShardWriter& shard, unsigned k, ParsedFile& parsed) {
+        trace::Scope scope("write file");
+        std::string file(parsed.path);
+        ParseResult& result = parsed.result;
+        if (parsed.unchanged) {
+            if (parsed.stored->blobId != parsed.blobId) {
+                shard.storage->setFileBlob(parsed.stored->id, parsed.blobId);
+            }
+            keptCount++;
+            return;
+        }
+        if (parsed.stored) {
+            shard.storage->deleteFile(parsed.stored->id, file);
+            parsed.stored->rewritten = true;
+        }
+        
+        int64_t globalFileId = globalShardId(shard.nextFileId++, k, shardCount);
+        uint32_t fileId = static_cast<uint32_t>(shard.storage->storeFile(file, result.content_hash,
+                                                                         globalFileId, parsed.blobId));
+        shard.files++;
+        std::vector<int64_t> symbolIds(result.symbols.size(), 0);
+        {
+            memory::TagScope tag(memory::MemoryTag::SYMBOLS);
+            for (size_t i = 0; i < result.symbols.size(); i++) {
+                int64_t localId = shard.storage->storeSymbol(result.symbols[i]);
+                if (localId != 0) {
+                    symbolIds[i] = globalShardId(localId, k, shardCount);
+                }
+            }
+        }
+        if (fileId != 0) {
+            memory::TagScope tag(memory::MemoryTag::INDEXES);
+            shard.occurrences.addFile(fileId, result.identifier_names, result.occurrences);
+            shard.nameBytes = shard.occurrences.memoryBytes();
+            // Kept for resolving again in runs that leave this file alone
+            for (const auto& include : result.includes) {
+                shard.storage->storeIncludeDirective(fileId, include);
+            }
+            for (const auto& call : result.calls) {
+                if (call.caller_index < symbolIds.size() && symbolIds[call.caller_index] != 0) {
+                    shard.storage->storeCallSite(localShardId(symbolIds[call.caller_index], shardCount),
+                                                 fileId, call);
+                }
+            }
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(sharedMutex);
+            memory::TagScope tag(memory::MemoryTag::SYMBOLS);
+            for (size_t i = 0; i < result.symbols.size(); i++) {
+                if (symbolIds[i] != 0) {
+                    callResolver.addSymbol(symbolIds[i], fileId, result.symbols[i]);
+                    symbolCount++;
+                }
+            }
+            for (const auto& call : result.calls) {
+                if (call.caller_index < symbolIds.size() && symbolIds[call.caller_index] != 0) {
+                    callResolver.addCall(symbolIds[call.caller_index], fileId, call);
+                }
+            }
+            if (fileId != 0) {
+                memory::TagScope indexTag(memory::MemoryTag::INDEXES);
+                resolver.addFile(file, fileId);
+                if (!result.includes.empty()) {
+                    for (auto& include : result.includes) {
+                        include.path = spellings.intern(include.path);
+                    }
+                    pendingIncludeBytes += result.includes.capacity() * sizeof(IncludeDirective);
+                    pendingIncludes.push_back({fileId, parsed.path, std::move(result.includes)});
+                }
+            }
+        }
+        
+        if (shard.occurrences.bufferedBytes() >= postingsBatchBytes / shardCount) {
+            flushPostings(shard);
+        }
+    };
+    
+    // With several shards each has a writer thread of its own and this
+    // thread only routes files to them; with one, it writes them itself
+    if (shardCount > 1) {
+        for (unsigned k = 0; k < shardCount; k++) {
+            ShardWriter& shard = *shards[k];
+            shard.queue.setCapacity(options.threads * 2);
+            shard.thread = std::thread([&writeFile, &shard, k]() {
+                trace::setThreadName("writer " + std::to_string(k));
+                ParsedFile item;
+                while (shard.queue.pop(item)) {
+                    writeFile(shard, k, item);
+                }
+            });
+        }
+    }
+    
+    // Paths, include spellings and edges, functions and call sites, and
+    // identifier names are kept until all files are in, so they raise the
+    // floor as the run goes on; so do the files an update started from
+    auto checkFloor = [&]() {
+        size_t keptBytes = paths.bytesReserved() + spellings.bytesReserved() + blobIds.bytesReserved() +
+                           stored.size() * (sizeof(std::pair<const std::string_view, StoredFile>) +
+                                            2 * sizeof(void*)) +
+                           stored.bucket_count() * sizeof(void*);
+        {
+            std::lock_guard<std::mutex> lock(sharedMutex);
+            keptBytes += resolver.memoryBytes() + pendingIncludes.capacity() * sizeof(PendingIncludes) +
+                         pendingIncludeBytes + callResolver.memoryBytes();
+        }
+        for (const auto& shard : shards) {
+            keptBytes += shard->nameBytes;
+        }
+        summary.memoryFloor = std::max(summary.memoryFloor, baseFloor + keptBytes);
+        if (!floorWarned && summary.memoryFloor > options.maxMemory) {
+            logging::warning("Memory budget of ", options.maxMemory >> 20,
+                             " MiB is below what indexing needs (", (summary.memoryFloor >> 20) + 1,
+                             " MiB, ", (keptBytes >> 20) + 1, " MiB of it kept until the run ends); ",
+                             "peak memory will exceed it");
+            floorWarned = true;
+        }
+    };
+    
+    ParsedFile parsed;
+    while (parsedFiles.pop(parsed)) {
+        fileCount++;
+        
+        if (options.maxMemory != 0 && fileCount % kMemoryCheckInterval == 0) {
+            checkFloor();
+            if (postingsBatchBytes > kMinPostingsBatchBytes && currentResidentBytes() > highWaterBytes) {
+                postingsBatchBytes = std::max(postingsBatchBytes / 2, kMinPostingsBatchBytes);
+                parsedFiles.setCapacity(options.threads);
+            }
+        }
+        
+        if (shardCount == 1) {
+            writeFile(*shards[0], 0, parsed);
+            continue;
+        }
+        std::string_view relative = parsed.path;
+        if (relative.substr(0, projectRoot.size()) == projectRoot) {
+            relative.remove_prefix(projectRoot.size());
+        }
+        while (!relative.empty() && relative.front() == '/') {
+            relative.remove_prefix(1);
+        }
+        shards[shardFor(relative, options.shardScheme, shardCount)]->queue.push(std::move(parsed));
+    }
+    if (shardCount > 1) {
+        for (auto& shard : shards) {
+            shard->queue.close();
+            shard->thread.join();
+        }
+    }
+    
+    walkerThread.join();
+    readerThread.join();
+    for (auto& thread : parseThreads) {
+        thread.join();
+    }
+    pipelinePhase.reset();
+    
+    // Paths indexed before but not walked this time are gone
+    size_t removedCount = 0;
+    for (auto& entry : stored) {
+        if (!entry.second.found) {
+            shards[shardOfId(entry.second.id, shardCount)]->storage->deleteFile(entry.second.id,
+                                                                                std::string(entry.first));
+            entry.second.rewritten = true;
+            removedCount++;
+        }
+    }
+    
+    size_t writtenCount = 0;
+    for (const auto& shard : shards) {
+        writtenCount += shard->files;
+    }
+    summary.files = keptCount + writtenCount;
+    summary.keptFiles = keptCount;
+    summary.removedFiles = removedCount;
+    summary.directories = walker.directoriesVisited();
+    summary.ignoredEntries = walker.entriesIgnored();
+    summary.inGitRepo = inGitRepo;
+    summary.cacheEnabled = parseCache.enabled();
+    summary.readBackend = reader.backend();
+    for (size_t i = 0; i < kTaskPriorityCount; i++) {
+        summary.scheduling[i] = readFiles.statsFor(static_cast<TaskPriority>(i));
+    }
+    summary.steals = readFiles.stealCount();
+    summary.yieldedTime = readFiles.yieldedTime();
+    if (inGitRepo) {
+        summary.gitWorkTree = gitIndex.workTree();
+        summary.unchangedFiles = unchangedCount;
+    }
+    
+    // Runs work for every shard, on a thread each when there are several
+    auto forEachShard = [&](const std::function<void(unsigned)>& work) {
+        if (shardCount == 1) {
+            work(0);
+            return;
+        }
+        std::vector<std::thread> threads;
+        for (unsigned k = 0; k < shardCount; k++) {
+            threads.emplace_back(work, k);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    };
+    
+    // Every file read had the contents indexed: at most blob ids changed
+    if (update && writtenCount == 0 && removedCount == 0) {
+        forEachShard([&](unsigned k) { shards[k]->storage->commitTransaction(); });
+        if (shardCount > 1) {
+            storage.commitTransaction();
+        }
+        summary.upToDate = true;
+        return true;
+    }
+    
+    // Resolution starts again from every file, so what the files left alone
+    // contributed is read back: their paths, include directives, functions
+    // and call sites
+    size_t keptSymbols = 0;
+    if (update) {
+        trace::Scope scope("load kept files");
+        memory::Phase phase("load kept files");
+        std::unordered_map<int64_t, std::string_view> keptPaths;
+        for (const auto& entry : stored) {
+            if (!entry.second.rewritten) {
+                keptPaths.emplace(entry.second.id, entry.first);
+                resolver.addFile(std::string(entry.first), static_cast<uint32_t>(entry.second.id));
+            }
+        }
+        for (unsigned k = 0; k < shardCount; k++) {
+            SqliteStorage& shardStorage = *shards[k]->storage;
+            shardStorage.scanIncludeDirectives([&](int64_t fileId, const IncludeDirective& include) {
+                auto kept = keptPaths.find(fileId);
+                if (kept == keptPaths.end()) {
+                    return;
+                }
+                if (pendingIncludes.empty() || pendingIncludes.back().fileId != fileId) {
+                    pendingIncludes.push_back({static_cast<uint32_t>(fileId), kept->second, {}});
+                }
+                IncludeDirective directive = include;
+                directive.path = spellings.intern(include.path);
+                pendingIncludes.back().includes.push_back(directive);
+                pendingIncludeBytes += sizeof(IncludeDirective);
+            });
+            shardStorage.scanSymbols([&](int64_t id, const Symbol& symbol) {
+                auto file = stored.find(symbol.file_path);
+                if (file == stored.end() || file->second.rewritten) {
+                    return;
+                }
+                SymbolRecord record;
+                record.name = symbol.name;
+                record.type = symbol.type;
+                record.file_path = file->first;
+                record.line_number = symbol.line_number;
+                record.column_number = symbol.column_number;
+                record.parent_scope = symbol.parent_scope;
+                record.qualified_name = symbol.qualified_name;
+                record.param_count = symbol.param_count;
+                record.required_param_count = symbol.required_param_count;
+                callResolver.addSymbol(globalShardId(id, k, shardCount), file->second.id, record);
+                keptSymbols++;
+            });
+            shardStorage.scanCallSites([&](int64_t callerId, int64_t fileId, const CallSite& call) {
+                if (keptPaths.count(fileId) != 0) {
+                    callResolver.addCall(globalShardId(callerId, k, shardCount), fileId, call);
+                }
+            });
+        }
+    }
+    if (options.maxMemory != 0) {
+        checkFloor();
+    }
+    
+    // Rebuilding, derived tables are written whole; updating, each is synced
+    // to what was derived, so only the rows that differ are touched
+    using TableValue = SqliteStorage::TableValue;
+    auto putRows = [update](SqliteStorage& target, const char* table,
+                            const std::function<bool(std::vector<TableValue>&)>& nextRow) {
+        const SqliteStorage::IndexTable& columns = *SqliteStorage::findIndexTable(table);
+        return update ? target.syncRows(columns, nextRow) : target.writeRows(columns, nextRow);
+    };
+    auto integer = [](int64_t value) {
+        TableValue column;
+        column.type = TableValue::Type::INTEGER;
+        column.integer = value;
+        return column;
+    };
+    auto bytes = [](TableValue::Type type, std::string_view value) {
+        TableValue column;
+        column.type = type;
+        column.bytes = value;
+        return column;
+    };
+    
+    // Includes can only be resolved once every file has an id. An edge is
+    // kept by the includer's shard, a file's dependents by its own.
+    IncludeGraph includeGraph;
+    int unresolvedIncludes = 0;
+    {
+        trace::Scope scope("resolve includes");
+        memory::Phase phase("resolve includes");
+        memory::TagScope tag(memory::MemoryTag::INDEXES);
+        for (unsigned k = 0; k < shardCount; k++) {
+            size_t next = 0;
+            size_t at = 0;
+            putRows(*shards[k]->storage, "include_edges", [&](std::vector<TableValue>& row) {
+                while (next < pendingIncludes.size()) {
+                    const PendingIncludes& pending = pendingIncludes[next];
+                    if (shardOfId(pending.fileId, shardCount) != k || at == pending.includes.size()) {
+                        next++;
+                        at = 0;
+                        continue;
+                    }
+                    const IncludeDirective& include = pending.includes[at++];
+                    uint32_t targetId = resolver.resolve(pending.filePath, include.path, include.is_system);
+                    if (targetId == 0) {
+                        unresolvedIncludes++;
+                        continue;
+                    }
+                    includeGraph.addEdge(pending.fileId, targetId);
+                    row = {integer(pending.fileId), integer(targetId), integer(include.line_number)};
+                    return true;
+                }
+                return false;
+            });
+        }
+        // Freed rather than cleared, so the closure below reuses the memory
+        pendingIncludes = std::vector<PendingIncludes>();
+    }
+    
+    {
+        trace::Scope scope("reverse dependencies");
+        memory::Phase phase("reverse dependencies");
+        memory::TagScope tag(memory::MemoryTag::INDEXES);
+        auto closure = includeGraph.computeReverseClosure();
+        forEachShard([&](unsigned k) {
+            auto entry = closure.begin();
+            std::string serialized;
+            putRows(*shards[k]->storage, "file_rdeps", [&](std::vector<TableValue>& row) {
+                for (; entry != closure.end(); ++entry) {
+                    if (!entry->second.empty() && shardOfId(entry->first, shardCount) == k) {
+                        serialized = entry->second.serialize();
+                        row = {integer(entry->first), bytes(TableValue::Type::BLOB, serialized)};
+                        ++entry;
+                        return true;
+                    }
+                }
+                return false;
+            });
+        });
+    }
+    
+    // Call targets may be defined in any file, so they are bound after
+    // parsing. A call between shards is kept by both, by name (see
+    // storeRemoteCall()), since neither can join against the other's symbols.
+    std::vector<CallEdge> callEdges;
+    std::vector<UnresolvedCall> unresolvedCalls;
+    std::atomic<size_t> crossShardCalls(0);
+    {
+        trace::Scope scope("resolve calls");
+        memory::Phase phase("resolve calls");
+        memory::TagScope tag(memory::MemoryTag::SYMBOLS);
+        callResolver.resolve(callEdges, unresolvedCalls);
+        forEachShard([&](unsigned k) {
+            trace::Scope shardScope("write calls");
+            SqliteStorage& shardStorage = *shards[k]->storage;
+            size_t next = 0;
+            putRows(shardStorage, "call_edges", [&](std::vector<TableValue>& row) {
+                while (next < callEdges.size()) {
+                    const CallEdge& edge = callEdges[next++];
+                    if (shardOfId(edge.caller_id, shardCount) == k && shardOfId(edge.callee_id, shardCount) == k) {
+                        row = {integer(localShardId(edge.caller_id, shardCount)),
+                               integer(localShardId(edge.callee_id, shardCount)), integer(edge.file_id),
+                               integer(edge.line_number)};
+                        return true;
+                    }
+                }
+                return false;
+            });
+            next = 0;
+            putRows(shardStorage, "remote_calls", [&](std::vector<TableValue>& row) {
+                while (next < callEdges.size()) {
+                    const CallEdge& edge = callEdges[next++];
+                    unsigned callerShard = shardOfId(edge.caller_id, shardCount);
+                    unsigned calleeShard = shardOfId(edge.callee_id, shardCount);
+                    if (callerShard == calleeShard || (callerShard != k && calleeShard != k)) {
+                        continue;
+                    }
+                    bool outgoing = callerShard == k;
+                    crossShardCalls += outgoing ? 1 : 0;
+                    int64_t symbolId = outgoing ? edge.caller_id : edge.callee_id;
+                    int64_t remoteId = outgoing ? edge.callee_id : edge.caller_id;
+                    row = {integer(localShardId(symbolId, shardCount)), integer(outgoing ? 1 : 0),
+                           bytes(TableValue::Type::TEXT, callResolver.qualifiedName(remoteId)),
+                           bytes(TableValue::Type::TEXT, callResolver.filePath(edge.caller_id)),
+                           integer(edge.line_number)};
+                    return true;
+                }
+                return false;
+            });
+            next = 0;
+            putRows(shardStorage, "unresolved_calls", [&](std::vector<TableValue>& row) {
+                while (next < unresolvedCalls.size()) {
+                    const UnresolvedCall& call = unresolvedCalls[next++];
+                    if (shardOfId(call.caller_id, shardCount) == k) {
+                        row = {integer(localShardId(call.caller_id, shardCount)),
+                               bytes(TableValue::Type::TEXT, call.callee_name), integer(call.file_id),
+                               integer(call.line_number)};
+                        return true;
+                    }
+                }
+                return false;
+            });
+        });
+    }
+    
+    {
+        memory::Phase phase("write postings");
+        forEachShard([&](unsigned k) { flushPostings(*shards[k]); });
+    }
+    
+    // Shards commit before the manifest that names them. Files rewritten or
+    // removed by an update leave postings behind, counted until a rebuild.
+    size_t retiring = 0;
+    for (const auto& entry : stored) {
+        retiring += entry.second.rewritten ? 1 : 0;
+    }
+    {
+        memory::Phase phase("commit");
+        for (auto& shard : shards) {
+            shard->storage->setMetadata("next_file_id", std::to_string(shard->nextFileId));
+        }
+        if (shardCount > 1) {
+            forEachShard([&](unsigned k) { shards[k]->storage->commitTransaction(); });
+            storage.setMetadata("shard_count", std::to_string(shardCount));
+            storage.setMetadata("shard_scheme", shardSchemeName(options.shardScheme));
+        }
+        storage.setMetadata("index_settings", settings);
+        storage.setMetadata("retired_files", std::to_string(update ? retiredFiles + retiring : 0));
+        // Where stored paths are rooted, for exporting the index elsewhere
+        std::string root = projectPath;
+        while (root.size() > 1 && root.back() == '/') {
+            root.pop_back();
+        }
+        std::string includePaths;
+        for (const auto& includePath : options.includePaths) {
+            includePaths += includePath + "\n";
+        }
+        storage.setMetadata("project_root", root);
+        storage.setMetadata("include_paths", includePaths);
+        storage.stampIndex();
+        storage.commitTransaction();
+    }
+    parseCache.evict();
+    removeShards(options.databasePath, shardCount > 1 ? shardCount : 0);
+    
+    summary.symbols = symbolCount + keptSymbols;
+    summary.includeEdges = includeGraph.edgeCount();
+    summary.unresolvedIncludes = static_cast<size_t>(unresolvedIncludes);
+    summary.callEdges = callEdges.size();
+    summary.unresolvedCalls = unresolvedCalls.size();
+    summary.cacheHits = parseCache.hits();
+    summary.cacheMisses = parseCache.misses();
+    summary.streamedFiles = streamedCount;
+    summary.declarationsOnlyFiles = declarationsOnlyCount;
+    summary.skippedFiles = skippedCount;
+    summary.shards = shardCount;
+    summary.crossShardCalls = crossShardCalls;
+    for (const auto& shard : shards) {
+        summary.shardFiles.push_back(shard->files);
+        summary.occurrences += shard->occurrences.occurrenceCount();
+        summary.occurrenceNames += shard->occurrences.nameCount();
+        summary.postingBytes += shard->occurrences.encodedBytes();
+        summary.postingSegments += shard->postingSegments;
+    }
+    return true;
+}
+
+} // namespace devpilot
@@ -0,0 +1,376 @@
+#include "lexer.hpp"
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <unordered_set>
+
+namespace devpilot {
+
+// Single responsibility: Only split C++ source into tokens
+
+namespace {
+
+bool isIdentifierStart(char c) {
+    // Bytes >= 0x80 are treated as identifier characters so UTF-8 names stay whole
+    return std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == '$' ||
+           static_cast<unsigned char>(c) >= 0x80;
+}
+
+bool isIdentifierChar(char c) {
+    return isIdentifierStart(c) || std::isdigit(static_cast<unsigned char>(c));
+}
+
+bool isStringPrefix(std::string_view text) {
+    return text == "L" || text == "u" || text == "U" || text == "u8" || text == "R" ||
+           text == "LR" || text == "uR" || text == "UR" || text == "u8R";
+}
+
+} // namespace
+
+bool isCppKeyword(std::string_view text) {
+    static const std::unordered_set<std::string_view> keywords = {
+        "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break",
+        "case", "catch", "char", "char8_t", "char16_t", "char32_t", "class", "co_await",
+        "co_return", "co_yield", "compl", "concept", "const", "consteval", "constexpr",
+        "constinit", "const_cast", "continue", "decltype", "default", "delete", "do", "double",
+        "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "float", "for",
+        "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept",
+        "not", "not_eq", "nullptr", "operator", "or", "or_eq", "private", "protected", "public",
+        "register", "reinterpret_cast", "requires", "return", "short", "signed", "sizeof",
+        "static", "static_assert", "static_cast", "struct", "switch", "template", "this",
+        "thread_local", "throw", "true", "try", "typedef", "typeid", "typename", "union",
+        "unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq"};
+    return keywords.count(text) > 0;
+}
+
+CppLexer::CppLexer(std::string_view source, size_t rewindLimit)
+    : source(source), base(0), pos(0), line(1), lineStart(0), atLineStart(true), final(true),
+      starved(false), rewindLimit(rewindLimit), carry(Carry::NONE), carryQuote('"'),
+      carryEscape(false), carryComment(false) {
+}
+
+void CppLexer::moveWindow(std::string_view window, size_t newBase, bool isFinal) {
+    pos = base + pos - newBase;
+    source = window;
+    base = newBase;
+    final = isFinal;
+}
+
+size_t CppLexer::resumeOffset() const {
+    return base + pos;
+}
+
+// At the edge of a window that is not the last, the answer depends on bytes
+// not seen yet: the scan is marked starved so next() can wait for them
+bool CppLexer::atEnd(size_t ahead) {
+    if (pos + ahead < source.size()) {
+        return false;
+    }
+    if (!final) {
+        starved = true;
+    }
+    return true;
+}
+
+char CppLexer::peek(size_t ahead) {
+    return atEnd(ahead) ? '\0' : source[pos + ahead];
+}
+
+void CppLexer::advance() {
+    if (source[pos] == '\n') {
+        line++;
+        lineStart = base + pos + 1;
+        atLineStart = true;
+    }
+    pos++;
+}
+
+int CppLexer::column(size_t offset) const {
+    return static_cast<int>(offset - lineStart) + 1;
+}
+
+Token CppLexer::makeToken(TokenKind kind, size_t start, int startLine, int startColumn) const {
+    return {kind, source.substr(start, pos - start), startLine, startColumn, base + start};
+}
+
+Token CppLexer::endOfInput() const {
+    return {TokenKind::END, std::string_view(), line, column(base + pos), base + pos};
+}
+
+void CppLexer::skipWhitespaceAndComments() {
+    while (!atEnd()) {
+        char c = source[pos];
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v') {
+            advance();
+        } else if (c == '\\' && (peek(1) == '\n' || (peek(1) == '\r' && peek(2) == '\n'))) {
+            // Line splice outside a directive
+            advance();
+        } else if (c == '/' && peek(1) == '/') {
+            carry = Carry::LINE_COMMENT;
+            if (!skipCarried()) {
+                return;
+            }
+        } else if (c == '/' && peek(1) == '*') {
+            pos += 2;
+            carry = Carry::BLOCK_COMMENT;
+            if (!skipCarried()) {
+                return;
+            }
+        } else {
+            break;
+        }
+    }
+}
+
+// Up to and including "*/", or to the end of the file
+bool CppLexer::skipBlockComment() {
+    while (!atEnd()) {
+        if (source[pos] == '*' && peek(1) == '/') {
+            pos += 2;
+            return true;
+        }
+        if (starved) {
+            return false;  // A "*" at the edge may begin the terminator
+        }
+        advance();
+    }
+    return !starved;
+}
+
+// Finishes a construct left open at the previous window's edge. Returns false
+// when this window ends inside it too.
+bool CppLexer::skipCarried() {
+    bool done = true;
+    switch (carry) {
+    case Carry::NONE:
+        return true;
+    case Carry::BLOCK_COMMENT:
+        done = skipBlockComment();
+        break;
+    case Carry::LINE_COMMENT:
+        while (!atEnd() && source[pos] != '\n') {
+            pos++;
+        }
+        done = !starved;
+        break;
+    case Carry::QUOTED:
+        done = skipQuoted();
+        break;
+    case Carry::RAW_STRING:
+        done = skipRawString();
+        break;
+    case Carry::DIRECTIVE:
+        done = skipDirective();
+        atLineStart = done;
+        break;
+    }
+    if (done) {
+        carry = Carry::NONE;
+    }
+    return done;
+}
+
+Token CppLexer::next() {
+    starved = false;
+    if (!skipCarried()) {
+        return endOfInput();
+    }
+    skipWhitespaceAndComments();
+    if (starved || atEnd()) {
+        return endOfInput();
+    }
+
+    size_t start = pos;
+    int startLine = line;
+    size_t startLineStart = lineStart;
+    bool startAtLineStart = atLineStart;
+    Token token;
+
+    char c = source[pos];
+    int startColumn = column(base + pos);
+    if (c == '#' && atLineStart) {
+        token = lexPreprocessor();
+    } else {
+        atLineStart = false;
+        if (isIdentifierStart(c)) {
+            token = lexIdentifierOrLiteral();
+        } else if (std::isdigit(static_cast<unsigned char>(c)) ||
+                   (c == '.' && std::isdigit(static_cast<unsigned char>(peek(1))))) {
+            token = lexNumber();
+        } else if (c == '"' || c == '\'') {
+            token = lexQuoted(start, line, startColumn);
+        } else {
+            // "::" and "->" matter for qualified names and member access; everything else is one char
+            pos += ((c == ':' && peek(1) == ':') || (c == '-' && peek(1) == '>')) ? 2 : 1;
+            token = makeToken(TokenKind::PUNCTUATION, start, line, startColumn);
+        }
+    }
+
+    // Cut by the window edge: lex it again once the next window arrives, unless
+    // it is too long to keep, in which case it stays truncated and skipCarried()
+    // consumes the rest
+    if (starved && pos - start <= rewindLimit) {
+        pos = start;
+        line = startLine;
+        lineStart = startLineStart;
+        atLineStart = startAtLineStart;
+        carry = Carry::NONE;
+        return endOfInput();
+    }
+    return token;
+}
+
+Token CppLexer::lexPreprocessor() {
+    size_t start = pos;
+    int startLine = line;
+    int startColumn = column(base + pos);
+
+    carryComment = false;
+    if (!skipDirective()) {
+        carry = Carry::DIRECTIVE;
+    }
+
+    Token token = makeToken(TokenKind::PREPROCESSOR, start, startLine, startColumn);
+    atLineStart = true;
+    return token;
+}
+
+// The rest of a directive line, continuations included
+bool CppLexer::skipDirective() {
+    if (carryComment) {
+        if (!skipBlockComment()) {
+            return false;
+        }
+        carryComment = false;
+    }
+    while (!atEnd() && source[pos] != '\n') {
+        if (source[pos] == '\\' && (peek(1) == '\n' || (peek(1) == '\r' && peek(2) == '\n'))) {
+            pos += peek(1) == '\r' ? 2 : 1;
+            advance();
+            continue;
+        }
+        if (source[pos] == '/' && peek(1) == '*') {
+            // A block comment may carry the directive over several lines
+            advance();
+            carryComment = true;
+            if (!skipBlockComment()) {
+                return false;
+            }
+            carryComment = false;
+            continue;
+        }
+        if (starved) {
+            return false;
+        }
+        pos++;
+    }
+    return !starved;
+}
+
+Token CppLexer::lexIdentifierOrLiteral() {
+    size_t start = pos;
+    int startColumn = column(base + pos);
+
+    while (!atEnd() && isIdentifierChar(source[pos])) {
+        pos++;
+    }
+
+    std::string_view text = source.substr(start, pos - start);
+    if (isStringPrefix(text) && (peek() == '"' || (peek() == '\'' && text.back() != 'R'))) {
+        if (text.back() == 'R' && peek() == '"') {
+            return lexRawString(start, line, startColumn);
+        }
+        return lexQuoted(start, line, startColumn);
+    }
+
+    return makeToken(TokenKind::IDENTIFIER, start, line, startColumn);
+}
+
+Token CppLexer::lexNumber() {
+    size_t start = pos;
+    int startColumn = column(base + pos);
+
+    while (!atEnd()) {
+        char c = source[pos];
+        if (isIdentifierChar(c) || c == '.' || c == '\'') {
+            pos++;
+        } else if ((c == '+' || c == '-') && pos > start &&
+                   (source[pos - 1] == 'e' || source[pos - 1] == 'E' || source[pos - 1] == 'p' ||
+                    source[pos - 1] == 'P')) {
+            pos++;
+        } else {
+            break;
+        }
+    }
+
+    return makeToken(TokenKind::NUMBER, start, line, startColumn);
+}
+
+Token CppLexer::lexQuoted(size_t start, int startLine, int startColumn) {
+    carryQuote = source[pos];
+    carryEscape = false;
+    pos++;
+    if (!skipQuoted()) {
+        carry = Carry::QUOTED;
+    }
+    return makeToken(carryQuote == '"' ? TokenKind::STRING : TokenKind::CHARACTER, start,
+                     startLine, startColumn);
+}
+
+// Up to and including the closing quote
+bool CppLexer::skipQuoted() {
+    while (!atEnd()) {
+        char c = source[pos];
+        if (carryEscape) {
+            carryEscape = false;
+            if (c == '\n') {
+                return true;
+            }
+        } else if (c == carryQuote) {
+            pos++;
+            return true;
+        } else if (c == '\\') {
+            carryEscape = true;
+        } else if (c == '\n') {
+            // Unterminated literal: stop at the end of the line
+            return true;
+        }
+        pos++;
+    }
+    return !starved;
+}
+
+Token CppLexer::lexRawString(size_t start, int startLine, int startColumn) {
+    // R"delim( ... )delim"
+    pos++;
+    size_t delimiterStart = pos;
+    while (!atEnd() && source[pos] != '(' && source[pos] != '\n') {
+        pos++;
+    }
+    if (starved) {
+        return makeToken(TokenKind::STRING, start, startLine, startColumn);
+    }
+    carryTerminator = ")" + std::string(source.substr(delimiterStart, pos - delimiterStart)) + "\"";
+
+    if (!skipRawString()) {
+        carry = Carry::RAW_STRING;
+    }
+    atLineStart = false;
+    return makeToken(TokenKind::STRING, start, startLine, startColumn);
+}
+
+bool CppLexer::skipRawString() {
+    size_t end = source.find(carryTerminator, pos);
+    size_t stop = end == std::string_view::npos ? source.size() : end + carryTerminator.size();
+    if (end == std::string_view::npos && !final) {
+        // The terminator may straddle the edge; leave room to find it whole
+        stop = std::max(pos, source.size() - std::min(source.size(), carryTerminator.size() - 1));
+        starved = true;
+    }
+    while (pos < stop) {
+        advance();
+    }
+    return !starved;
+}
+
+} // namespace devpilot
@@ -0,0 +1,249 @@
+#include "logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace devpilot {
+namespace logging {
+
+// Single responsibility: Only queue log messages and write them out in order
+
+namespace {
+
+struct Entry {
+    uint64_t sequence = 0;
+    LogLevel level = LogLevel::INFO;
+    std::string text;
+};
+
+// Written by one thread, read by whoever holds the drain lock
+class LogRing {
+public:
+    static constexpr size_t kCapacity = 512;
+
+    bool push(Entry& entry) {
+        size_t position = head.load(std::memory_order_relaxed);
+        if (position - tail.load(std::memory_order_acquire) == kCapacity) {
+            return false;
+        }
+        entries[position % kCapacity] = std::move(entry);
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // The lowest sequence this ring's thread may still push; set before the
+    // thread takes a sequence and cleared once the entry is in
+    std::atomic<uint64_t> pending{UINT64_MAX};
+
+    size_t size() const {
+        return head.load(std::memory_order_relaxed) - tail.load(std::memory_order_relaxed);
+    }
+
+    bool pop(Entry& entry) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if (position == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        entry = std::move(entries[position % kCapacity]);
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    Entry entries[kCapacity];
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+};
+
+// Set once the drain is gone (static destruction); later messages are
+// written directly
+std::atomic<bool> shutDown{false};
+std::atomic<bool> started{false};
+std::atomic<uint64_t> nextSequence{0};
+std::atomic<bool> allToStderr{false};
+
+void writeEntry(const Entry& entry) {
+    bool toStderr = entry.level <= LogLevel::WARNING || allToStderr.load(std::memory_order_relaxed);
+    std::ostream& out = toStderr ? std::cerr : std::cout;
+    out << entry.text << '\n';
+}
+
+class Drain {
+public:
+    static Drain& instance() {
+        static Drain drain;
+        return drain;
+    }
+
+    Drain() : thread([this]() { run(); }) {
+        started.store(true);
+    }
+
+    ~Drain() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wakeup.notify_one();
+        thread.join();
+        shutDown.store(true);
+        drainOnce(true);
+    }
+
+    LogRing& localRing() {
+        thread_local LogRing* ring = nullptr;
+        if (!ring) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            rings.push_back(std::make_unique<LogRing>());
+            ring = rings.back().get();
+        }
+        return *ring;
+    }
+
+    // At most one wakeup per drain pass, however many messages arrive
+    void wake() {
+        if (!signalled.exchange(true, std::memory_order_acq_rel)) {
+            {
+                std::lock_guard<std::mutex> lock(wakeMutex);
+                pending = true;
+            }
+            wakeup.notify_one();
+        }
+    }
+
+    // Writes, in order, every message whose sequence is below the lowest one
+    // a thread may still be pushing; later ones wait for a following pass so
+    // a slow submitter cannot be overtaken. Returns the first sequence not
+    // yet written. The final pass writes everything.
+    uint64_t drainOnce(bool final = false) {
+        std::lock_guard<std::mutex> drainLock(drainMutex);
+        signalled.store(false, std::memory_order_release);
+        // Read before the rings: a thread that has not announced itself by
+        // then takes a sequence at or above this
+        uint64_t complete = nextSequence.load();
+        std::vector<LogRing*> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            for (const auto& ring : rings) {
+                snapshot.push_back(ring.get());
+            }
+        }
+        for (LogRing* ring : snapshot) {
+            complete = std::min(complete, ring->pending.load());
+        }
+        if (final) {
+            complete = UINT64_MAX;
+        }
+
+        Entry entry;
+        for (LogRing* ring : snapshot) {
+            while (ring->pop(entry)) {
+                held.push_back(std::move(entry));
+            }
+        }
+        std::sort(held.begin(), held.end(),
+                  [](const Entry& a, const Entry& b) { return a.sequence < b.sequence; });
+        size_t ready = 0;
+        while (ready < held.size() && held[ready].sequence < complete) {
+            writeEntry(held[ready++]);
+        }
+        if (ready > 0) {
+            held.erase(held.begin(), held.begin() + static_cast<std::ptrdiff_t>(ready));
+            std::cout.flush();
+            std::cerr.flush();
+        }
+        return held.empty() ? complete : held.front().sequence;
+    }
+
+private:
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<LogRing>> rings;  // Outlive their threads
+
+    std::mutex drainMutex;  // Held by the one consumer of every ring
+    std::vector<Entry> held;  // Popped but waiting for a lower sequence
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeup;
+    std::atomic<bool> signalled{false};
+    bool pending = false;
+    bool stopping = false;
+    std::thread thread;
+
+    void run() {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                wakeup.wait_for(lock, std::chrono::milliseconds(50),
+                                [this]() { return pending || stopping; });
+                pending = false;
+                if (stopping) {
+                    return;
+                }
+            }
+            drainOnce();
+        }
+    }
+};
+
+} // namespace
+
+namespace detail {
+
+std::atomic<int> threshold{static_cast<int>(LogLevel::INFO)};
+
+void submit(LogLevel level, std::string message) {
+    Entry entry;
+    entry.level = level;
+    entry.text = std::move(message);
+    if (shutDown.load()) {
+        writeEntry(entry);
+        return;
+    }
+    Drain& drain = Drain::instance();
+    LogRing& ring = drain.localRing();
+    // Announced before the sequence is taken, so the drain holds back every
+    // later message until this one is in
+    ring.pending.store(nextSequence.load());
+    entry.sequence = nextSequence.fetch_add(1);
+    // A full ring means the drain has fallen behind; wait for it rather
+    // than lose the message
+    while (!ring.push(entry)) {
+        drain.wake();
+        std::this_thread::yield();
+    }
+    ring.pending.store(UINT64_MAX);
+    // Otherwise the drain's periodic pass picks it up
+    if (level <= LogLevel::WARNING || ring.size() >= LogRing::kCapacity / 2) {
+        drain.wake();
+    }
+}
+
+} // namespace detail
+
+void setLevel(LogLevel level) {
+    detail::threshold.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+void writeAllToStderr() {
+    allToStderr.store(true, std::memory_order_relaxed);
+}
+
+void flush() {
+    if (started.load() && !shutDown.load()) {
+        // Messages logged so far may wait on another thread still pushing
+        // an earlier one; that takes moments
+        uint64_t target = nextSequence.load();
+        while (Drain::instance().drainOnce() < target) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+} // namespace logging
+} // namespace devpilot
@@ -1,10 +1,34 @@
+#include "devpilot.h"
+#include "embedder.hpp"
+#include "index_artifact.hpp"
+#include "indexer.hpp"
 #include "parser.hpp"
+#include "sharded_storage.hpp"
 #include "storage.hpp"
+#include "summarizer.hpp"
+#include "logger.hpp"
+#include "memory_accounting.hpp"
+#include "priority_scheduler.hpp"
+#include "process_memory.hpp"
+#include "query_activity.hpp"
+#include "query_context.hpp"
+#include "source_snippet.hpp"
+#include "trace.hpp"
+#include "work_queue.hpp"
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
-#include <filesystem>
-#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace devpilot {
 
@@ -12,24 +36,67 @@ namespace devpilot {
 
 class DevPilotCLI {
 public:
+    ~DevPilotCLI() { devpilot_close(api); }
+    
     int run(int argc, char* argv[]);
     
 private:
     CppParser parser;
-    SqliteStorage storage;
+    SqliteStorage storage;  // Written by index
+    ShardedStorage shards;  // Read by the other commands
+    SnippetReader snippets;
+    // search, usages, refs and show query through include/devpilot.h, as an
+    // editor linking devpilot_core in-process would
+    devpilot_index* api = nullptr;
+    
+    using ApiResults = std::unique_ptr<devpilot_results, void (*)(devpilot_results*)>;
     
     // Command implementations
-    int indexCommand(const std::string& projectPath);
+    struct IndexCommandOptions : IndexOptions {
+        bool stats = false;     // Print per-phase timings and counters
+        std::string tracePath;  // Write a Chrome trace here
+    };
+    
+    static constexpr const char* kDatabasePath = "devpilot.db";
+    
+    // One line of `serve` input, from its arrival until its answer is written
+    struct ServeRequest {
+        std::string id;
+        std::string command;
+        std::vector<std::string> arguments;
+        CancellationToken token;
+    };
+    
+    int indexCommand(const std::string& projectPath, const IndexCommandOptions& options);
     int searchCommand(const std::string& query);
     int usagesCommand(const std::string& symbolName);
+    int calltreeCommand(const std::string& symbolName, int maxDepth);
+    int rdepsCommand(const std::string& filePath);
+    int refsCommand(const std::string& name);
+    int showCommand(const std::vector<std::string>& queries);
+    int outlineCommand(const std::vector<std::string>& filePaths);
+    int summarizeCommand(const std::vector<std::string>& names, const std::vector<std::string>& filePaths,
+                         const std::string& backendCommand, size_t batchSize);
+    int serveCommand(std::chrono::milliseconds timeout);
+    int exportCommand(const std::string& target);
+    int importCommand(const std::string& source, const std::string& projectPath,
+                      const IndexCommandOptions& options);
+    int embedCommand(const VectorBuildOptions& options);
+    int askCommand(const std::string& question, size_t count, size_t probes, bool exact);
     int helpCommand();
     
     // Helper methods
     void printUsage();
     void printSymbol(const Symbol& symbol);
+    void printSymbol(const Symbol& symbol, SnippetStatus status, const std::string& signature);
     void printSymbols(const std::vector<Symbol>& symbols);
-    std::vector<std::string> findCppFiles(const std::string& directory);
-    bool isCppFile(const std::string& filename);
+    void printSymbols(devpilot_results* results);
+    void printSnippet(devpilot_results* results, size_t i);
+    // Null, with the error printed, when the query failed
+    ApiResults apiResults(devpilot_status status, devpilot_results* results);
+    void reportTrace(const IndexCommandOptions& options);
+    void answerRequest(const ServeRequest& request, std::chrono::milliseconds timeout,
+                       std::ostream& out);
 };
 
 int DevPilotCLI::run(int argc, char* argv[]) {
@@ -40,18 +107,157 @@ int DevPilotCLI::run(int argc, char* argv[]) {
     
     std::string command = argv[1];
     
-    // Initialize storage with default database
-    if (!storage.initialize("devpilot.db")) {
+    if (command == "help" || command == "--help" || command == "-h") {
+        return helpCommand();
+    }
+    
+    // Export opens the index itself
+    if (command == "export") {
+        if (argc != 3) {
+            std::cerr << "Usage: devpilot export <artifact | ->" << std::endl;
+            return 1;
+        }
+        return exportCommand(argv[2]);
+    }
+    
+    // Only index and import create or migrate the database; queries open it
+    // and its shards read-only, and fail when there is no current index
+    bool writes = command == "index" || command == "import";
+    bool throughApi = command == "search" || command == "usages" || command == "refs" || command == "show";
+    if (writes && !storage.initialize(kDatabasePath)) {
+        std::cerr << "Failed to initialize database" << std::endl;
+        return 1;
+    }
+    if (throughApi && devpilot_open(kDatabasePath, &api) != DEVPILOT_OK) {
+        logging::flush();
+        std::cerr << devpilot_last_error() << std::endl;
+        return 1;
+    }
+    if (!writes && !throughApi && !shards.open(kDatabasePath)) {
+        logging::flush();
+        std::cerr << shards.openError() << std::endl;
+        return 1;
+    }
+    // Summaries are cached in the main database, next to the index they describe
+    if (command == "summarize" && !storage.initialize(kDatabasePath)) {
         std::cerr << "Failed to initialize database" << std::endl;
         return 1;
     }
     
     if (command == "index") {
         if (argc < 3) {
-            std::cerr << "Usage: devpilot index <project_path>" << std::endl;
+            std::cerr << "Usage: devpilot index <project_path> [-I <include_dir>]... "
+                      << "[--threads <n>] [--force] [--no-cache] [--cache-size <MiB>] "
+                      << "[--max-memory <MiB>] [--declarations-only-above <MiB>] "
+                      << "[--skip-above <MiB>] [--open <file>]... [--shards <n>] "
+                      << "[--shard-by directory|hash] [--stats] [--trace <out.json>]" << std::endl;
+            return 1;
+        }
+        
+        IndexCommandOptions options;
+        options.databasePath = kDatabasePath;
+        for (int i = 3; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "-I" && i + 1 < argc) {
+                options.includePaths.push_back(argv[++i]);
+            } else if (arg.size() > 2 && arg.compare(0, 2, "-I") == 0) {
+                options.includePaths.push_back(arg.substr(2));
+            } else if (arg == "--threads" && i + 1 < argc) {
+                try {
+                    options.threads = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid thread count: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--shards" && i + 1 < argc) {
+                try {
+                    int count = std::stoi(argv[++i]);
+                    if (count < 1 || count > static_cast<int>(kMaxShards)) {
+                        throw std::out_of_range("shards");
+                    }
+                    options.shards = static_cast<unsigned>(count);
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid shard count (1-" << kMaxShards << "): " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--shard-by" && i + 1 < argc) {
+                if (!parseShardScheme(argv[++i], options.shardScheme)) {
+                    std::cerr << "Invalid shard scheme: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--open" && i + 1 < argc) {
+                options.openFiles.push_back(argv[++i]);
+            } else if (arg == "--trace" && i + 1 < argc) {
+                options.tracePath = argv[++i];
+            } else if (arg == "--stats") {
+                options.stats = true;
+            } else if (arg == "--force") {
+                options.force = true;
+            } else if (arg == "--no-cache") {
+                options.useCache = false;
+            } else if (arg == "--cache-size" && i + 1 < argc) {
+                try {
+                    options.cacheBytes = std::stoull(argv[++i]) << 20;
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid cache size: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--max-memory" && i + 1 < argc) {
+                try {
+                    options.maxMemory = std::stoull(argv[++i]) << 20;
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid memory budget: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else if ((arg == "--declarations-only-above" || arg == "--skip-above") && i + 1 < argc) {
+                try {
+                    uint64_t limit = std::stoull(argv[++i]) << 20;
+                    if (arg == "--skip-above") {
+                        options.sizePolicy.skipAbove = limit;
+                    } else {
+                        options.sizePolicy.declarationsAbove = limit;
+                    }
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid size limit: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Unknown index option: " << arg << std::endl;
+                return 1;
+            }
+        }
+        return indexCommand(argv[2], options);
+    }
+    else if (command == "import") {
+        if (argc < 4) {
+            std::cerr << "Usage: devpilot import <artifact | -> <project_path> [--threads <n>] "
+                      << "[--cache-size <MiB>]" << std::endl;
             return 1;
         }
-        return indexCommand(argv[2]);
+        IndexCommandOptions options;
+        options.databasePath = kDatabasePath;
+        for (int i = 4; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--threads" && i + 1 < argc) {
+                try {
+                    options.threads = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid thread count: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--cache-size" && i + 1 < argc) {
+                try {
+                    options.cacheBytes = std::stoull(argv[++i]) << 20;
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid cache size: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Unknown import option: " << arg << std::endl;
+                return 1;
+            }
+        }
+        return importCommand(argv[2], argv[3], options);
     }
     else if (command == "search") {
         if (argc < 3) {
@@ -67,8 +273,154 @@ int DevPilotCLI::run(int argc, char* argv[]) {
         }
         return usagesCommand(argv[2]);
     }
-    else if (command == "help" || command == "--help" || command == "-h") {
-        return helpCommand();
+    else if (command == "calltree") {
+        if (argc < 3) {
+            std::cerr << "Usage: devpilot calltree <symbol_name> [depth]" << std::endl;
+            return 1;
+        }
+        int depth = 3;
+        if (argc >= 4) {
+            try {
+                depth = std::stoi(argv[3]);
+            } catch (const std::exception&) {
+                std::cerr << "Invalid depth: " << argv[3] << std::endl;
+                return 1;
+            }
+        }
+        return calltreeCommand(argv[2], depth);
+    }
+    else if (command == "rdeps") {
+        if (argc < 3) {
+            std::cerr << "Usage: devpilot rdeps <file>" << std::endl;
+            return 1;
+        }
+        return rdepsCommand(argv[2]);
+    }
+    else if (command == "refs") {
+        if (argc < 3) {
+            std::cerr << "Usage: devpilot refs <name>" << std::endl;
+            return 1;
+        }
+        return refsCommand(argv[2]);
+    }
+    else if (command == "show") {
+        if (argc < 3) {
+            std::cerr << "Usage: devpilot show <name>..." << std::endl;
+            return 1;
+        }
+        return showCommand(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    else if (command == "outline") {
+        if (argc < 3) {
+            std::cerr << "Usage: devpilot outline <file>..." << std::endl;
+            return 1;
+        }
+        return outlineCommand(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    else if (command == "summarize") {
+        std::vector<std::string> names;
+        std::vector<std::string> filePaths;
+        const char* environment = std::getenv("DEVPILOT_SUMMARY_BACKEND");
+        std::string backendCommand = environment ? environment : "";
+        size_t batchSize = 8;
+        for (int i = 2; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--file" && i + 1 < argc) {
+                filePaths.push_back(argv[++i]);
+            } else if (arg == "--backend" && i + 1 < argc) {
+                backendCommand = argv[++i];
+            } else if (arg == "--batch" && i + 1 < argc) {
+                try {
+                    batchSize = static_cast<size_t>(std::max(1, std::stoi(argv[++i])));
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid batch size: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else if (arg.compare(0, 2, "--") == 0) {
+                std::cerr << "Unknown summarize option: " << arg << std::endl;
+                return 1;
+            } else {
+                names.push_back(arg);
+            }
+        }
+        if ((names.empty() && filePaths.empty()) || backendCommand.empty()) {
+            std::cerr << "Usage: devpilot summarize <name>... [--file <file>]... "
+                      << "--backend <command> [--batch <n>]" << std::endl;
+            std::cerr << "(DEVPILOT_SUMMARY_BACKEND sets the backend command too)" << std::endl;
+            return 1;
+        }
+        return summarizeCommand(names, filePaths, backendCommand, batchSize);
+    }
+    else if (command == "embed") {
+        VectorBuildOptions options;
+        for (int i = 2; i < argc; i++) {
+            std::string arg = argv[i];
+            if ((arg == "--lists" || arg == "--threads") && i + 1 < argc) {
+                try {
+                    int value = std::max(1, std::stoi(argv[++i]));
+                    if (arg == "--lists") {
+                        options.lists = static_cast<size_t>(value);
+                    } else {
+                        options.threads = static_cast<unsigned>(value);
+                    }
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Unknown embed option: " << arg << std::endl;
+                return 1;
+            }
+        }
+        return embedCommand(options);
+    }
+    else if (command == "ask") {
+        std::string question;
+        size_t count = 10;
+        size_t probes = 16;
+        bool exact = false;
+        for (int i = 2; i < argc; i++) {
+            std::string arg = argv[i];
+            if ((arg == "--top" || arg == "--probes") && i + 1 < argc) {
+                try {
+                    size_t value = static_cast<size_t>(std::max(1, std::stoi(argv[++i])));
+                    (arg == "--top" ? count : probes) = value;
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--exact") {
+                exact = true;
+            } else if (arg.compare(0, 2, "--") == 0) {
+                std::cerr << "Unknown ask option: " << arg << std::endl;
+                return 1;
+            } else {
+                question += (question.empty() ? "" : " ") + arg;
+            }
+        }
+        if (question.empty()) {
+            std::cerr << "Usage: devpilot ask <question> [--top <k>] [--probes <n>] [--exact]" << std::endl;
+            return 1;
+        }
+        return askCommand(question, count, probes, exact);
+    }
+    else if (command == "serve") {
+        std::chrono::milliseconds timeout(500);
+        for (int i = 2; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--timeout" && i + 1 < argc) {
+                try {
+                    timeout = std::chrono::milliseconds(std::stoll(argv[++i]));
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid timeout: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Unknown serve option: " << arg << std::endl;
+                return 1;
+            }
+        }
+        return serveCommand(timeout);
     }
     else {
         std::cerr << "Unknown command: " << command << std::endl;
@@ -77,60 +429,252 @@ int DevPilotCLI::run(int argc, char* argv[]) {
     }
 }
 
-int DevPilotCLI::indexCommand(const std::string& projectPath) {
-    std::cout << "Indexing C++ project: " << projectPath << std::endl;
+int DevPilotCLI::indexCommand(const std::string& projectPath, const IndexCommandOptions& options) {
+    logging::info("Indexing C++ project: ", projectPath);
     
-    if (!std::filesystem::exists(projectPath)) {
-        std::cerr << "Error: Path does not exist: " << projectPath << std::endl;
+    // Spans and counters are only recorded when someone asked for them
+    if (options.stats || !options.tracePath.empty()) {
+        trace::enable();
+        trace::setThreadName("main");
+    }
+    if (options.stats) {
+        memory::enable();
+    }
+    
+    Indexer indexer(parser, storage);
+    IndexSummary summary;
+    bool indexed = indexer.run(projectPath, options, summary);
+    logging::flush();
+    if (!indexed) {
         return 1;
     }
     
-    if (!parser.isInitialized()) {
-        std::cerr << "Error: Parser not initialized" << std::endl;
+    std::cout << "Found " << summary.files << " C++ files (" << summary.directories
+              << " directories, " << summary.ignoredEntries << " ignored entries)" << std::endl;
+    if (summary.inGitRepo) {
+        std::cout << "Git work tree: " << summary.gitWorkTree << " (" << summary.unchangedFiles
+                  << " files match the index)" << std::endl;
+    }
+    if (summary.upToDate) {
+        std::cout << "Index is up to date" << std::endl;
+        reportTrace(options);
+        return 0;
+    }
+    
+    std::cout << "Indexing complete!" << std::endl;
+    std::cout << "Files processed: " << summary.files - summary.keptFiles << std::endl;
+    if (summary.keptFiles + summary.removedFiles > 0) {
+        std::cout << "Updated in place: " << summary.keptFiles << " files left as indexed, "
+                  << summary.removedFiles << " removed" << std::endl;
+    }
+    std::cout << "Symbols extracted: " << summary.symbols << std::endl;
+    std::cout << "Include edges: " << summary.includeEdges
+              << " (" << summary.unresolvedIncludes << " unresolved)" << std::endl;
+    if (summary.cacheEnabled) {
+        std::cout << "Parse cache: " << summary.cacheHits << " hits, " << summary.cacheMisses
+                  << " misses" << std::endl;
+    }
+    std::cout << "File reads: " << summary.readBackend << std::endl;
+    std::cout << "Scheduling:";
+    auto milliseconds = [](std::chrono::nanoseconds duration) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.1f ms", duration.count() / 1e6);
+        return std::string(text);
+    };
+    for (size_t i = 0; i < kTaskPriorityCount; i++) {
+        const PriorityStats& stats = summary.scheduling[i];
+        if (stats.tasks == 0) {
+            continue;
+        }
+        double spanSeconds = std::chrono::duration<double>(stats.span).count();
+        std::cout << " " << taskPriorityName(static_cast<TaskPriority>(i)) << " " << stats.tasks
+                  << " files ("
+                  << static_cast<uint64_t>(spanSeconds > 0 ? stats.tasks / spanSeconds : 0)
+                  << "/s, latency avg " << milliseconds(stats.totalLatency / stats.tasks)
+                  << ", max " << milliseconds(stats.maxLatency) << ");";
+    }
+    std::cout << " " << summary.steals << " steals, "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(summary.yieldedTime).count()
+              << " ms yielded to queries" << std::endl;
+    if (summary.streamedFiles + summary.declarationsOnlyFiles + summary.skippedFiles > 0) {
+        std::cout << "Large files: " << summary.streamedFiles << " streamed, "
+                  << summary.declarationsOnlyFiles << " declarations only, "
+                  << summary.skippedFiles << " skipped" << std::endl;
+    }
+    std::cout << "Call edges: " << summary.callEdges
+              << " (" << summary.unresolvedCalls << " unresolved)" << std::endl;
+    std::cout << "Identifier occurrences: " << summary.occurrences << " across "
+              << summary.occurrenceNames << " names (" << summary.postingBytes
+              << " bytes of postings in " << summary.postingSegments << " segment(s))" << std::endl;
+    if (summary.shards > 1) {
+        std::cout << "Shards: " << summary.shards << " by " << shardSchemeName(options.shardScheme)
+                  << " (files:";
+        for (size_t i = 0; i < summary.shardFiles.size(); i++) {
+            std::cout << (i == 0 ? " " : ", ") << summary.shardFiles[i];
+        }
+        std::cout << "; " << summary.crossShardCalls << " calls cross shards)" << std::endl;
+    }
+    std::cout << "Peak memory: " << (peakResidentBytes() >> 20) << " MiB";
+    if (options.maxMemory != 0) {
+        std::cout << " (budget " << (options.maxMemory >> 20) << " MiB, floor "
+                  << (summary.memoryFloor >> 20) + 1 << " MiB)";
+    }
+    std::cout << std::endl;
+    reportTrace(options);
+    
+    return 0;
+}
+
+// Written to stdout, the artifact is the only output there (see main())
+int DevPilotCLI::exportCommand(const std::string& target) {
+    bool toStdout = target == "-";
+    std::ofstream file;
+    if (!toStdout) {
+        file.open(target, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Cannot write " << target << std::endl;
+            return 1;
+        }
+    }
+    
+    ExportSummary summary;
+    bool exported = exportIndex(kDatabasePath, toStdout ? std::cout : file, summary);
+    logging::flush();
+    if (!exported) {
+        if (!toStdout) {
+            file.close();
+            std::remove(target.c_str());
+        }
         return 1;
     }
     
-    // Find all C++ files
-    auto cppFiles = findCppFiles(projectPath);
-    std::cout << "Found " << cppFiles.size() << " C++ files" << std::endl;
+    std::ostream& report = toStdout ? std::cerr : std::cout;
+    report << "Exported " << summary.files << " files (" << summary.rows << " rows";
+    if (summary.shards > 1) {
+        report << " in " << summary.shards << " shards";
+    }
+    report << ", parse results for " << summary.parseEntries << ") in "
+           << (summary.bytes >> 10) << " KiB" << std::endl;
+    return 0;
+}
+
+int DevPilotCLI::importCommand(const std::string& source, const std::string& projectPath,
+                               const IndexCommandOptions& options) {
+    std::ifstream file;
+    if (source != "-") {
+        file.open(source, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Cannot read " << source << std::endl;
+            return 1;
+        }
+    }
     
-    // Clear existing data for this project
-    storage.clearDatabase();
+    ImportOptions importOptions;
+    importOptions.threads = options.threads;
+    importOptions.cacheBytes = options.cacheBytes;
+    importOptions.databasePath = options.databasePath;
+    ImportSummary summary;
+    bool imported = importIndex(source == "-" ? std::cin : file, projectPath, storage, importOptions, summary);
+    logging::flush();
+    if (!imported) {
+        return 1;
+    }
     
-    int fileCount = 0;
-    int symbolCount = 0;
+    std::cout << "Artifact: " << summary.files << " files";
+    if (summary.shards > 1) {
+        std::cout << " in " << summary.shards << " shards";
+    }
+    std::cout << " (" << summary.seededEntries << " parse results cached)" << std::endl;
+    if (summary.restored) {
+        std::cout << "Checkout matches the artifact; index restored" << std::endl;
+        return 0;
+    }
     
-    for (const auto& file : cppFiles) {
-        std::cout << "Parsing: " << file << std::endl;
+    // Only files that differ miss the cache the artifact just filled
+    std::cout << "Checkout differs: " << summary.changedFiles << " changed, " << summary.addedFiles
+              << " added, " << summary.removedFiles << " removed; updating the index" << std::endl;
+    IndexCommandOptions indexOptions = options;
+    indexOptions.includePaths = summary.includePaths;
+    indexOptions.shards = summary.shards;
+    indexOptions.shardScheme = summary.shardScheme;
+    indexOptions.force = true;
+    return indexCommand(projectPath, indexOptions);
+}
+
+// Called once the pipeline's threads have been joined, as merging requires
+void DevPilotCLI::reportTrace(const IndexCommandOptions& options) {
+    if (options.stats) {
+        trace::Summary summary = trace::summarize();
+        std::cout << "Stats (span times are summed over threads):" << std::endl;
+        for (const auto& span : summary.spans) {
+            char line[160];
+            std::snprintf(line, sizeof(line), "  %-22s %8llu x %12.1f ms total %10.3f ms avg %10.3f ms max",
+                          span.name.c_str(), static_cast<unsigned long long>(span.count),
+                          span.total.count() / 1e6, span.total.count() / 1e6 / span.count,
+                          span.max.count() / 1e6);
+            std::cout << line << std::endl;
+        }
+        for (size_t i = 0; i < trace::kCounterCount; i++) {
+            std::cout << "  " << trace::counterName(static_cast<trace::Counter>(i)) << ": "
+                      << summary.counters[i] << std::endl;
+        }
         
-        auto symbols = parser.parseFile(file);
-        for (const auto& symbol : symbols) {
-            if (storage.storeSymbol(symbol)) {
-                symbolCount++;
+        auto mebibytes = [](double bytes) {
+            char text[32];
+            std::snprintf(text, sizeof(text), "%.1f MiB", bytes / (1 << 20));
+            return std::string(text);
+        };
+        bool counted = memory::accountingAvailable();
+        std::cout << "Memory by phase:" << std::endl;
+        for (const auto& phase : memory::phaseUsage()) {
+            std::cout << "  " << phase.name << ": peak RSS " << mebibytes(phase.peakResidentBytes)
+                      << ", SQLite peak " << mebibytes(phase.sqlitePeakBytes);
+            if (counted) {
+                std::cout << ", heap live " << mebibytes(phase.liveBytes) << ", "
+                          << phase.allocations << " allocations";
             }
+            std::cout << std::endl;
+        }
+        memory::Usage usage = memory::currentUsage();
+        std::cout << "Memory by subsystem (live at end, allocated in total):" << std::endl;
+        if (counted) {
+            for (size_t i = 0; i < memory::kMemoryTagCount; i++) {
+                const memory::TagUsage& tag = usage.tags[i];
+                std::cout << "  " << memory::memoryTagName(static_cast<memory::MemoryTag>(i)) << ": "
+                          << mebibytes(tag.liveBytes) << " live, " << mebibytes(tag.allocatedBytes)
+                          << " in " << tag.allocations << " allocations" << std::endl;
+            }
+        } else {
+            std::cout << "  (heap counts need a build with -DENABLE_MEMORY_ACCOUNTING=ON)" << std::endl;
+        }
+        std::cout << "  sqlite: " << mebibytes(usage.sqliteBytes) << " live" << std::endl;
+    }
+    if (!options.tracePath.empty()) {
+        if (trace::writeChromeTrace(options.tracePath)) {
+            std::cout << "Trace written to " << options.tracePath << std::endl;
+        } else {
+            std::cerr << "Could not write trace: " << options.tracePath << std::endl;
         }
-        fileCount++;
     }
-    
-    std::cout << "Indexing complete!" << std::endl;
-    std::cout << "Files processed: " << fileCount << std::endl;
-    std::cout << "Symbols extracted: " << symbolCount << std::endl;
-    
-    return 0;
 }
 
 int DevPilotCLI::searchCommand(const std::string& query) {
     std::cout << "Searching for: " << query << std::endl;
     
-    auto symbols = storage.searchSymbols(query);
+    devpilot_results* found = nullptr;
+    devpilot_status status = devpilot_search(api, query.c_str(), 0, nullptr, &found);
+    ApiResults symbols = apiResults(status, found);
+    if (!symbols) {
+        return 1;
+    }
     
-    if (symbols.empty()) {
+    if (devpilot_results_count(symbols.get()) == 0) {
         std::cout << "No symbols found matching: " << query << std::endl;
         return 0;
     }
     
-    std::cout << "Found " << symbols.size() << " symbol(s):" << std::endl;
-    printSymbols(symbols);
+    std::cout << "Found " << devpilot_results_count(symbols.get()) << " symbol(s):" << std::endl;
+    printSymbols(symbols.get());
     
     return 0;
 }
@@ -138,18 +682,457 @@ int DevPilotCLI::searchCommand(const std::string& query) {
 int DevPilotCLI::usagesCommand(const std::string& symbolName) {
     std::cout << "Finding usages of: " << symbolName << std::endl;
     
-    auto usages = storage.getSymbolUsages(symbolName);
+    devpilot_results* found = nullptr;
+    devpilot_status status = devpilot_usages(api, symbolName.c_str(), 0, nullptr, &found);
+    ApiResults usages = apiResults(status, found);
+    if (!usages) {
+        return 1;
+    }
+    size_t count = devpilot_results_count(usages.get());
     
-    if (usages.empty()) {
+    if (count == 0) {
         std::cout << "No usages found for: " << symbolName << std::endl;
         return 0;
     }
     
-    std::cout << "Found " << usages.size() << " usage(s):" << std::endl;
-    for (const auto& usage : usages) {
-        std::cout << "  " << usage << std::endl;
+    std::cout << "Found " << count << " usage(s):" << std::endl;
+    for (size_t i = 0; i < count; i++) {
+        std::cout << "  " << devpilot_results_string(usages.get(), i) << std::endl;
+    }
+    
+    return 0;
+}
+
+int DevPilotCLI::calltreeCommand(const std::string& symbolName, int maxDepth) {
+    std::cout << "Call tree of: " << symbolName << std::endl;
+    
+    auto callees = shards.getSymbolCallees(symbolName);
+    if (callees.empty()) {
+        std::cout << "No calls found from: " << symbolName << std::endl;
+        return 0;
     }
     
+    // Functions already on the current path are printed but not expanded again
+    std::unordered_set<std::string> onPath = {symbolName};
+    std::function<void(const std::vector<std::string>&, int)> printLevel =
+        [&](const std::vector<std::string>& names, int depth) {
+            for (const auto& name : names) {
+                bool recursive = onPath.count(name) != 0;
+                std::cout << std::string(depth * 2, ' ') << name
+                          << (recursive ? " (recursive)" : "") << std::endl;
+                if (recursive || depth >= maxDepth) {
+                    continue;
+                }
+                onPath.insert(name);
+                printLevel(shards.getSymbolCallees(name), depth + 1);
+                onPath.erase(name);
+            }
+        };
+    printLevel(callees, 1);
+    
+    return 0;
+}
+
+int DevPilotCLI::rdepsCommand(const std::string& filePath) {
+    std::cout << "Finding files that depend on: " << filePath << std::endl;
+    
+    auto fileIds = shards.findFiles(filePath);
+    
+    if (fileIds.empty()) {
+        std::cout << "No indexed file matches: " << filePath << std::endl;
+        return 0;
+    }
+    
+    for (int64_t fileId : fileIds) {
+        auto dependents = shards.getTransitiveDependents(fileId);
+        
+        std::cout << shards.getFilePath(fileId) << ": " << dependents.size()
+                  << " dependent file(s)" << std::endl;
+        for (const auto& dependent : dependents) {
+            std::cout << "  " << dependent << std::endl;
+        }
+    }
+    
+    return 0;
+}
+
+int DevPilotCLI::refsCommand(const std::string& name) {
+    std::cout << "Finding references to: " << name << std::endl;
+    
+    devpilot_results* found = nullptr;
+    devpilot_status status = devpilot_references(api, name.c_str(), 0, nullptr, &found);
+    ApiResults references = apiResults(status, found);
+    if (!references) {
+        return 1;
+    }
+    size_t count = devpilot_results_count(references.get());
+    
+    if (count == 0) {
+        std::cout << "No references found for: " << name << std::endl;
+        return 0;
+    }
+    
+    std::cout << "Found " << count << " reference(s):" << std::endl;
+    for (size_t i = 0; i < count; i++) {
+        const devpilot_reference* reference = devpilot_results_reference(references.get(), i);
+        std::cout << "  " << reference->file_path << ":" << reference->line << ":"
+                  << reference->column << std::endl;
+    }
+    
+    return 0;
+}
+
+int DevPilotCLI::showCommand(const std::vector<std::string>& queries) {
+    // All names are resolved in one batch; a plain name matches only itself.
+    // Symbols come grouped in query order.
+    std::vector<const char*> names;
+    for (const auto& query : queries) {
+        names.push_back(query.c_str());
+    }
+    devpilot_results* found = nullptr;
+    devpilot_status status = devpilot_lookup(api, names.data(), names.size(), 0, nullptr, &found);
+    ApiResults symbols = apiResults(status, found);
+    if (!symbols) {
+        return 1;
+    }
+    
+    size_t count = devpilot_results_count(symbols.get());
+    size_t next = 0;
+    for (size_t group = 0; group < queries.size(); group++) {
+        size_t first = next;
+        while (next < count && devpilot_results_symbol(symbols.get(), next)->group == group) {
+            printSnippet(symbols.get(), next++);
+        }
+        if (next == first) {
+            std::cout << "No symbols found matching: " << queries[group] << std::endl;
+        }
+    }
+    
+    return 0;
+}
+
+int DevPilotCLI::outlineCommand(const std::vector<std::string>& filePaths) {
+    auto groups = shards.getSymbolsInFiles(filePaths);
+    
+    for (size_t i = 0; i < filePaths.size(); i++) {
+        if (groups[i].empty()) {
+            std::cout << "No symbols indexed in: " << filePaths[i] << std::endl;
+            continue;
+        }
+        std::cout << filePaths[i] << ": " << groups[i].size() << " symbol(s)" << std::endl;
+        printSymbols(groups[i]);
+    }
+    
+    return 0;
+}
+
+void DevPilotCLI::printSnippet(devpilot_results* results, size_t i) {
+    const devpilot_symbol* symbol = devpilot_results_symbol(results, i);
+    std::cout << "// " << symbol->file_path << ":" << symbol->line << " ("
+              << (*symbol->qualified_name ? symbol->qualified_name : symbol->name) << ")" << std::endl;
+    const char* text = nullptr;
+    size_t length = 0;
+    switch (devpilot_results_source(results, i, &text, &length)) {
+        case DEVPILOT_OK:
+            std::cout << std::string_view(text, length) << std::endl;
+            break;
+        case DEVPILOT_SOURCE_STALE:
+            std::cout << "// File changed since it was indexed; run 'devpilot index' again" << std::endl;
+            break;
+        default:
+            std::cout << "// File not found" << std::endl;
+            break;
+    }
+    std::cout << std::endl;
+}
+
+// Line protocol for editor integrations. Each input line is either
+// "<id> <command> <argument>..." or "cancel <id>...". Queries run one at a
+// time in arrival order while this thread keeps reading, so a cancel reaches
+// a queued request before it starts and a running one within a few thousand
+// SQLite steps. Every answer is a block of "<id>\t..." lines ending in
+// "<id>\tdone\t<count>", plus "\ttruncated" if the deadline cut it short, or a
+// single "<id>\tcancelled": results of a cancelled request are stale anyway.
+// A request that is malformed or whose query failed, for example on a locked
+// database, is answered with a single "<id>\terror\t<message>".
+int DevPilotCLI::serveCommand(std::chrono::milliseconds timeout) {
+    WorkQueue<std::shared_ptr<ServeRequest>> requests;
+    std::mutex pendingMutex;
+    std::unordered_map<std::string, std::shared_ptr<ServeRequest>> pending;
+    std::mutex outputMutex;
+    
+    // Indexing in another process holds back its bulk work while this answers
+    QueryActivity queryActivity(kDatabasePath);
+    
+    std::thread worker([&] {
+        std::shared_ptr<ServeRequest> request;
+        while (requests.pop(request)) {
+            std::ostringstream response;
+            if (!request->token.isCancelled()) {
+                queryActivity.beginQuery();
+                answerRequest(*request, timeout, response);
+                queryActivity.endQuery();
+            }
+            {
+                std::lock_guard<std::mutex> lock(pendingMutex);
+                auto it = pending.find(request->id);
+                if (it != pending.end() && it->second == request) {
+                    pending.erase(it);
+                }
+            }
+            std::lock_guard<std::mutex> lock(outputMutex);
+            if (request->token.isCancelled()) {
+                std::cout << request->id << "\tcancelled\n";
+            } else {
+                std::cout << response.str();
+            }
+            std::cout.flush();
+        }
+    });
+    
+    {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::cout << "ready" << std::endl;
+    }
+    
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream fields(line);
+        std::vector<std::string> words;
+        for (std::string word; fields >> word;) {
+            words.push_back(word);
+        }
+        if (words.empty()) {
+            continue;
+        }
+        
+        if (words[0] == "cancel") {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            for (size_t i = 1; i < words.size(); i++) {
+                auto it = pending.find(words[i]);
+                if (it != pending.end()) {
+                    it->second->token.cancel();
+                }
+            }
+            continue;
+        }
+        if (words.size() < 2) {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << words[0] << "\terror\tmissing command" << std::endl;
+            continue;
+        }
+        
+        auto request = std::make_shared<ServeRequest>();
+        request->id = words[0];
+        request->command = words[1];
+        request->arguments.assign(words.begin() + 2, words.end());
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            // A reused id refers to the newest request from then on
+            pending[request->id] = request;
+        }
+        requests.push(request);
+    }
+    
+    requests.close();
+    worker.join();
+    return 0;
+}
+
+void DevPilotCLI::answerRequest(const ServeRequest& request, std::chrono::milliseconds timeout,
+                                std::ostream& response) {
+    const std::string& id = request.id;
+    const std::string& command = request.command;
+    const auto& arguments = request.arguments;
+    QueryContext context(timeout, &request.token);
+    size_t count = 0;
+    // Held back until the query is known to have succeeded
+    std::ostringstream out;
+    
+    auto writeSymbol = [&](const Symbol& symbol) {
+        out << id << "\tsymbol\t" << symbolTypeToString(symbol.type) << "\t"
+            << (symbol.qualified_name.empty() ? symbol.name : symbol.qualified_name) << "\t"
+            << symbol.file_path << "\t" << symbol.line_number << "\n";
+        count++;
+    };
+    
+    if (command == "search" && arguments.size() == 1) {
+        for (const auto& symbol : shards.searchSymbols(arguments[0], &context)) {
+            writeSymbol(symbol);
+        }
+    } else if ((command == "lookup" || command == "outline") && !arguments.empty()) {
+        auto groups = command == "lookup" ? shards.lookupSymbols(arguments, &context)
+                                          : shards.getSymbolsInFiles(arguments, &context);
+        for (size_t i = 0; i < arguments.size(); i++) {
+            out << id << "\tgroup\t" << arguments[i] << "\n";
+            for (const auto& symbol : groups[i]) {
+                writeSymbol(symbol);
+            }
+        }
+    } else if ((command == "usages" || command == "callees") && arguments.size() == 1) {
+        bool usages = command == "usages";
+        auto lines = usages ? shards.getSymbolUsages(arguments[0], &context)
+                            : shards.getSymbolCallees(arguments[0], &context);
+        for (const auto& line : lines) {
+            out << id << (usages ? "\tusage\t" : "\tcallee\t") << line << "\n";
+            count++;
+        }
+    } else if (command == "refs" && arguments.size() == 1) {
+        for (const auto& reference : shards.getReferences(arguments[0], &context)) {
+            out << id << "\tref\t" << reference.file_path << "\t" << reference.line_number << "\t"
+                << reference.column_number << "\n";
+            count++;
+        }
+    } else if (command == "rdeps" && arguments.size() == 1) {
+        for (int64_t fileId : shards.findFiles(arguments[0], &context)) {
+            if (context.shouldStop()) {
+                break;
+            }
+            out << id << "\tfile\t" << shards.getFilePath(fileId) << "\n";
+            for (const auto& dependent : shards.getTransitiveDependents(fileId, &context)) {
+                out << id << "\tdependent\t" << dependent << "\n";
+                count++;
+            }
+        }
+    } else {
+        response << id << "\terror\tunknown command or wrong number of arguments: " << command << "\n";
+        return;
+    }
+    
+    if (context.failed) {
+        response << id << "\terror\t" << context.error << "\n";
+        return;
+    }
+    response << out.str() << id << "\tdone\t" << count << (context.truncated ? "\ttruncated" : "")
+             << "\n";
+}
+
+// Every function body goes to the summarizer in one call, so the misses
+// among them share batches
+int DevPilotCLI::summarizeCommand(const std::vector<std::string>& names,
+                                  const std::vector<std::string>& filePaths,
+                                  const std::string& backendCommand, size_t batchSize) {
+    std::vector<Symbol> functions;
+    std::vector<SummaryRequest> requests;
+    auto collect = [&](const std::vector<std::vector<Symbol>>& groups) {
+        for (const auto& group : groups) {
+            for (const auto& symbol : group) {
+                std::string_view text;
+                // Only definitions: a declaration has nothing to summarize
+                if (symbol.type != SymbolType::FUNCTION || snippets.text(symbol, text) != SnippetStatus::OK ||
+                    text.find('{') == std::string_view::npos) {
+                    continue;
+                }
+                functions.push_back(symbol);
+                requests.push_back({symbol.qualified_name.empty() ? symbol.name : symbol.qualified_name,
+                                    std::string(text)});
+            }
+        }
+    };
+    if (!names.empty()) {
+        collect(shards.lookupSymbols(names));
+    }
+    if (!filePaths.empty()) {
+        collect(shards.getSymbolsInFiles(filePaths));
+    }
+    if (requests.empty()) {
+        std::cout << "No function definitions found to summarize" << std::endl;
+        return 1;
+    }
+    
+    ProcessBackend backend(backendCommand);
+    SummarizerStats stats;
+    std::vector<std::string> summaries;
+    {
+        Summarizer summarizer(storage, backend, batchSize);
+        summaries = summarizer.summarize(requests);
+        stats = summarizer.stats();
+    }
+    logging::flush();
+    
+    for (size_t i = 0; i < functions.size(); i++) {
+        std::cout << requests[i].name << " (" << functions[i].file_path << ":" << functions[i].line_number
+                  << "): " << (summaries[i].empty() ? "(no summary)" : summaries[i]) << std::endl;
+    }
+    std::cout << "Summaries: " << stats.requests << " requested, " << stats.cacheHits << " cache hits ("
+              << (stats.cacheHits * 100 / stats.requests) << "%), " << stats.deduplicated
+              << " deduplicated, " << stats.summarized << " summarized in " << stats.batches
+              << " batches, " << stats.failed << " failed; queue depth max " << stats.maxQueueDepth
+              << "; model " << std::chrono::duration_cast<std::chrono::milliseconds>(stats.backendTime).count()
+              << " ms" << std::endl;
+    return stats.failed == 0 ? 0 : 1;
+}
+
+int DevPilotCLI::embedCommand(const VectorBuildOptions& options) {
+    HashingEmbedder embedder;
+    EmbedSummary summary;
+    std::string path = vectorPath(kDatabasePath);
+    bool embedded = embedIndex(shards, embedder, path, options, summary);
+    logging::flush();
+    if (!embedded) {
+        return 1;
+    }
+    
+    std::cout << "Embedded " << summary.symbols << " symbols with " << embedder.id() << " in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(summary.embedTime).count() << " ms";
+    if (summary.missingSources > 0) {
+        std::cout << " (" << summary.missingSources << " from their names only: file missing or changed)";
+    }
+    std::cout << std::endl;
+    std::cout << "Vector index: " << summary.lists << " lists, built in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(summary.buildTime).count()
+              << " ms, written to " << path << std::endl;
+    return 0;
+}
+
+// The question goes through the same embedder as the symbols did
+int DevPilotCLI::askCommand(const std::string& question, size_t count, size_t probes, bool exact) {
+    std::string path = vectorPath(kDatabasePath);
+    VectorIndex vectors;
+    if (!vectors.open(path)) {
+        logging::flush();
+        std::cerr << "No vector index; run 'devpilot embed' first" << std::endl;
+        return 1;
+    }
+    HashingEmbedder embedder(vectors.dimensions());
+    if (vectors.embedderId() != embedder.id()) {
+        std::cerr << path << " was built by " << vectors.embedderId() << "; run 'devpilot embed' again"
+                  << std::endl;
+        return 1;
+    }
+    if (vectors.indexStamp() != shards.indexStamp()) {
+        std::cerr << "The index changed since it was embedded; run 'devpilot embed' again" << std::endl;
+        return 1;
+    }
+    
+    std::vector<float> query(embedder.dimensions());
+    embedder.embed(question, query.data());
+    auto start = std::chrono::steady_clock::now();
+    std::vector<VectorMatch> matches = exact ? vectors.searchExact(query.data(), count)
+                                             : vectors.search(query.data(), count, probes);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    
+    for (const auto& match : matches) {
+        // Nothing in common with the question
+        Symbol symbol;
+        if (match.score <= 0 || !shards.getSymbol(match.id, symbol)) {
+            continue;
+        }
+        char score[16];
+        std::snprintf(score, sizeof(score), "%.3f", match.score);
+        std::cout << score;
+        printSymbol(symbol);
+    }
+    char milliseconds[32];
+    std::snprintf(milliseconds, sizeof(milliseconds), "%.2f ms",
+                  std::chrono::duration<double, std::milli>(elapsed).count());
+    std::cout << "Searched " << vectors.size() << " vectors (";
+    if (exact) {
+        std::cout << "exact";
+    } else {
+        std::cout << std::min(probes, vectors.lists()) << " of " << vectors.lists() << " lists";
+    }
+    std::cout << ", " << dotProductKernel() << ") in " << milliseconds << std::endl;
     return 0;
 }
 
@@ -157,18 +1140,66 @@ int DevPilotCLI::helpCommand() {
     std::cout << "DevPilot - Local AI Codebase Navigator" << std::endl;
     std::cout << std::endl;
     std::cout << "USAGE:" << std::endl;
-    std::cout << "  devpilot <command> [arguments]" << std::endl;
+    std::cout << "  devpilot <command> [arguments] [--quiet | --verbose]" << std::endl;
     std::cout << std::endl;
     std::cout << "COMMANDS:" << std::endl;
     std::cout << "  index <path>     Index a C++ project directory" << std::endl;
-    std::cout << "  search <name>    Search for symbols by name" << std::endl;
+    std::cout << "                   (-I <dir> adds an include search path;" << std::endl;
+    std::cout << "                    --no-cache / --cache-size <MiB> control the parse cache;" << std::endl;
+    std::cout << "                    --force rebuilds even when the git tree is unchanged;" << std::endl;
+    std::cout << "                    --threads <n> sets walker and parser threads;" << std::endl;
+    std::cout << "                    --max-memory <MiB> flushes postings early to stay under it;" << std::endl;
+    std::cout << "                    --declarations-only-above / --skip-above <MiB> index" << std::endl;
+    std::cout << "                    larger files lightly or not at all, 0 for never;" << std::endl;
+    std::cout << "                    --open <file> indexes a file the editor shows first;" << std::endl;
+    std::cout << "                    --shards <n> writes n databases at once, split by top-level" << std::endl;
+    std::cout << "                    directory or, with --shard-by hash, by path;" << std::endl;
+    std::cout << "                    --stats prints time and memory per phase;" << std::endl;
+    std::cout << "                    --trace <out.json> writes a Chrome trace)" << std::endl;
+    std::cout << "  export <file>    Write the index as a relocatable artifact (- for stdout)" << std::endl;
+    std::cout << "  import <file> <path>  Take an exported index for the checkout at path (- for" << std::endl;
+    std::cout << "                   stdin); files that differ from it are indexed again" << std::endl;
+    std::cout << "                   (--threads <n>, --cache-size <MiB> as for index)" << std::endl;
+    std::cout << "  search <name>    Search for symbols by name (ns::Class::method for exact scope)" << std::endl;
     std::cout << "  usages <name>    Find where a symbol is used" << std::endl;
+    std::cout << "  calltree <name>  Show the functions a symbol calls (optional depth, default 3)" << std::endl;
+    std::cout << "  refs <name>      List every occurrence of an identifier" << std::endl;
+    std::cout << "  rdeps <file>     List files that include a file, directly or transitively" << std::endl;
+    std::cout << "  show <name>...   Print symbols' source text, read from their files" << std::endl;
+    std::cout << "  outline <file>...  List the symbols declared in files, in line order" << std::endl;
+    std::cout << "  summarize <name>...  Summarize functions with a local model, caching each" << std::endl;
+    std::cout << "                   summary by body (--file <file> adds a file's functions;" << std::endl;
+    std::cout << "                    --backend <command> runs the model, or DEVPILOT_SUMMARY_BACKEND;" << std::endl;
+    std::cout << "                    --batch <n> bodies per model call, default 8)" << std::endl;
+    std::cout << "  embed            Build the vector index for ask from the indexed symbols" << std::endl;
+    std::cout << "                   (--lists <n> inverted lists, default about sqrt(symbols);" << std::endl;
+    std::cout << "                    --threads <n> for clustering)" << std::endl;
+    std::cout << "  ask <question>   Find symbols by meaning, best matches first (--top <k>," << std::endl;
+    std::cout << "                   default 10; --probes <n> lists searched, default 16;" << std::endl;
+    std::cout << "                   --exact scores every vector instead)" << std::endl;
+    std::cout << "  serve            Answer queries read line by line from stdin, for editors" << std::endl;
+    std::cout << "                   (--timeout <ms> bounds each query, default 500, 0 for none;" << std::endl;
+    std::cout << "                    \"cancel <id>\" drops a queued or running request)" << std::endl;
     std::cout << "  help             Show this help message" << std::endl;
     std::cout << std::endl;
+    std::cout << "OPTIONS:" << std::endl;
+    std::cout << "  -q, --quiet      Log only warnings and errors" << std::endl;
+    std::cout << "  -v, --verbose    Also log per-file detail" << std::endl;
+    std::cout << std::endl;
     std::cout << "EXAMPLES:" << std::endl;
     std::cout << "  devpilot index /path/to/cpp/project" << std::endl;
     std::cout << "  devpilot search \"calculateSum\"" << std::endl;
+    std::cout << "  devpilot search \"Calculator::add\"" << std::endl;
     std::cout << "  devpilot usages \"processData\"" << std::endl;
+    std::cout << "  devpilot calltree \"UserService::createUser\" 2" << std::endl;
+    std::cout << "  devpilot refs \"processData\"" << std::endl;
+    std::cout << "  devpilot rdeps include/user_service.hpp" << std::endl;
+    std::cout << "  devpilot show \"Calculator::add\" \"Calculator::subtract\"" << std::endl;
+    std::cout << "  devpilot outline src/calculator.cpp include/calculator.hpp" << std::endl;
+    std::cout << "  devpilot summarize \"Calculator::add\" --backend ./llama-summarize" << std::endl;
+    std::cout << "  devpilot embed && devpilot ask \"function that retries http requests\"" << std::endl;
+    std::cout << "  devpilot export index.dpx" << std::endl;
+    std::cout << "  devpilot import index.dpx /path/to/checkout" << std::endl;
     std::cout << std::endl;
     
     return 0;
@@ -179,11 +1210,21 @@ void DevPilotCLI::printUsage() {
     std::cout << "Run 'devpilot help' for more information." << std::endl;
 }
 
+// The signature is read from the source file, only for symbols printed
 void DevPilotCLI::printSymbol(const Symbol& symbol) {
-    std::cout << "  " << symbolTypeToString(symbol.type) << " " << symbol.name;
+    std::string signature;
+    SnippetStatus status = snippets.signature(symbol, signature);
+    printSymbol(symbol, status, signature);
+}
+
+void DevPilotCLI::printSymbol(const Symbol& symbol, SnippetStatus status, const std::string& signature) {
+    std::cout << "  " << symbolTypeToString(symbol.type) << " "
+              << (symbol.qualified_name.empty() ? symbol.name : symbol.qualified_name);
     std::cout << " (" << symbol.file_path << ":" << symbol.line_number << ")";
-    if (!symbol.signature.empty() && symbol.signature != symbol.name) {
-        std::cout << " - " << symbol.signature;
+    if (status == SnippetStatus::STALE) {
+        std::cout << " - (changed since indexed)";
+    } else if (status == SnippetStatus::OK && !signature.empty() && signature != symbol.name) {
+        std::cout << " - " << signature;
     }
     std::cout << std::endl;
 }
@@ -194,41 +1235,66 @@ void DevPilotCLI::printSymbols(const std::vector<Symbol>& symbols) {
     }
 }
 
-std::vector<std::string> DevPilotCLI::findCppFiles(const std::string& directory) {
-    std::vector<std::string> cppFiles;
-    
-    try {
-        for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
-            if (entry.is_regular_file() && isCppFile(entry.path().filename().string())) {
-                cppFiles.push_back(entry.path().string());
-            }
+// Signatures come from the text the results read back from the files
+void DevPilotCLI::printSymbols(devpilot_results* results) {
+    for (size_t i = 0; i < devpilot_results_count(results); i++) {
+        const devpilot_symbol* found = devpilot_results_symbol(results, i);
+        Symbol symbol(found->name, static_cast<SymbolType>(found->kind), found->file_path, found->line,
+                      found->column);
+        symbol.qualified_name = found->qualified_name;
+        const char* text = nullptr;
+        size_t length = 0;
+        devpilot_status source = devpilot_results_source(results, i, &text, &length);
+        std::string signature;
+        SnippetStatus status = SnippetStatus::MISSING;
+        if (source == DEVPILOT_OK) {
+            status = SnippetStatus::OK;
+            signature = signatureOf(symbol.type, std::string_view(text, length));
+        } else if (source == DEVPILOT_SOURCE_STALE) {
+            status = SnippetStatus::STALE;
         }
-    } catch (const std::filesystem::filesystem_error& e) {
-        std::cerr << "Error traversing directory: " << e.what() << std::endl;
+        printSymbol(symbol, status, signature);
     }
-    
-    std::sort(cppFiles.begin(), cppFiles.end());
-    return cppFiles;
 }
 
-bool DevPilotCLI::isCppFile(const std::string& filename) {
-    // Check for C++ file extensions
-    std::vector<std::string> extensions = {".cpp", ".cxx", ".cc", ".hpp", ".h", ".hxx"};
-    
-    for (const auto& ext : extensions) {
-        if (filename.length() >= ext.length() &&
-            filename.substr(filename.length() - ext.length()) == ext) {
-            return true;
-        }
+DevPilotCLI::ApiResults DevPilotCLI::apiResults(devpilot_status status, devpilot_results* results) {
+    if (status != DEVPILOT_OK && status != DEVPILOT_TRUNCATED) {
+        logging::flush();
+        std::cerr << devpilot_last_error() << std::endl;
+        return ApiResults(nullptr, devpilot_results_free);
     }
-    
-    return false;
+    return ApiResults(results, devpilot_results_free);
 }
 
 } // namespace devpilot
 
 // Main entry point
 int main(int argc, char* argv[]) {
-    devpilot::DevPilotCLI cli;
-    return cli.run(argc, argv);
+    // Logging switches apply to every command, so they are taken out before
+    // anything (the parser's constructor included) logs
+    using devpilot::LogLevel;
+    std::vector<char*> args;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i > 0 && (arg == "--quiet" || arg == "-q")) {
+            devpilot::logging::setLevel(LogLevel::WARNING);
+        } else if (i > 0 && (arg == "--verbose" || arg == "-v")) {
+            devpilot::logging::setLevel(LogLevel::DEBUG);
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    
+    // An artifact exported to stdout must not be interleaved with log output
+    if (args.size() == 3 && std::string(args[1]) == "export" && std::string(args[2]) == "-") {
+        devpilot::logging::writeAllToStderr();
+    }
+    
+    int status;
+    {
+        devpilot::DevPilotCLI cli;
+        status = cli.run(static_cast<int>(args.size()), args.data());
+    }
+    devpilot::logging::flush();
+    return status;
 }
@@ -0,0 +1,164 @@
+#include "memory_accounting.hpp"
+#include "process_memory.hpp"
+#include <algorithm>
+#include <mutex>
+#include <sqlite3.h>
+
+namespace devpilot {
+namespace memory {
+
+// Single responsibility: Only count allocations per subsystem and phase
+
+namespace {
+
+// One block per thread, so counting stays off shared cache lines. Threads
+// beyond the table share the last block. Everything here is statically
+// allocated: the allocator hook may run before main and must not recurse.
+struct alignas(64) Counters {
+    std::atomic<uint64_t> allocations[kMemoryTagCount];
+    std::atomic<uint64_t> allocatedBytes[kMemoryTagCount];
+    std::atomic<uint64_t> freedBytes[kMemoryTagCount];
+};
+
+constexpr size_t kCounterBlocks = 256;
+Counters counters[kCounterBlocks];
+std::atomic<size_t> nextBlock{0};
+thread_local Counters* localCounters = nullptr;
+
+Counters& threadCounters() {
+    if (!localCounters) {
+        size_t block = nextBlock.fetch_add(1, std::memory_order_relaxed);
+        localCounters = &counters[block < kCounterBlocks ? block : kCounterBlocks - 1];
+    }
+    return *localCounters;
+}
+
+std::mutex phaseMutex;
+std::vector<PhaseUsage> phases;
+
+void sqliteMemory(uint64_t& current, uint64_t& peak, bool resetPeak) {
+    sqlite3_int64 used = 0;
+    sqlite3_int64 highWater = 0;
+    sqlite3_status64(SQLITE_STATUS_MEMORY_USED, &used, &highWater, resetPeak ? 1 : 0);
+    current = static_cast<uint64_t>(used);
+    peak = static_cast<uint64_t>(highWater);
+}
+
+} // namespace
+
+namespace detail {
+
+thread_local MemoryTag currentTag = MemoryTag::OTHER;
+bool hookInstalled = false;
+std::atomic<bool> active{false};
+
+uint32_t recordAllocation(size_t size) {
+    if (!active.load(std::memory_order_relaxed)) {
+        return kUncounted;
+    }
+    size_t tag = static_cast<size_t>(currentTag);
+    Counters& own = threadCounters();
+    own.allocations[tag].fetch_add(1, std::memory_order_relaxed);
+    own.allocatedBytes[tag].fetch_add(size, std::memory_order_relaxed);
+    return static_cast<uint32_t>(tag);
+}
+
+void recordFree(uint32_t tag, size_t size) {
+    if (tag < kMemoryTagCount) {
+        threadCounters().freedBytes[tag].fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+} // namespace detail
+
+const char* memoryTagName(MemoryTag tag) {
+    switch (tag) {
+        case MemoryTag::OTHER: return "other";
+        case MemoryTag::READER: return "reader";
+        case MemoryTag::PARSER: return "parser";
+        case MemoryTag::PARSE_CACHE: return "parse cache";
+        case MemoryTag::SYMBOLS: return "symbols";
+        case MemoryTag::INDEXES: return "indexes";
+    }
+    return "other";
+}
+
+bool accountingAvailable() {
+    return detail::hookInstalled;
+}
+
+void enable() {
+    uint64_t current = 0;
+    uint64_t peak = 0;
+    sqliteMemory(current, peak, true);
+    detail::active.store(true, std::memory_order_relaxed);
+}
+
+bool enabled() {
+    return detail::active.load(std::memory_order_relaxed);
+}
+
+int64_t Usage::liveBytes() const {
+    int64_t total = 0;
+    for (const auto& tag : tags) {
+        total += tag.liveBytes;
+    }
+    return total;
+}
+
+uint64_t Usage::allocations() const {
+    uint64_t total = 0;
+    for (const auto& tag : tags) {
+        total += tag.allocations;
+    }
+    return total;
+}
+
+Usage currentUsage() {
+    Usage usage;
+    size_t blocks = std::min(nextBlock.load(std::memory_order_relaxed), kCounterBlocks);
+    for (size_t block = 0; block < blocks; block++) {
+        for (size_t tag = 0; tag < kMemoryTagCount; tag++) {
+            uint64_t allocated = counters[block].allocatedBytes[tag].load(std::memory_order_relaxed);
+            uint64_t freed = counters[block].freedBytes[tag].load(std::memory_order_relaxed);
+            usage.tags[tag].allocations += counters[block].allocations[tag].load(std::memory_order_relaxed);
+            usage.tags[tag].allocatedBytes += allocated;
+            usage.tags[tag].liveBytes += static_cast<int64_t>(allocated - freed);
+        }
+    }
+    sqliteMemory(usage.sqliteBytes, usage.sqlitePeakBytes, false);
+    return usage;
+}
+
+Phase::Phase(const char* name) : name(enabled() ? name : nullptr) {
+    if (this->name) {
+        resetResidentHighWater();
+        uint64_t current = 0;
+        uint64_t peak = 0;
+        sqliteMemory(current, peak, true);
+        startAllocations = currentUsage().allocations();
+    }
+}
+
+Phase::~Phase() {
+    if (!name) {
+        return;
+    }
+    Usage usage = currentUsage();
+    PhaseUsage phase;
+    phase.name = name;
+    phase.peakResidentBytes = residentHighWaterBytes();
+    phase.sqlitePeakBytes = usage.sqlitePeakBytes;
+    phase.liveBytes = usage.liveBytes();
+    phase.allocations = usage.allocations() - startAllocations;
+    std::lock_guard<std::mutex> lock(phaseMutex);
+    phases.push_back(std::move(phase));
+}
+
+std::vector<PhaseUsage> phaseUsage() {
+    std::lock_guard<std::mutex> lock(phaseMutex);
+    return phases;
+}
+
+} // namespace memory
+} // namespace devpilot
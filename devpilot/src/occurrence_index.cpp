@@ -0,0 +1,159 @@
+#include "occurrence_index.hpp"
+
+namespace devpilot {
+
+// Single responsibility: Only build and decode identifier posting lists
+
+namespace {
+
+void appendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool readVarint(const unsigned char*& cursor, const unsigned char* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; cursor < end && shift < 64; shift += 7) {
+        unsigned char byte = *cursor++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+// A name's string, its list and its hash node, which holds the key, the id,
+// the next pointer and the cached hash
+size_t OccurrenceIndex::entryBytes(const std::string& name) {
+    return sizeof(std::string) + name.capacity() + sizeof(PostingList) +
+           sizeof(std::pair<const std::string_view, uint32_t>) + 2 * sizeof(void*);
+}
+
+void OccurrenceIndex::addFile(uint32_t fileId, const std::vector<std::string_view>& fileNames,
+                              const std::vector<IdentifierOccurrence>& occurrences) {
+    // Map the file-local name table onto global name ids once per file
+    std::vector<uint32_t> globalIds(fileNames.size());
+    for (size_t i = 0; i < fileNames.size(); i++) {
+        auto found = nameIds.find(fileNames[i]);
+        if (found == nameIds.end()) {
+            names.emplace_back(fileNames[i]);
+            postings.emplace_back();
+            found = nameIds.emplace(names.back(), static_cast<uint32_t>(names.size())).first;
+            nameBytes += entryBytes(names.back());
+        }
+        globalIds[i] = found->second;
+    }
+
+    for (const auto& occurrence : occurrences) {
+        PostingList& list = postings[globalIds[occurrence.name_index] - 1];
+        size_t before = list.bytes.size();
+        uint32_t line = static_cast<uint32_t>(occurrence.line_number);
+
+        if (list.count == 0 || fileId != list.lastFile) {
+            appendVarint(list.bytes, fileId - list.lastFile);
+            appendVarint(list.bytes, line);
+        } else {
+            appendVarint(list.bytes, 0);
+            appendVarint(list.bytes, line - list.lastLine);
+        }
+        appendVarint(list.bytes, static_cast<uint32_t>(occurrence.column_number));
+
+        list.lastFile = fileId;
+        list.lastLine = line;
+        list.count++;
+        totalOccurrences++;
+        totalBytes += list.bytes.size() - before;
+        pendingBytes += list.bytes.size() - before;
+    }
+}
+
+void OccurrenceIndex::restoreName(uint32_t nameId, std::string_view name) {
+    // Ids that were never stored stay as empty names no file can look up
+    while (names.size() + 1 < nameId) {
+        names.emplace_back();
+        postings.emplace_back();
+    }
+    if (names.size() + 1 != nameId || nameIds.count(name) != 0) {
+        return;
+    }
+    names.emplace_back(name);
+    postings.emplace_back();
+    nameIds.emplace(names.back(), nameId);
+    nameBytes += entryBytes(names.back());
+}
+
+void OccurrenceIndex::startSegment(int next) {
+    segment = next;
+}
+
+size_t OccurrenceIndex::nameCount() const {
+    return names.size();
+}
+
+uint64_t OccurrenceIndex::occurrenceCount() const {
+    return totalOccurrences;
+}
+
+uint64_t OccurrenceIndex::encodedBytes() const {
+    return totalBytes;
+}
+
+uint64_t OccurrenceIndex::bufferedBytes() const {
+    return pendingBytes;
+}
+
+size_t OccurrenceIndex::memoryBytes() const {
+    return nameBytes + nameIds.bucket_count() * sizeof(void*);
+}
+
+void OccurrenceIndex::flush(
+    const std::function<void(uint32_t, const std::string&, int, uint64_t, const std::string&)>&
+        visitor) {
+    for (size_t i = 0; i < names.size(); i++) {
+        PostingList& list = postings[i];
+        if (list.count == 0) {
+            continue;
+        }
+        visitor(static_cast<uint32_t>(i + 1), names[i], segment, list.count, list.bytes);
+        list = PostingList();
+    }
+    pendingBytes = 0;
+    segment++;
+}
+
+bool OccurrenceIndex::decode(const void* data, size_t size, std::vector<Occurrence>& out) {
+    const unsigned char* cursor = static_cast<const unsigned char*>(data);
+    const unsigned char* end = cursor + size;
+    uint64_t file = 0;
+    uint64_t line = 0;
+    bool first = true;
+
+    while (cursor < end) {
+        uint64_t fileDelta = 0, lineValue = 0, column = 0;
+        if (!readVarint(cursor, end, fileDelta) || !readVarint(cursor, end, lineValue) ||
+            !readVarint(cursor, end, column)) {
+            return false;
+        }
+
+        // A new file restarts line numbering; the first entry has a non-zero delta
+        if (fileDelta != 0 || first) {
+            file += fileDelta;
+            line = lineValue;
+        } else {
+            line += lineValue;
+        }
+        first = false;
+
+        out.push_back({static_cast<uint32_t>(file), static_cast<int>(line), static_cast<int>(column)});
+    }
+
+    return true;
+}
+
+} // namespace devpilot
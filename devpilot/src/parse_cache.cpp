@@ -0,0 +1,399 @@
+#include "parse_cache.hpp"
+#include "byte_codec.hpp"
+#include "content_hash.hpp"
+#include "logger.hpp"
+#include "memory_accounting.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace devpilot {
+
+// Single responsibility: Only persist and look up parse results by content hash
+
+namespace {
+
+const char kMagic[4] = {'D', 'P', 'C', '1'};
+const char kBlobMagic[4] = {'D', 'P', 'B', '1'};
+constexpr size_t kHeaderSize = 4 + 4 + 8 + 8;
+
+// Evicting down to a low-water mark keeps the next few runs from evicting again
+constexpr uint64_t kLowWaterPercent = 80;
+
+// Entries written by another parser version, or damaged, are treated as misses
+bool validEntry(const std::string& data) {
+    if (data.size() < kHeaderSize || !std::equal(kMagic, kMagic + 4, data.data())) {
+        return false;
+    }
+    ByteReader header(data.data() + 4, kHeaderSize - 4);
+    return header.fixed(4) == CppParser::kVersion &&
+           header.fixed(8) == data.size() - kHeaderSize &&
+           header.fixed(8) == hashContent(data.data() + kHeaderSize, data.size() - kHeaderSize);
+}
+
+std::string encode(const ParseResult& result) {
+    ByteWriter out;
+    out.varint(result.content_hash);
+
+    out.varint(result.symbols.size());
+    for (const auto& symbol : result.symbols) {
+        out.string(symbol.name);
+        out.varint(static_cast<uint64_t>(symbol.type));
+        out.signedVarint(symbol.line_number);
+        out.signedVarint(symbol.column_number);
+        out.varint(symbol.start_offset);
+        out.varint(symbol.end_offset - symbol.start_offset);
+        out.string(symbol.parent_scope);
+        out.string(symbol.qualified_name);
+        out.signedVarint(symbol.param_count);
+        out.signedVarint(symbol.required_param_count);
+    }
+
+    out.varint(result.includes.size());
+    for (const auto& include : result.includes) {
+        out.string(include.path);
+        out.varint(include.is_system ? 1 : 0);
+        out.signedVarint(include.line_number);
+    }
+
+    out.varint(result.calls.size());
+    for (const auto& call : result.calls) {
+        out.varint(call.caller_index);
+        out.string(call.callee_name);
+        out.string(call.qualifier);
+        out.varint(call.is_member ? 1 : 0);
+        out.signedVarint(call.arg_count);
+        out.signedVarint(call.line_number);
+        out.signedVarint(call.column_number);
+    }
+
+    out.varint(result.identifier_names.size());
+    for (const auto& name : result.identifier_names) {
+        out.string(name);
+    }
+
+    // Occurrences are in source order, so lines are stored as deltas
+    out.varint(result.occurrences.size());
+    int previousLine = 0;
+    for (const auto& occurrence : result.occurrences) {
+        out.varint(occurrence.name_index);
+        out.signedVarint(occurrence.line_number - previousLine);
+        out.signedVarint(occurrence.column_number);
+        previousLine = occurrence.line_number;
+    }
+
+    return out.bytes;
+}
+
+bool decode(const char* data, size_t size, std::string_view filePath, ParseResult& result) {
+    StringArena& arena = result.arena;
+    ByteReader in(data, size);
+    result.content_hash = in.varint();
+
+    result.symbols.resize(in.count());
+    for (auto& symbol : result.symbols) {
+        symbol.name = arena.copy(in.string());
+        uint64_t type = in.varint();
+        symbol.type = type <= static_cast<uint64_t>(SymbolType::UNKNOWN)
+                          ? static_cast<SymbolType>(type) : SymbolType::UNKNOWN;
+        symbol.file_path = filePath;
+        symbol.line_number = in.integer();
+        symbol.column_number = in.integer();
+        symbol.start_offset = in.varint();
+        symbol.end_offset = symbol.start_offset + in.varint();
+        symbol.parent_scope = arena.copy(in.string());
+        symbol.qualified_name = arena.copy(in.string());
+        symbol.param_count = in.integer();
+        symbol.required_param_count = in.integer();
+    }
+
+    result.includes.resize(in.count());
+    for (auto& include : result.includes) {
+        include.path = arena.copy(in.string());
+        include.is_system = in.varint() != 0;
+        include.line_number = in.integer();
+    }
+
+    result.calls.resize(in.count());
+    for (auto& call : result.calls) {
+        call.caller_index = static_cast<uint32_t>(in.varint());
+        call.callee_name = arena.copy(in.string());
+        call.qualifier = arena.copy(in.string());
+        call.is_member = in.varint() != 0;
+        call.arg_count = in.integer();
+        call.line_number = in.integer();
+        call.column_number = in.integer();
+        if (call.caller_index >= result.symbols.size()) {
+            return false;
+        }
+    }
+
+    result.identifier_names.resize(in.count());
+    for (auto& name : result.identifier_names) {
+        name = arena.copy(in.string());
+    }
+
+    result.occurrences.resize(in.count());
+    int line = 0;
+    for (auto& occurrence : result.occurrences) {
+        occurrence.name_index = static_cast<uint32_t>(in.varint());
+        line += in.integer();
+        occurrence.line_number = line;
+        occurrence.column_number = in.integer();
+        if (occurrence.name_index >= result.identifier_names.size()) {
+            return false;
+        }
+    }
+
+    return in.finished();
+}
+
+} // namespace
+
+ParseCache::ParseCache(const std::string& directory, uint64_t maxBytes)
+    : directory(directory), maxBytes(maxBytes), usable(false), hitCount(0), missCount(0) {
+    if (directory.empty() || maxBytes == 0) {
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    usable = !error && std::filesystem::is_directory(directory, error);
+    if (!usable) {
+        logging::warning("Parse cache disabled: cannot use ", directory);
+    }
+}
+
+std::string ParseCache::defaultDirectory() {
+    if (const char* dir = std::getenv("DEVPILOT_CACHE_DIR")) {
+        return dir;
+    }
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME")) {
+        if (*xdg) {
+            return (std::filesystem::path(xdg) / "devpilot").string();
+        }
+    }
+    if (const char* home = std::getenv("HOME")) {
+        if (*home) {
+            return (std::filesystem::path(home) / ".cache" / "devpilot").string();
+        }
+    }
+    return std::string();
+}
+
+uint64_t ParseCache::keySeed(ParseDepth depth) {
+    return CppParser::kVersion | static_cast<uint64_t>(depth) << 32;
+}
+
+uint64_t ParseCache::key(uint64_t contentHash, ParseDepth depth) {
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = static_cast<unsigned char>(contentHash >> (8 * i));
+    }
+    return hashContent(bytes, sizeof(bytes), keySeed(depth));
+}
+
+bool ParseCache::enabled() const {
+    return usable;
+}
+
+std::string ParseCache::pathFor(uint64_t key) const {
+    std::string hex = hashToHex(key);
+    return (std::filesystem::path(directory) / hex.substr(0, 2) / hex).string();
+}
+
+bool ParseCache::load(uint64_t key, std::string_view filePath, ParseResult& result) {
+    if (!usable) {
+        return false;
+    }
+    trace::Scope scope("parse cache load");
+    memory::TagScope tag(memory::MemoryTag::PARSE_CACHE);
+
+    std::string data;
+    ParseResult decoded;
+    if (!readEntry(key, data) ||
+        !decode(data.data() + kHeaderSize, data.size() - kHeaderSize, filePath, decoded)) {
+        missCount++;
+        return false;
+    }
+
+    result = std::move(decoded);
+    hitCount++;
+    return true;
+}
+
+void ParseCache::store(uint64_t key, const ParseResult& result) {
+    if (!usable) {
+        return;
+    }
+    trace::Scope scope("parse cache store");
+    memory::TagScope tag(memory::MemoryTag::PARSE_CACHE);
+
+    std::string payload = encode(result);
+    ByteWriter header;
+    header.bytes.append(kMagic, 4);
+    header.fixed(CppParser::kVersion, 4);
+    header.fixed(payload.size(), 8);
+    header.fixed(hashContent(payload.data(), payload.size()), 8);
+
+    writeAtomically(pathFor(key), header.bytes, payload);
+}
+
+bool ParseCache::readEntry(uint64_t key, std::string& entry) {
+    std::string path = pathFor(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string data = buffer.str();
+    file.close();
+    if (!validEntry(data)) {
+        return false;
+    }
+
+    // Refresh recency for eviction; failure only makes the entry look older
+    std::error_code error;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
+    entry = std::move(data);
+    return true;
+}
+
+bool ParseCache::loadEntry(uint64_t key, std::string& entry) {
+    return usable && readEntry(key, entry);
+}
+
+// Keys are content hashes, so an entry already present holds the same result
+bool ParseCache::storeEntry(uint64_t key, const std::string& entry) {
+    if (!usable || !validEntry(entry)) {
+        return false;
+    }
+    std::string path = pathFor(key);
+    std::error_code error;
+    return std::filesystem::exists(path, error) || writeAtomically(path, entry, std::string());
+}
+
+bool ParseCache::loadBlobKey(const std::string& blobId, uint64_t& key) {
+    if (!usable || blobId.size() < 3) {
+        return false;
+    }
+
+    std::ifstream file(blobPathFor(blobId), std::ios::binary);
+    char data[12];
+    if (!file.read(data, sizeof(data)) || !std::equal(kBlobMagic, kBlobMagic + 4, data)) {
+        return false;
+    }
+    key = ByteReader(data + 4, 8).fixed(8);
+    return true;
+}
+
+void ParseCache::storeBlobKey(const std::string& blobId, uint64_t key) {
+    if (!usable || blobId.size() < 3) {
+        return;
+    }
+
+    ByteWriter entry;
+    entry.bytes.append(kBlobMagic, 4);
+    entry.fixed(key, 8);
+    writeAtomically(blobPathFor(blobId), entry.bytes, std::string());
+}
+
+std::string ParseCache::blobPathFor(const std::string& blobId) const {
+    return (std::filesystem::path(directory) / "git" / blobId.substr(0, 2) / blobId.substr(2)).string();
+}
+
+bool ParseCache::writeAtomically(const std::string& target, const std::string& header,
+                                 const std::string& payload) {
+    std::filesystem::path path = target;
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    // Write then rename so concurrent indexers never observe a partial entry
+    std::filesystem::path temporary = path;
+    temporary += ".tmp" + std::to_string(
+        std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.write(header.data(), static_cast<std::streamsize>(header.size()));
+        file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        if (!file) {
+            file.close();
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+void ParseCache::evict() {
+    if (!usable) {
+        return;
+    }
+
+    struct Entry {
+        std::filesystem::file_time_type lastUsed;
+        uint64_t size;
+        std::filesystem::path path;
+    };
+    std::vector<Entry> entries;
+    uint64_t totalBytes = 0;
+
+    std::error_code error;
+    for (auto it = std::filesystem::recursive_directory_iterator(directory, error);
+         !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+        std::error_code entryError;
+        if (!it->is_regular_file(entryError)) {
+            continue;
+        }
+        uint64_t size = it->file_size(entryError);
+        auto lastUsed = it->last_write_time(entryError);
+        if (entryError) {
+            continue;
+        }
+        entries.push_back({lastUsed, size, it->path()});
+        totalBytes += size;
+    }
+
+    if (totalBytes <= maxBytes) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+    uint64_t target = maxBytes / 100 * kLowWaterPercent;
+    for (const auto& entry : entries) {
+        if (totalBytes <= target) {
+            break;
+        }
+        std::error_code removeError;
+        if (std::filesystem::remove(entry.path, removeError)) {
+            totalBytes -= entry.size;
+        }
+    }
+}
+
+uint64_t ParseCache::hits() const {
+    return hitCount;
+}
+
+uint64_t ParseCache::misses() const {
+    return missCount;
+}
+
+} // namespace devpilot
@@ -1,9 +1,16 @@
 #include "parser.hpp"
+#include "declaration_scanner.hpp"
+#include "lexer.hpp"
+#include "logger.hpp"
+#include "memory_accounting.hpp"
+#include "trace.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <cstring>
 #include <cctype>
+#include <functional>
+#include <vector>
 
 #ifdef HAVE_TREE_SITTER
 // TreeSitter includes
@@ -40,16 +47,16 @@ CppParser::CppParser() : parser(nullptr), cpp_language(nullptr), initialized(fal
     if (parser) {
         // We'll implement a simple fallback parser for now
         initialized = true;
-        std::cout << "Parser initialized (TreeSitter available but using fallback implementation)" << std::endl;
+        logging::debug("Parser initialized (TreeSitter available but using fallback implementation)");
     }
 #else
     // Fallback implementation without TreeSitter
     initialized = true;
-    std::cout << "Parser initialized (fallback implementation - limited functionality)" << std::endl;
+    logging::debug("Parser initialized (fallback implementation - limited functionality)");
 #endif
     
     if (!initialized) {
-        std::cerr << "Failed to initialize C++ parser" << std::endl;
+        logging::error("Failed to initialize C++ parser");
     }
 }
 
@@ -67,137 +74,234 @@ bool CppParser::isInitialized() const {
 
 std::vector<Symbol> CppParser::parseFile(const std::string& filePath) {
     std::vector<Symbol> symbols;
+    for (const auto& record : parse(filePath).symbols) {
+        symbols.push_back(record.toSymbol());
+    }
+    return symbols;
+}
+
+ParseResult CppParser::parse(const std::string& filePath) {
+    ParseResult result;
     
     if (!initialized) {
-        std::cerr << "Parser not initialized" << std::endl;
-        return symbols;
+        logging::error("Parser not initialized");
+        return result;
     }
     
     // Read file contents
     std::string source = readFile(filePath);
     if (source.empty()) {
-        std::cerr << "Could not read file: " << filePath << std::endl;
-        return symbols;
+        logging::error("Could not read file: ", filePath);
+        return result;
+    }
+    
+    return parseSource(source, filePath);
+}
+
+ParseDepth SizePolicy::depthFor(uint64_t size) const {
+    if (skipAbove != 0 && size > skipAbove) {
+        return ParseDepth::SKIP;
+    }
+    if (declarationsAbove != 0 && size > declarationsAbove) {
+        return ParseDepth::DECLARATIONS;
+    }
+    return ParseDepth::FULL;
+}
+
+namespace {
+
+void countEmitted(const ParseResult& result) {
+    trace::count(trace::Counter::FILES_PARSED);
+    trace::count(trace::Counter::SYMBOLS_EMITTED, result.symbols.size());
+    trace::count(trace::Counter::CALLS_EMITTED, result.calls.size());
+    trace::count(trace::Counter::INCLUDES_EMITTED, result.includes.size());
+    trace::count(trace::Counter::OCCURRENCES_EMITTED, result.occurrences.size());
+}
+
+} // namespace
+
+ParseResult CppParser::parseSource(std::string_view source, std::string_view filePath,
+                                   ParseDepth depth) {
+    trace::Scope scope("parse");
+    memory::TagScope tag(memory::MemoryTag::PARSER);
+    ParseResult result;
+    
+    if (!initialized) {
+        logging::error("Parser not initialized");
+        return result;
+    }
+    if (depth == ParseDepth::SKIP) {
+        return result;
     }
     
 #ifdef HAVE_TREE_SITTER
     // For now, we'll implement a simple fallback even with TreeSitter available
     // since we don't have the C++ grammar installed
-    std::cout << "Using fallback parser for: " << filePath << std::endl;
-    return parseWithFallback(source, filePath);
+    logging::debug("Using fallback parser for: ", filePath);
+    parseWithFallback(source, filePath, depth, result);
 #else
     // Fallback implementation without TreeSitter
-    std::cout << "Using fallback parser for: " << filePath << std::endl;
-    return parseWithFallback(source, filePath);
+    logging::debug("Using fallback parser for: ", filePath);
+    parseWithFallback(source, filePath, depth, result);
 #endif
-}
-
-// Fallback parser implementation using simple text processing
-std::vector<Symbol> CppParser::parseWithFallback(const std::string& source, const std::string& filePath) {
-    std::vector<Symbol> symbols;
     
-    // Simple text-based parsing - not as accurate as TreeSitter but functional for MVP
-    extractFunctionsFromText(source, filePath, symbols);
-    extractClassesFromText(source, filePath, symbols);
-    
-    return symbols;
+    if (trace::enabled()) {
+        countEmitted(result);
+    }
+    return result;
 }
 
-void CppParser::extractFunctionsFromText(const std::string& source, const std::string& filePath, std::vector<Symbol>& symbols) {
-    std::istringstream stream(source);
-    std::string line;
-    int lineNumber = 0;
-    
-    while (std::getline(stream, line)) {
-        lineNumber++;
-        
-        // Look for function patterns: "type functionName(" 
-        // This is a simple heuristic - not perfect but functional
-        size_t parenPos = line.find('(');
-        if (parenPos != std::string::npos) {
-            // Skip lines that look like function calls (inside other functions)
-            if (line.find("    ") == 0 || line.find("\t") == 0) {
-                continue; // Skip indented lines (likely function calls)
+namespace {
+
+// Open-addressing map from identifier to its index in the result's name list.
+// A node-based map would allocate once per distinct identifier in every file.
+class NameIndexTable {
+public:
+    explicit NameIndexTable(std::vector<std::string_view>& names) : names(names), slots(256, 0) {}
+
+    // Returns the name's index, appending it through copyName when new
+    template <typename CopyName>
+    uint32_t find(std::string_view name, CopyName&& copyName) {
+        size_t mask = slots.size() - 1;
+        for (size_t i = std::hash<std::string_view>()(name) & mask;; i = (i + 1) & mask) {
+            uint32_t slot = slots[i];
+            if (slot == 0) {
+                names.push_back(copyName(name));
+                slots[i] = static_cast<uint32_t>(names.size());
+                if (names.size() * 2 > slots.size()) {
+                    grow();
+                }
+                return static_cast<uint32_t>(names.size() - 1);
             }
-            
-            // Skip preprocessor directives and comments
-            if (line.find("#") != std::string::npos || 
-                line.find("//") != std::string::npos ||
-                line.find("/*") != std::string::npos) {
-                continue;
+            if (names[slot - 1] == name) {
+                return slot - 1;
             }
-            
-            // Extract potential function name
-            std::string beforeParen = line.substr(0, parenPos);
-            
-            // Find the last word before the parenthesis
-            size_t lastSpace = beforeParen.find_last_of(" \t");
-            if (lastSpace != std::string::npos) {
-                std::string functionName = beforeParen.substr(lastSpace + 1);
-                
-                // Clean up the function name
-                size_t asteriskPos = functionName.find('*');
-                if (asteriskPos != std::string::npos) {
-                    functionName = functionName.substr(asteriskPos + 1);
-                }
-                
-                // Skip constructors/destructors for now, and invalid names
-                if (!functionName.empty() && 
-                    functionName.find("if") != 0 && 
-                    functionName.find("while") != 0 &&
-                    functionName.find("for") != 0 &&
-                    functionName != "return" &&
-                    std::isalpha(functionName[0])) {
-                    
-                    std::string signature = line;
-                    if (signature.length() > 100) {
-                        signature = signature.substr(0, 97) + "...";
-                    }
-                    
-                    Symbol symbol(functionName, SymbolType::FUNCTION, filePath, lineNumber, 0, signature);
-                    symbols.push_back(symbol);
+        }
+    }
+
+private:
+    std::vector<std::string_view>& names;
+    std::vector<uint32_t> slots;  // 1-based name index, 0 when empty
+
+    void grow() {
+        std::vector<uint32_t> larger(slots.size() * 2, 0);
+        size_t mask = larger.size() - 1;
+        for (uint32_t slot : slots) {
+            if (slot != 0) {
+                size_t i = std::hash<std::string_view>()(names[slot - 1]) & mask;
+                while (larger[i] != 0) {
+                    i = (i + 1) & mask;
                 }
+                larger[i] = slot;
             }
         }
+        slots.swap(larger);
     }
-}
+};
 
-void CppParser::extractClassesFromText(const std::string& source, const std::string& filePath, std::vector<Symbol>& symbols) {
-    std::istringstream stream(source);
-    std::string line;
-    int lineNumber = 0;
-    
-    while (std::getline(stream, line)) {
-        lineNumber++;
-        
-        // Look for class declarations: "class ClassName"
-        if (line.find("class ") != std::string::npos || line.find("struct ") != std::string::npos) {
-            // Skip comments
-            if (line.find("//") != std::string::npos || line.find("/*") != std::string::npos) {
-                continue;
-            }
-            
-            size_t classPos = line.find("class ");
-            size_t structPos = line.find("struct ");
-            size_t keywordPos = (classPos != std::string::npos) ? classPos : structPos;
+// Fallback parser implementation: a tokenizer plus a scope-tracking declaration
+// scanner, fed the whole source or one window of it at a time
+class FallbackPass {
+public:
+    FallbackPass(std::string_view source, std::string_view filePath, ParseDepth depth,
+                 ParseResult& result, size_t rewindLimit = SIZE_MAX)
+        : result(result), lexer(source, rewindLimit),
+          scanner(filePath, result, depth == ParseDepth::FULL),
+          nameIndexes(result.identifier_names), recordOccurrences(depth == ParseDepth::FULL) {}
+
+    // Consumes tokens until the window runs out
+    void run() {
+        auto copyName = [this](std::string_view name) { return result.arena.copy(name); };
+        for (Token token = lexer.next(); token.kind != TokenKind::END; token = lexer.next()) {
+            scanner.feed(token);
             
-            if (keywordPos != std::string::npos) {
-                std::string keyword = (classPos != std::string::npos) ? "class " : "struct ";
-                size_t nameStart = keywordPos + keyword.length();
-                
-                // Extract class name
-                std::string rest = line.substr(nameStart);
-                size_t spacePos = rest.find_first_of(" \t{:");
-                std::string className = (spacePos != std::string::npos) ? rest.substr(0, spacePos) : rest;
-                
-                if (!className.empty() && std::isalpha(className[0])) {
-                    std::string signature = keyword + className;
-                    Symbol symbol(className, SymbolType::CLASS, filePath, lineNumber, 0, signature);
-                    symbols.push_back(symbol);
-                }
+            // Identifier occurrences are recorded in the same pass for find-references
+            if (recordOccurrences && token.kind == TokenKind::IDENTIFIER && !isCppKeyword(token.text)) {
+                uint32_t nameIndex = nameIndexes.find(token.text, copyName);
+                result.occurrences.push_back({nameIndex, token.line, token.column});
             }
         }
     }
+
+    // First file offset the next window must start at, no more than limit
+    // bytes before end; a declaration reaching further back is given up
+    size_t keepFrom(size_t end, size_t limit) {
+        size_t keep = std::min(lexer.resumeOffset(), scanner.retainedOffset());
+        if (end - keep > limit) {
+            scanner.release(end - limit);
+            keep = std::min(lexer.resumeOffset(), scanner.retainedOffset());
+        }
+        return keep;
+    }
+
+    void moveWindow(std::string_view window, size_t base, bool final) {
+        lexer.moveWindow(window, base, final);
+        scanner.moveWindow(window, base);
+    }
+
+private:
+    ParseResult& result;
+    CppLexer lexer;
+    DeclarationScanner scanner;
+    NameIndexTable nameIndexes;
+    bool recordOccurrences;
+};
+
+} // namespace
+
+void CppParser::parseWithFallback(std::string_view source, std::string_view filePath,
+                                  ParseDepth depth, ParseResult& result) {
+    FallbackPass pass(source, filePath, depth, result);
+    pass.run();
+}
+
+ParseResult CppParser::parseStream(const std::string& path, std::string_view filePath,
+                                   ParseDepth depth, size_t chunkSize) {
+    trace::Scope scope("parse streamed");
+    memory::TagScope tag(memory::MemoryTag::PARSER);
+    ParseResult result;
+    
+    if (!initialized) {
+        logging::error("Parser not initialized");
+        return result;
+    }
+    if (depth == ParseDepth::SKIP) {
+        return result;
+    }
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        logging::error("Could not read file: ", path);
+        return result;
+    }
+    logging::debug("Using fallback parser for: ", filePath, " (streamed)");
+    
+    // The window holds whatever the previous chunk left unfinished, at most one
+    // chunk of it, followed by the next chunk
+    std::vector<char> window(chunkSize * 2);
+    size_t base = 0;
+    size_t size = 0;
+    FallbackPass pass(std::string_view(), filePath, depth, result, chunkSize / 4);
+    while (true) {
+        file.read(window.data() + size, static_cast<std::streamsize>(chunkSize));
+        size += static_cast<size_t>(file.gcount());
+        bool final = !file;
+        pass.moveWindow(std::string_view(window.data(), size), base, final);
+        pass.run();
+        if (final) {
+            break;
+        }
+        
+        size_t end = base + size;
+        size_t keep = pass.keepFrom(end, chunkSize);
+        std::memmove(window.data(), window.data() + (keep - base), end - keep);
+        size = end - keep;
+        base = keep;
+    }
+    
+    if (trace::enabled()) {
+        countEmitted(result);
+    }
+    return result;
 }
 
 #ifdef HAVE_TREE_SITTER
@@ -230,15 +334,11 @@ void CppParser::extractFunctions(TSNode node, const std::string& source,
             std::string name = getNodeText(nameNode, source);
             if (!name.empty()) {
                 TSPoint startPoint = ts_node_start_point(node);
-                std::string signature = getNodeText(node, source);
-                
-                // Limit signature length for storage
-                if (signature.length() > 200) {
-                    signature = signature.substr(0, 197) + "...";
-                }
                 
                 Symbol symbol(name, SymbolType::FUNCTION, filePath, 
-                            startPoint.row + 1, startPoint.column + 1, signature);
+                            startPoint.row + 1, startPoint.column + 1);
+                symbol.start_offset = ts_node_start_byte(node);
+                symbol.end_offset = ts_node_end_byte(node);
                 symbols.push_back(symbol);
             }
         }
@@ -254,10 +354,11 @@ void CppParser::extractClasses(TSNode node, const std::string& source,
             std::string name = getNodeText(nameNode, source);
             if (!name.empty()) {
                 TSPoint startPoint = ts_node_start_point(node);
-                std::string signature = "class " + name;
                 
                 Symbol symbol(name, SymbolType::CLASS, filePath,
-                            startPoint.row + 1, startPoint.column + 1, signature);
+                            startPoint.row + 1, startPoint.column + 1);
+                symbol.start_offset = ts_node_start_byte(node);
+                symbol.end_offset = ts_node_end_byte(node);
                 symbols.push_back(symbol);
             }
         }
@@ -275,14 +376,11 @@ void CppParser::extractVariables(TSNode node, const std::string& source,
             std::string name = getNodeText(declaratorNode, source);
             if (!name.empty() && name.find('(') == std::string::npos) { // Not a function
                 TSPoint startPoint = ts_node_start_point(node);
-                std::string signature = getNodeText(node, source);
-                
-                if (signature.length() > 100) {
-                    signature = signature.substr(0, 97) + "...";
-                }
                 
                 Symbol symbol(name, SymbolType::VARIABLE, filePath,
-                            startPoint.row + 1, startPoint.column + 1, signature);
+                            startPoint.row + 1, startPoint.column + 1);
+                symbol.start_offset = ts_node_start_byte(node);
+                symbol.end_offset = ts_node_end_byte(node);
                 symbols.push_back(symbol);
             }
         }
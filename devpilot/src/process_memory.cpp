@@ -0,0 +1,80 @@
+#include "process_memory.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cstdio>
+#include <cstring>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace devpilot {
+
+// Single responsibility: Only report this process's memory use
+
+uint64_t currentResidentBytes() {
+#if defined(__linux__)
+    // Second field of statm is resident pages; cheap enough to poll
+    FILE* file = std::fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0;
+    }
+    unsigned long long size = 0, resident = 0;
+    int fields = std::fscanf(file, "%llu %llu", &size, &resident);
+    std::fclose(file);
+    return fields == 2 ? resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+    return peakResidentBytes();
+#endif
+}
+
+uint64_t peakResidentBytes() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return static_cast<uint64_t>(usage.ru_maxrss);  // Bytes on macOS
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // Kilobytes elsewhere
+#endif
+#else
+    return 0;
+#endif
+}
+
+uint64_t residentHighWaterBytes() {
+#if defined(__linux__)
+    // VmHWM follows resets through clear_refs, unlike getrusage's maximum
+    FILE* file = std::fopen("/proc/self/status", "r");
+    if (!file) {
+        return peakResidentBytes();
+    }
+    char line[256];
+    unsigned long long kilobytes = 0;
+    bool found = false;
+    while (!found && std::fgets(line, sizeof(line), file)) {
+        found = std::strncmp(line, "VmHWM:", 6) == 0 && std::sscanf(line + 6, "%llu", &kilobytes) == 1;
+    }
+    std::fclose(file);
+    return found ? kilobytes * 1024 : peakResidentBytes();
+#else
+    return peakResidentBytes();
+#endif
+}
+
+bool resetResidentHighWater() {
+#if defined(__linux__)
+    // "5" resets the high-water mark to the current resident size (Linux 4.0+)
+    FILE* file = std::fopen("/proc/self/clear_refs", "w");
+    if (!file) {
+        return false;
+    }
+    bool written = std::fputs("5", file) >= 0;
+    return std::fclose(file) == 0 && written;
+#else
+    return false;
+#endif
+}
+
+} // namespace devpilot
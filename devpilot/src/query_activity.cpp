@@ -0,0 +1,68 @@
+#include "query_activity.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#define DEVPILOT_HAVE_FLOCK 1
+#endif
+
+namespace devpilot {
+
+// Single responsibility: Only signal running queries across processes
+
+QueryActivity::QueryActivity(const std::string& databasePath) : lockPath(databasePath + "-query") {
+#ifdef DEVPILOT_HAVE_FLOCK
+    fd = ::open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+#endif
+}
+
+QueryActivity::~QueryActivity() {
+#ifdef DEVPILOT_HAVE_FLOCK
+    if (fd >= 0) {
+        ::close(fd);
+    }
+#endif
+}
+
+void QueryActivity::beginQuery() {
+#ifdef DEVPILOT_HAVE_FLOCK
+    if (fd >= 0) {
+        while (flock(fd, LOCK_SH) != 0 && errno == EINTR) {
+        }
+    }
+#endif
+}
+
+void QueryActivity::endQuery() {
+#ifdef DEVPILOT_HAVE_FLOCK
+    if (fd >= 0) {
+        flock(fd, LOCK_UN);
+    }
+#endif
+}
+
+bool QueryActivity::waitForQueries() {
+    bool waited = false;
+#ifdef DEVPILOT_HAVE_FLOCK
+    // flock() locks belong to an open file description, so each call opens
+    // its own: threads sharing one would only exclude each other. The probe
+    // is one non-blocking attempt; only while a query holds the lock does it
+    // block until the lock is released.
+    int probe = ::open(lockPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (probe < 0) {
+        return false;
+    }
+    if (flock(probe, LOCK_EX | LOCK_NB) != 0) {
+        waited = true;
+        while (flock(probe, LOCK_EX) != 0 && errno == EINTR) {
+        }
+    }
+    flock(probe, LOCK_UN);
+    ::close(probe);
+#endif
+    return waited;
+}
+
+} // namespace devpilot
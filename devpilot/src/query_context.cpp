@@ -0,0 +1,28 @@
+#include "query_context.hpp"
+
+namespace devpilot {
+
+// Single responsibility: Only decide when a query has to give up
+
+QueryContext::QueryContext(std::chrono::milliseconds timeout, const CancellationToken* token)
+    : token(token) {
+    if (timeout.count() > 0) {
+        deadline = Clock::now() + timeout;
+    }
+}
+
+bool QueryContext::shouldStop() {
+    if (!truncated && ((token && token->isCancelled()) || Clock::now() >= deadline)) {
+        truncated = true;
+    }
+    return truncated;
+}
+
+void QueryContext::fail(const std::string& message) {
+    if (!failed) {
+        failed = true;
+        error = message;
+    }
+}
+
+} // namespace devpilot
@@ -0,0 +1,366 @@
+#include "sharded_storage.hpp"
+#include "content_hash.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <tuple>
+
+namespace devpilot {
+
+// Single responsibility: Only split an index into shards and merge their answers
+
+namespace {
+
+// Concatenates per-shard results that are each sorted by less, keeping the
+// order. Shards are few, so merging each run into the ones before is enough.
+template <typename T, typename Less>
+std::vector<T> mergeSorted(std::vector<std::vector<T>> runs, Less less) {
+    if (runs.size() == 1) {
+        return std::move(runs[0]);
+    }
+    std::vector<T> merged;
+    size_t total = 0;
+    for (const auto& run : runs) {
+        total += run.size();
+    }
+    merged.reserve(total);
+    for (auto& run : runs) {
+        size_t middle = merged.size();
+        std::move(run.begin(), run.end(), std::back_inserter(merged));
+        std::inplace_merge(merged.begin(), merged.begin() + middle, merged.end(), less);
+    }
+    return merged;
+}
+
+bool byName(const Symbol& a, const Symbol& b) {
+    return a.name < b.name;
+}
+
+bool byQualifiedName(const Symbol& a, const Symbol& b) {
+    return std::tie(a.qualified_name, a.file_path) < std::tie(b.qualified_name, b.file_path);
+}
+
+bool byLine(const Symbol& a, const Symbol& b) {
+    return a.line_number < b.line_number;
+}
+
+// getSymbolUsages() sorts "<caller> (<file>:<line>)" by caller, file, then
+// line as a number
+std::tuple<std::string_view, std::string_view, int> usageKey(std::string_view usage) {
+    size_t open = usage.rfind(" (");
+    size_t colon = usage.rfind(':');
+    if (open == std::string_view::npos || colon == std::string_view::npos || colon < open) {
+        return {usage, std::string_view(), 0};
+    }
+    std::string_view file = usage.substr(open + 2, colon - open - 2);
+    int line = 0;
+    for (size_t i = colon + 1; i < usage.size() && usage[i] >= '0' && usage[i] <= '9'; i++) {
+        line = line * 10 + (usage[i] - '0');
+    }
+    return {usage.substr(0, open), file, line};
+}
+
+// Several symbols may share a name across shards, and so a usage
+template <typename T>
+void removeDuplicates(std::vector<T>& sorted) {
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+}
+
+} // namespace
+
+const char* shardSchemeName(ShardScheme scheme) {
+    return scheme == ShardScheme::PATH_HASH ? "hash" : "directory";
+}
+
+bool parseShardScheme(const std::string& name, ShardScheme& scheme) {
+    if (name == "directory" || name == "dir") {
+        scheme = ShardScheme::DIRECTORY;
+    } else if (name == "hash") {
+        scheme = ShardScheme::PATH_HASH;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string shardPath(const std::string& databasePath, unsigned shard) {
+    return databasePath + ".shard" + std::to_string(shard);
+}
+
+void removeShards(const std::string& databasePath, unsigned first) {
+    for (unsigned k = first; k < kMaxShards; k++) {
+        std::error_code error;
+        std::string path = shardPath(databasePath, k);
+        if (!std::filesystem::remove(path, error)) {
+            break;
+        }
+        // What WAL mode leaves beside it
+        std::filesystem::remove(path + "-wal", error);
+        std::filesystem::remove(path + "-shm", error);
+    }
+}
+
+unsigned shardFor(std::string_view relativePath, ShardScheme scheme, unsigned count) {
+    if (count <= 1) {
+        return 0;
+    }
+    std::string_view key = relativePath;
+    if (scheme == ShardScheme::DIRECTORY) {
+        // Files directly in the root share one shard
+        size_t separator = key.find('/');
+        key = separator == std::string_view::npos ? std::string_view() : key.substr(0, separator);
+    }
+    return static_cast<unsigned>(hashContent(key.data(), key.size()) % count);
+}
+
+ShardedStorage::~ShardedStorage() {
+    close();
+}
+
+bool ShardedStorage::open(const std::string& dbPath) {
+    close();
+    failure = SqliteStorage::OpenFailure::NONE;
+    failureMessage.clear();
+    auto main = std::make_unique<Shard>();
+    if (!main->storage.initialize(dbPath, SqliteStorage::OpenMode::READ_ONLY)) {
+        failure = main->storage.openFailure();
+        failureMessage = main->storage.openError();
+        return false;
+    }
+    stamp = main->storage.indexStamp();
+
+    unsigned count = 0;
+    try {
+        count = static_cast<unsigned>(std::stoul(main->storage.getMetadata("shard_count")));
+    } catch (const std::exception&) {
+        count = 0;  // Unsharded
+    }
+    if (count <= 1 || count > kMaxShards) {
+        shards.push_back(std::move(main));
+        return true;
+    }
+    main.reset();
+
+    for (unsigned k = 0; k < count; k++) {
+        auto shard = std::make_unique<Shard>();
+        if (!shard->storage.initialize(shardPath(dbPath, k), SqliteStorage::OpenMode::READ_ONLY)) {
+            // The manifest is current, so a shard missing or older than it
+            // means the index is incomplete
+            failure = shard->storage.openFailure() == SqliteStorage::OpenFailure::ERROR
+                          ? SqliteStorage::OpenFailure::ERROR
+                          : SqliteStorage::OpenFailure::OUTDATED;
+            failureMessage = "Shard " + std::to_string(k) + " of " + dbPath +
+                             " is missing or damaged; run `devpilot index <project_path>` to rebuild it";
+            close();
+            return false;
+        }
+        Shard* own = shard.get();
+        shard->thread = std::thread([own]() {
+            std::function<void()> task;
+            while (own->tasks.pop(task)) {
+                task();
+            }
+        });
+        shards.push_back(std::move(shard));
+    }
+    return true;
+}
+
+void ShardedStorage::close() {
+    for (auto& shard : shards) {
+        shard->tasks.close();
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+        shard->storage.close();
+    }
+    shards.clear();
+    stamp = 0;
+}
+
+template <typename Result>
+std::vector<Result> ShardedStorage::fanOut(const std::function<Result(SqliteStorage&, QueryContext*)>& query,
+                                           QueryContext* context) {
+    std::vector<Result> results(shards.size());
+    if (shards.size() == 1) {
+        results[0] = query(shards[0]->storage, context);
+        return results;
+    }
+
+    // A context belongs to one thread, so each shard gets a copy
+    std::vector<QueryContext> contexts(shards.size(), context ? *context : QueryContext());
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t remaining = shards.size();
+    for (size_t i = 0; i < shards.size(); i++) {
+        shards[i]->tasks.push([&, i]() {
+            results[i] = query(shards[i]->storage, context ? &contexts[i] : nullptr);
+            std::lock_guard<std::mutex> lock(mutex);
+            remaining--;
+            finished.notify_one();
+        });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&]() { return remaining == 0; });
+
+    if (context) {
+        for (const auto& shardContext : contexts) {
+            context->truncated = context->truncated || shardContext.truncated;
+            if (shardContext.failed) {
+                context->fail(shardContext.error);
+            }
+        }
+    }
+    return results;
+}
+
+std::vector<Symbol> ShardedStorage::searchSymbols(const std::string& query, QueryContext* context) {
+    auto runs = fanOut<std::vector<Symbol>>(
+        [&query](SqliteStorage& storage, QueryContext* shardContext) {
+            return storage.searchSymbols(query, shardContext);
+        }, context);
+    bool qualified = query.find("::") != std::string::npos;
+    return mergeSorted(std::move(runs), qualified ? byQualifiedName : byName);
+}
+
+std::vector<std::vector<Symbol>> ShardedStorage::lookupSymbols(const std::vector<std::string>& names,
+                                                               QueryContext* context) {
+    auto runs = fanOut<std::vector<std::vector<Symbol>>>(
+        [&names](SqliteStorage& storage, QueryContext* shardContext) {
+            return storage.lookupSymbols(names, shardContext);
+        }, context);
+    if (runs.size() == 1) {
+        return std::move(runs[0]);
+    }
+    std::vector<std::vector<Symbol>> groups(names.size());
+    for (size_t group = 0; group < names.size(); group++) {
+        std::vector<std::vector<Symbol>> groupRuns;
+        for (auto& run : runs) {
+            groupRuns.push_back(std::move(run[group]));
+        }
+        groups[group] = mergeSorted(std::move(groupRuns), byQualifiedName);
+    }
+    return groups;
+}
+
+std::vector<std::vector<Symbol>> ShardedStorage::getSymbolsInFiles(const std::vector<std::string>& filePaths,
+                                                                   QueryContext* context) {
+    auto runs = fanOut<std::vector<std::vector<Symbol>>>(
+        [&filePaths](SqliteStorage& storage, QueryContext* shardContext) {
+            return storage.getSymbolsInFiles(filePaths, shardContext);
+        }, context);
+    if (runs.size() == 1) {
+        return std::move(runs[0]);
+    }
+    std::vector<std::vector<Symbol>> groups(filePaths.size());
+    for (size_t group = 0; group < filePaths.size(); group++) {
+        std::vector<std::vector<Symbol>> groupRuns;
+        for (auto& run : runs) {
+            groupRuns.push_back(std::move(run[group]));
+        }
+        groups[group] = mergeSorted(std::move(groupRuns), byLine);
+    }
+    return groups;
+}
+
+std::vector<std::string> ShardedStorage::getSymbolUsages(const std::string& symbolName,
+                                                         QueryContext* context) {
+    auto runs = fanOut<std::vector<std::string>>(
+        [&symbolName](SqliteStorage& storage, QueryContext* shardContext) {
+            return storage.getSymbolUsages(symbolName, shardContext);
+        }, context);
+    if (runs.size() == 1) {
+        return std::move(runs[0]);
+    }
+    auto usages = mergeSorted(std::move(runs), [](const std::string& a, const std::string& b) {
+        return usageKey(a) < usageKey(b);
+    });
+    removeDuplicates(usages);
+    return usages;
+}
+
+std::vector<std::string> ShardedStorage::getSymbolCallees(const std::string& symbolName,
+                                                          QueryContext* context) {
+    auto runs = fanOut<std::vector<std::string>>(
+        [&symbolName](SqliteStorage& storage, QueryContext* shardContext) {
+            return storage.getSymbolCallees(symbolName, shardContext);
+        }, context);
+    if (runs.size() == 1) {
+        return std::move(runs[0]);
+    }
+    auto callees = mergeSorted(std::move(runs), std::less<std::string>());
+    removeDuplicates(callees);
+    return callees;
+}
+
+std::vector<int64_t> ShardedStorage::findFiles(const std::string& filePath, QueryContext* context) {
+    auto runs = fanOut<std::vector<int64_t>>(
+        [&filePath](SqliteStorage& storage, QueryContext* shardContext) {
+            return storage.findFiles(filePath, shardContext);
+        }, context);
+    return mergeSorted(std::move(runs), std::less<int64_t>());
+}
+
+std::string ShardedStorage::getFilePath(int64_t fileId) {
+    return shards.empty() ? std::string() : owner(fileId).getFilePath(fileId);
+}
+
+std::vector<std::string> ShardedStorage::getTransitiveDependents(int64_t fileId, QueryContext* context) {
+    if (shards.size() <= 1) {
+        return shards.empty() ? std::vector<std::string>()
+                              : shards[0]->storage.getTransitiveDependents(fileId, context);
+    }
+    // Dependents may sit in any shard; their paths come from the shard that owns each
+    std::vector<std::string> results;
+    for (uint32_t dependentId : owner(fileId).getTransitiveDependentIds(fileId, context)) {
+        if (shouldStopEvery(context, results.size())) {
+            break;
+        }
+        results.push_back(owner(dependentId).getFilePath(dependentId));
+    }
+    return results;
+}
+
+std::vector<SymbolReference> ShardedStorage::getReferences(const std::string& name, QueryContext* context) {
+    auto runs = fanOut<std::vector<SymbolReference>>(
+        [&name](SqliteStorage& storage, QueryContext* shardContext) {
+            return storage.getReferences(name, shardContext);
+        }, context);
+    if (runs.size() == 1) {
+        return std::move(runs[0]);
+    }
+    // Every shard's run is sorted by path, line and column, as one database's is
+    auto before = [](const SymbolReference& a, const SymbolReference& b) {
+        return std::tie(a.file_path, a.line_number, a.column_number) <
+               std::tie(b.file_path, b.line_number, b.column_number);
+    };
+    std::vector<SymbolReference> references;
+    for (auto& run : runs) {
+        size_t middle = references.size();
+        std::move(run.begin(), run.end(), std::back_inserter(references));
+        std::inplace_merge(references.begin(), references.begin() + middle, references.end(), before);
+    }
+    return references;
+}
+
+bool ShardedStorage::scanSymbols(const std::function<void(int64_t id, const Symbol& symbol)>& onSymbol) {
+    unsigned count = shardCount();
+    for (unsigned k = 0; k < count; k++) {
+        bool scanned = shards[k]->storage.scanSymbols([&](int64_t id, const Symbol& symbol) {
+            onSymbol(globalShardId(id, k, count), symbol);
+        });
+        if (!scanned) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ShardedStorage::getSymbol(int64_t id, Symbol& symbol) {
+    return !shards.empty() && owner(id).getSymbol(localShardId(id, shardCount()), symbol);
+}
+
+} // namespace devpilot
@@ -0,0 +1,151 @@
+#include "source_snippet.hpp"
+#include "content_hash.hpp"
+#include "lexer.hpp"
+#include <fstream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace devpilot {
+
+// Single responsibility: Only read indexed declarations back from source files
+
+SnippetReader::~SnippetReader() {
+#if defined(__unix__) || defined(__APPLE__)
+    for (auto& entry : files) {
+        if (entry.second.mapped) {
+            munmap(const_cast<char*>(entry.second.data), entry.second.size);
+        }
+    }
+#endif
+}
+
+const SnippetReader::MappedFile& SnippetReader::open(const std::string& path) {
+    auto found = files.find(path);
+    if (found != files.end()) {
+        return found->second;
+    }
+    MappedFile& file = files[path];
+
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return file;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return file;
+    }
+    if (info.st_size > 0) {
+        void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            file.data = static_cast<const char*>(data);
+            file.size = static_cast<size_t>(info.st_size);
+            file.mapped = true;
+        }
+    }
+    ::close(fd);
+    if (!file.mapped && info.st_size > 0) {
+        return file;
+    }
+#else
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream.is_open()) {
+        return file;
+    }
+    std::ostringstream contents;
+    contents << stream.rdbuf();
+    file.contents = contents.str();
+    file.data = file.contents.data();
+    file.size = file.contents.size();
+#endif
+
+    file.hash = hashContent(file.data, file.size);
+    file.status = SnippetStatus::OK;
+    return file;
+}
+
+SnippetStatus SnippetReader::text(const Symbol& symbol, std::string_view& text) {
+    const MappedFile& file = open(symbol.file_path);
+    if (file.status != SnippetStatus::OK) {
+        return file.status;
+    }
+    // Offsets only mean something in the exact bytes they were taken from
+    if (file.hash != symbol.file_hash || symbol.end_offset > file.size ||
+        symbol.start_offset > symbol.end_offset) {
+        return SnippetStatus::STALE;
+    }
+    text = std::string_view(file.data + symbol.start_offset, symbol.end_offset - symbol.start_offset);
+    return SnippetStatus::OK;
+}
+
+SnippetStatus SnippetReader::signature(const Symbol& symbol, std::string& signature) {
+    std::string_view declaration;
+    SnippetStatus status = text(symbol, declaration);
+    if (status == SnippetStatus::OK) {
+        signature = signatureOf(symbol.type, declaration);
+    }
+    return status;
+}
+
+std::string signatureOf(SymbolType type, std::string_view declaration) {
+    // A function's signature also ends at "= 0", "= default" or a member-init
+    // list once its parameter list has closed; a variable's at its initializer.
+    // Tokens are rejoined with single spaces, which drops comments and
+    // directives; an #else or #elif ends it, as only the first branch was parsed.
+    bool isFunction = type == SymbolType::FUNCTION;
+    std::string signature;
+    size_t previousEnd = 0;
+    int parenDepth = 0;
+    bool paramsClosed = false;
+    bool inOperatorName = false;  // "operator=" and "operator()" are names, not cut points
+    std::string_view operatorPart;  // Last token of the operator's spelling so far
+    CppLexer lexer(declaration);
+    for (Token token = lexer.next(); token.kind != TokenKind::END; token = lexer.next()) {
+        std::string_view text = token.text;
+        if (token.kind == TokenKind::PREPROCESSOR) {
+            size_t name = text.find_first_not_of("# \t");
+            if (name != std::string_view::npos &&
+                (text.compare(name, 4, "else") == 0 || text.compare(name, 4, "elif") == 0)) {
+                break;
+            }
+            continue;
+        }
+        bool endsOperator = text == "(" || text == ")" || text == ";" || text == "{";
+        if (inOperatorName && (operatorPart.empty() || (operatorPart == "(" && text == ")") ||
+                               !endsOperator)) {
+            operatorPart = text;
+        } else if (token.kind == TokenKind::IDENTIFIER && text == "operator") {
+            inOperatorName = true;
+            operatorPart = std::string_view();
+        } else if (token.kind == TokenKind::PUNCTUATION) {
+            inOperatorName = false;
+            if (text == "(") {
+                if (parenDepth++ == 0) {
+                    paramsClosed = false;
+                }
+            } else if (text == ")" && parenDepth > 0) {
+                paramsClosed = --parenDepth == 0;
+            } else if (parenDepth == 0 &&
+                       (text == "{" || text == ";" ||
+                        (text == "=" && (type == SymbolType::VARIABLE || (isFunction && paramsClosed))) ||
+                        (text == ":" && isFunction && paramsClosed))) {
+                break;
+            }
+        }
+        if (!signature.empty() && token.offset > previousEnd) {
+            signature.push_back(' ');
+        }
+        signature.append(text);
+        previousEnd = token.offset + text.size();
+    }
+    return signature;
+}
+
+} // namespace devpilot
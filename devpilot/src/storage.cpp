@@ -1,40 +1,221 @@
 #include "storage.hpp"
-#include <iostream>
+#include "compressed_bitset.hpp"
+#include "logger.hpp"
+#include "occurrence_index.hpp"
+#include "parser.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <unordered_map>
 #include <sqlite3.h>
 
 namespace devpilot {
 
 // Single responsibility: Only handle SQLite database operations
 
+namespace {
+
+// Views are not NUL-terminated and an empty one may have no data pointer,
+// which SQLite would store as NULL
+void bindText(sqlite3_stmt* stmt, int index, std::string_view text) {
+    sqlite3_bind_text(stmt, index, text.empty() ? "" : text.data(), static_cast<int>(text.size()),
+                      SQLITE_STATIC);
+}
+
+std::string_view columnText(sqlite3_stmt* stmt, int column) {
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+    return text ? std::string_view(text, static_cast<size_t>(sqlite3_column_bytes(stmt, column)))
+                : std::string_view();
+}
+
+// Runs one INSERT, counting the row for --stats
+bool stepInsert(sqlite3_stmt* stmt) {
+    bool inserted = sqlite3_step(stmt) == SQLITE_DONE;
+    if (inserted) {
+        trace::count(trace::Counter::ROWS_WRITTEN);
+    }
+    return inserted;
+}
+
+// What createSymbolFromRow() reads, in order. The content hash of the
+// symbol's file comes along so its text can be checked against the file.
+const std::string kSymbolColumns =
+    "name, type, file_path, line_number, column_number, start_offset, end_offset, parent_scope, "
+    "qualified_name, (SELECT content_hash FROM files WHERE files.path = symbols.file_path), "
+    "param_count, required_param_count";
+
+// SQLite runs the progress handler every this many virtual machine steps,
+// roughly every few microseconds of query work
+constexpr int kProgressInterval = 1000;
+
+// Puts a query under its context for the guard's lifetime: once the context
+// says stop, the handler makes the running statement fail with SQLITE_INTERRUPT,
+// which ends the caller's step loop with the rows it already has. Queries do
+// not nest on a connection, so there is no previous handler to restore.
+class ProgressGuard {
+public:
+    ProgressGuard(sqlite3* db, QueryContext* context) : db(context ? db : nullptr) {
+        if (this->db) {
+            sqlite3_progress_handler(this->db, kProgressInterval, onProgress, context);
+        }
+    }
+    ~ProgressGuard() {
+        if (db) {
+            sqlite3_progress_handler(db, 0, nullptr, nullptr);
+        }
+    }
+    ProgressGuard(const ProgressGuard&) = delete;
+    ProgressGuard& operator=(const ProgressGuard&) = delete;
+
+private:
+    static int onProgress(void* context) {
+        return static_cast<QueryContext*>(context)->shouldStop() ? 1 : 0;
+    }
+    
+    sqlite3* db;
+};
+
+// A cached statement for one use, reset again when it goes out of scope so
+// it never holds a read transaction open between calls
+class StatementUse {
+public:
+    explicit StatementUse(sqlite3_stmt* stmt) : stmt(stmt) {}
+    ~StatementUse() {
+        if (stmt) {
+            sqlite3_reset(stmt);
+        }
+    }
+    StatementUse(const StatementUse&) = delete;
+    StatementUse& operator=(const StatementUse&) = delete;
+
+    operator sqlite3_stmt*() const { return stmt; }
+
+private:
+    sqlite3_stmt* stmt;
+};
+
+// Query connections map up to this much of the database instead of copying
+// pages through SQLite's cache
+constexpr int64_t kMmapBytes = 1ll << 30;
+
+// How long a connection waits for another's lock before SQLITE_BUSY: with
+// WAL only writers wait on each other, and readers only during recovery
+constexpr int kBusyTimeoutMs = 5000;
+
+} // namespace
+
 SqliteStorage::SqliteStorage() 
-    : db(nullptr), initialized(false), insertSymbolStmt(nullptr),
-      searchSymbolStmt(nullptr), getSymbolsInFileStmt(nullptr),
-      insertCallStmt(nullptr), getUsagesStmt(nullptr) {
+    : db(nullptr), initialized(false), readOnly(false) {
+    statements.fill(nullptr);
 }
 
 SqliteStorage::~SqliteStorage() {
     close();
 }
 
-bool SqliteStorage::initialize(const std::string& dbPath) {
+bool SqliteStorage::initialize(const std::string& dbPath, OpenMode mode) {
     if (initialized) {
         return true;
     }
     
+    failure = OpenFailure::NONE;
+    failureMessage.clear();
+    
+    // A reader takes the database as it is: SQLITE_OPEN_READONLY never
+    // creates the file, and nothing here writes to it. A database another
+    // process is busy writing is opened too; its schema cannot be checked
+    // until that commits.
+    if (mode == OpenMode::READ_ONLY) {
+        if (sqlite3_open_v2(dbPath.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+            sqlite3_close(db);
+            db = nullptr;
+            return failOpen(OpenFailure::NO_INDEX, dbPath);
+        }
+        sqlite3_busy_timeout(db, kBusyTimeoutMs);
+        int version = schemaVersion();
+        bool busy = version < 0 && (sqlite3_errcode(db) == SQLITE_BUSY ||
+                                    sqlite3_errcode(db) == SQLITE_LOCKED);
+        if (!busy && version < kSchemaVersion) {
+            // user_version 0 is a database nothing was ever indexed into
+            std::string detail = version < 0 ? sqlite3_errmsg(db) : "";
+            sqlite3_close(db);
+            db = nullptr;
+            return failOpen(version == 0 ? OpenFailure::NO_INDEX
+                            : version < 0 ? OpenFailure::ERROR : OpenFailure::OUTDATED,
+                            dbPath, detail);
+        }
+        if (version > kSchemaVersion) {
+            logging::warning("Database ", dbPath, " was written by a newer devpilot (schema ", version, ")");
+        }
+        readOnly = true;
+        executeSql(("PRAGMA mmap_size = " + std::to_string(kMmapBytes)).c_str(), "initialize");
+        initialized = true;
+        logging::debug("Database opened read-only", busy ? " while busy: " : ": ", dbPath);
+        return true;
+    }
+    
     int result = sqlite3_open(dbPath.c_str(), &db);
     if (result != SQLITE_OK) {
-        std::cerr << "Cannot open database: " << sqlite3_errmsg(db) << std::endl;
+        logging::error("Cannot open database: ", sqlite3_errmsg(db));
+        failure = OpenFailure::ERROR;
+        failureMessage = "Cannot open database " + dbPath + ": " + sqlite3_errmsg(db);
+        sqlite3_close(db);
+        db = nullptr;
         return false;
     }
+    sqlite3_busy_timeout(db, kBusyTimeoutMs);
+    
+    // The mode is stored in the database, so every later connection reads
+    // from the last commit while a writer's transaction is open
+    sqlite3_stmt* journal = prepareStatement("PRAGMA journal_mode = WAL");
+    if (!journal || sqlite3_step(journal) != SQLITE_ROW ||
+        std::string(reinterpret_cast<const char*>(sqlite3_column_text(journal, 0))) != "wal") {
+        logging::warning("Database ", dbPath, " is not in WAL mode; queries wait for indexing");
+    }
+    sqlite3_finalize(journal);
     
-    createTables();
-    prepareStatements();
+    int version = schemaVersion();
+    if (version < kSchemaVersion) {
+        createTables();
+        executeSql(("PRAGMA user_version = " + std::to_string(kSchemaVersion)).c_str(), "initialize");
+    } else if (version > kSchemaVersion) {
+        logging::warning("Database ", dbPath, " was written by a newer devpilot (schema ", version, ")");
+    }
     initialized = true;
     
-    std::cout << "Database initialized: " << dbPath << std::endl;
+    logging::debug("Database initialized: ", dbPath);
     return true;
 }
 
+bool SqliteStorage::failOpen(OpenFailure reason, const std::string& dbPath, const std::string& detail) {
+    failure = reason;
+    switch (reason) {
+    case OpenFailure::NO_INDEX:
+        failureMessage = "No index at " + dbPath + "; run `devpilot index <project_path>` first";
+        break;
+    case OpenFailure::OUTDATED:
+        failureMessage = "The index at " + dbPath + " was written by an older devpilot and needs "
+                         "re-indexing; run `devpilot index <project_path>`";
+        break;
+    default:
+        failureMessage = "Cannot read index " + dbPath + (detail.empty() ? "" : ": " + detail) +
+                         "; run `devpilot index <project_path>` to rebuild it";
+        break;
+    }
+    return false;
+}
+
+int SqliteStorage::schemaVersion() {
+    sqlite3_stmt* stmt = prepareStatement("PRAGMA user_version");
+    int version = -1;
+    if (stmt && sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return version;
+}
+
 void SqliteStorage::close() {
     if (!initialized) {
         return;
@@ -48,6 +229,7 @@ void SqliteStorage::close() {
     }
     
     initialized = false;
+    readOnly = false;
 }
 
 bool SqliteStorage::isInitialized() const {
@@ -63,189 +245,676 @@ void SqliteStorage::createTables() {
             file_path TEXT NOT NULL,
             line_number INTEGER NOT NULL,
             column_number INTEGER NOT NULL,
-            signature TEXT,
-            parent_scope TEXT
+            start_offset INTEGER NOT NULL DEFAULT 0,
+            end_offset INTEGER NOT NULL DEFAULT 0,
+            parent_scope TEXT,
+            qualified_name TEXT,
+            param_count INTEGER NOT NULL DEFAULT -1,
+            required_param_count INTEGER NOT NULL DEFAULT -1
         );
         CREATE INDEX IF NOT EXISTS idx_symbol_name ON symbols(name);
         CREATE INDEX IF NOT EXISTS idx_symbol_file ON symbols(file_path);
     )";
     
+    // Resolved calls are pairs of symbol ids; names that matched no indexed
+    // function are kept apart so they never pollute usage queries. The call
+    // sites they were resolved from are kept too, for resolving again when
+    // other files change.
     const char* createCallsTable = R"(
-        CREATE TABLE IF NOT EXISTS call_relationships (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            caller_name TEXT NOT NULL,
+        DROP TABLE IF EXISTS call_relationships;
+        CREATE TABLE IF NOT EXISTS call_edges (
+            caller_id INTEGER NOT NULL,
+            callee_id INTEGER NOT NULL,
+            file_id INTEGER NOT NULL,
+            line INTEGER NOT NULL
+        );
+        CREATE INDEX IF NOT EXISTS idx_call_caller ON call_edges(caller_id);
+        CREATE INDEX IF NOT EXISTS idx_call_callee ON call_edges(callee_id);
+        CREATE TABLE IF NOT EXISTS unresolved_calls (
+            caller_id INTEGER NOT NULL,
             callee_name TEXT NOT NULL,
-            call_file TEXT NOT NULL,
-            call_line INTEGER NOT NULL
+            file_id INTEGER NOT NULL,
+            line INTEGER NOT NULL
+        );
+        CREATE INDEX IF NOT EXISTS idx_unresolved_callee ON unresolved_calls(callee_name);
+        CREATE TABLE IF NOT EXISTS remote_calls (
+            symbol_id INTEGER NOT NULL,
+            outgoing INTEGER NOT NULL,
+            remote_name TEXT NOT NULL,
+            file_path TEXT NOT NULL,
+            line INTEGER NOT NULL
         );
-        CREATE INDEX IF NOT EXISTS idx_caller ON call_relationships(caller_name);
-        CREATE INDEX IF NOT EXISTS idx_callee ON call_relationships(callee_name);
+        CREATE INDEX IF NOT EXISTS idx_remote_symbol ON remote_calls(symbol_id);
+        CREATE TABLE IF NOT EXISTS call_sites (
+            caller_id INTEGER NOT NULL,
+            file_id INTEGER NOT NULL,
+            callee_name TEXT NOT NULL,
+            qualifier TEXT NOT NULL,
+            is_member INTEGER NOT NULL,
+            arg_count INTEGER NOT NULL,
+            line INTEGER NOT NULL,
+            column_number INTEGER NOT NULL
+        );
+        CREATE INDEX IF NOT EXISTS idx_call_site_file ON call_sites(file_id);
+    )";
+    
+    const char* createFilesTables = R"(
+        CREATE TABLE IF NOT EXISTS files (
+            id INTEGER PRIMARY KEY,
+            path TEXT NOT NULL UNIQUE,
+            content_hash INTEGER NOT NULL DEFAULT 0,
+            blob_id TEXT NOT NULL DEFAULT ''
+        );
+        CREATE TABLE IF NOT EXISTS include_edges (
+            includer_id INTEGER NOT NULL,
+            included_id INTEGER NOT NULL,
+            line INTEGER NOT NULL
+        );
+        CREATE INDEX IF NOT EXISTS idx_include_includer ON include_edges(includer_id);
+        CREATE INDEX IF NOT EXISTS idx_include_included ON include_edges(included_id);
+        CREATE TABLE IF NOT EXISTS file_rdeps (
+            file_id INTEGER PRIMARY KEY,
+            dependents BLOB NOT NULL
+        );
+        CREATE TABLE IF NOT EXISTS include_directives (
+            file_id INTEGER NOT NULL,
+            spelling TEXT NOT NULL,
+            is_system INTEGER NOT NULL,
+            line INTEGER NOT NULL
+        );
+        CREATE INDEX IF NOT EXISTS idx_directive_file ON include_directives(file_id);
+    )";
+    
+    const char* createOccurrenceTables = R"(
+        CREATE TABLE IF NOT EXISTS identifiers (
+            id INTEGER PRIMARY KEY,
+            name TEXT NOT NULL UNIQUE
+        );
+        CREATE TABLE IF NOT EXISTS postings (
+            name_id INTEGER NOT NULL,
+            segment INTEGER NOT NULL,
+            occurrence_count INTEGER NOT NULL,
+            data BLOB NOT NULL,
+            PRIMARY KEY (name_id, segment)
+        ) WITHOUT ROWID;
+    )";
+    
+    const char* createMetadataTable = R"(
+        CREATE TABLE IF NOT EXISTS metadata (
+            key TEXT PRIMARY KEY,
+            value TEXT NOT NULL
+        ) WITHOUT ROWID;
+    )";
+    
+    // Model output is keyed by what was summarized, not where it lives, so
+    // it outlives re-indexing and is never cleared with the index
+    const char* createSummariesTable = R"(
+        CREATE TABLE IF NOT EXISTS summaries (
+            body_hash INTEGER NOT NULL,
+            backend TEXT NOT NULL,
+            summary TEXT NOT NULL,
+            PRIMARY KEY (body_hash, backend)
+        ) WITHOUT ROWID;
     )";
     
     char* errMsg = nullptr;
     int result = sqlite3_exec(db, createSymbolsTable, nullptr, nullptr, &errMsg);
     if (result != SQLITE_OK) {
-        std::cerr << "Error creating symbols table: " << errMsg << std::endl;
+        logging::error("Error creating symbols table: ", errMsg);
         sqlite3_free(errMsg);
         return;
     }
     
+    // Databases created before qualified names were tracked lack the column
+    if (!hasColumn("symbols", "qualified_name") &&
+        !executeSql("ALTER TABLE symbols ADD COLUMN qualified_name TEXT", "createTables")) {
+        return;
+    }
+    if (!executeSql("CREATE INDEX IF NOT EXISTS idx_symbol_qualified ON symbols(qualified_name)",
+                    "createTables")) {
+        return;
+    }
+    
+    // Signatures used to be stored as truncated text; symbols now keep the
+    // byte range of their declaration and read the text from the file
+    if (!hasColumn("symbols", "start_offset") &&
+        !executeSql("ALTER TABLE symbols ADD COLUMN start_offset INTEGER NOT NULL DEFAULT 0; "
+                    "ALTER TABLE symbols ADD COLUMN end_offset INTEGER NOT NULL DEFAULT 0",
+                    "createTables")) {
+        return;
+    }
+    // Older databases did not keep parameter counts; theirs read as unknown
+    // until the next index run rewrites the symbols
+    if (!hasColumn("symbols", "param_count") &&
+        !executeSql("ALTER TABLE symbols ADD COLUMN param_count INTEGER NOT NULL DEFAULT -1; "
+                    "ALTER TABLE symbols ADD COLUMN required_param_count INTEGER NOT NULL DEFAULT -1",
+                    "createTables")) {
+        return;
+    }
+    if (hasColumn("symbols", "signature") && sqlite3_libversion_number() >= 3035000 &&
+        !executeSql("ALTER TABLE symbols DROP COLUMN signature", "createTables")) {
+        return;
+    }
+    
     result = sqlite3_exec(db, createCallsTable, nullptr, nullptr, &errMsg);
     if (result != SQLITE_OK) {
-        std::cerr << "Error creating calls table: " << errMsg << std::endl;
+        logging::error("Error creating calls table: ", errMsg);
+        sqlite3_free(errMsg);
+        return;
+    }
+    
+    result = sqlite3_exec(db, createFilesTables, nullptr, nullptr, &errMsg);
+    if (result != SQLITE_OK) {
+        logging::error("Error creating files tables: ", errMsg);
+        sqlite3_free(errMsg);
+        return;
+    }
+    if (!hasColumn("files", "content_hash") &&
+        !executeSql("ALTER TABLE files ADD COLUMN content_hash INTEGER NOT NULL DEFAULT 0",
+                    "createTables")) {
+        return;
+    }
+    if (!hasColumn("files", "blob_id") &&
+        !executeSql("ALTER TABLE files ADD COLUMN blob_id TEXT NOT NULL DEFAULT ''", "createTables")) {
+        return;
+    }
+    
+    result = sqlite3_exec(db, createOccurrenceTables, nullptr, nullptr, &errMsg);
+    if (result != SQLITE_OK) {
+        logging::error("Error creating occurrence tables: ", errMsg);
+        sqlite3_free(errMsg);
+        return;
+    }
+    
+    result = sqlite3_exec(db, createMetadataTable, nullptr, nullptr, &errMsg);
+    if (result != SQLITE_OK) {
+        logging::error("Error creating metadata table: ", errMsg);
+        sqlite3_free(errMsg);
+        return;
+    }
+    
+    result = sqlite3_exec(db, createSummariesTable, nullptr, nullptr, &errMsg);
+    if (result != SQLITE_OK) {
+        logging::error("Error creating summaries table: ", errMsg);
         sqlite3_free(errMsg);
         return;
     }
+    
 }
 
-void SqliteStorage::prepareStatements() {
-    insertSymbolStmt = prepareStatement(
-        "INSERT INTO symbols (name, type, file_path, line_number, column_number, signature, parent_scope) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?)"
-    );
+std::string SqliteStorage::statementSql(Statement which) {
+    // ?1 is the query as typed, ?2 its last component: the name index picks the
+    // candidate symbols, then the edges are read back through the id indexes.
+    // Calls from other shards come from remote_calls (empty when unsharded).
+    // A partial name must equal the tail of the qualified name after a "::";
+    // LIKE would read "_" as a wildcard and ignore ASCII case.
+    static const std::string candidates = "(SELECT id FROM symbols WHERE name = ?2 AND "
+        "(?1 = ?2 OR qualified_name = ?1 OR substr(qualified_name, -length(?1) - 2) = '::' || ?1))";
+    
+    switch (which) {
+    case Statement::INSERT_SYMBOL:
+        return "INSERT INTO symbols (name, type, file_path, line_number, column_number, start_offset, "
+               "end_offset, parent_scope, qualified_name, param_count, required_param_count) "
+               "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+    case Statement::SEARCH_SYMBOLS:
+        return "SELECT " + kSymbolColumns + " FROM symbols WHERE name LIKE ? ORDER BY name";
+    case Statement::SEARCH_QUALIFIED:
+        // Both arms are index probes: the full qualified name, or the last component
+        // plus a suffix filter for partially qualified queries like "Matrix::add"
+        return "SELECT " + kSymbolColumns + " FROM symbols WHERE qualified_name = ?1 "
+               "OR (name = ?2 AND substr(qualified_name, -length(?1) - 2) = '::' || ?1) "
+               "ORDER BY qualified_name, file_path";
+    case Statement::SYMBOLS_IN_FILE:
+        return "SELECT " + kSymbolColumns + " FROM symbols WHERE file_path = ? ORDER BY line_number";
+    case Statement::ALL_SYMBOLS:
+        return "SELECT " + kSymbolColumns + " FROM symbols ORDER BY name";
+    case Statement::SCAN_SYMBOLS:
+        return "SELECT " + kSymbolColumns + ", id FROM symbols ORDER BY id";
+    case Statement::GET_SYMBOL:
+        return "SELECT " + kSymbolColumns + " FROM symbols WHERE id = ?";
+    
+    // The batch forms of the two above. CROSS JOIN keeps the keys as the outer
+    // loop, so each key is one probe of the name or file index; the slot comes
+    // last so createSymbolFromRow() reads the row unchanged.
+    case Statement::INSERT_LOOKUP_KEY:
+        return "INSERT INTO temp.lookup_keys (slot, key, last_name) VALUES (?, ?, ?)";
+    case Statement::LOOKUP_SYMBOLS:
+        return "SELECT " + kSymbolColumns + ", lookup_keys.slot FROM temp.lookup_keys "
+               "CROSS JOIN symbols ON symbols.name = lookup_keys.last_name "
+               "WHERE lookup_keys.key = lookup_keys.last_name OR symbols.qualified_name = lookup_keys.key "
+               "OR substr(symbols.qualified_name, -length(lookup_keys.key) - 2) = '::' || lookup_keys.key "
+               "ORDER BY lookup_keys.slot, symbols.qualified_name, symbols.file_path";
+    case Statement::LOOKUP_FILES:
+        return "SELECT " + kSymbolColumns + ", lookup_keys.slot FROM temp.lookup_keys "
+               "CROSS JOIN symbols ON symbols.file_path = lookup_keys.key "
+               "ORDER BY lookup_keys.slot, symbols.line_number";
+    
+    case Statement::INSERT_CALL:
+        return "INSERT INTO call_edges (caller_id, callee_id, file_id, line) VALUES (?, ?, ?, ?)";
+    case Statement::INSERT_UNRESOLVED_CALL:
+        return "INSERT INTO unresolved_calls (caller_id, callee_name, file_id, line) VALUES (?, ?, ?, ?)";
+    case Statement::INSERT_REMOTE_CALL:
+        return "INSERT INTO remote_calls (symbol_id, outgoing, remote_name, file_path, line) "
+               "VALUES (?, ?, ?, ?, ?)";
+    case Statement::GET_USAGES:
+        return "SELECT COALESCE(caller.qualified_name, caller.name), files.path, call_edges.line "
+               "FROM call_edges JOIN symbols AS caller ON caller.id = call_edges.caller_id "
+               "JOIN files ON files.id = call_edges.file_id "
+               "WHERE call_edges.callee_id IN " + candidates + " "
+               "UNION SELECT remote_name, file_path, line FROM remote_calls "
+               "WHERE outgoing = 0 AND symbol_id IN " + candidates + " "
+               "ORDER BY 1, 2, 3";
+    case Statement::GET_CALLEES:
+        return "SELECT COALESCE(callee.qualified_name, callee.name) "
+               "FROM call_edges JOIN symbols AS callee ON callee.id = call_edges.callee_id "
+               "WHERE call_edges.caller_id IN " + candidates + " "
+               "UNION SELECT remote_name FROM remote_calls "
+               "WHERE outgoing = 1 AND symbol_id IN " + candidates + " "
+               "ORDER BY 1";
+    
+    case Statement::INSERT_FILE:
+        return "INSERT INTO files (id, path, content_hash, blob_id) VALUES (?, ?, ?, ?)";
+    case Statement::SET_FILE_BLOB:
+        return "UPDATE files SET blob_id = ? WHERE id = ?";
+    case Statement::INSERT_INCLUDE:
+        return "INSERT INTO include_edges (includer_id, included_id, line) VALUES (?, ?, ?)";
+    case Statement::INSERT_RDEPS:
+        return "INSERT OR REPLACE INTO file_rdeps (file_id, dependents) VALUES (?, ?)";
+    case Statement::FIND_FILES:
+        // Exact path first, then any indexed file ending in "/<filePath>",
+        // compared exactly like partial names above
+        return "SELECT id FROM files WHERE path = ?1 "
+               "UNION SELECT id FROM files WHERE substr(path, -length(?1) - 1) = '/' || ?1 ORDER BY 1";
+    case Statement::GET_FILE_PATH:
+        return "SELECT path FROM files WHERE id = ?";
+    case Statement::GET_DEPENDENTS:
+        // Reachability is precomputed at index time, so this is one row fetch
+        return "SELECT dependents FROM file_rdeps WHERE file_id = ?";
+    case Statement::SCAN_FILES:
+        return "SELECT id, path, content_hash, blob_id FROM files";
     
-    searchSymbolStmt = prepareStatement(
-        "SELECT name, type, file_path, line_number, column_number, signature, parent_scope "
-        "FROM symbols WHERE name LIKE ? ORDER BY name"
-    );
+    case Statement::INSERT_IDENTIFIER:
+        return "INSERT OR IGNORE INTO identifiers (id, name) VALUES (?, ?)";
+    case Statement::INSERT_POSTINGS:
+        return "INSERT INTO postings (name_id, segment, occurrence_count, data) VALUES (?, ?, ?, ?)";
+    case Statement::GET_POSTINGS:
+        return "SELECT p.data FROM identifiers i JOIN postings p ON p.name_id = i.id "
+               "WHERE i.name = ? ORDER BY p.segment";
+    case Statement::SCAN_IDENTIFIERS:
+        return "SELECT id, name FROM identifiers ORDER BY id";
+    case Statement::NEXT_SEGMENT:
+        return "SELECT COALESCE(MAX(segment) + 1, 0) FROM postings";
     
-    getSymbolsInFileStmt = prepareStatement(
-        "SELECT name, type, file_path, line_number, column_number, signature, parent_scope "
-        "FROM symbols WHERE file_path = ? ORDER BY line_number"
-    );
+    case Statement::INSERT_DIRECTIVE:
+        return "INSERT INTO include_directives (file_id, spelling, is_system, line) VALUES (?, ?, ?, ?)";
+    case Statement::INSERT_CALL_SITE:
+        return "INSERT INTO call_sites (caller_id, file_id, callee_name, qualifier, is_member, arg_count, "
+               "line, column_number) VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
+    case Statement::SCAN_DIRECTIVES:
+        return "SELECT file_id, spelling, is_system, line FROM include_directives";
+    case Statement::SCAN_CALL_SITES:
+        return "SELECT caller_id, file_id, callee_name, qualifier, is_member, arg_count, line, "
+               "column_number FROM call_sites";
+    case Statement::DELETE_FILE:
+        return "DELETE FROM files WHERE id = ?";
+    case Statement::DELETE_FILE_SYMBOLS:
+        return "DELETE FROM symbols WHERE file_path = ?";
+    case Statement::DELETE_FILE_DIRECTIVES:
+        return "DELETE FROM include_directives WHERE file_id = ?";
+    case Statement::DELETE_FILE_CALL_SITES:
+        return "DELETE FROM call_sites WHERE file_id = ?";
     
-    insertCallStmt = prepareStatement(
-        "INSERT INTO call_relationships (caller_name, callee_name, call_file, call_line) "
-        "VALUES (?, ?, ?, ?)"
-    );
+    case Statement::SET_METADATA:
+        return "INSERT OR REPLACE INTO metadata (key, value) VALUES (?, ?)";
+    case Statement::GET_METADATA:
+        return "SELECT value FROM metadata WHERE key = ?";
     
-    getUsagesStmt = prepareStatement(
-        "SELECT DISTINCT caller_name, call_file, call_line FROM call_relationships "
-        "WHERE callee_name = ? ORDER BY caller_name"
-    );
+    case Statement::GET_SUMMARY:
+        return "SELECT summary FROM summaries WHERE body_hash = ? AND backend = ?";
+    case Statement::SET_SUMMARY:
+        return "INSERT OR REPLACE INTO summaries (body_hash, backend, summary) VALUES (?, ?, ?)";
+    
+    case Statement::COUNT:
+        break;
+    }
+    return std::string();
+}
+
+sqlite3_stmt* SqliteStorage::statement(Statement which) {
+    if (!initialized) {
+        return nullptr;
+    }
+    sqlite3_stmt*& cached = statements[static_cast<size_t>(which)];
+    if (!cached) {
+        cached = prepareStatement(statementSql(which));
+    } else {
+        sqlite3_reset(cached);
+    }
+    return cached;
 }
 
 void SqliteStorage::cleanupStatements() {
-    if (insertSymbolStmt) { sqlite3_finalize(insertSymbolStmt); insertSymbolStmt = nullptr; }
-    if (searchSymbolStmt) { sqlite3_finalize(searchSymbolStmt); searchSymbolStmt = nullptr; }
-    if (getSymbolsInFileStmt) { sqlite3_finalize(getSymbolsInFileStmt); getSymbolsInFileStmt = nullptr; }
-    if (insertCallStmt) { sqlite3_finalize(insertCallStmt); insertCallStmt = nullptr; }
-    if (getUsagesStmt) { sqlite3_finalize(getUsagesStmt); getUsagesStmt = nullptr; }
+    for (auto& stmt : statements) {
+        if (stmt) {
+            sqlite3_finalize(stmt);
+            stmt = nullptr;
+        }
+    }
 }
 
 sqlite3_stmt* SqliteStorage::prepareStatement(const std::string& sql) {
     sqlite3_stmt* stmt = nullptr;
     int result = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
     if (result != SQLITE_OK) {
-        std::cerr << "Error preparing statement: " << sqlite3_errmsg(db) << std::endl;
+        logging::error("Error preparing statement: ", sqlite3_errmsg(db));
         return nullptr;
     }
     return stmt;
 }
 
-bool SqliteStorage::storeSymbol(const Symbol& symbol) {
-    if (!initialized || !insertSymbolStmt) {
-        return false;
+int64_t SqliteStorage::storeSymbol(const SymbolRecord& symbol) {
+    StatementUse insertSymbolStmt(statement(Statement::INSERT_SYMBOL));
+    if (!insertSymbolStmt) {
+        return 0;
     }
     
-    sqlite3_reset(insertSymbolStmt);
     
-    sqlite3_bind_text(insertSymbolStmt, 1, symbol.name.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(insertSymbolStmt, 2, symbolTypeToString(symbol.type).c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(insertSymbolStmt, 3, symbol.file_path.c_str(), -1, SQLITE_STATIC);
+    bindText(insertSymbolStmt, 1, symbol.name);
+    sqlite3_bind_text(insertSymbolStmt, 2, symbolTypeToString(symbol.type).c_str(), -1, SQLITE_TRANSIENT);
+    bindText(insertSymbolStmt, 3, symbol.file_path);
     sqlite3_bind_int(insertSymbolStmt, 4, symbol.line_number);
     sqlite3_bind_int(insertSymbolStmt, 5, symbol.column_number);
-    sqlite3_bind_text(insertSymbolStmt, 6, symbol.signature.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(insertSymbolStmt, 7, symbol.parent_scope.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(insertSymbolStmt, 6, static_cast<int64_t>(symbol.start_offset));
+    sqlite3_bind_int64(insertSymbolStmt, 7, static_cast<int64_t>(symbol.end_offset));
+    bindText(insertSymbolStmt, 8, symbol.parent_scope);
+    bindText(insertSymbolStmt, 9, symbol.qualified_name);
+    sqlite3_bind_int(insertSymbolStmt, 10, symbol.param_count);
+    sqlite3_bind_int(insertSymbolStmt, 11, symbol.required_param_count);
     
-    int result = sqlite3_step(insertSymbolStmt);
-    return result == SQLITE_DONE;
+    if (!stepInsert(insertSymbolStmt)) {
+        logError("storeSymbol");
+        return 0;
+    }
+    return sqlite3_last_insert_rowid(db);
 }
 
-std::vector<Symbol> SqliteStorage::searchSymbols(const std::string& query) {
+std::vector<Symbol> SqliteStorage::searchSymbols(const std::string& query, QueryContext* context) {
     std::vector<Symbol> results;
     
-    if (!initialized || !searchSymbolStmt) {
+    if (!initialized) {
         return results;
     }
+    ProgressGuard progress(db, context);
     
-    sqlite3_reset(searchSymbolStmt);
+    // "ns::Class::method" is resolved through the qualified-name index, not a LIKE scan
+    size_t separator = query.rfind("::");
+    if (separator != std::string::npos) {
+        StatementUse searchQualifiedStmt(statement(Statement::SEARCH_QUALIFIED));
+        if (!searchQualifiedStmt) {
+            finishQuery(SQLITE_ERROR, context, "searchSymbols");
+            return results;
+        }
+        std::string qualified = query.compare(0, 2, "::") == 0 ? query.substr(2) : query;
+        std::string lastComponent = query.substr(separator + 2);
+        
+        sqlite3_bind_text(searchQualifiedStmt, 1, qualified.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(searchQualifiedStmt, 2, lastComponent.c_str(), -1, SQLITE_STATIC);
+        
+        int result;
+        while ((result = sqlite3_step(searchQualifiedStmt)) == SQLITE_ROW) {
+            results.push_back(createSymbolFromRow(searchQualifiedStmt));
+        }
+        finishQuery(result, context, "searchSymbols");
+        return results;
+    }
+    
+    StatementUse searchSymbolStmt(statement(Statement::SEARCH_SYMBOLS));
+    if (!searchSymbolStmt) {
+        finishQuery(SQLITE_ERROR, context, "searchSymbols");
+        return results;
+    }
     std::string searchPattern = "%" + query + "%";
     sqlite3_bind_text(searchSymbolStmt, 1, searchPattern.c_str(), -1, SQLITE_STATIC);
     
-    while (sqlite3_step(searchSymbolStmt) == SQLITE_ROW) {
+    int result;
+    while ((result = sqlite3_step(searchSymbolStmt)) == SQLITE_ROW) {
         results.push_back(createSymbolFromRow(searchSymbolStmt));
     }
+    finishQuery(result, context, "searchSymbols");
     
     return results;
 }
 
-std::vector<Symbol> SqliteStorage::getSymbolsInFile(const std::string& filePath) {
+std::vector<Symbol> SqliteStorage::getSymbolsInFile(const std::string& filePath, QueryContext* context) {
     std::vector<Symbol> results;
     
-    if (!initialized || !getSymbolsInFileStmt) {
+    StatementUse getSymbolsInFileStmt(statement(Statement::SYMBOLS_IN_FILE));
+    if (!getSymbolsInFileStmt) {
+        finishQuery(SQLITE_ERROR, context, "getSymbolsInFile");
         return results;
     }
+    ProgressGuard progress(db, context);
     
-    sqlite3_reset(getSymbolsInFileStmt);
     sqlite3_bind_text(getSymbolsInFileStmt, 1, filePath.c_str(), -1, SQLITE_STATIC);
     
-    while (sqlite3_step(getSymbolsInFileStmt) == SQLITE_ROW) {
+    int result;
+    while ((result = sqlite3_step(getSymbolsInFileStmt)) == SQLITE_ROW) {
         results.push_back(createSymbolFromRow(getSymbolsInFileStmt));
     }
+    finishQuery(result, context, "getSymbolsInFile");
     
     return results;
 }
 
-std::vector<Symbol> SqliteStorage::getAllSymbols() {
-    std::vector<Symbol> results;
+std::vector<std::vector<Symbol>> SqliteStorage::lookupSymbols(const std::vector<std::string>& names,
+                                                              QueryContext* context) {
+    return runBatchLookup(Statement::LOOKUP_SYMBOLS, names, true, context);
+}
+
+std::vector<std::vector<Symbol>> SqliteStorage::getSymbolsInFiles(const std::vector<std::string>& filePaths,
+                                                                  QueryContext* context) {
+    return runBatchLookup(Statement::LOOKUP_FILES, filePaths, false, context);
+}
+
+std::vector<std::vector<Symbol>> SqliteStorage::runBatchLookup(Statement which,
+                                                               const std::vector<std::string>& keys,
+                                                               bool qualifiedKeys,
+                                                               QueryContext* context) {
+    std::vector<std::vector<Symbol>> results(keys.size());
     
-    if (!initialized) {
+    // Keys of the batch lookup in progress; private to this connection, and
+    // writable even when the database itself is opened read-only
+    if (!initialized || keys.empty() ||
+        !executeSql("CREATE TEMP TABLE IF NOT EXISTS lookup_keys ("
+                    "slot INTEGER PRIMARY KEY, key TEXT NOT NULL, last_name TEXT NOT NULL)",
+                    "batchLookup")) {
+        if (initialized && !keys.empty()) {
+            finishQuery(SQLITE_ERROR, context, "batchLookup");
+        }
+        return results;
+    }
+    StatementUse query(statement(which));
+    sqlite3_stmt* insertLookupKeyStmt = statement(Statement::INSERT_LOOKUP_KEY);
+    if (!query || !insertLookupKeyStmt) {
+        finishQuery(SQLITE_ERROR, context, "batchLookup");
         return results;
     }
     
-    const char* sql = "SELECT name, type, file_path, line_number, column_number, signature, parent_scope FROM symbols ORDER BY name";
-    sqlite3_stmt* stmt = prepareStatement(sql);
+    // The keys only live inside this savepoint: rolling back to it empties
+    // the temp table without a DELETE, even within an indexing transaction
+    if (!executeSql("SAVEPOINT batch_lookup", "batchLookup")) {
+        finishQuery(SQLITE_ERROR, context, "batchLookup");
+        return results;
+    }
+    
+    // An editor pane repeats the same identifiers; each is looked up once
+    std::unordered_map<std::string_view, size_t> firstSlot;
+    std::vector<size_t> slotOf(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        std::string_view key = keys[i];
+        if (qualifiedKeys && key.compare(0, 2, "::") == 0) {
+            key.remove_prefix(2);
+        }
+        auto inserted = firstSlot.emplace(key, i);
+        slotOf[i] = inserted.first->second;
+        if (!inserted.second) {
+            continue;
+        }
+        
+        std::string_view lastName = key;
+        size_t separator = qualifiedKeys ? key.rfind("::") : std::string_view::npos;
+        if (separator != std::string_view::npos) {
+            lastName = key.substr(separator + 2);
+        }
+        sqlite3_reset(insertLookupKeyStmt);
+        sqlite3_bind_int64(insertLookupKeyStmt, 1, static_cast<sqlite3_int64>(i));
+        bindText(insertLookupKeyStmt, 2, key);
+        bindText(insertLookupKeyStmt, 3, lastName);
+        sqlite3_step(insertLookupKeyStmt);
+    }
+    
+    // Only the join is interruptible: an interrupted INSERT would roll back
+    // the whole enclosing transaction, not just this savepoint
+    if (!context || !context->shouldStop()) {
+        ProgressGuard progress(db, context);
+        int result;
+        while ((result = sqlite3_step(query)) == SQLITE_ROW) {
+            size_t slot = static_cast<size_t>(sqlite3_column_int64(query, 12));
+            if (slot < results.size()) {
+                results[slot].push_back(createSymbolFromRow(query));
+            }
+        }
+        finishQuery(result, context, "batchLookup");
+        sqlite3_reset(query);
+    }
+    sqlite3_reset(insertLookupKeyStmt);
+    
+    executeSql("ROLLBACK TO batch_lookup; RELEASE batch_lookup", "batchLookup");
     
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (slotOf[i] != i) {
+            results[i] = results[slotOf[i]];
+        }
+    }
+    
+    return results;
+}
+
+std::vector<Symbol> SqliteStorage::getAllSymbols(QueryContext* context) {
+    std::vector<Symbol> results;
+    
+    StatementUse stmt(statement(Statement::ALL_SYMBOLS));
     if (!stmt) {
+        finishQuery(SQLITE_ERROR, context, "getAllSymbols");
         return results;
     }
+    ProgressGuard progress(db, context);
     
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
+    int result;
+    while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
         results.push_back(createSymbolFromRow(stmt));
     }
+    finishQuery(result, context, "getAllSymbols");
     
-    sqlite3_finalize(stmt);
     return results;
 }
 
-bool SqliteStorage::storeCallRelationship(const std::string& caller, const std::string& callee,
-                                         const std::string& file, int line) {
-    if (!initialized || !insertCallStmt) {
+bool SqliteStorage::scanSymbols(const std::function<void(int64_t id, const Symbol& symbol)>& onSymbol) {
+    StatementUse stmt(statement(Statement::SCAN_SYMBOLS));
+    if (!stmt) {
+        return false;
+    }
+    
+    int result;
+    while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
+        onSymbol(sqlite3_column_int64(stmt, 12), createSymbolFromRow(stmt));
+    }
+    if (result != SQLITE_DONE) {
+        logError("scanSymbols");
+        return false;
+    }
+    return true;
+}
+
+bool SqliteStorage::getSymbol(int64_t id, Symbol& symbol) {
+    StatementUse stmt(statement(Statement::GET_SYMBOL));
+    if (!stmt) {
+        return false;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, id);
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
+        return false;
+    }
+    symbol = createSymbolFromRow(stmt);
+    return true;
+}
+
+bool SqliteStorage::storeCallEdge(int64_t callerId, int64_t calleeId, int64_t fileId, int line) {
+    StatementUse insertCallStmt(statement(Statement::INSERT_CALL));
+    if (!insertCallStmt) {
         return false;
     }
     
-    sqlite3_reset(insertCallStmt);
-    sqlite3_bind_text(insertCallStmt, 1, caller.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(insertCallStmt, 2, callee.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(insertCallStmt, 3, file.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(insertCallStmt, 1, callerId);
+    sqlite3_bind_int64(insertCallStmt, 2, calleeId);
+    sqlite3_bind_int64(insertCallStmt, 3, fileId);
     sqlite3_bind_int(insertCallStmt, 4, line);
     
-    int result = sqlite3_step(insertCallStmt);
-    return result == SQLITE_DONE;
+    return stepInsert(insertCallStmt);
+}
+
+bool SqliteStorage::storeUnresolvedCall(int64_t callerId, const std::string& calleeName,
+                                        int64_t fileId, int line) {
+    StatementUse insertUnresolvedCallStmt(statement(Statement::INSERT_UNRESOLVED_CALL));
+    if (!insertUnresolvedCallStmt) {
+        return false;
+    }
+    
+    sqlite3_bind_int64(insertUnresolvedCallStmt, 1, callerId);
+    sqlite3_bind_text(insertUnresolvedCallStmt, 2, calleeName.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(insertUnresolvedCallStmt, 3, fileId);
+    sqlite3_bind_int(insertUnresolvedCallStmt, 4, line);
+    
+    return stepInsert(insertUnresolvedCallStmt);
+}
+
+bool SqliteStorage::storeRemoteCall(int64_t symbolId, bool outgoing, const std::string& remoteName,
+                                    const std::string& filePath, int line) {
+    StatementUse insertRemoteCallStmt(statement(Statement::INSERT_REMOTE_CALL));
+    if (!insertRemoteCallStmt) {
+        return false;
+    }
+    
+    sqlite3_bind_int64(insertRemoteCallStmt, 1, symbolId);
+    sqlite3_bind_int(insertRemoteCallStmt, 2, outgoing ? 1 : 0);
+    sqlite3_bind_text(insertRemoteCallStmt, 3, remoteName.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(insertRemoteCallStmt, 4, filePath.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int(insertRemoteCallStmt, 5, line);
+    
+    return stepInsert(insertRemoteCallStmt);
 }
 
-std::vector<std::string> SqliteStorage::getSymbolUsages(const std::string& symbolName) {
+std::vector<std::string> SqliteStorage::getSymbolUsages(const std::string& symbolName,
+                                                        QueryContext* context) {
     std::vector<std::string> results;
     
-    if (!initialized || !getUsagesStmt) {
+    StatementUse getUsagesStmt(statement(Statement::GET_USAGES));
+    if (!getUsagesStmt) {
+        finishQuery(SQLITE_ERROR, context, "getSymbolUsages");
         return results;
     }
+    ProgressGuard progress(db, context);
     
-    sqlite3_reset(getUsagesStmt);
-    sqlite3_bind_text(getUsagesStmt, 1, symbolName.c_str(), -1, SQLITE_STATIC);
+    std::string qualified = symbolName.compare(0, 2, "::") == 0 ? symbolName.substr(2) : symbolName;
+    size_t separator = qualified.rfind("::");
+    std::string lastComponent = separator == std::string::npos ? qualified : qualified.substr(separator + 2);
     
-    while (sqlite3_step(getUsagesStmt) == SQLITE_ROW) {
+    sqlite3_bind_text(getUsagesStmt, 1, qualified.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(getUsagesStmt, 2, lastComponent.c_str(), -1, SQLITE_STATIC);
+    
+    int result;
+    while ((result = sqlite3_step(getUsagesStmt)) == SQLITE_ROW) {
         const char* caller = (const char*)sqlite3_column_text(getUsagesStmt, 0);
         const char* file = (const char*)sqlite3_column_text(getUsagesStmt, 1);
         int line = sqlite3_column_int(getUsagesStmt, 2);
@@ -253,46 +922,698 @@ std::vector<std::string> SqliteStorage::getSymbolUsages(const std::string& symbo
         std::string usage = std::string(caller) + " (" + file + ":" + std::to_string(line) + ")";
         results.push_back(usage);
     }
+    finishQuery(result, context, "getSymbolUsages");
     
     return results;
 }
 
-std::vector<std::string> SqliteStorage::getSymbolCallees(const std::string& symbolName) {
+std::vector<std::string> SqliteStorage::getSymbolCallees(const std::string& symbolName,
+                                                        QueryContext* context) {
     std::vector<std::string> results;
     
-    if (!initialized) {
+    StatementUse getCalleesStmt(statement(Statement::GET_CALLEES));
+    if (!getCalleesStmt) {
+        finishQuery(SQLITE_ERROR, context, "getSymbolCallees");
         return results;
     }
+    ProgressGuard progress(db, context);
     
-    const char* sql = "SELECT DISTINCT callee_name FROM call_relationships WHERE caller_name = ? ORDER BY callee_name";
-    sqlite3_stmt* stmt = prepareStatement(sql);
+    std::string qualified = symbolName.compare(0, 2, "::") == 0 ? symbolName.substr(2) : symbolName;
+    size_t separator = qualified.rfind("::");
+    std::string lastComponent = separator == std::string::npos ? qualified : qualified.substr(separator + 2);
+    
+    sqlite3_bind_text(getCalleesStmt, 1, qualified.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(getCalleesStmt, 2, lastComponent.c_str(), -1, SQLITE_STATIC);
+    
+    int result;
+    while ((result = sqlite3_step(getCalleesStmt)) == SQLITE_ROW) {
+        const char* callee = (const char*)sqlite3_column_text(getCalleesStmt, 0);
+        results.push_back(std::string(callee));
+    }
+    finishQuery(result, context, "getSymbolCallees");
+    
+    return results;
+}
+
+int64_t SqliteStorage::storeFile(const std::string& filePath, uint64_t contentHash, int64_t fileId,
+                                 std::string_view blobId) {
+    StatementUse insertFileStmt(statement(Statement::INSERT_FILE));
+    if (!insertFileStmt) {
+        return 0;
+    }
+    
+    if (fileId != 0) {
+        sqlite3_bind_int64(insertFileStmt, 1, fileId);
+    } else {
+        sqlite3_bind_null(insertFileStmt, 1);
+    }
+    sqlite3_bind_text(insertFileStmt, 2, filePath.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(insertFileStmt, 3, static_cast<int64_t>(contentHash));
+    bindText(insertFileStmt, 4, blobId);
+    
+    if (!stepInsert(insertFileStmt)) {
+        logError("storeFile");
+        return 0;
+    }
+    return sqlite3_last_insert_rowid(db);
+}
+
+bool SqliteStorage::setFileBlob(int64_t fileId, std::string_view blobId) {
+    StatementUse stmt(statement(Statement::SET_FILE_BLOB));
+    if (!stmt) {
+        return false;
+    }
+    
+    bindText(stmt, 1, blobId);
+    sqlite3_bind_int64(stmt, 2, fileId);
+    return sqlite3_step(stmt) == SQLITE_DONE;
+}
+
+bool SqliteStorage::deleteFile(int64_t fileId, const std::string& filePath) {
+    for (Statement which : {Statement::DELETE_FILE, Statement::DELETE_FILE_DIRECTIVES,
+                            Statement::DELETE_FILE_CALL_SITES}) {
+        StatementUse stmt(statement(which));
+        if (!stmt) {
+            return false;
+        }
+        sqlite3_bind_int64(stmt, 1, fileId);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            logError("deleteFile");
+            return false;
+        }
+    }
     
+    StatementUse stmt(statement(Statement::DELETE_FILE_SYMBOLS));
     if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, filePath.c_str(), -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        logError("deleteFile");
+        return false;
+    }
+    return true;
+}
+
+bool SqliteStorage::scanFiles(const std::function<void(int64_t id, std::string_view path,
+                                                       uint64_t contentHash, std::string_view blobId)>& onFile) {
+    StatementUse stmt(statement(Statement::SCAN_FILES));
+    if (!stmt) {
+        return false;
+    }
+    
+    int result;
+    while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
+        onFile(sqlite3_column_int64(stmt, 0), columnText(stmt, 1),
+               static_cast<uint64_t>(sqlite3_column_int64(stmt, 2)), columnText(stmt, 3));
+    }
+    if (result != SQLITE_DONE) {
+        logError("scanFiles");
+        return false;
+    }
+    return true;
+}
+
+bool SqliteStorage::storeInclude(int64_t includerId, int64_t includedId, int line) {
+    StatementUse insertIncludeStmt(statement(Statement::INSERT_INCLUDE));
+    if (!insertIncludeStmt) {
+        return false;
+    }
+    
+    sqlite3_bind_int64(insertIncludeStmt, 1, includerId);
+    sqlite3_bind_int64(insertIncludeStmt, 2, includedId);
+    sqlite3_bind_int(insertIncludeStmt, 3, line);
+    
+    return stepInsert(insertIncludeStmt);
+}
+
+bool SqliteStorage::storeReverseDependencies(int64_t fileId, const std::string& serializedBitset) {
+    StatementUse insertRdepsStmt(statement(Statement::INSERT_RDEPS));
+    if (!insertRdepsStmt) {
+        return false;
+    }
+    
+    sqlite3_bind_int64(insertRdepsStmt, 1, fileId);
+    sqlite3_bind_blob(insertRdepsStmt, 2, serializedBitset.data(),
+                      static_cast<int>(serializedBitset.size()), SQLITE_STATIC);
+    
+    return stepInsert(insertRdepsStmt);
+}
+
+std::vector<int64_t> SqliteStorage::findFiles(const std::string& filePath, QueryContext* context) {
+    std::vector<int64_t> results;
+    
+    StatementUse stmt(statement(Statement::FIND_FILES));
+    if (!stmt) {
+        finishQuery(SQLITE_ERROR, context, "findFiles");
         return results;
     }
+    ProgressGuard progress(db, context);
     
-    sqlite3_bind_text(stmt, 1, symbolName.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 1, filePath.c_str(), -1, SQLITE_STATIC);
     
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        const char* callee = (const char*)sqlite3_column_text(stmt, 0);
-        results.push_back(std::string(callee));
+    int result;
+    while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
+        results.push_back(sqlite3_column_int64(stmt, 0));
     }
+    finishQuery(result, context, "findFiles");
     
-    sqlite3_finalize(stmt);
     return results;
 }
 
+std::string SqliteStorage::getFilePath(int64_t fileId) {
+    StatementUse getFilePathStmt(statement(Statement::GET_FILE_PATH));
+    if (!getFilePathStmt) {
+        return "";
+    }
+    
+    sqlite3_bind_int64(getFilePathStmt, 1, fileId);
+    
+    if (sqlite3_step(getFilePathStmt) != SQLITE_ROW) {
+        return "";
+    }
+    return (const char*)sqlite3_column_text(getFilePathStmt, 0);
+}
+
+std::vector<std::string> SqliteStorage::getTransitiveDependents(int64_t fileId, QueryContext* context) {
+    std::vector<std::string> results;
+    
+    // The id lookups are checked here too: each is short enough to slip
+    // between progress callbacks, but there can be thousands of them
+    for (uint32_t dependentId : getTransitiveDependentIds(fileId, context)) {
+        if (shouldStopEvery(context, results.size())) {
+            break;
+        }
+        results.push_back(getFilePath(dependentId));
+    }
+    
+    return results;
+}
+
+std::vector<uint32_t> SqliteStorage::getTransitiveDependentIds(int64_t fileId, QueryContext* context) {
+    std::vector<uint32_t> results;
+    
+    CompressedBitset dependents;
+    bool found = false;
+    {
+        StatementUse stmt(statement(Statement::GET_DEPENDENTS));
+        if (!stmt) {
+            finishQuery(SQLITE_ERROR, context, "getTransitiveDependents");
+            return results;
+        }
+        ProgressGuard progress(db, context);
+        
+        sqlite3_bind_int64(stmt, 1, fileId);
+        int result = sqlite3_step(stmt);
+        if (result == SQLITE_ROW) {
+            found = CompressedBitset::deserialize(sqlite3_column_blob(stmt, 0),
+                                                  sqlite3_column_bytes(stmt, 0), dependents);
+        }
+        finishQuery(result, context, "getTransitiveDependents");
+    }
+    
+    if (!found) {
+        return results;
+    }
+    
+    dependents.forEach([&](uint32_t dependentId) {
+        // A file inside an include cycle reaches itself; that is not a dependent
+        if (dependentId != fileId) {
+            results.push_back(dependentId);
+        }
+    });
+    
+    return results;
+}
+
+bool SqliteStorage::storePostings(int64_t nameId, const std::string& name, int segment,
+                                  int64_t occurrenceCount, const std::string& postings) {
+    StatementUse insertIdentifierStmt(statement(Statement::INSERT_IDENTIFIER));
+    StatementUse insertPostingsStmt(statement(Statement::INSERT_POSTINGS));
+    if (!insertIdentifierStmt || !insertPostingsStmt) {
+        return false;
+    }
+    
+    sqlite3_bind_int64(insertIdentifierStmt, 1, nameId);
+    sqlite3_bind_text(insertIdentifierStmt, 2, name.c_str(), -1, SQLITE_STATIC);
+    if (!stepInsert(insertIdentifierStmt)) {
+        logError("storePostings");
+        return false;
+    }
+    
+    sqlite3_bind_int64(insertPostingsStmt, 1, nameId);
+    sqlite3_bind_int(insertPostingsStmt, 2, segment);
+    sqlite3_bind_int64(insertPostingsStmt, 3, occurrenceCount);
+    sqlite3_bind_blob(insertPostingsStmt, 4, postings.data(), static_cast<int>(postings.size()),
+                      SQLITE_STATIC);
+    
+    return stepInsert(insertPostingsStmt);
+}
+
+std::vector<SymbolReference> SqliteStorage::getReferences(const std::string& name,
+                                                          QueryContext* context) {
+    std::vector<SymbolReference> results;
+    
+    // Decoding the postings is all the work; sources are never re-read
+    std::vector<Occurrence> occurrences;
+    {
+        StatementUse stmt(statement(Statement::GET_POSTINGS));
+        if (!stmt) {
+            finishQuery(SQLITE_ERROR, context, "getReferences");
+            return results;
+        }
+        ProgressGuard progress(db, context);
+        
+        sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_STATIC);
+        int result;
+        while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
+            if (context && context->shouldStop()) {
+                break;
+            }
+            if (!OccurrenceIndex::decode(sqlite3_column_blob(stmt, 0), sqlite3_column_bytes(stmt, 0),
+                                         occurrences)) {
+                logging::warning("Corrupt posting list for: ", name);
+                break;
+            }
+        }
+        finishQuery(result, context, "getReferences");
+    }
+    
+    std::unordered_map<uint32_t, std::string> paths;
+    results.reserve(occurrences.size());
+    for (const auto& occurrence : occurrences) {
+        if (shouldStopEvery(context, results.size())) {
+            break;
+        }
+        auto it = paths.find(occurrence.file_id);
+        if (it == paths.end()) {
+            it = paths.emplace(occurrence.file_id, getFilePath(occurrence.file_id)).first;
+        }
+        if (!it->second.empty()) {
+            results.push_back({it->second, occurrence.line_number, occurrence.column_number});
+        }
+    }
+    
+    // Postings come in file id order; by path, a sharded index gives the same
+    std::sort(results.begin(), results.end(), [](const SymbolReference& a, const SymbolReference& b) {
+        return std::tie(a.file_path, a.line_number, a.column_number) <
+               std::tie(b.file_path, b.line_number, b.column_number);
+    });
+    return results;
+}
+
+bool SqliteStorage::storeIncludeDirective(int64_t fileId, const IncludeDirective& include) {
+    StatementUse stmt(statement(Statement::INSERT_DIRECTIVE));
+    if (!stmt) {
+        return false;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, fileId);
+    bindText(stmt, 2, include.path);
+    sqlite3_bind_int(stmt, 3, include.is_system ? 1 : 0);
+    sqlite3_bind_int(stmt, 4, include.line_number);
+    return stepInsert(stmt);
+}
+
+bool SqliteStorage::storeCallSite(int64_t callerId, int64_t fileId, const CallSite& call) {
+    StatementUse stmt(statement(Statement::INSERT_CALL_SITE));
+    if (!stmt) {
+        return false;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, callerId);
+    sqlite3_bind_int64(stmt, 2, fileId);
+    bindText(stmt, 3, call.callee_name);
+    bindText(stmt, 4, call.qualifier);
+    sqlite3_bind_int(stmt, 5, call.is_member ? 1 : 0);
+    sqlite3_bind_int(stmt, 6, call.arg_count);
+    sqlite3_bind_int(stmt, 7, call.line_number);
+    sqlite3_bind_int(stmt, 8, call.column_number);
+    return stepInsert(stmt);
+}
+
+bool SqliteStorage::scanIncludeDirectives(
+    const std::function<void(int64_t fileId, const IncludeDirective&)>& onInclude) {
+    StatementUse stmt(statement(Statement::SCAN_DIRECTIVES));
+    if (!stmt) {
+        return false;
+    }
+    
+    int result;
+    while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
+        IncludeDirective include{columnText(stmt, 1), sqlite3_column_int(stmt, 2) != 0,
+                                 sqlite3_column_int(stmt, 3)};
+        onInclude(sqlite3_column_int64(stmt, 0), include);
+    }
+    if (result != SQLITE_DONE) {
+        logError("scanIncludeDirectives");
+        return false;
+    }
+    return true;
+}
+
+bool SqliteStorage::scanCallSites(
+    const std::function<void(int64_t callerId, int64_t fileId, const CallSite&)>& onCall) {
+    StatementUse stmt(statement(Statement::SCAN_CALL_SITES));
+    if (!stmt) {
+        return false;
+    }
+    
+    int result;
+    while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
+        CallSite call{0, columnText(stmt, 2), columnText(stmt, 3), sqlite3_column_int(stmt, 4) != 0,
+                      sqlite3_column_int(stmt, 5), sqlite3_column_int(stmt, 6), sqlite3_column_int(stmt, 7)};
+        onCall(sqlite3_column_int64(stmt, 0), sqlite3_column_int64(stmt, 1), call);
+    }
+    if (result != SQLITE_DONE) {
+        logError("scanCallSites");
+        return false;
+    }
+    return true;
+}
+
+bool SqliteStorage::scanIdentifiers(const std::function<void(int64_t nameId, std::string_view name)>& onName) {
+    StatementUse stmt(statement(Statement::SCAN_IDENTIFIERS));
+    if (!stmt) {
+        return false;
+    }
+    
+    int result;
+    while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
+        onName(sqlite3_column_int64(stmt, 0), columnText(stmt, 1));
+    }
+    if (result != SQLITE_DONE) {
+        logError("scanIdentifiers");
+        return false;
+    }
+    return true;
+}
+
+int SqliteStorage::nextPostingSegment() {
+    StatementUse stmt(statement(Statement::NEXT_SEGMENT));
+    if (!stmt || sqlite3_step(stmt) != SQLITE_ROW) {
+        return 0;
+    }
+    return sqlite3_column_int(stmt, 0);
+}
+
+bool SqliteStorage::setMetadata(const std::string& key, const std::string& value) {
+    StatementUse stmt(statement(Statement::SET_METADATA));
+    if (!stmt) {
+        return false;
+    }
+    
+    sqlite3_bind_text(stmt, 1, key.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, value.c_str(), -1, SQLITE_STATIC);
+    return sqlite3_step(stmt) == SQLITE_DONE;
+}
+
+std::string SqliteStorage::getMetadata(const std::string& key) {
+    std::string value;
+    
+    StatementUse stmt(statement(Statement::GET_METADATA));
+    if (!stmt) {
+        return value;
+    }
+    
+    sqlite3_bind_text(stmt, 1, key.c_str(), -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        value = (const char*)sqlite3_column_text(stmt, 0);
+    }
+    return value;
+}
+
+const std::vector<SqliteStorage::IndexTable>& SqliteStorage::indexTables() {
+    static const std::vector<IndexTable> tables = {
+        {"files", {"id", "path", "content_hash", "blob_id"}},
+        {"symbols", {"id", "name", "type", "file_path", "line_number", "column_number",
+                     "start_offset", "end_offset", "parent_scope", "qualified_name", "param_count",
+                     "required_param_count"}},
+        {"call_edges", {"caller_id", "callee_id", "file_id", "line"}},
+        {"unresolved_calls", {"caller_id", "callee_name", "file_id", "line"}},
+        {"remote_calls", {"symbol_id", "outgoing", "remote_name", "file_path", "line"}},
+        {"include_edges", {"includer_id", "included_id", "line"}},
+        {"file_rdeps", {"file_id", "dependents"}},
+        {"include_directives", {"file_id", "spelling", "is_system", "line"}},
+        {"call_sites", {"caller_id", "file_id", "callee_name", "qualifier", "is_member", "arg_count",
+                        "line", "column_number"}},
+        {"identifiers", {"id", "name"}},
+        {"postings", {"name_id", "segment", "occurrence_count", "data"}},
+    };
+    return tables;
+}
+
+const SqliteStorage::IndexTable* SqliteStorage::findIndexTable(std::string_view name) {
+    for (const auto& table : indexTables()) {
+        if (name == table.name) {
+            return &table;
+        }
+    }
+    return nullptr;
+}
+
+// Names come from indexTables() only, never from the data being copied
+bool SqliteStorage::readTable(const IndexTable& table,
+                              const std::function<void(const std::vector<TableValue>&)>& onRow) {
+    std::string sql = "SELECT ";
+    for (size_t i = 0; i < table.columns.size(); i++) {
+        sql += (i == 0 ? "" : ", ") + std::string(table.columns[i]);
+    }
+    sql += " FROM " + std::string(table.name);
+    sqlite3_stmt* stmt = prepareStatement(sql);
+    if (!stmt) {
+        return false;
+    }
+    
+    std::vector<TableValue> row(table.columns.size());
+    int result;
+    while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
+        for (size_t i = 0; i < row.size(); i++) {
+            int column = static_cast<int>(i);
+            TableValue& value = row[i];
+            switch (sqlite3_column_type(stmt, column)) {
+            case SQLITE_NULL:
+                value.type = TableValue::Type::NULL_VALUE;
+                break;
+            case SQLITE_INTEGER:
+                value.type = TableValue::Type::INTEGER;
+                value.integer = sqlite3_column_int64(stmt, column);
+                break;
+            case SQLITE_BLOB:
+                value.type = TableValue::Type::BLOB;
+                value.bytes = std::string_view(static_cast<const char*>(sqlite3_column_blob(stmt, column)),
+                                               static_cast<size_t>(sqlite3_column_bytes(stmt, column)));
+                break;
+            default:
+                value.type = TableValue::Type::TEXT;
+                value.bytes = std::string_view(reinterpret_cast<const char*>(sqlite3_column_text(stmt, column)),
+                                               static_cast<size_t>(sqlite3_column_bytes(stmt, column)));
+                break;
+            }
+        }
+        onRow(row);
+    }
+    
+    bool finished = result == SQLITE_DONE;
+    if (!finished) {
+        logError("readTable");
+    }
+    sqlite3_finalize(stmt);
+    return finished;
+}
+
+bool SqliteStorage::writeRows(const IndexTable& table,
+                              const std::function<bool(std::vector<TableValue>&)>& nextRow) {
+    std::string sql = "INSERT INTO " + std::string(table.name) + " (";
+    std::string placeholders;
+    for (size_t i = 0; i < table.columns.size(); i++) {
+        sql += (i == 0 ? "" : ", ") + std::string(table.columns[i]);
+        placeholders += i == 0 ? "?" : ", ?";
+    }
+    sql += ") VALUES (" + placeholders + ")";
+    sqlite3_stmt* stmt = prepareStatement(sql);
+    if (!stmt) {
+        return false;
+    }
+    
+    // Building the table's indexes once at the end is cheaper than updating
+    // them row by row. Their definitions come from the schema itself.
+    std::vector<std::string> names;
+    std::vector<std::string> indexes;
+    sqlite3_stmt* indexQuery = prepareStatement(
+        "SELECT name, sql FROM sqlite_master WHERE type = 'index' AND tbl_name = ? AND sql IS NOT NULL");
+    if (indexQuery) {
+        sqlite3_bind_text(indexQuery, 1, table.name, -1, SQLITE_STATIC);
+        while (sqlite3_step(indexQuery) == SQLITE_ROW) {
+            names.push_back((const char*)sqlite3_column_text(indexQuery, 0));
+            indexes.push_back((const char*)sqlite3_column_text(indexQuery, 1));
+        }
+        sqlite3_finalize(indexQuery);
+    }
+    for (const auto& name : names) {
+        executeSql(("DROP INDEX " + name).c_str(), "writeRows");
+    }
+    
+    bool written = true;
+    std::vector<TableValue> row(table.columns.size());
+    while (written && nextRow(row)) {
+        sqlite3_reset(stmt);
+        for (size_t i = 0; i < row.size(); i++) {
+            int index = static_cast<int>(i) + 1;
+            const TableValue& value = row[i];
+            switch (value.type) {
+            case TableValue::Type::NULL_VALUE:
+                sqlite3_bind_null(stmt, index);
+                break;
+            case TableValue::Type::INTEGER:
+                sqlite3_bind_int64(stmt, index, value.integer);
+                break;
+            case TableValue::Type::TEXT:
+                bindText(stmt, index, value.bytes);
+                break;
+            case TableValue::Type::BLOB:
+                // As with text, an empty value must not bind as NULL
+                sqlite3_bind_blob(stmt, index, value.bytes.empty() ? "" : value.bytes.data(),
+                                  static_cast<int>(value.bytes.size()), SQLITE_STATIC);
+                break;
+            }
+        }
+        written = stepInsert(stmt);
+        if (!written) {
+            logError("writeRows");
+        }
+    }
+    sqlite3_finalize(stmt);
+    for (const auto& index : indexes) {
+        written = executeSql(index.c_str(), "writeRows") && written;
+    }
+    return written;
+}
+
+bool SqliteStorage::syncRows(const IndexTable& table,
+                             const std::function<bool(std::vector<TableValue>&)>& nextRow) {
+    // The rows go to a scratch table first; IS compares NULLs as equal
+    std::string columns;
+    std::string same;
+    for (size_t i = 0; i < table.columns.size(); i++) {
+        std::string column = table.columns[i];
+        columns += (i == 0 ? "" : ", ") + column;
+        same += (i == 0 ? "" : " AND ") + ("s." + column + " IS t." + column);
+    }
+    std::string name = table.name;
+    std::string create = "DROP TABLE IF EXISTS temp.sync_rows; "
+                         "CREATE TEMP TABLE sync_rows AS SELECT " + columns + " FROM " + name + " WHERE 0";
+    if (!executeSql(create.c_str(), "syncRows")) {
+        return false;
+    }
+    
+    IndexTable scratch{"temp.sync_rows", table.columns};
+    std::string index = "CREATE INDEX temp.sync_rows_all ON sync_rows (" + columns + ")";
+    std::string remove = "DELETE FROM " + name + " WHERE rowid IN (SELECT t.rowid FROM " + name +
+                         " AS t WHERE NOT EXISTS (SELECT 1 FROM temp.sync_rows AS s WHERE " + same + "))";
+    std::string insert = "INSERT INTO " + name + " (" + columns + ") SELECT " + columns +
+                         " FROM temp.sync_rows AS s WHERE NOT EXISTS (SELECT 1 FROM " + name +
+                         " AS t WHERE " + same + ")";
+    bool synced = writeRows(scratch, nextRow) && executeSql(index.c_str(), "syncRows") &&
+                  executeSql(remove.c_str(), "syncRows") && executeSql(insert.c_str(), "syncRows");
+    return executeSql("DROP TABLE temp.sync_rows", "syncRows") && synced;
+}
+
+bool SqliteStorage::stampIndex() {
+    std::random_device entropy;
+    uint64_t stamp = 0;
+    while (stamp == 0) {
+        stamp = (static_cast<uint64_t>(entropy()) << 32) ^ entropy() ^
+                static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+    return setMetadata("index_stamp", std::to_string(stamp));
+}
+
+uint64_t SqliteStorage::indexStamp() {
+    try {
+        return std::stoull(getMetadata("index_stamp"));
+    } catch (const std::exception&) {
+        return 0;
+    }
+}
+
+bool SqliteStorage::getSummary(uint64_t bodyHash, const std::string& backend, std::string& summary) {
+    StatementUse stmt(statement(Statement::GET_SUMMARY));
+    if (!stmt) {
+        return false;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, static_cast<int64_t>(bodyHash));
+    bindText(stmt, 2, backend);
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
+        return false;
+    }
+    summary = (const char*)sqlite3_column_text(stmt, 0);
+    return true;
+}
+
+bool SqliteStorage::storeSummary(uint64_t bodyHash, const std::string& backend, const std::string& summary) {
+    StatementUse stmt(statement(Statement::SET_SUMMARY));
+    if (!stmt) {
+        return false;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, static_cast<int64_t>(bodyHash));
+    bindText(stmt, 2, backend);
+    bindText(stmt, 3, summary);
+    return stepInsert(stmt);
+}
+
+bool SqliteStorage::beginTransaction() {
+    return initialized && executeSql("BEGIN TRANSACTION", "beginTransaction");
+}
+
+bool SqliteStorage::commitTransaction() {
+    trace::Scope scope("sqlite commit");
+    return initialized && executeSql("COMMIT", "commitTransaction");
+}
+
+bool SqliteStorage::rollbackTransaction() {
+    return initialized && executeSql("ROLLBACK", "rollbackTransaction");
+}
+
 bool SqliteStorage::clearDatabase() {
     if (!initialized) {
         return false;
     }
     
-    const char* clearSql = "DELETE FROM symbols; DELETE FROM call_relationships;";
+    const char* clearSql = "DELETE FROM symbols; DELETE FROM call_edges; DELETE FROM unresolved_calls; "
+                           "DELETE FROM remote_calls; DELETE FROM call_sites; "
+                           "DELETE FROM include_edges; DELETE FROM file_rdeps; DELETE FROM files; "
+                           "DELETE FROM include_directives; "
+                           "DELETE FROM postings; DELETE FROM identifiers; DELETE FROM metadata;";
+    return executeSql(clearSql, "clearDatabase");
+}
+
+bool SqliteStorage::hasColumn(const std::string& table, const std::string& column) {
+    std::string sql = "PRAGMA table_info(" + table + ")";
+    sqlite3_stmt* stmt = prepareStatement(sql);
+    
+    if (!stmt) {
+        return false;
+    }
+    
+    bool found = false;
+    while (!found && sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* name = (const char*)sqlite3_column_text(stmt, 1);
+        found = name && column == name;
+    }
+    
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+bool SqliteStorage::executeSql(const char* sql, const std::string& operation) {
     char* errMsg = nullptr;
-    int result = sqlite3_exec(db, clearSql, nullptr, nullptr, &errMsg);
+    int result = sqlite3_exec(db, sql, nullptr, nullptr, &errMsg);
     
     if (result != SQLITE_OK) {
-        std::cerr << "Error clearing database: " << errMsg << std::endl;
+        logging::error("SQLite error in ", operation, ": ", errMsg);
         sqlite3_free(errMsg);
         return false;
     }
@@ -307,20 +1628,41 @@ Symbol SqliteStorage::createSymbolFromRow(sqlite3_stmt* stmt) {
     symbol.file_path = (const char*)sqlite3_column_text(stmt, 2);
     symbol.line_number = sqlite3_column_int(stmt, 3);
     symbol.column_number = sqlite3_column_int(stmt, 4);
+    symbol.start_offset = static_cast<uint64_t>(sqlite3_column_int64(stmt, 5));
+    symbol.end_offset = static_cast<uint64_t>(sqlite3_column_int64(stmt, 6));
     
-    const char* signature = (const char*)sqlite3_column_text(stmt, 5);
-    symbol.signature = signature ? std::string(signature) : "";
-    
-    const char* parent_scope = (const char*)sqlite3_column_text(stmt, 6);
+    const char* parent_scope = (const char*)sqlite3_column_text(stmt, 7);
     symbol.parent_scope = parent_scope ? std::string(parent_scope) : "";
     
+    const char* qualified_name = (const char*)sqlite3_column_text(stmt, 8);
+    symbol.qualified_name = qualified_name ? std::string(qualified_name) : symbol.name;
+    
+    symbol.file_hash = static_cast<uint64_t>(sqlite3_column_int64(stmt, 9));
+    symbol.param_count = sqlite3_column_int(stmt, 10);
+    symbol.required_param_count = sqlite3_column_int(stmt, 11);
+    
     return symbol;
 }
 
 void SqliteStorage::logError(const std::string& operation) {
     if (db) {
-        std::cerr << "SQLite error in " << operation << ": " << sqlite3_errmsg(db) << std::endl;
+        logging::error("SQLite error in ", operation, ": ", sqlite3_errmsg(db));
+    }
+}
+
+// A query's rows end in SQLITE_DONE, or in SQLITE_INTERRUPT once its context
+// gave up; any other end, such as SQLITE_BUSY, failed it. Stopping early on
+// SQLITE_ROW is the caller's choice and not an error.
+bool SqliteStorage::finishQuery(int result, QueryContext* context, const std::string& operation) {
+    if (result == SQLITE_DONE || result == SQLITE_ROW ||
+        (result == SQLITE_INTERRUPT && context && context->truncated)) {
+        return true;
+    }
+    logError(operation);
+    if (context) {
+        context->fail(db ? sqlite3_errmsg(db) : "database is not open");
     }
+    return false;
 }
 
 } // namespace devpilot
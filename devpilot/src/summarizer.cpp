@@ -0,0 +1,266 @@
+#include "summarizer.hpp"
+#include "content_hash.hpp"
+#include "logger.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace devpilot {
+
+// Single responsibility: Only turn function bodies into summaries, through a cache and in batches
+
+ProcessBackend::ProcessBackend(std::string command)
+    : command(std::move(command)), pid(-1), socket(-1) {}
+
+ProcessBackend::~ProcessBackend() {
+    stop();
+}
+
+std::string ProcessBackend::id() const {
+    return "process:" + command;
+}
+
+bool ProcessBackend::start() {
+    // One socket serves as the child's stdin and stdout; unlike a pipe, it
+    // can be written with MSG_NOSIGNAL, so a dead child is an error and not
+    // a SIGPIPE
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+        logging::error("Cannot start summary backend: ", std::strerror(errno));
+        return false;
+    }
+    pid = fork();
+    if (pid == 0) {
+        // Only async-signal-safe calls between fork and exec
+        dup2(fds[1], STDIN_FILENO);
+        dup2(fds[1], STDOUT_FILENO);
+        execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    close(fds[1]);
+    if (pid < 0) {
+        logging::error("Cannot start summary backend: ", std::strerror(errno));
+        close(fds[0]);
+        return false;
+    }
+    socket = fds[0];
+    received.clear();
+    logging::debug("Summary backend started: ", command);
+    return true;
+}
+
+// Closing the socket is the child's end of input; one that does not take
+// the hint is terminated
+void ProcessBackend::stop() {
+    if (socket >= 0) {
+        close(socket);
+        socket = -1;
+    }
+    if (pid > 0) {
+        int status = 0;
+        for (int attempt = 0; attempt < 50 && waitpid(pid, &status, WNOHANG) == 0; attempt++) {
+            usleep(10000);
+            if (attempt == 49) {
+                kill(pid, SIGTERM);
+                waitpid(pid, &status, 0);
+            }
+        }
+        pid = -1;
+    }
+}
+
+bool ProcessBackend::readLine(std::string& line) {
+    size_t end;
+    while ((end = received.find('\n')) == std::string::npos) {
+        char buffer[4096];
+        ssize_t bytes = recv(socket, buffer, sizeof(buffer), 0);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            return false;
+        }
+        received.append(buffer, static_cast<size_t>(bytes));
+    }
+    line = received.substr(0, end);
+    received.erase(0, end + 1);
+    return true;
+}
+
+bool ProcessBackend::summarize(const std::vector<const SummaryRequest*>& batch,
+                               std::vector<std::string>& summaries) {
+    if (socket < 0 && !start()) {
+        return false;
+    }
+
+    std::string message = "batch " + std::to_string(batch.size()) + "\n";
+    for (size_t i = 0; i < batch.size(); i++) {
+        message += std::to_string(i) + "\t" + batch[i]->name + "\t" +
+                   std::to_string(batch[i]->body.size()) + "\n" + batch[i]->body + "\n";
+    }
+    for (size_t sent = 0; sent < message.size();) {
+        ssize_t bytes = send(socket, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            logging::error("Summary backend stopped reading: ", command);
+            stop();
+            return false;
+        }
+        sent += static_cast<size_t>(bytes);
+    }
+
+    summaries.assign(batch.size(), std::string());
+    std::vector<bool> answered(batch.size(), false);
+    for (size_t remaining = batch.size(); remaining > 0; remaining--) {
+        std::string line;
+        if (!readLine(line)) {
+            logging::error("Summary backend exited: ", command);
+            stop();
+            return false;
+        }
+        size_t tab = line.find('\t');
+        size_t index = 0;
+        bool valid = tab != std::string::npos && tab > 0;
+        for (size_t i = 0; valid && i < tab; i++) {
+            valid = line[i] >= '0' && line[i] <= '9';
+            index = index * 10 + static_cast<size_t>(line[i] - '0');
+        }
+        if (!valid || index >= batch.size() || answered[index]) {
+            logging::error("Summary backend answered out of protocol: ", line);
+            stop();
+            return false;
+        }
+        answered[index] = true;
+        summaries[index] = line.substr(tab + 1);
+    }
+    return true;
+}
+
+Summarizer::Summarizer(SqliteStorage& cache, SummaryBackend& backend, size_t batchSize)
+    : cache(cache), backend(backend), backendId(backend.id()), batchSize(std::max<size_t>(1, batchSize)),
+      stopping(false), worker([this]() { run(); }) {}
+
+// Whatever is still queued is summarized first
+Summarizer::~Summarizer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+    worker.join();
+}
+
+std::vector<std::string> Summarizer::summarize(const std::vector<SummaryRequest>& requests) {
+    std::vector<std::string> summaries(requests.size());
+    std::vector<uint64_t> hashes(requests.size());
+    std::vector<bool> cached(requests.size(), false);
+    size_t hits = 0;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        for (size_t i = 0; i < requests.size(); i++) {
+            hashes[i] = hashContent(requests[i].body.data(), requests[i].body.size());
+            cached[i] = cache.getSummary(hashes[i], backendId, summaries[i]);
+            hits += cached[i] ? 1 : 0;
+        }
+    }
+
+    // A call's misses are queued together, so they share batches
+    std::vector<std::shared_future<std::string>> waiting(requests.size());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.requests += requests.size();
+        counters.cacheHits += hits;
+        for (size_t i = 0; i < requests.size(); i++) {
+            if (cached[i]) {
+                continue;
+            }
+            auto found = inFlight.find(hashes[i]);
+            if (found != inFlight.end()) {
+                waiting[i] = found->second;
+                counters.deduplicated++;
+                continue;
+            }
+            auto job = std::make_unique<Job>();
+            job->hash = hashes[i];
+            job->request = requests[i];
+            waiting[i] = job->result.get_future().share();
+            inFlight.emplace(hashes[i], waiting[i]);
+            queue.push_back(std::move(job));
+        }
+        counters.queueDepth = queue.size();
+        counters.maxQueueDepth = std::max(counters.maxQueueDepth, queue.size());
+    }
+    available.notify_one();
+
+    for (size_t i = 0; i < requests.size(); i++) {
+        if (waiting[i].valid()) {
+            summaries[i] = waiting[i].get();
+        }
+    }
+    return summaries;
+}
+
+SummarizerStats Summarizer::stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void Summarizer::run() {
+    trace::setThreadName("summarizer");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        available.wait(lock, [this]() { return stopping || !queue.empty(); });
+        if (queue.empty()) {
+            return;
+        }
+        std::vector<std::unique_ptr<Job>> batch;
+        while (!queue.empty() && batch.size() < batchSize) {
+            batch.push_back(std::move(queue.front()));
+            queue.pop_front();
+        }
+        counters.queueDepth = queue.size();
+        lock.unlock();
+
+        std::vector<const SummaryRequest*> requests;
+        for (const auto& job : batch) {
+            requests.push_back(&job->request);
+        }
+        std::vector<std::string> summaries;
+        auto start = std::chrono::steady_clock::now();
+        bool answered;
+        {
+            trace::Scope scope("summarize batch");
+            answered = backend.summarize(requests, summaries) && summaries.size() == batch.size();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        // Failures are not cached, so the next request tries again
+        if (answered) {
+            std::lock_guard<std::mutex> cacheLock(cacheMutex);
+            cache.beginTransaction();
+            for (size_t i = 0; i < batch.size(); i++) {
+                if (!summaries[i].empty()) {
+                    cache.storeSummary(batch[i]->hash, backendId, summaries[i]);
+                }
+            }
+            cache.commitTransaction();
+        }
+
+        lock.lock();
+        counters.batches++;
+        counters.backendTime += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+        (answered ? counters.summarized : counters.failed) += batch.size();
+        for (size_t i = 0; i < batch.size(); i++) {
+            inFlight.erase(batch[i]->hash);
+            batch[i]->result.set_value(answered ? summaries[i] : std::string());
+        }
+    }
+}
+
+} // namespace devpilot
@@ -24,6 +24,17 @@ SymbolType stringToSymbolType(const std::string& typeStr) {
     return SymbolType::UNKNOWN;
 }
 
+Symbol SymbolRecord::toSymbol() const {
+    Symbol symbol(std::string(name), type, std::string(file_path), line_number, column_number);
+    symbol.parent_scope = std::string(parent_scope);
+    symbol.qualified_name = std::string(qualified_name);
+    symbol.param_count = param_count;
+    symbol.required_param_count = required_param_count;
+    symbol.start_offset = start_offset;
+    symbol.end_offset = end_offset;
+    return symbol;
+}
+
 void SymbolManager::addSymbol(const Symbol& symbol) {
     // Avoid duplicates
     auto it = std::find(symbols.begin(), symbols.end(), symbol);
@@ -0,0 +1,194 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace devpilot {
+namespace trace {
+
+// Single responsibility: Only collect and report timing spans and counters
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Event {
+    const char* name;
+    int64_t start;  // Nanoseconds since enable()
+    int64_t end;
+};
+
+// Written by its own thread only; read once that thread is done
+struct ThreadBuffer {
+    uint32_t id = 0;
+    std::string name;
+    std::vector<Event> events;
+    uint64_t counters[kCounterCount] = {};
+};
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;  // Outlive their threads
+Clock::time_point origin;
+
+ThreadBuffer& localBuffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = buffers.back().get();
+        buffer->id = static_cast<uint32_t>(buffers.size());
+    }
+    return *buffer;
+}
+
+std::string escapeJson(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// Microseconds with the nanoseconds kept, as the format expects
+std::string microseconds(int64_t nanoseconds) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.3f", nanoseconds / 1e3);
+    return text;
+}
+
+} // namespace
+
+namespace detail {
+
+std::atomic<bool> active{false};
+
+void recordSpan(const char* name, Clock::time_point start) {
+    Clock::time_point end = Clock::now();
+    localBuffer().events.push_back({name, (start - origin).count(), (end - origin).count()});
+}
+
+void addCount(Counter counter, uint64_t amount) {
+    localBuffer().counters[static_cast<size_t>(counter)] += amount;
+}
+
+} // namespace detail
+
+const char* counterName(Counter counter) {
+    switch (counter) {
+        case Counter::BYTES_READ: return "bytes_read";
+        case Counter::FILES_PARSED: return "files_parsed";
+        case Counter::SYMBOLS_EMITTED: return "symbols_emitted";
+        case Counter::CALLS_EMITTED: return "calls_emitted";
+        case Counter::INCLUDES_EMITTED: return "includes_emitted";
+        case Counter::OCCURRENCES_EMITTED: return "occurrences_emitted";
+        case Counter::ROWS_WRITTEN: return "rows_written";
+    }
+    return "unknown";
+}
+
+void enable() {
+    if (!detail::active.load(std::memory_order_relaxed)) {
+        origin = Clock::now();
+        detail::active.store(true, std::memory_order_relaxed);
+    }
+}
+
+void setThreadName(const std::string& name) {
+    if (enabled()) {
+        localBuffer().name = name;
+    }
+}
+
+Summary summarize() {
+    Summary summary;
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    // Literals with the same text may live at different addresses
+    std::map<std::string, std::pair<int64_t, SpanSummary>> byName;
+    for (const auto& buffer : buffers) {
+        for (size_t i = 0; i < kCounterCount; i++) {
+            summary.counters[i] += buffer->counters[i];
+        }
+        for (const auto& event : buffer->events) {
+            auto inserted = byName.emplace(event.name, std::make_pair(event.start, SpanSummary()));
+            auto& entry = inserted.first->second;
+            entry.first = std::min(entry.first, event.start);
+            SpanSummary& span = entry.second;
+            std::chrono::nanoseconds duration(event.end - event.start);
+            span.count++;
+            span.total += duration;
+            span.max = std::max(span.max, duration);
+        }
+    }
+
+    std::vector<std::pair<int64_t, SpanSummary>> ordered;
+    for (auto& entry : byName) {
+        entry.second.second.name = entry.first;
+        ordered.push_back(std::move(entry.second));
+    }
+    std::sort(ordered.begin(), ordered.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (auto& entry : ordered) {
+        summary.spans.push_back(std::move(entry.second));
+    }
+    return summary;
+}
+
+bool writeChromeTrace(const std::string& path) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separator = [&]() -> const char* {
+        const char* text = first ? "" : ",\n";
+        first = false;
+        return text;
+    };
+    int64_t last = 0;
+    for (const auto& buffer : buffers) {
+        std::string name = buffer->name.empty() ? "thread " + std::to_string(buffer->id) : buffer->name;
+        out << separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+            << ",\"args\":{\"name\":\"" << escapeJson(name) << "\"}}";
+        for (const auto& event : buffer->events) {
+            out << separator() << "{\"name\":\"" << escapeJson(event.name)
+                << "\",\"cat\":\"devpilot\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                << ",\"ts\":" << microseconds(event.start)
+                << ",\"dur\":" << microseconds(event.end - event.start) << "}";
+            last = std::max(last, event.end);
+        }
+    }
+
+    // Counters are totals, so each is one sample at the end of the run
+    uint64_t counters[kCounterCount] = {};
+    for (const auto& buffer : buffers) {
+        for (size_t i = 0; i < kCounterCount; i++) {
+            counters[i] += buffer->counters[i];
+        }
+    }
+    for (size_t i = 0; i < kCounterCount; i++) {
+        out << separator() << "{\"name\":\"" << counterName(static_cast<Counter>(i))
+            << "\",\"ph\":\"C\",\"pid\":1,\"ts\":" << microseconds(last)
+            << ",\"args\":{\"value\":" << counters[i] << "}}";
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+} // namespace trace
+} // namespace devpilot
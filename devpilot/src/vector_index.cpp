@@ -0,0 +1,510 @@
+#include "vector_index.hpp"
+#include "logger.hpp"
+#include "trace.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace devpilot {
+
+// Single responsibility: Only store quantized vectors and find the nearest ones
+
+namespace {
+
+constexpr char kMagic[8] = {'D', 'P', 'V', 'E', 'C', 'S', '0', '1'};
+constexpr size_t kRowAlignment = 32;     // Code rows are whole AVX2 registers
+constexpr size_t kSectionAlignment = 64; // Sections start on cache lines
+constexpr size_t kMaxLists = 65536;
+constexpr size_t kSamplePerList = 64;    // k-means trains on this many rows per list
+
+struct FileHeader {
+    char magic[8];
+    uint32_t dimensions;
+    uint32_t stride;
+    uint64_t count;
+    uint64_t lists;
+    uint64_t indexStamp;
+    char embedder[64];  // NUL-padded
+};
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Where each section starts; the header says nothing else about the layout
+struct Layout {
+    size_t centroids, listStarts, ids, scales, codes, total;
+};
+
+Layout layoutOf(size_t dims, size_t stride, size_t count, size_t lists) {
+    Layout layout;
+    layout.centroids = alignUp(sizeof(FileHeader), kSectionAlignment);
+    layout.listStarts = alignUp(layout.centroids + lists * dims * sizeof(float), kSectionAlignment);
+    layout.ids = alignUp(layout.listStarts + (lists + 1) * sizeof(uint64_t), kSectionAlignment);
+    layout.scales = alignUp(layout.ids + count * sizeof(int64_t), kSectionAlignment);
+    layout.codes = alignUp(layout.scales + count * sizeof(float), kSectionAlignment);
+    layout.total = layout.codes + count * stride;
+    return layout;
+}
+
+// Symmetric, per vector: the largest magnitude becomes 127. Returns the
+// scale that turns codes back into values; the padding stays zero.
+float quantize(const float* vector, size_t dims, int8_t* codes) {
+    float largest = 0;
+    for (size_t i = 0; i < dims; i++) {
+        largest = std::max(largest, std::fabs(vector[i]));
+    }
+    if (largest == 0 || !std::isfinite(largest)) {
+        std::fill(codes, codes + dims, static_cast<int8_t>(0));
+        return 0;
+    }
+    float inverse = 127.0f / largest;
+    for (size_t i = 0; i < dims; i++) {
+        codes[i] = static_cast<int8_t>(std::lrint(std::max(-127.0f, std::min(127.0f, vector[i] * inverse))));
+    }
+    return largest / 127.0f;
+}
+
+int32_t dotScalar(const int8_t* a, const int8_t* b, size_t size) {
+    int32_t sum = 0;
+    for (size_t i = 0; i < size; i++) {
+        sum += static_cast<int32_t>(a[i]) * b[i];
+    }
+    return sum;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Widens to int16 and multiply-adds pairs into int32 lanes: 32 products per
+// iteration in two independent accumulators
+__attribute__((target("avx2")))
+int32_t dotAvx2(const int8_t* a, const int8_t* b, size_t size) {
+    __m256i even = _mm256_setzero_si256();
+    __m256i odd = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i a0 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        __m256i b0 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        __m256i a1 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 16)));
+        __m256i b1 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 16)));
+        even = _mm256_add_epi32(even, _mm256_madd_epi16(a0, b0));
+        odd = _mm256_add_epi32(odd, _mm256_madd_epi16(a1, b1));
+    }
+    __m256i sum = _mm256_add_epi32(even, odd);
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(half) + dotScalar(a + i, b + i, size - i);
+}
+#elif defined(__aarch64__)
+int32_t dotNeon(const int8_t* a, const int8_t* b, size_t size) {
+    int32x4_t sum = vdupq_n_s32(0);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        int8x16_t x = vld1q_s8(a + i);
+        int8x16_t y = vld1q_s8(b + i);
+        sum = vpadalq_s16(sum, vmull_s8(vget_low_s8(x), vget_low_s8(y)));
+        sum = vpadalq_s16(sum, vmull_high_s8(x, y));
+    }
+    return vaddvq_s32(sum) + dotScalar(a + i, b + i, size - i);
+}
+#endif
+
+using DotKernel = int32_t (*)(const int8_t*, const int8_t*, size_t);
+
+struct Kernel {
+    DotKernel function;
+    const char* name;
+};
+
+// Chosen once, by what the running CPU supports
+const Kernel& kernel() {
+    static const Kernel selected = []() -> Kernel {
+#if defined(__x86_64__) || defined(__i386__)
+        if (__builtin_cpu_supports("avx2")) {
+            return {dotAvx2, "avx2"};
+        }
+#elif defined(__aarch64__)
+        return {dotNeon, "neon"};
+#endif
+        return {dotScalar, "scalar"};
+    }();
+    return selected;
+}
+
+// Splits [0, count) into one contiguous range per thread
+void parallelFor(size_t count, unsigned threads, const std::function<void(size_t, size_t)>& body) {
+    size_t workers = std::max<size_t>(1, std::min<size_t>(threads, count / 1024));
+    if (workers == 1) {
+        body(0, count);
+        return;
+    }
+    std::vector<std::thread> pool;
+    for (size_t w = 0; w < workers; w++) {
+        pool.emplace_back(body, count * w / workers, count * (w + 1) / workers);
+    }
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+// Best first; equal scores in id order, so results do not depend on layout
+bool better(const VectorMatch& a, const VectorMatch& b) {
+    return a.score > b.score || (a.score == b.score && a.id < b.id);
+}
+
+// The nearest centroid for each row in [begin, end), all in int8
+void assignRows(const int8_t* codes, size_t stride, const std::vector<size_t>& rows, size_t begin, size_t end,
+                const std::vector<int8_t>& centroidCodes, const std::vector<float>& centroidScales,
+                std::vector<uint32_t>& assignment) {
+    DotKernel dot = kernel().function;
+    size_t lists = centroidScales.size();
+    for (size_t i = begin; i < end; i++) {
+        const int8_t* row = codes + (rows.empty() ? i : rows[i]) * stride;
+        float best = -INFINITY;
+        uint32_t bestList = 0;
+        for (size_t list = 0; list < lists; list++) {
+            float score = static_cast<float>(dot(row, centroidCodes.data() + list * stride, stride)) *
+                          centroidScales[list];
+            if (score > best) {
+                best = score;
+                bestList = static_cast<uint32_t>(list);
+            }
+        }
+        assignment[i] = bestList;
+    }
+}
+
+bool writeZeros(std::ofstream& out, size_t from, size_t to) {
+    static const char zeros[kSectionAlignment] = {};
+    out.write(zeros, static_cast<std::streamsize>(to - from));
+    return static_cast<bool>(out);
+}
+
+} // namespace
+
+std::string vectorPath(const std::string& databasePath) {
+    return databasePath + ".vectors";
+}
+
+int32_t dotProductInt8(const int8_t* a, const int8_t* b, size_t size) {
+    return kernel().function(a, b, size);
+}
+
+const char* dotProductKernel() {
+    return kernel().name;
+}
+
+VectorIndexBuilder::VectorIndexBuilder(size_t dimensions)
+    : dimensions(dimensions), stride(alignUp(std::max<size_t>(1, dimensions), kRowAlignment)) {}
+
+void VectorIndexBuilder::add(int64_t id, const float* vector) {
+    ids.push_back(id);
+    codes.resize(codes.size() + stride, 0);
+    scales.push_back(quantize(vector, dimensions, codes.data() + codes.size() - stride));
+}
+
+// Spherical k-means on a sample of the rows, then every row goes to its
+// nearest centroid. Both steps score in int8 against quantized centroids.
+bool VectorIndexBuilder::write(const std::string& path, const std::string& embedderId, uint64_t indexStamp,
+                               const VectorBuildOptions& options, size_t& lists) {
+    trace::Scope scope("write vectors");
+    size_t count = ids.size();
+    FileHeader header = {};
+    if (embedderId.size() >= sizeof(header.embedder)) {
+        logging::error("Embedder id too long: ", embedderId);
+        return false;
+    }
+    lists = options.lists != 0 ? options.lists : static_cast<size_t>(std::lround(std::sqrt(count)));
+    lists = std::min({std::max<size_t>(1, lists), std::max<size_t>(1, count), kMaxLists});
+    if (count == 0) {
+        lists = 0;
+    }
+
+    std::vector<size_t> sample;
+    size_t step = std::max<size_t>(1, count / std::max<size_t>(1, lists * kSamplePerList));
+    for (size_t row = 0; row < count; row += step) {
+        sample.push_back(row);
+    }
+
+    // Centroids start on rows spread evenly through the input
+    std::vector<float> centroids(lists * dimensions, 0.0f);
+    for (size_t list = 0; list < lists; list++) {
+        size_t row = list * count / lists;
+        for (size_t d = 0; d < dimensions; d++) {
+            centroids[list * dimensions + d] = codes[row * stride + d] * scales[row];
+        }
+    }
+    std::vector<int8_t> centroidCodes(lists * stride, 0);
+    std::vector<float> centroidScales(lists);
+    auto quantizeCentroids = [&]() {
+        for (size_t list = 0; list < lists; list++) {
+            centroidScales[list] = quantize(centroids.data() + list * dimensions, dimensions,
+                                            centroidCodes.data() + list * stride);
+        }
+    };
+
+    std::vector<uint32_t> assignment(sample.size());
+    for (unsigned iteration = 0; iteration < options.iterations && lists > 1; iteration++) {
+        quantizeCentroids();
+        parallelFor(sample.size(), options.threads, [&](size_t begin, size_t end) {
+            assignRows(codes.data(), stride, sample, begin, end, centroidCodes, centroidScales, assignment);
+        });
+        std::fill(centroids.begin(), centroids.end(), 0.0f);
+        std::vector<size_t> members(lists, 0);
+        for (size_t i = 0; i < sample.size(); i++) {
+            size_t row = sample[i];
+            float* centroid = centroids.data() + assignment[i] * dimensions;
+            for (size_t d = 0; d < dimensions; d++) {
+                centroid[d] += codes[row * stride + d] * scales[row];
+            }
+            members[assignment[i]]++;
+        }
+        for (size_t list = 0; list < lists; list++) {
+            float* centroid = centroids.data() + list * dimensions;
+            if (members[list] == 0) {
+                // An empty list restarts on some sample row
+                size_t row = sample[(list * 7919 + iteration) % sample.size()];
+                for (size_t d = 0; d < dimensions; d++) {
+                    centroid[d] = codes[row * stride + d] * scales[row];
+                }
+            }
+            double norm = 0;
+            for (size_t d = 0; d < dimensions; d++) {
+                norm += static_cast<double>(centroid[d]) * centroid[d];
+            }
+            if (norm > 0) {
+                float inverse = static_cast<float>(1.0 / std::sqrt(norm));
+                for (size_t d = 0; d < dimensions; d++) {
+                    centroid[d] *= inverse;
+                }
+            }
+        }
+    }
+
+    // Rows are written grouped by list, in input order within each
+    quantizeCentroids();
+    assignment.assign(count, 0);
+    if (lists > 1) {
+        parallelFor(count, options.threads, [&](size_t begin, size_t end) {
+            assignRows(codes.data(), stride, {}, begin, end, centroidCodes, centroidScales, assignment);
+        });
+    }
+    std::vector<uint64_t> listStarts(lists + 1, 0);
+    for (uint32_t list : assignment) {
+        listStarts[list + 1]++;
+    }
+    for (size_t list = 0; list < lists; list++) {
+        listStarts[list + 1] += listStarts[list];
+    }
+    std::vector<size_t> order(count);
+    {
+        std::vector<uint64_t> next(listStarts.begin(), listStarts.end() - (lists > 0 ? 1 : 0));
+        for (size_t row = 0; row < count; row++) {
+            order[next[assignment[row]]++] = row;
+        }
+    }
+
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.dimensions = static_cast<uint32_t>(dimensions);
+    header.stride = static_cast<uint32_t>(stride);
+    header.count = count;
+    header.lists = lists;
+    header.indexStamp = indexStamp;
+    std::memcpy(header.embedder, embedderId.data(), embedderId.size());
+    Layout layout = layoutOf(dimensions, stride, count, lists);
+
+    std::string temporary = path + ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    size_t offset = sizeof(header);
+    auto section = [&](size_t start, const void* data, size_t bytes) {
+        writeZeros(out, offset, start);
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        offset = start + bytes;
+    };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    section(layout.centroids, centroids.data(), centroids.size() * sizeof(float));
+    section(layout.listStarts, listStarts.data(), listStarts.size() * sizeof(uint64_t));
+    std::vector<int64_t> orderedIds(count);
+    std::vector<float> orderedScales(count);
+    for (size_t i = 0; i < count; i++) {
+        orderedIds[i] = ids[order[i]];
+        orderedScales[i] = scales[order[i]];
+    }
+    section(layout.ids, orderedIds.data(), count * sizeof(int64_t));
+    section(layout.scales, orderedScales.data(), count * sizeof(float));
+    writeZeros(out, offset, layout.codes);
+    for (size_t i = 0; i < count; i++) {
+        out.write(reinterpret_cast<const char*>(codes.data() + order[i] * stride), static_cast<std::streamsize>(stride));
+    }
+    out.close();
+    if (!out || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        logging::error("Cannot write ", path);
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+VectorIndex::~VectorIndex() {
+    close();
+}
+
+bool VectorIndex::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        logging::error("Not a vector file: ", path);
+        return false;
+    }
+    mappedBytes = static_cast<size_t>(info.st_size);
+    mapping = mmap(nullptr, mappedBytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        logging::error("Cannot map ", path);
+        return false;
+    }
+
+    const char* base = static_cast<const char*>(mapping);
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    Layout layout = layoutOf(header.dimensions, header.stride, header.count, header.lists);
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.dimensions == 0 ||
+        header.stride != alignUp(header.dimensions, kRowAlignment) || header.lists > kMaxLists ||
+        header.count > mappedBytes || layout.total != mappedBytes ||
+        header.embedder[sizeof(header.embedder) - 1] != '\0') {
+        logging::error("Not a vector file, or from another devpilot: ", path);
+        close();
+        return false;
+    }
+    count = header.count;
+    dims = header.dimensions;
+    stride = header.stride;
+    listCount = header.lists;
+    embedder = header.embedder;
+    stamp = header.indexStamp;
+    centroids = reinterpret_cast<const float*>(base + layout.centroids);
+    listStarts = reinterpret_cast<const uint64_t*>(base + layout.listStarts);
+    ids = reinterpret_cast<const int64_t*>(base + layout.ids);
+    scales = reinterpret_cast<const float*>(base + layout.scales);
+    codes = reinterpret_cast<const int8_t*>(base + layout.codes);
+
+    bool ordered = listStarts[0] == 0 && listStarts[listCount] == count;
+    for (size_t list = 0; ordered && list < listCount; list++) {
+        ordered = listStarts[list] <= listStarts[list + 1];
+    }
+    if (!ordered) {
+        logging::error("Corrupt vector file: ", path);
+        close();
+        return false;
+    }
+    return true;
+}
+
+void VectorIndex::close() {
+    if (mapping) {
+        munmap(mapping, mappedBytes);
+    }
+    mapping = nullptr;
+    mappedBytes = 0;
+    count = dims = stride = listCount = 0;
+    embedder.clear();
+    stamp = 0;
+    centroids = nullptr;
+    listStarts = nullptr;
+    ids = nullptr;
+    scales = nullptr;
+    codes = nullptr;
+}
+
+std::vector<VectorMatch> VectorIndex::search(const float* query, size_t k, size_t probes) const {
+    if (count == 0 || k == 0) {
+        return {};
+    }
+    probes = std::max<size_t>(1, std::min(probes, listCount));
+
+    // Centroids are few enough to score in float
+    std::vector<std::pair<float, size_t>> nearest(listCount);
+    for (size_t list = 0; list < listCount; list++) {
+        const float* centroid = centroids + list * dims;
+        float score = 0;
+        for (size_t d = 0; d < dims; d++) {
+            score += centroid[d] * query[d];
+        }
+        nearest[list] = {score, list};
+    }
+    std::partial_sort(nearest.begin(), nearest.begin() + static_cast<std::ptrdiff_t>(probes), nearest.end(),
+                      [](const std::pair<float, size_t>& a, const std::pair<float, size_t>& b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+    std::vector<size_t> lists(probes);
+    for (size_t i = 0; i < probes; i++) {
+        lists[i] = nearest[i].second;
+    }
+    return scan(query, k, lists.data(), probes);
+}
+
+std::vector<VectorMatch> VectorIndex::searchExact(const float* query, size_t k) const {
+    if (count == 0 || k == 0) {
+        return {};
+    }
+    return scan(query, k, nullptr, 0);
+}
+
+// All rows when lists is null. Ranking needs only the integer dot product
+// times each row's scale; the query's scale is applied to the k kept.
+std::vector<VectorMatch> VectorIndex::scan(const float* query, size_t k, const size_t* lists,
+                                           size_t probes) const {
+    std::vector<int8_t> queryCodes(stride, 0);
+    float queryScale = quantize(query, dims, queryCodes.data());
+    DotKernel dot = kernel().function;
+
+    std::vector<VectorMatch> heap;  // The k best so far, worst at the front
+    heap.reserve(k + 1);
+    auto scanRows = [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; row++) {
+            VectorMatch match{ids[row],
+                              static_cast<float>(dot(queryCodes.data(), codes + row * stride, stride)) * scales[row]};
+            if (heap.size() < k) {
+                heap.push_back(match);
+                std::push_heap(heap.begin(), heap.end(), better);
+            } else if (better(match, heap.front())) {
+                std::pop_heap(heap.begin(), heap.end(), better);
+                heap.back() = match;
+                std::push_heap(heap.begin(), heap.end(), better);
+            }
+        }
+    };
+    if (lists) {
+        for (size_t i = 0; i < probes; i++) {
+            scanRows(listStarts[lists[i]], listStarts[lists[i] + 1]);
+        }
+    } else {
+        scanRows(0, count);
+    }
+
+    std::sort_heap(heap.begin(), heap.end(), better);
+    for (auto& match : heap) {
+        match.score *= queryScale;
+    }
+    return heap;
+}
+
+} // namespace devpilot
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+// Unlike assert(), checked (and evaluated) in release builds too: a failure
+// names the condition and exits the test with a non-zero status
+#define CHECK(condition)                                                         \
+    do {                                                                         \
+        if (!(condition)) {                                                      \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: "      \
+                      << #condition << std::endl;                                \
+            std::exit(1);                                                        \
+        }                                                                        \
+    } while (0)
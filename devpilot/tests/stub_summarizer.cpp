@@ -0,0 +1,36 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Stands in for a model behind the summarize backend protocol (see
+// ProcessBackend): answers each body with its name and line count, last
+// request first, and appends "batch <count>" to the log named by argv[1]
+// so the test can see how requests were batched.
+
+int main(int argc, char* argv[]) {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (line.compare(0, 6, "batch ") != 0) {
+            return 1;
+        }
+        size_t count = std::stoul(line.substr(6));
+        std::ostringstream answers;
+        for (size_t i = 0; i < count; i++) {
+            std::string index, name, size;
+            std::getline(std::cin, index, '\t');
+            std::getline(std::cin, name, '\t');
+            std::getline(std::cin, size);
+            std::string body(std::stoul(size) + 1, '\0');
+            std::cin.read(&body[0], static_cast<std::streamsize>(body.size()));
+            size_t lines = static_cast<size_t>(std::count(body.begin(), body.end(), '\n'));
+            answers.str(index + "\t" + name + ": " + std::to_string(lines) + " lines\n" + answers.str());
+        }
+        if (argc > 1) {
+            std::ofstream(argv[1], std::ios::app) << "batch " << count << "\n";
+        }
+        std::cout << answers.str() << std::flush;
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "arena.hpp"
+#include "check.hpp"
+#include "parser.hpp"
+#include <string>
+#include <thread>
+#include <vector>
+
+// Strings copied into an arena stay where they are, however many chunks
+// follow them and however often the arena moves, until it is reset. Parse
+// results lean on that: their records view the arena, not the source, so
+// they outlive the source text and survive being moved around.
+
+using namespace devpilot;
+
+static void testArena() {
+    StringArena arena;
+    std::vector<std::string> texts;
+    std::vector<std::string_view> views;
+    // Enough to need several chunks, with one copy bigger than any chunk
+    for (int i = 0; i < 2000; i++) {
+        texts.push_back(i == 1000 ? std::string(300 * 1024, 'x') : "name_" + std::to_string(i));
+        views.push_back(arena.copy(texts.back()));
+    }
+    views.push_back(arena.concat("ns", "::", "name"));
+    CHECK(arena.bytesReserved() > 300 * 1024);
+    CHECK(arena.copy("").empty());
+
+    StringArena moved(std::move(arena));
+    CHECK(arena.bytesReserved() == 0);
+    StringArena assigned;
+    assigned = std::move(moved);
+    for (size_t i = 0; i < texts.size(); i++) {
+        CHECK(views[i] == texts[i]);
+    }
+    CHECK(views.back() == "ns::name");
+
+    assigned.reset();
+    CHECK(assigned.bytesReserved() == 0);
+    std::cout << "✓ Arena views stay valid across chunks and moves until reset" << std::endl;
+}
+
+static void testParseResult() {
+    std::string path = "geometry/shapes.cpp";
+    std::string source =
+        "namespace geometry {\n"
+        "class Matrix {\n"
+        "public:\n"
+        "    Matrix add(const Matrix& other) const;\n"
+        "};\n"
+        "int area(int width, int height) { return width * height; }\n"
+        "}\n";
+
+    std::vector<ParseResult> results;
+    {
+        CppParser parser;
+        CHECK(parser.isInitialized());
+        results.push_back(parser.parseSource(source, path, ParseDepth::FULL));
+    }
+    // Nothing left of the source, and the result moved as the vector grows
+    source.assign(source.size(), '?');
+    source = std::string();
+    for (int i = 0; i < 8; i++) {
+        results.emplace_back();
+    }
+
+    const ParseResult& result = results.front();
+    std::vector<Symbol> copies;
+    bool sawArea = false;
+    for (const SymbolRecord& record : result.symbols) {
+        CHECK(record.file_path.data() == path.data());
+        if (record.name == "area") {
+            sawArea = true;
+            CHECK(record.qualified_name == "geometry::area");
+            CHECK(record.parent_scope == "geometry");
+        }
+        copies.push_back(record.toSymbol());
+    }
+    CHECK(sawArea);
+    CHECK(!result.identifier_names.empty());
+    for (std::string_view name : result.identifier_names) {
+        CHECK(!name.empty() && name.find('?') == std::string_view::npos);
+    }
+
+    // Symbols own their strings and outlive the result
+    std::vector<std::string> names;
+    for (const SymbolRecord& record : result.symbols) {
+        names.push_back(std::string(record.name));
+    }
+    results.clear();
+    CHECK(copies.size() == names.size());
+    for (size_t i = 0; i < copies.size(); i++) {
+        CHECK(copies[i].name == names[i] && copies[i].file_path == path);
+    }
+    std::cout << "✓ Parse records view their arena, not the source, across moves" << std::endl;
+}
+
+static void testStringTable() {
+    StringTable table;
+    std::string_view first = table.intern("src/main.cpp");
+    std::vector<std::thread> threads;
+    std::vector<std::string_view> seen(8);
+    for (size_t t = 0; t < seen.size(); t++) {
+        threads.emplace_back([&table, &seen, t]() {
+            for (int i = 0; i < 1000; i++) {
+                table.intern("src/file" + std::to_string(i) + ".cpp");
+            }
+            seen[t] = table.intern(std::string("src/main.cpp"));
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    CHECK(table.size() == 1001);
+    for (std::string_view view : seen) {
+        CHECK(view.data() == first.data());
+    }
+    CHECK(first == "src/main.cpp");
+    std::cout << "✓ Interned strings are stored once and never move" << std::endl;
+}
+
+int main() {
+    testArena();
+    testParseResult();
+    testStringTable();
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include "check.hpp"
+#include "storage.hpp"
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Batch lookups return one group per key, in key order, holding what the
+// single lookup for that key would; repeated and unknown keys included.
+
+using namespace devpilot;
+namespace fs = std::filesystem;
+
+static void store(SqliteStorage& storage, const char* name, SymbolType type, const char* file, int line,
+                  const char* scope, const char* qualified) {
+    SymbolRecord symbol;
+    symbol.name = name;
+    symbol.type = type;
+    symbol.file_path = file;
+    symbol.line_number = line;
+    symbol.column_number = 1;
+    symbol.parent_scope = scope;
+    symbol.qualified_name = qualified;
+    CHECK(storage.storeSymbol(symbol) > 0);
+}
+
+static std::vector<std::string> describe(const std::vector<Symbol>& symbols) {
+    std::vector<std::string> described;
+    for (const Symbol& symbol : symbols) {
+        described.push_back(symbol.qualified_name + "@" + symbol.file_path + ":" +
+                            std::to_string(symbol.line_number));
+    }
+    return described;
+}
+
+static void testNames(SqliteStorage& storage) {
+    std::vector<std::string> keys = {"add", "Matrix::add", "missing", "add", "::geometry::Matrix::add",
+                                     "geometry::Matrix", "scale", "trix::add"};
+    auto groups = storage.lookupSymbols(keys);
+    CHECK(groups.size() == keys.size());
+
+    // Plain names match exactly, qualified ones as searchSymbols() does
+    CHECK(describe(groups[0]) == (std::vector<std::string>{
+        "add@c.cpp:3", "algebra::Matrix::add@b.cpp:5", "geometry::Matrix::add@a.cpp:10"}));
+    for (size_t i : {1, 4, 5}) {
+        CHECK(!groups[i].empty());
+        CHECK(describe(groups[i]) == describe(storage.searchSymbols(keys[i])));
+    }
+    CHECK(describe(groups[1]) == (std::vector<std::string>{
+        "algebra::Matrix::add@b.cpp:5", "geometry::Matrix::add@a.cpp:10"}));
+    CHECK(describe(groups[4]) == (std::vector<std::string>{"geometry::Matrix::add@a.cpp:10"}));
+    CHECK(groups[2].empty());
+    CHECK(describe(groups[3]) == describe(groups[0]));
+    CHECK(describe(groups[6]) == (std::vector<std::string>{"scale@a.cpp:20", "scale@b.cpp:8"}));
+    // A suffix only matches whole scope components
+    CHECK(groups[7].empty());
+    std::cout << "✓ Name lookups come back grouped per key" << std::endl;
+}
+
+static void testFiles(SqliteStorage& storage) {
+    auto groups = storage.getSymbolsInFiles({"b.cpp", "none.cpp", "a.cpp", "b.cpp"});
+    CHECK(groups.size() == 4);
+    CHECK(describe(groups[0]) == describe(storage.getSymbolsInFile("b.cpp")));
+    CHECK(describe(groups[0]) == (std::vector<std::string>{"algebra::Matrix::add@b.cpp:5", "scale@b.cpp:8"}));
+    CHECK(groups[1].empty());
+    CHECK(describe(groups[2]) == (std::vector<std::string>{
+        "geometry::Matrix@a.cpp:2", "geometry::Matrix::add@a.cpp:10", "scale@a.cpp:20"}));
+    CHECK(describe(groups[3]) == describe(groups[0]));
+    std::cout << "✓ File lookups come back grouped per key" << std::endl;
+}
+
+// A partially qualified name matches whole trailing scope components,
+// spelled exactly: "_" is no wildcard and case counts. Partial file paths
+// likewise.
+static void testExactSuffix(SqliteStorage& storage) {
+    SymbolRecord callee;
+    callee.name = "fit";
+    callee.type = SymbolType::FUNCTION;
+    callee.file_path = "e.cpp";
+    callee.line_number = 1;
+    callee.parent_scope = "geo::BoxA";
+    callee.qualified_name = "geo::BoxA::fit";
+    int64_t calleeId = storage.storeSymbol(callee);
+    SymbolRecord caller = callee;
+    caller.name = "layout";
+    caller.line_number = 5;
+    caller.parent_scope = "geo";
+    caller.qualified_name = "geo::layout";
+    int64_t callerId = storage.storeSymbol(caller);
+    int64_t fileId = storage.storeFile("e.cpp", 0);
+    CHECK(calleeId > 0 && callerId > 0 && fileId > 0);
+    CHECK(storage.storeCallEdge(callerId, calleeId, fileId, 6));
+
+    auto groups = storage.lookupSymbols({"BoxA::fit", "Box_::fit", "boxa::fit", "geo::BoxA::fit"});
+    CHECK(groups[0].size() == 1 && groups[1].empty() && groups[2].empty() && groups[3].size() == 1);
+    CHECK(storage.searchSymbols("BoxA::fit").size() == 1);
+    CHECK(storage.searchSymbols("Box_::fit").empty() && storage.searchSymbols("BOXA::fit").empty());
+    CHECK(storage.getSymbolUsages("BoxA::fit").size() == 1);
+    CHECK(storage.getSymbolUsages("Box_::fit").empty() && storage.getSymbolUsages("boxA::fit").empty());
+    CHECK(storage.getSymbolCallees("geo::layout").size() == 1);
+    CHECK(storage.getSymbolCallees("g_o::layout").empty() && storage.getSymbolCallees("GEO::layout").empty());
+
+    // File paths end in "/" plus the name given, under the same rule
+    int64_t serviceId = storage.storeFile("src/user_service.hpp", 0);
+    CHECK(storage.storeFile("src/userXservice.hpp", 0) > 0);
+    CHECK(storage.findFiles("user_service.hpp") == std::vector<int64_t>{serviceId});
+    CHECK(storage.findFiles("USER_SERVICE.hpp").empty() && storage.findFiles("r_service.hpp").empty());
+    std::cout << "✓ Qualified suffixes match exactly" << std::endl;
+}
+
+int main() {
+    fs::path work = fs::temp_directory_path() / ("devpilot_batch_" + std::to_string(getpid()));
+    fs::create_directories(work);
+    {
+        SqliteStorage storage;
+        CHECK(storage.initialize((work / "devpilot.db").string()));
+        store(storage, "Matrix", SymbolType::CLASS, "a.cpp", 2, "geometry", "geometry::Matrix");
+        store(storage, "add", SymbolType::FUNCTION, "a.cpp", 10, "geometry::Matrix", "geometry::Matrix::add");
+        store(storage, "scale", SymbolType::FUNCTION, "a.cpp", 20, "", "scale");
+        store(storage, "add", SymbolType::FUNCTION, "b.cpp", 5, "algebra::Matrix", "algebra::Matrix::add");
+        store(storage, "scale", SymbolType::FUNCTION, "b.cpp", 8, "", "scale");
+        store(storage, "add", SymbolType::FUNCTION, "c.cpp", 3, "", "add");
+
+        testNames(storage);
+        testFiles(storage);
+
+        // Inside an indexing transaction the batch sees uncommitted rows, and
+        // its keys are gone afterwards without disturbing the transaction
+        CHECK(storage.beginTransaction());
+        store(storage, "add", SymbolType::FUNCTION, "d.cpp", 1, "", "add");
+        auto groups = storage.lookupSymbols({"add"});
+        CHECK(groups.size() == 1 && groups[0].size() == 4);
+        groups = storage.lookupSymbols({"scale"});
+        CHECK(groups.size() == 1 && groups[0].size() == 2);
+        CHECK(storage.commitTransaction());
+        CHECK(storage.lookupSymbols({"add"})[0].size() == 4);
+        CHECK(storage.lookupSymbols({}).empty());
+
+        testExactSuffix(storage);
+    }
+    fs::remove_all(work);
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include "check.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+// Indexes a generated corpus under a memory budget and checks the peak the
+// indexer reports. The budget defaults to a little above the floor a one-file
+// run reports, plus an allowance for what every file adds to the floor: tight
+// enough that postings are written in several segments. A budget below the
+// floor has to be warned about. Files too big for a read buffer slot,
+// together well over the budget, have to fit in a budget just above the
+// floor. The corpus defaults to a size that runs in seconds; the nightly run
+// (BUILD_NIGHTLY_TESTS) sets DEVPILOT_SYNTHETIC_FILES=1000000.
+
+namespace fs = std::filesystem;
+
+// Lines of arithmetic in every function body, each four identifier
+// occurrences: enough postings to outgrow a batch at the default budget
+static const size_t kBodyLines = 300;
+
+static size_t envNumber(const char* name, size_t fallback) {
+    const char* value = std::getenv(name);
+    return value && *value ? std::stoull(value) : fallback;
+}
+
+// Every file includes and calls into the one before it, so the run also has
+// include edges and call edges to keep within the budget
+static void generateCorpus(const fs::path& root, size_t fileCount) {
+    const size_t filesPerDirectory = 1000;
+    for (size_t i = 0; i < fileCount; i++) {
+        fs::path directory = root / ("d" + std::to_string(i / filesPerDirectory));
+        if (i % filesPerDirectory == 0) {
+            fs::create_directories(directory);
+        }
+        std::string name = "f" + std::to_string(i);
+        std::ofstream header(directory / (name + ".h"));
+        header << "#pragma once\nnamespace n" << i << " { int " << name << "(int value); }\n";
+
+        std::ofstream source(directory / (name + ".cpp"));
+        source << "#include \"" << name << ".h\"\n";
+        if (i > 0) {
+            std::string previous = "f" + std::to_string(i - 1);
+            source << "#include \"../d" << (i - 1) / filesPerDirectory << "/" << previous << ".h\"\n"
+                   << "namespace n" << i << " {\nint " << name << "(int value) {\n";
+            for (size_t line = 0; line < kBodyLines; line++) {
+                source << "    value = (value ^ salt) + value / 3;\n";
+            }
+            source << "    return n" << i - 1 << "::" << previous << "(value) + 1;\n}\n}\n";
+        } else {
+            source << "namespace n0 {\nint f0(int value) {\n    return value;\n}\n}\n";
+        }
+    }
+}
+
+// Mostly comment, so holding the contents costs more than parsing them
+static const size_t kLargeFiles = 8;
+static const size_t kLargeFileBytes = 6 << 20;
+
+static void generateLargeFiles(const fs::path& root) {
+    fs::create_directories(root);
+    std::string comment = "// " + std::string(77, '-') + "\n";
+    for (size_t i = 0; i < kLargeFiles; i++) {
+        std::ofstream source(root / ("large" + std::to_string(i) + ".cpp"));
+        for (size_t written = 0; written < kLargeFileBytes; written += comment.size()) {
+            source << comment;
+        }
+        source << "int large" << i << "() { return " << i << "; }\n";
+    }
+}
+
+static size_t reportedNumber(const std::string& output, const std::string& label) {
+    size_t pos = output.find(label);
+    CHECK(pos != std::string::npos);
+    return std::stoull(output.substr(pos + label.size()));
+}
+
+// The index is written to the working directory, so each run is from a scratch one
+static std::string index(const std::string& executable, const fs::path& work, const fs::path& project,
+                         size_t budgetMiB) {
+    std::string command = "cd '" + work.string() + "' && '" + executable + "' index '" +
+                          project.string() + "' --no-cache --force --max-memory " +
+                          std::to_string(budgetMiB) + " 2>&1";
+    std::string output;
+    FILE* pipe = popen(command.c_str(), "r");
+    CHECK(pipe);
+    char buffer[4096];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, bytes);
+    }
+    int status = pclose(pipe);
+    std::cout << output << std::flush;
+    CHECK(status == 0);
+    return output;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: test_bounded_memory <devpilot executable>" << std::endl;
+        return 1;
+    }
+    size_t fileCount = envNumber("DEVPILOT_SYNTHETIC_FILES", 2000);
+    std::string executable = fs::absolute(argv[1]).string();
+
+    fs::path work = fs::temp_directory_path() / ("devpilot_bounded_" + std::to_string(getpid()));
+    fs::path probe = work / "probe";
+    fs::create_directories(probe);
+    generateCorpus(probe, 1);
+
+    // A budget below the floor is indexed anyway, with a warning
+    std::string output = index(executable, work, probe, 1);
+    CHECK(output.find("Memory budget of 1 MiB is below what indexing needs") != std::string::npos);
+    size_t floorMiB = reportedNumber(output, "floor ");
+    // The floor grows by what each file leaves behind until the run ends,
+    // about 2 KiB per generated pair, and the peak by a little more since the
+    // floor leaves out the allocator's own overhead
+    size_t budgetMiB = envNumber("DEVPILOT_SYNTHETIC_BUDGET_MIB", floorMiB + 12 + fileCount * 4 / 1024);
+
+    fs::path corpus = work / "corpus";
+    fs::create_directories(corpus);
+    generateCorpus(corpus, fileCount);
+    std::cout << "Generated " << fileCount * 2 << " files under " << corpus << std::endl;
+
+    output = index(executable, work, corpus, budgetMiB);
+    CHECK(output.find("is below what indexing needs") == std::string::npos);
+    CHECK(reportedNumber(output, "Files processed: ") == fileCount * 2);
+    size_t segments = reportedNumber(output, "bytes of postings in ");
+    CHECK(segments > 1);
+    size_t peakMiB = reportedNumber(output, "Peak memory: ");
+    CHECK(peakMiB <= budgetMiB);
+    size_t corpusFloorMiB = reportedNumber(output, "floor ");
+    CHECK(corpusFloorMiB > floorMiB || fileCount < 1000);
+
+    std::cout << "✓ Indexed " << fileCount * 2 << " files with a peak of " << peakMiB
+              << " MiB (budget " << budgetMiB << " MiB, floor " << corpusFloorMiB << " MiB), postings in "
+              << segments << " segments" << std::endl;
+
+    // One at a time they fit in a little over the floor; read all at once
+    // they would take the process far over
+    fs::path large = work / "large";
+    generateLargeFiles(large);
+    size_t largeBudgetMiB = floorMiB + 8;
+    output = index(executable, work, large, largeBudgetMiB);
+    fs::remove_all(work);
+    CHECK(reportedNumber(output, "Files processed: ") == kLargeFiles);
+    peakMiB = reportedNumber(output, "Peak memory: ");
+    CHECK(peakMiB <= largeBudgetMiB);
+    std::cout << "✓ Indexed " << kLargeFiles << " files of " << (kLargeFileBytes >> 20) << " MiB with a peak of "
+              << peakMiB << " MiB (budget " << largeBudgetMiB << " MiB)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include "devpilot.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Drives devpilot_core through its C API only, as an editor linking it
+ * in-process would: index a small project, then query it from several
+ * threads at once. Written in C so the header is checked as C. */
+
+/* Unlike assert(), still checked (and run) in release builds */
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            exit(1);                                                                  \
+        }                                                                             \
+    } while (0)
+
+#define QUERY_THREADS 8
+#define QUERIES_PER_THREAD 200
+
+static char work[256];
+
+static void writeFile(const char* name, const char* contents) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/project/%s", work, name);
+    FILE* file = fopen(path, "w");
+    CHECK(file);
+    fputs(contents, file);
+    fclose(file);
+}
+
+static int contains(const char* text, size_t length, const char* needle) {
+    size_t size = strlen(needle);
+    for (size_t i = 0; i + size <= length; i++) {
+        if (memcmp(text + i, needle, size) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static const char* kHeader =
+    "#pragma once\n"
+    "namespace geometry {\n"
+    "class Matrix {\n"
+    "public:\n"
+    "    int add(int value);\n"
+    "};\n"
+    "int scale(int value);\n"
+    "int clamp(int value, int low = 0, int high = 255);\n"
+    "}\n";
+
+static const char* kSource =
+    "#include \"geometry.h\"\n"
+    "namespace geometry {\n"
+    "int scale(int value) {\n"
+    "    return value * 2;\n"
+    "}\n"
+    "int Matrix::add(int value) {\n"
+    "    return scale(value) + 1;\n"
+    "}\n"
+    "}\n";
+
+static void test_index_and_query(devpilot_index* index) {
+    devpilot_results* results = NULL;
+    CHECK(devpilot_search(index, "scale", 0, NULL, &results) == DEVPILOT_OK);
+    CHECK(devpilot_results_count(results) >= 1);
+    const devpilot_symbol* symbol = devpilot_results_symbol(results, 0);
+    CHECK(symbol && strcmp(symbol->name, "scale") == 0);
+    CHECK(symbol->kind == DEVPILOT_SYMBOL_FUNCTION);
+    CHECK(devpilot_results_string(results, 0) == NULL);
+    CHECK(devpilot_results_symbol(results, devpilot_results_count(results)) == NULL);
+    CHECK(symbol->param_count == 1 && symbol->required_param_count == 1);
+
+    /* The definition's text comes straight from the mapped file */
+    size_t i = 0;
+    while (i < devpilot_results_count(results) &&
+           strstr(devpilot_results_symbol(results, i)->file_path, ".cpp") == NULL) {
+        i++;
+    }
+    CHECK(i < devpilot_results_count(results));
+    const char* text = NULL;
+    size_t length = 0;
+    CHECK(devpilot_results_source(results, i, &text, &length) == DEVPILOT_OK);
+    CHECK(length > 0 && contains(text, length, "value * 2"));
+    devpilot_results_free(results);
+
+    const char* names[] = {"Matrix", "missing", "scale"};
+    CHECK(devpilot_lookup(index, names, 3, 0, NULL, &results) == DEVPILOT_OK);
+    int groups[3] = {0, 0, 0};
+    for (i = 0; i < devpilot_results_count(results); i++) {
+        groups[devpilot_results_symbol(results, i)->group]++;
+    }
+    CHECK(groups[0] >= 1 && groups[1] == 0 && groups[2] >= 1);
+    devpilot_results_free(results);
+
+    /* Parameter counts are stored with the symbol, default arguments apart */
+    CHECK(devpilot_search(index, "clamp", 0, NULL, &results) == DEVPILOT_OK);
+    CHECK(devpilot_results_count(results) == 1);
+    symbol = devpilot_results_symbol(results, 0);
+    CHECK(symbol->param_count == 3 && symbol->required_param_count == 1);
+    devpilot_results_free(results);
+
+    CHECK(devpilot_usages(index, "scale", 0, NULL, &results) == DEVPILOT_OK);
+    CHECK(devpilot_results_count(results) == 1);
+    CHECK(strstr(devpilot_results_string(results, 0), "add") != NULL);
+    devpilot_results_free(results);
+
+    CHECK(devpilot_references(index, "scale", 0, NULL, &results) == DEVPILOT_OK);
+    CHECK(devpilot_results_count(results) >= 2);
+    CHECK(devpilot_results_reference(results, 0)->line > 0);
+    devpilot_results_free(results);
+
+    CHECK(devpilot_dependents(index, "geometry.h", 0, NULL, &results) == DEVPILOT_OK);
+    CHECK(devpilot_results_count(results) == 1);
+    CHECK(strstr(devpilot_results_string(results, 0), "geometry.cpp") != NULL);
+    devpilot_results_free(results);
+
+    printf("✓ C API index and query test passed\n");
+}
+
+static void test_errors_and_cancellation(devpilot_index* index) {
+    devpilot_results* results = (devpilot_results*)&results;
+    CHECK(devpilot_search(index, NULL, 0, NULL, &results) == DEVPILOT_INVALID_ARGUMENT);
+    CHECK(strlen(devpilot_last_error()) > 0);
+
+    devpilot_token* token = devpilot_token_create();
+    devpilot_token_cancel(token);
+    CHECK(devpilot_search(index, "a", 0, token, &results) == DEVPILOT_TRUNCATED);
+    CHECK(devpilot_results_truncated(results));
+    devpilot_results_free(results);
+    devpilot_token_free(token);
+
+    CHECK(devpilot_index_project(index, "/nonexistent/devpilot", NULL, 0, 1) == DEVPILOT_INDEX_FAILED);
+    printf("✓ C API error and cancellation test passed\n");
+}
+
+static void* queryRepeatedly(void* argument) {
+    devpilot_index* index = (devpilot_index*)argument;
+    char header[300];
+    snprintf(header, sizeof(header), "%s/project/geometry.h", work);
+    const char* files[] = {header};
+    for (int i = 0; i < QUERIES_PER_THREAD; i++) {
+        devpilot_results* results = NULL;
+        if (devpilot_search(index, "Matrix", 0, NULL, &results) != DEVPILOT_OK ||
+            devpilot_results_count(results) == 0) {
+            return (void*)1;
+        }
+        devpilot_results_free(results);
+        if (devpilot_outline(index, files, 1, 0, NULL, &results) != DEVPILOT_OK ||
+            devpilot_results_count(results) < 3) {
+            return (void*)1;
+        }
+        devpilot_results_free(results);
+    }
+    return NULL;
+}
+
+static void test_concurrent_queries(devpilot_index* index) {
+    pthread_t threads[QUERY_THREADS];
+    for (int i = 0; i < QUERY_THREADS; i++) {
+        CHECK(pthread_create(&threads[i], NULL, queryRepeatedly, index) == 0);
+    }
+    for (int i = 0; i < QUERY_THREADS; i++) {
+        void* failed = NULL;
+        pthread_join(threads[i], &failed);
+        CHECK(failed == NULL);
+    }
+    printf("✓ C API concurrent query test passed\n");
+}
+
+int main(void) {
+    CHECK(devpilot_api_version() == DEVPILOT_API_VERSION);
+    devpilot_set_log_level(DEVPILOT_LOG_WARNING);
+
+    snprintf(work, sizeof(work), "/tmp/devpilot_c_api_%d", (int)getpid());
+    char command[600];
+    snprintf(command, sizeof(command), "mkdir -p '%s/project'", work);
+    CHECK(system(command) == 0);
+    writeFile("geometry.h", kHeader);
+    writeFile("geometry.cpp", kSource);
+
+    char database[300];
+    char project[300];
+    snprintf(database, sizeof(database), "%s/devpilot.db", work);
+    snprintf(project, sizeof(project), "%s/project", work);
+
+    devpilot_index* index = NULL;
+    CHECK(devpilot_open(database, &index) == DEVPILOT_OK);
+    /* Nothing indexed yet: queries fail, and leave no database behind */
+    devpilot_results* results = NULL;
+    CHECK(devpilot_search(index, "scale", 0, NULL, &results) == DEVPILOT_OPEN_FAILED);
+    CHECK(results == NULL && strstr(devpilot_last_error(), "devpilot index") != NULL);
+    CHECK(access(database, F_OK) != 0);
+    CHECK(devpilot_index_project(index, project, NULL, 0, 2) == DEVPILOT_OK);
+
+    test_index_and_query(index);
+    test_errors_and_cancellation(index);
+    test_concurrent_queries(index);
+    devpilot_close(index);
+
+    snprintf(command, sizeof(command), "rm -rf '%s'", work);
+    CHECK(system(command) == 0);
+    printf("All C API tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "call_resolver.hpp"
+#include "check.hpp"
+#include <string>
+#include <vector>
+
+// Calls bound to the candidate that fits best: the overload whose arity
+// matches, the function in the caller's own namespace over a sibling's, and
+// between equally good candidates the one first in path order, whatever order
+// the files were added in. A qualifier naming a scope no candidate lives in
+// leaves the call unresolved rather than guessed.
+
+using namespace devpilot;
+
+struct Function {
+    int64_t id;
+    int64_t fileId;
+    const char* path;
+    const char* scope;
+    const char* name;
+    int params;
+    int required;
+};
+
+struct Call {
+    int64_t caller;
+    int64_t fileId;
+    const char* callee;
+    const char* qualifier;
+    int args;
+};
+
+static void add(CallResolver& resolver, const Function& function) {
+    std::string scope = function.scope;
+    SymbolRecord record;
+    record.name = function.name;
+    record.type = SymbolType::FUNCTION;
+    record.file_path = function.path;
+    record.parent_scope = scope;
+    std::string qualified = scope.empty() ? function.name : scope + "::" + function.name;
+    record.qualified_name = qualified;
+    record.param_count = function.params;
+    record.required_param_count = function.required;
+    resolver.addSymbol(function.id, function.fileId, record);
+}
+
+// The callee each call resolves to, in order, or 0 when unresolved
+static std::vector<int64_t> resolve(const std::vector<Function>& functions, const std::vector<Call>& calls) {
+    CallResolver resolver;
+    for (const Function& function : functions) {
+        add(resolver, function);
+    }
+    int line = 1;
+    for (const Call& call : calls) {
+        CallSite site{0, call.callee, call.qualifier, false, call.args, line++, 1};
+        resolver.addCall(call.caller, call.fileId, site);
+    }
+
+    std::vector<CallEdge> edges;
+    std::vector<UnresolvedCall> unresolved;
+    resolver.resolve(edges, unresolved);
+    CHECK(edges.size() + unresolved.size() == calls.size());
+    std::vector<int64_t> callees(calls.size(), 0);
+    for (const CallEdge& edge : edges) {
+        callees[edge.line_number - 1] = edge.callee_id;
+    }
+    for (const UnresolvedCall& call : unresolved) {
+        CHECK(callees[call.line_number - 1] == 0 && call.callee_name == calls[call.line_number - 1].callee);
+    }
+    return callees;
+}
+
+static void testArity() {
+    std::vector<Function> functions = {
+        {1, 1, "src/util.cpp", "util", "format", 1, 1},
+        {2, 1, "src/util.cpp", "util", "format", 3, 2},  // Last parameter defaulted
+        {3, 1, "src/util.cpp", "util", "run", 0, 0},
+    };
+    std::vector<Call> calls = {
+        {3, 1, "format", "", 1},
+        {3, 1, "format", "", 2},
+        {3, 1, "format", "", 3},
+    };
+    CHECK(resolve(functions, calls) == (std::vector<int64_t>{1, 2, 2}));
+    std::cout << "✓ Overloads chosen by argument count" << std::endl;
+}
+
+static void testSiblingNamespaces() {
+    // Callers in a file of their own, so only scope tells the candidates apart
+    std::vector<Function> functions = {
+        {10, 2, "src/a.cpp", "net::a", "helper", 0, 0},
+        {11, 3, "src/b.cpp", "net::b", "helper", 0, 0},
+        {20, 4, "src/main.cpp", "net::a", "go", 0, 0},
+        {21, 4, "src/main.cpp", "net::b", "go", 0, 0},
+    };
+    std::vector<Call> calls = {
+        {20, 4, "helper", "", 0},
+        {21, 4, "helper", "", 0},
+        {20, 4, "helper", "b", 0},      // Qualified: reaches the sibling
+        {20, 4, "helper", "net::b", 0},
+    };
+    CHECK(resolve(functions, calls) == (std::vector<int64_t>{10, 11, 11, 11}));
+    std::cout << "✓ Same-named functions resolved by the caller's namespace" << std::endl;
+}
+
+static void testUnknownQualifier() {
+    std::vector<Function> functions = {
+        {10, 2, "src/a.cpp", "net::a", "helper", 0, 0},
+        {11, 3, "src/b.cpp", "net::b", "helper", 0, 0},
+        {20, 2, "src/a.cpp", "net::a", "go", 0, 0},
+    };
+    // Neither candidate lives in "c" or a top-level "a"; the caller's own
+    // helper, in the same file and scope, must not be taken instead
+    std::vector<Call> calls = {
+        {20, 2, "helper", "c", 0},
+        {20, 2, "helper", "net::c", 0},
+        {20, 2, "helper", "other::a", 0},
+        {20, 2, "helper", "a", 0},
+    };
+    CHECK(resolve(functions, calls) == (std::vector<int64_t>{0, 0, 0, 10}));
+    std::cout << "✓ Qualified calls to a scope with no candidate stay unresolved" << std::endl;
+}
+
+static void testTieByPath() {
+    // Equally good candidates; the later path was added first and has the
+    // lower id, as happens when its file finishes parsing sooner
+    Function later{5, 5, "z/log.cpp", "", "log", 1, 1};
+    Function earlier{9, 6, "m/log.cpp", "", "log", 1, 1};
+    Function caller{30, 7, "src/main.cpp", "", "main", 0, 0};
+    std::vector<Call> calls = {{30, 7, "log", "", 1}};
+    CHECK(resolve({later, earlier, caller}, calls) == (std::vector<int64_t>{9}));
+    CHECK(resolve({earlier, later, caller}, calls) == (std::vector<int64_t>{9}));
+    std::cout << "✓ Ties go to the first candidate in path order, whatever the order added" << std::endl;
+}
+
+int main() {
+    testArity();
+    testSiblingNamespaces();
+    testUnknownQualifier();
+    testTieByPath();
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "check.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sqlite3.h>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+// Re-indexes a generated corpus in the background and runs searches until
+// it finishes: each must answer from the previous index while the indexer's
+// write transaction is open, rather than fail on the lock or find nothing.
+// A lock that cannot be waited out has to be reported as such by serve.
+
+namespace fs = std::filesystem;
+
+static std::string run(const std::string& command, int& status) {
+    std::string output;
+    FILE* pipe = popen(command.c_str(), "r");
+    CHECK(pipe);
+    char buffer[4096];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, bytes);
+    }
+    status = pclose(pipe);
+    return output;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: test_concurrent_query <devpilot executable>" << std::endl;
+        return 1;
+    }
+    const char* files = std::getenv("DEVPILOT_SYNTHETIC_FILES");
+    size_t fileCount = files && *files ? std::stoull(files) : 8000;
+
+    fs::path work = fs::temp_directory_path() / ("devpilot_concurrent_" + std::to_string(getpid()));
+    fs::path corpus = work / "corpus";
+    for (size_t i = 0; i < fileCount; i++) {
+        fs::path directory = corpus / ("d" + std::to_string(i / 1000));
+        if (i % 1000 == 0) {
+            fs::create_directories(directory);
+        }
+        std::ofstream(directory / ("f" + std::to_string(i) + ".cpp"))
+            << "namespace n" << i << " {\nint f" << i << "(int value) {\n    return value + " << i
+            << ";\n}\n}\n";
+    }
+
+    std::string executable = fs::absolute(argv[1]).string();
+    std::string prefix = "cd '" + work.string() + "' && '" + executable + "' ";
+    int status;
+    run(prefix + "index '" + corpus.string() + "' --quiet 2>&1", status);
+    CHECK(status == 0);
+
+    pid_t indexer = fork();
+    CHECK(indexer >= 0);
+    if (indexer == 0) {
+        std::string command = prefix + "index '" + corpus.string() + "' --force --no-cache --quiet > /dev/null 2>&1";
+        execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+
+    // A search counts once the indexer has written into the log and is
+    // still running after the search is answered
+    fs::path wal = work / "devpilot.db-wal";
+    size_t overlapping = 0;
+    size_t searches = 0;
+    int indexStatus = 0;
+    while (waitpid(indexer, &indexStatus, WNOHANG) == 0) {
+        std::error_code error;
+        bool writing = fs::exists(wal, error) && fs::file_size(wal, error) > 0;
+        std::string output = run(prefix + "search f7 2>&1", status);
+        searches++;
+        CHECK(status == 0);
+        CHECK(output.find("locked") == std::string::npos);
+        CHECK(output.find("function n7::f7 ") != std::string::npos);
+        if (writing && waitpid(indexer, &indexStatus, WNOHANG) == 0) {
+            overlapping++;
+        } else if (!writing) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+    CHECK(WIFEXITED(indexStatus) && WEXITSTATUS(indexStatus) == 0);
+
+    std::cout << searches << " searches, " << overlapping << " answered while indexing wrote" << std::endl;
+    CHECK(overlapping > 0);
+    std::cout << "✓ Queries read the previous index while indexing runs" << std::endl;
+
+    // Out of WAL mode, an exclusive lock keeps every reader out until the
+    // busy timeout runs out; the query failed, it did not find nothing
+    sqlite3* locker = nullptr;
+    CHECK(sqlite3_open((work / "devpilot.db").string().c_str(), &locker) == SQLITE_OK);
+    CHECK(sqlite3_exec(locker, "PRAGMA journal_mode = DELETE; BEGIN EXCLUSIVE", nullptr, nullptr, nullptr) ==
+          SQLITE_OK);
+    std::string serve = "cd '" + work.string() + "' && printf '1 search f7\\n' | '" + executable +
+                        "' serve 2>/dev/null";
+    std::string locked = run(serve, status);
+    CHECK(sqlite3_exec(locker, "ROLLBACK; PRAGMA journal_mode = WAL", nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_close(locker);
+    CHECK(locked.find("1\terror\t") != std::string::npos);
+    CHECK(locked.find("1\tdone") == std::string::npos);
+    std::string unlocked = run(serve, status);
+    CHECK(unlocked.find("1\tdone\t") != std::string::npos);
+    std::cout << "✓ Serve answers a query that fails on a lock with an error" << std::endl;
+
+    fs::remove_all(work);
+    return 0;
+}
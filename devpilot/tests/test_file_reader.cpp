@@ -0,0 +1,121 @@
+#include "check.hpp"
+#include "file_reader.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Reads files of every size through both backends: small ones into the pool,
+// bigger ones into heap buffers that together stay within the heap budget
+// however slowly the consumer releases them, and one file bigger than the
+// whole budget on its own.
+
+using namespace devpilot;
+namespace fs = std::filesystem;
+
+static const size_t kSlotSize = 4096;
+static const size_t kLargeSize = 40 * 1024;
+static const uint64_t kHeapLimit = 100 * 1024;  // Room for two large files
+
+static std::string contentsOf(size_t index, size_t size) {
+    std::string text;
+    while (text.size() < size) {
+        text += "// file " + std::to_string(index) + " line " + std::to_string(text.size()) + "\n";
+    }
+    text.resize(size);
+    return text;
+}
+
+struct Corpus {
+    std::vector<std::string> paths;
+    std::vector<std::string> contents;
+};
+
+static Corpus writeCorpus(const fs::path& root) {
+    fs::create_directories(root);
+    Corpus corpus;
+    for (size_t i = 0; i < 40; i++) {
+        // Every third file is too big for a slot, the last bigger than the budget
+        size_t size = i == 39 ? 3 * kHeapLimit : i % 3 == 0 ? kLargeSize : 100 + i * 50;
+        fs::path path = root / ("file" + std::to_string(i) + ".cpp");
+        corpus.contents.push_back(contentsOf(i, size));
+        std::ofstream(path, std::ios::binary) << corpus.contents.back();
+        corpus.paths.push_back(path.string());
+    }
+    return corpus;
+}
+
+static std::string readAll(const Corpus& corpus) {
+    FileReader reader(8, kSlotSize, 2, UINT64_MAX, kHeapLimit);
+
+    WorkQueue<ReadRequest> requests;
+    for (size_t i = 0; i < corpus.paths.size(); i++) {
+        requests.push({corpus.paths[i], i});
+    }
+    requests.close();
+
+    // The consumer holds each buffer a while, so the reader runs ahead as far
+    // as the pool and the budget let it. Counts drop before a buffer goes, so
+    // they never exceed what is really held.
+    WorkQueue<ReadCompletion> completed;
+    std::atomic<size_t> heldLarge{0};
+    std::atomic<size_t> mostLarge{0};
+    std::vector<bool> seen(corpus.paths.size(), false);
+    std::thread consumer([&]() {
+        ReadCompletion read;
+        while (completed.pop(read)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            CHECK(read.buffer.ok() && !read.buffer.deferred());
+            CHECK(read.buffer.contents() == corpus.contents[read.user_data]);
+            seen[read.user_data] = true;
+            if (read.buffer.contents().size() > kSlotSize) {
+                heldLarge--;
+            }
+            read.buffer = FileBuffer();
+        }
+    });
+    reader.run(requests, [&](ReadCompletion read) {
+        if (read.buffer.contents().size() > kSlotSize) {
+            size_t held = ++heldLarge;
+            size_t most = mostLarge.load();
+            while (held > most && !mostLarge.compare_exchange_weak(most, held)) {
+            }
+        }
+        completed.push(std::move(read));
+    });
+    completed.close();
+    consumer.join();
+
+    CHECK(std::all_of(seen.begin(), seen.end(), [](bool read) { return read; }));
+    CHECK(mostLarge.load() >= 1 && mostLarge.load() <= 2);
+    std::cout << "✓ " << reader.backend() << ": " << corpus.paths.size() << " files read, at most "
+              << mostLarge.load() << " large ones held" << std::endl;
+    return reader.backend();
+}
+
+int main() {
+    fs::path work = fs::temp_directory_path() / ("devpilot_reader_" + std::to_string(getpid()));
+    Corpus corpus = writeCorpus(work);
+
+    // io_uring where the kernel allows it, then the thread fallback
+    readAll(corpus);
+    setenv("DEVPILOT_NO_IO_URING", "1", 1);
+    CHECK(readAll(corpus) == "threads");
+
+    // Files above the stream limit are only sized, not read
+    FileBuffer deferred = FileReader::read(corpus.paths.back(), kLargeSize);
+    CHECK(!deferred.ok() && deferred.deferred() && deferred.fileSize() == 3 * kHeapLimit);
+    std::ofstream(work / "empty.cpp");
+    FileBuffer empty = FileReader::read((work / "empty.cpp").string());
+    CHECK(empty.ok() && empty.contents().empty());
+    std::cout << "✓ Deferred and empty files read as such" << std::endl;
+
+    fs::remove_all(work);
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include "check.hpp"
+#include "git_index.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Reads hand-written .git/index files in versions 2, 3 and 4, including a
+// version 4 prefix strip long enough to take a two-byte varint, then checks
+// an index written by git itself when git is installed.
+
+using namespace devpilot;
+namespace fs = std::filesystem;
+
+struct Entry {
+    std::string path;
+    unsigned char blobByte;  // The object id is this byte, repeated
+    uint32_t mode = 0100644;
+    uint16_t stage = 0;
+    bool skipWorktree = false;
+};
+
+static void bigEndian(std::string& out, uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+// Git's offset varint (varint.c): every continuation also adds one
+static void gitVarint(std::string& out, uint64_t value) {
+    unsigned char bytes[16];
+    size_t pos = sizeof(bytes) - 1;
+    bytes[pos] = value & 127;
+    while (value >>= 7) {
+        bytes[--pos] = static_cast<unsigned char>(128 | (--value & 127));
+    }
+    out.append(reinterpret_cast<const char*>(bytes + pos), sizeof(bytes) - pos);
+}
+
+static std::string writeIndex(uint32_t version, const std::vector<Entry>& entries) {
+    std::string out = "DIRC";
+    bigEndian(out, version, 4);
+    bigEndian(out, entries.size(), 4);
+    std::string previous;
+    for (size_t i = 0; i < entries.size(); i++) {
+        const Entry& entry = entries[i];
+        size_t start = out.size();
+        bigEndian(out, 0, 8);                  // ctime
+        bigEndian(out, 1700000000 + i, 4);     // mtime seconds
+        bigEndian(out, 500 + i, 4);            // mtime nanoseconds
+        bigEndian(out, 0, 8);                  // dev, ino
+        bigEndian(out, entry.mode, 4);
+        bigEndian(out, 0, 8);                  // uid, gid
+        bigEndian(out, 100 + i, 4);            // size
+        out.append(20, static_cast<char>(entry.blobByte));
+        uint16_t flags = static_cast<uint16_t>(std::min<size_t>(entry.path.size(), 0xFFF)) |
+                         static_cast<uint16_t>(entry.stage << 12) | (entry.skipWorktree ? 0x4000 : 0);
+        bigEndian(out, flags, 2);
+        if (entry.skipWorktree) {
+            bigEndian(out, 0x4000, 2);
+        }
+        if (version == 4) {
+            size_t common = 0;
+            while (common < previous.size() && common < entry.path.size() &&
+                   previous[common] == entry.path[common]) {
+                common++;
+            }
+            gitVarint(out, previous.size() - common);
+            out += entry.path.substr(common);
+            out.push_back('\0');
+        } else {
+            out += entry.path;
+            out.append(8 - (out.size() - start) % 8, '\0');
+        }
+        previous = entry.path;
+    }
+    out += std::string("TREE") + std::string("\0\0\0\0", 4);  // An empty extension
+    out.append(20, '\x5a');                                     // Checksum, not verified
+    return out;
+}
+
+static void testVersion(const fs::path& repo, uint32_t version) {
+    std::string deep = "src/" + std::string(150, 'x') + "/deeply/nested/widget.cpp";
+    std::vector<Entry> entries = {
+        {deep, 0x11},
+        {"src/b.cpp", 0x22},            // Strips most of the long path
+        {"src/b.h", 0x33},              // Strips "cpp"
+        {"src/conflict.cpp", 0x44, 0100644, 1},
+        {"src/link.h", 0x55, 0120000},
+    };
+    if (version >= 3) {
+        entries.push_back({"src/sparse.cpp", 0x66, 0100644, 0, true});
+    }
+    fs::create_directories(repo / ".git");
+    std::ofstream(repo / ".git" / "index", std::ios::binary | std::ios::trunc) << writeIndex(version, entries);
+
+    GitIndex index;
+    CHECK(index.load((repo / "src").string()));
+    CHECK(index.workTree() == repo.generic_string());
+    CHECK(index.size() == 3);
+
+    const GitIndexEntry* widget = index.find((repo / deep).string());
+    CHECK(widget && widget->path == deep && widget->blob_id == std::string(40, '1'));
+    const GitIndexEntry* header = index.find((repo / "src/b.h").string());
+    CHECK(header && header->blob_id == std::string(40, '3'));
+    CHECK(header->mtime_seconds == 1700000002 && header->mtime_nanoseconds == 502 && header->size == 102);
+    CHECK(index.find((repo / "src/b.cpp").string())->blob_id == std::string(40, '2'));
+
+    // Conflicts, symlinks and skip-worktree entries describe no work tree file
+    CHECK(!index.find((repo / "src/conflict.cpp").string()));
+    CHECK(!index.find((repo / "src/link.h").string()));
+    CHECK(!index.find((repo / "src/sparse.cpp").string()));
+    CHECK(!index.find((repo / "src/missing.cpp").string()));
+    std::cout << "✓ Index version " << version << " parsed" << std::endl;
+}
+
+static std::string run(const std::string& command) {
+    std::string output;
+    FILE* pipe = popen(command.c_str(), "r");
+    CHECK(pipe);
+    char buffer[4096];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, bytes);
+    }
+    CHECK(pclose(pipe) == 0);
+    return output;
+}
+
+// Blob ids must agree with `git ls-files -s` whichever version git wrote
+static void testRealGit(const fs::path& repo) {
+    if (std::system("git --version > /dev/null 2>&1") != 0) {
+        std::cout << "- git not installed; skipped the index written by git" << std::endl;
+        return;
+    }
+    fs::create_directories(repo / "lib" / std::string(140, 'y'));
+    std::ofstream(repo / "lib" / "a.cpp") << "int a() { return 1; }\n";
+    std::ofstream(repo / "lib" / "a.h") << "int a();\n";
+    std::ofstream(repo / "lib" / std::string(140, 'y') / "z.cpp") << "int z() { return 26; }\n";
+    // Older than the index, so the racy-clean check cannot fire
+    for (const char* path : {"lib/a.cpp", "lib/a.h"}) {
+        fs::last_write_time(repo / path, fs::last_write_time(repo / path) - std::chrono::seconds(10));
+    }
+    std::string git = "cd '" + repo.string() + "' && git -c init.defaultBranch=main ";
+    run(git + "init -q && git add lib");
+
+    for (int version : {2, 3, 4}) {
+        run(git + "update-index --index-version " + std::to_string(version));
+        GitIndex index;
+        CHECK(index.load(repo.string()));
+        CHECK(index.size() == 3);
+        std::string listed = run(git + "ls-files -s");
+        for (const char* path : {"lib/a.cpp", "lib/a.h"}) {
+            const GitIndexEntry* entry = index.find((repo / path).string());
+            CHECK(entry);
+            CHECK(listed.find(entry->blob_id + " 0\t" + path) != std::string::npos);
+            CHECK(index.isUnchanged((repo / path).string(), *entry));
+        }
+    }
+    std::cout << "✓ Indexes written by git parsed in versions 2, 3 and 4" << std::endl;
+}
+
+int main() {
+    fs::path work = fs::temp_directory_path() / ("devpilot_git_index_" + std::to_string(getpid()));
+    for (uint32_t version : {2u, 3u, 4u}) {
+        testVersion(work / ("v" + std::to_string(version)), version);
+    }
+    testRealGit(work / "git");
+    fs::remove_all(work);
+    return 0;
+}
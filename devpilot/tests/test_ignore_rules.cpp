@@ -0,0 +1,121 @@
+#include "check.hpp"
+#include "file_walker.hpp"
+#include "ignore_rules.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Ignore patterns the way git applies them: the last matching line wins,
+// "!" re-includes, deeper ignore files override shallower ones, and nothing
+// inside an ignored directory comes back.
+
+using namespace devpilot;
+namespace fs = std::filesystem;
+
+using Match = IgnoreRules::Match;
+
+static void testPatterns() {
+    IgnoreRules rules;
+    rules.addPatterns(
+        "# generated code\n"
+        "*.gen.cpp\n"
+        "!keep.gen.cpp\n"
+        "keep.gen.cpp.bak\n"
+        "\\!bang.cpp\n"
+        "out/\n"
+        "/top.cpp\n"
+        "docs/**/skip.cpp\n"
+        "tmp[0-9].h\r\n");
+
+    CHECK(rules.match("x.gen.cpp", "x.gen.cpp", false) == Match::IGNORED);
+    CHECK(rules.match("a/b/x.gen.cpp", "x.gen.cpp", false) == Match::IGNORED);
+    CHECK(rules.match("a/keep.gen.cpp", "keep.gen.cpp", false) == Match::INCLUDED);
+    CHECK(rules.match("x.cpp", "x.cpp", false) == Match::NONE);
+    CHECK(rules.match("!bang.cpp", "!bang.cpp", false) == Match::IGNORED);
+
+    // Directory-only patterns leave files of the same name alone
+    CHECK(rules.match("out", "out", true) == Match::IGNORED);
+    CHECK(rules.match("out", "out", false) == Match::NONE);
+
+    // A leading or inner "/" anchors to the rules' own directory
+    CHECK(rules.match("top.cpp", "top.cpp", false) == Match::IGNORED);
+    CHECK(rules.match("a/top.cpp", "top.cpp", false) == Match::NONE);
+    CHECK(rules.match("docs/skip.cpp", "skip.cpp", false) == Match::IGNORED);
+    CHECK(rules.match("docs/a/b/skip.cpp", "skip.cpp", false) == Match::IGNORED);
+    CHECK(rules.match("src/docs/skip.cpp", "skip.cpp", false) == Match::NONE);
+
+    CHECK(rules.match("tmp3.h", "tmp3.h", false) == Match::IGNORED);
+    CHECK(rules.match("tmpx.h", "tmpx.h", false) == Match::NONE);
+
+    // Order matters: a later plain pattern undoes an earlier negation
+    IgnoreRules reordered;
+    reordered.addPatterns("!keep.gen.cpp\n*.gen.cpp\n");
+    CHECK(reordered.match("keep.gen.cpp", "keep.gen.cpp", false) == Match::IGNORED);
+    std::cout << "✓ The last matching pattern decides" << std::endl;
+}
+
+static void testScopes() {
+    auto root = std::make_shared<IgnoreScope>();
+    root->rules.addPatterns("*.gen.cpp\nlocal.cpp\n");
+    auto sub = std::make_shared<IgnoreScope>();
+    sub->parent = root;
+    sub->base = "sub";
+    sub->rules.addPatterns("!*.gen.cpp\n/only_here.cpp\n");
+
+    CHECK(IgnoreScope::isIgnored(root.get(), "y.gen.cpp", "y.gen.cpp", false));
+    CHECK(!IgnoreScope::isIgnored(sub.get(), "sub/y.gen.cpp", "y.gen.cpp", false));
+    // Rules the deeper file says nothing about fall through to its parent
+    CHECK(IgnoreScope::isIgnored(sub.get(), "sub/local.cpp", "local.cpp", false));
+    // Anchored patterns are relative to the directory holding them
+    CHECK(IgnoreScope::isIgnored(sub.get(), "sub/only_here.cpp", "only_here.cpp", false));
+    CHECK(!IgnoreScope::isIgnored(sub.get(), "sub/x/only_here.cpp", "only_here.cpp", false));
+    std::cout << "✓ Deeper ignore files take precedence" << std::endl;
+}
+
+static void write(const fs::path& path, const std::string& text) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << text;
+}
+
+static void testWalk(const fs::path& root) {
+    write(root / ".gitignore", "*.gen.cpp\n!keep.gen.cpp\n/top.cpp\nbuild_*/\n!build_x/b.cpp\n");
+    write(root / ".devpilotignore", "!build/\nvendor/\n");
+    write(root / "sub" / ".gitignore", "!*.gen.cpp\nlocal.cpp\n");
+    for (const char* file : {"a.cpp", "x.gen.cpp", "keep.gen.cpp", "top.cpp", "sub/top.cpp",
+                             "sub/y.gen.cpp", "sub/local.cpp", "sub/deeper/z.gen.cpp",
+                             "build_x/b.cpp", "build/gen.cpp", "cmake-build-debug/c.cpp",
+                             "vendor/v.cpp", "third_party/t.cpp", "out/o.cpp"}) {
+        write(root / file, "int f();\n");
+    }
+
+    std::mutex mutex;
+    std::vector<std::string> found;
+    FileWalker walker(4);
+    walker.walk(root.string(), [&](std::string path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        found.push_back(fs::path(path).lexically_relative(root).generic_string());
+    });
+    std::sort(found.begin(), found.end());
+
+    // build_x/b.cpp stays out: git never looks inside an excluded directory.
+    // .devpilotignore's "!build/" overrides a built-in default, and vendored
+    // or output directories are only left out when an ignore file says so.
+    std::vector<std::string> expected = {"a.cpp", "build/gen.cpp", "keep.gen.cpp", "out/o.cpp",
+                                         "sub/deeper/z.gen.cpp", "sub/top.cpp", "sub/y.gen.cpp",
+                                         "third_party/t.cpp"};
+    CHECK(found == expected);
+    std::cout << "✓ The walker applies nested ignore files" << std::endl;
+}
+
+int main() {
+    testPatterns();
+    testScopes();
+    fs::path work = fs::temp_directory_path() / ("devpilot_ignore_" + std::to_string(getpid()));
+    testWalk(work);
+    fs::remove_all(work);
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "check.hpp"
+#include "compressed_bitset.hpp"
+#include "include_graph.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The compressed bitset through its storage form, sparse and dense buckets
+// alike, and the reverse include closure across an include cycle.
+
+using namespace devpilot;
+
+static void testBitsetRoundTrip() {
+    CompressedBitset set;
+    std::vector<uint32_t> expected;
+    // Bucket 0 turns into a bitmap; bucket 3 stays a sorted array
+    for (uint32_t value = 0; value < 10000; value += 2) {
+        expected.push_back(value);
+    }
+    for (uint32_t value : {196608u + 7, 196608u + 65535}) {
+        expected.push_back(value);
+    }
+    expected.push_back(UINT32_MAX);
+    for (auto it = expected.rbegin(); it != expected.rend(); ++it) {
+        set.add(*it);
+    }
+    set.add(4);  // Already present
+
+    std::string bytes = set.serialize();
+    CompressedBitset restored;
+    CHECK(CompressedBitset::deserialize(bytes.data(), bytes.size(), restored));
+    CHECK(restored.toVector() == expected);
+    CHECK(restored.cardinality() == expected.size());
+    CHECK(restored.contains(9998) && !restored.contains(9999) && restored.contains(UINT32_MAX));
+    CHECK(restored.serialize() == bytes);
+
+    // Anything short of the whole form is rejected, not read as a smaller
+    // set: the last bucket (one value) takes 9 bytes
+    for (size_t size : {bytes.size() - 1, bytes.size() - 9, size_t(10)}) {
+        CompressedBitset truncated;
+        CHECK(!CompressedBitset::deserialize(bytes.data(), size, truncated));
+    }
+
+    CompressedBitset empty;
+    CHECK(CompressedBitset::deserialize(nullptr, 0, empty) && empty.empty());
+    std::string emptyBytes = CompressedBitset().serialize();
+    CHECK(CompressedBitset::deserialize(emptyBytes.data(), emptyBytes.size(), empty) && empty.empty());
+    std::cout << "✓ Compressed bitset survives serialization" << std::endl;
+}
+
+static void testReverseClosure() {
+    // 1 -> 2 <-> 3 -> 5, and 4 -> 3
+    IncludeGraph graph;
+    graph.addEdge(1, 2);
+    graph.addEdge(2, 3);
+    graph.addEdge(3, 2);
+    graph.addEdge(4, 3);
+    graph.addEdge(3, 5);
+    CHECK(graph.edgeCount() == 5);
+
+    auto closure = graph.computeReverseClosure();
+    // Members of the cycle include each other, themselves included
+    CHECK(closure[2].toVector() == (std::vector<uint32_t>{1, 2, 3, 4}));
+    CHECK(closure[3].toVector() == (std::vector<uint32_t>{1, 2, 3, 4}));
+    CHECK(closure[5].toVector() == (std::vector<uint32_t>{1, 2, 3, 4}));
+    CHECK(closure[1].empty() && closure[4].empty());
+    std::cout << "✓ Reverse include closure collapses cycles" << std::endl;
+}
+
+int main() {
+    testBitsetRoundTrip();
+    testReverseClosure();
+    return 0;
+}
@@ -0,0 +1,233 @@
+#include "check.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Updates an index in place after files are changed, added and removed, and
+// expects every query to answer as an index built from scratch does, with
+// one database and with three. Only the files that differ are written;
+// once rewritten files outnumber the live ones the index is rebuilt. In a
+// git checkout, an unchanged tree is up to date and switching branches
+// processes only the files the branches disagree on.
+
+namespace fs = std::filesystem;
+
+static const std::vector<std::string> kComponents = {"core", "net", "ui", "app", "db"};
+
+static std::string run(const std::string& command, int& status) {
+    std::string output;
+    FILE* pipe = popen(command.c_str(), "r");
+    CHECK(pipe);
+    char buffer[4096];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, bytes);
+    }
+    status = pclose(pipe);
+    return output;
+}
+
+static void writeFile(const fs::path& path, const std::string& contents) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << contents;
+}
+
+static std::string component(size_t i, const std::string& extra = "") {
+    const std::string& name = kComponents[i];
+    const std::string& next = kComponents[(i + 1) % kComponents.size()];
+    return "#include \"../core/log.h\"\n"
+           "namespace " + next + " { int step(int value); }\n"
+           "namespace " + name + " {\n"
+           "int step(int value) {\n"
+           "    core::log(\"" + name + "\");\n"
+           "    return value > 0 ? " + next + "::step(value - 1) : core::clamp(value);\n"
+           "}\n" + extra + "}\n";
+}
+
+static void writeCorpus(const fs::path& corpus) {
+    writeFile(corpus / "core" / "log.h",
+              "#pragma once\nnamespace core {\nvoid log(const char* message);\nint clamp(int value);\n}\n");
+    writeFile(corpus / "core" / "log.cpp",
+              "#include \"log.h\"\nnamespace core {\nvoid log(const char* message) { clamp(1); }\n"
+              "int clamp(int value) { return value; }\n}\n");
+    for (size_t i = 0; i < kComponents.size(); i++) {
+        writeFile(corpus / kComponents[i] / (kComponents[i] + ".cpp"), component(i));
+    }
+}
+
+// Changes one file, adds one and removes one
+static void editCorpus(const fs::path& corpus) {
+    writeFile(corpus / "net" / "net.cpp", component(1, "int retry(int value) { return clamp(value); }\n"
+                                                       "int clamp(int value) { return core::clamp(value); }\n"));
+    writeFile(corpus / "extra" / "extra.cpp",
+              "#include \"../core/log.h\"\nnamespace extra {\nint run() { core::log(\"extra\"); "
+              "return net::retry(2); }\n}\n");
+    fs::remove(corpus / "ui" / "ui.cpp");
+}
+
+static std::string sortedLines(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream stream(text);
+    for (std::string line; std::getline(stream, line);) {
+        lines.push_back(line);
+    }
+    std::sort(lines.begin(), lines.end());
+    std::string sorted;
+    for (const std::string& line : lines) {
+        sorted += line + "\n";
+    }
+    return sorted;
+}
+
+static size_t reportedNumber(const std::string& output, const std::string& label) {
+    size_t pos = output.find(label);
+    CHECK(pos != std::string::npos);
+    return std::stoull(output.substr(pos + label.size()));
+}
+
+static std::string index(const std::string& executable, const fs::path& directory, const fs::path& corpus,
+                         const std::string& options) {
+    fs::create_directories(directory);
+    int status;
+    std::string output = run("cd '" + directory.string() + "' && '" + executable + "' index '" +
+                             corpus.string() + "' --no-cache " + options + " 2>&1", status);
+    if (status != 0) {
+        std::cerr << output;
+    }
+    CHECK(status == 0);
+    return output;
+}
+
+// Symbol ids differ between an updated index and a rebuilt one, so answers
+// are compared as sets of lines
+static std::vector<std::string> query(const std::string& executable, const fs::path& directory,
+                                      const fs::path& corpus) {
+    std::string prefix = "cd '" + directory.string() + "' && '" + executable + "' ";
+    std::vector<std::string> answers;
+    for (const std::string& command : std::vector<std::string>{
+             "usages core::log", "usages core::clamp", "usages net::retry", "usages app::step",
+             "calltree db::step 4", "search step", "search clamp", "refs clamp", "refs step", "refs retry",
+             "rdeps '" + (corpus / "core" / "log.h").string() + "'"}) {
+        int status;
+        std::string output = run(prefix + command + " 2>&1", status);
+        CHECK(status == 0);
+        answers.push_back(command + ":\n" + sortedLines(output));
+    }
+    return answers;
+}
+
+static void checkSameAnswers(const std::string& executable, const fs::path& work, const fs::path& updated,
+                             const fs::path& corpus, const std::string& options) {
+    fs::path rebuilt = work / "rebuilt";
+    fs::remove_all(rebuilt);
+    index(executable, rebuilt, corpus, options);
+    std::vector<std::string> expected = query(executable, rebuilt, corpus);
+    std::vector<std::string> actual = query(executable, updated, corpus);
+    for (size_t i = 0; i < expected.size(); i++) {
+        if (actual[i] != expected[i]) {
+            std::cerr << "updated " << actual[i] << "rebuilt " << expected[i];
+        }
+        CHECK(actual[i] == expected[i]);
+    }
+}
+
+static void checkUpdates(const std::string& executable, const fs::path& work, const std::string& options) {
+    fs::path corpus = work / "corpus";
+    fs::path updated = work / "updated";
+    fs::remove_all(corpus);
+    fs::remove_all(updated);
+    writeCorpus(corpus);
+    std::string output = index(executable, updated, corpus, options);
+    CHECK(reportedNumber(output, "Files processed: ") == kComponents.size() + 2);
+
+    // Nothing changed: every file is read, none is written
+    output = index(executable, updated, corpus, options);
+    CHECK(output.find("Index is up to date") != std::string::npos);
+
+    editCorpus(corpus);
+    output = index(executable, updated, corpus, options);
+    CHECK(reportedNumber(output, "Files processed: ") == 2);
+    CHECK(reportedNumber(output, "Updated in place: ") == kComponents.size());
+    CHECK(output.find("files left as indexed, 1 removed") != std::string::npos);
+    checkSameAnswers(executable, work, updated, corpus, options);
+
+    // Each rewrite retires a file; once they outnumber the live ones the
+    // next run rebuilds, and answers the same
+    size_t liveFiles = kComponents.size() + 2;
+    size_t runs = 1;
+    for (;; runs++) {
+        writeFile(corpus / "app" / "app.cpp", component(3, "int version() { return " + std::to_string(runs) +
+                                                               "; }\n"));
+        output = index(executable, updated, corpus, options);
+        if (output.find("Updated in place: ") == std::string::npos) {
+            break;
+        }
+        CHECK(runs <= liveFiles);
+    }
+    CHECK(runs > 1);
+    CHECK(reportedNumber(output, "Files processed: ") == liveFiles);
+    checkSameAnswers(executable, work, updated, corpus, options);
+    std::cout << "✓ " << (options.empty() ? "One database" : options) << ": updated in place, answers as "
+              << "rebuilt; rebuilt after " << runs << " rewrites" << std::endl;
+}
+
+static void checkBranches(const std::string& executable, const fs::path& work) {
+    if (std::system("git --version > /dev/null 2>&1") != 0) {
+        std::cout << "- git not installed; skipped switching branches" << std::endl;
+        return;
+    }
+    fs::path corpus = work / "repo";
+    fs::path updated = work / "updated";
+    fs::remove_all(corpus);
+    fs::remove_all(updated);
+    writeCorpus(corpus);
+    std::string git = "cd '" + corpus.string() + "' && git -c init.defaultBranch=main -c user.name=test "
+                      "-c user.email=test@example.com ";
+    int status;
+    run(git + "init -q && " + git + "add -A && " + git + "commit -q -m base 2>&1", status);
+    CHECK(status == 0);
+    run(git + "checkout -q -b feature 2>&1", status);
+    CHECK(status == 0);
+    editCorpus(corpus);
+    run(git + "add -A && " + git + "commit -q -m feature 2>&1", status);
+    CHECK(status == 0);
+
+    index(executable, updated, corpus, "");
+    std::string output = index(executable, updated, corpus, "");
+    CHECK(output.find("Index is up to date") != std::string::npos);
+
+    // main has net.cpp as it was and ui.cpp back, and no extra.cpp
+    run(git + "checkout -q main 2>&1", status);
+    CHECK(status == 0);
+    output = index(executable, updated, corpus, "");
+    CHECK(reportedNumber(output, "Files processed: ") == 2);
+    CHECK(output.find("1 removed") != std::string::npos);
+    checkSameAnswers(executable, work, updated, corpus, "");
+
+    output = index(executable, updated, corpus, "");
+    CHECK(output.find("Index is up to date") != std::string::npos);
+    std::cout << "✓ Switching branches processes only the files that differ" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: test_incremental_index <devpilot executable>" << std::endl;
+        return 1;
+    }
+    std::string executable = fs::absolute(argv[1]).string();
+    fs::path work = fs::temp_directory_path() / ("devpilot_incremental_" + std::to_string(getpid()));
+
+    checkUpdates(executable, work, "");
+    checkUpdates(executable, work, "--shards 3 --shard-by hash");
+    checkBranches(executable, work);
+
+    fs::remove_all(work);
+    return 0;
+}
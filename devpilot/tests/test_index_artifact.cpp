@@ -0,0 +1,152 @@
+#include "check.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+
+// Exports an index and imports it into a copy of the project somewhere else:
+// a matching checkout is restored under its own root, a changed one is
+// brought up to date, and a damaged artifact leaves the index alone.
+
+namespace fs = std::filesystem;
+
+static std::string run(const std::string& command, int& status) {
+    std::string output;
+    FILE* pipe = popen(command.c_str(), "r");
+    CHECK(pipe);
+    char buffer[4096];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, bytes);
+    }
+    status = pclose(pipe);
+    std::cout << output << std::flush;
+    return output;
+}
+
+static bool contains(const std::string& text, const std::string& part) {
+    return text.find(part) != std::string::npos;
+}
+
+static void writeProject(const fs::path& project) {
+    fs::create_directories(project / "src");
+    fs::create_directories(project / "include");
+    std::ofstream(project / "include" / "geometry.h")
+        << "#pragma once\nnamespace geometry {\nint area(int width, int height);\nint perimeter(int width, int height);\n}\n";
+    std::ofstream(project / "src" / "geometry.cpp")
+        << "#include \"geometry.h\"\nnamespace geometry {\n"
+        << "int area(int width, int height) { return width * height; }\n"
+        << "int perimeter(int width, int height) { return 2 * (width + height); }\n}\n";
+    std::ofstream(project / "src" / "main.cpp")
+        << "#include \"geometry.h\"\nint main() {\n    return geometry::area(2, 3) + geometry::perimeter(1, 1);\n}\n";
+}
+
+static std::string readFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: test_index_artifact <devpilot executable>" << std::endl;
+        return 1;
+    }
+    std::string executable = fs::absolute(argv[1]).string();
+    fs::path work = fs::temp_directory_path() / ("devpilot_artifact_" + std::to_string(getpid()));
+    fs::path source = work / "ci" / "project";
+    writeProject(source);
+    fs::path artifact = work / "index.dpx";
+
+    // Built and exported on one machine, each side with a parse cache of its own
+    auto tool = [&](const std::string& cache) {
+        return "DEVPILOT_CACHE_DIR='" + (work / cache).string() + "' '" + executable + "' ";
+    };
+    auto in = [&](const fs::path& directory, const std::string& cache) {
+        fs::create_directories(directory);
+        return "cd '" + directory.string() + "' && " + tool(cache);
+    };
+    std::string ci = in(work / "ci", "ci-cache");
+    int status;
+    run(ci + "index '" + source.string() + "' -I '" + (source / "include").string() + "' 2>&1", status);
+    CHECK(status == 0);
+    std::string output = run(ci + "export '" + artifact.string() + "' 2>&1", status);
+    CHECK(status == 0 && contains(output, "Exported 3 files"));
+
+    // The machine taking it has an index of something else, which a damaged
+    // or truncated artifact must not disturb
+    fs::path checkout = work / "dev" / "checkout";
+    fs::create_directories(checkout);
+    fs::copy(source, checkout, fs::copy_options::recursive);
+    fs::create_directories(work / "dev" / "other");
+    std::ofstream(work / "dev" / "other" / "other.cpp") << "int unrelated() { return 0; }\n";
+    std::string dev = in(work / "dev", "dev-cache");
+    run(dev + "index '" + (work / "dev" / "other").string() + "' 2>&1", status);
+    CHECK(status == 0);
+
+    std::string bytes = readFile(artifact);
+    std::string flipped = bytes;
+    flipped[bytes.size() / 2] ^= 0x20;
+    std::ofstream(work / "flipped.dpx", std::ios::binary) << flipped;
+    std::ofstream(work / "truncated.dpx", std::ios::binary) << bytes.substr(0, bytes.size() / 2);
+    for (const char* damaged : {"flipped.dpx", "truncated.dpx"}) {
+        output = run(dev + "import '" + (work / damaged).string() + "' '" + checkout.string() + "' 2>&1", status);
+        CHECK(status != 0 && (contains(output, "damaged") || contains(output, "malformed")));
+        output = run(dev + "search unrelated 2>&1", status);
+        CHECK(status == 0 && contains(output, "Found 1 symbol"));
+    }
+    std::cout << "✓ Damaged artifacts are rejected and the index kept" << std::endl;
+
+    // A matching checkout is restored under its own root, from stdin too
+    output = run("cd '" + (work / "dev").string() + "' && cat '" + artifact.string() + "' | " + tool("dev-cache") +
+                 "import - '" + checkout.string() + "' 2>&1", status);
+    CHECK(status == 0 && contains(output, "index restored"));
+    CHECK(contains(output, "Artifact: 3 files") && !contains(output, "(0 parse results cached)"));
+    output = run(dev + "search geometry::area 2>&1", status);
+    CHECK(contains(output, (checkout / "include" / "geometry.h").string()));
+    CHECK(contains(output, (checkout / "src" / "geometry.cpp").string()));
+    CHECK(!contains(output, source.string()));
+    output = run(dev + "usages geometry::perimeter 2>&1", status);
+    CHECK(contains(output, "main (" + (checkout / "src" / "main.cpp").string() + ":3)"));
+    output = run(dev + "rdeps '" + (checkout / "include" / "geometry.h").string() + "' 2>&1", status);
+    CHECK(contains(output, "2 dependent file(s)"));
+    output = run(dev + "search unrelated 2>&1", status);
+    CHECK(contains(output, "No symbols found") || !contains(output, "unrelated ("));
+    std::cout << "✓ A matching checkout is restored under its own root" << std::endl;
+
+    // One file changed and one added: re-indexed, mostly from the seeded cache
+    std::ofstream(checkout / "src" / "geometry.cpp")
+        << "#include \"geometry.h\"\nnamespace geometry {\n"
+        << "int area(int width, int height) { return width * height; }\n"
+        << "int diagonal(int width, int height) { return width + height; }\n}\n";
+    std::ofstream(checkout / "src" / "extra.cpp") << "int extra() { return 1; }\n";
+    output = run(dev + "import '" + artifact.string() + "' '" + checkout.string() + "' 2>&1", status);
+    CHECK(status == 0 && contains(output, "1 changed, 1 added, 0 removed"));
+    output = run(dev + "search diagonal 2>&1", status);
+    CHECK(contains(output, (checkout / "src" / "geometry.cpp").string()));
+    output = run(dev + "search extra 2>&1", status);
+    CHECK(contains(output, "Found 1 symbol"));
+    output = run(dev + "usages geometry::area 2>&1", status);
+    CHECK(contains(output, (checkout / "src" / "main.cpp").string()));
+    std::cout << "✓ A changed checkout is brought up to date" << std::endl;
+
+    // A sharded index travels with its layout
+    run(ci + "index '" + source.string() + "' --shards 3 --shard-by hash 2>&1", status);
+    CHECK(status == 0);
+    run(ci + "export '" + artifact.string() + "' 2>&1", status);
+    CHECK(status == 0);
+    fs::path shardedCheckout = work / "sharded" / "checkout";
+    fs::create_directories(shardedCheckout);
+    fs::copy(source, shardedCheckout, fs::copy_options::recursive);
+    std::string sharded = in(work / "sharded", "dev-cache");
+    output = run(sharded + "import '" + artifact.string() + "' '" + shardedCheckout.string() + "' 2>&1", status);
+    CHECK(status == 0 && contains(output, "in 3 shards") && contains(output, "index restored"));
+    output = run(sharded + "usages geometry::perimeter 2>&1", status);
+    CHECK(contains(output, "main (" + (shardedCheckout / "src" / "main.cpp").string() + ":3)"));
+    std::cout << "✓ Sharded indexes are restored with their shards" << std::endl;
+
+    fs::remove_all(work);
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "check.hpp"
+#include "logger.hpp"
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Messages below the level are dropped; the rest are written in the order
+// they were logged, across threads, errors and warnings to stderr and the
+// rest to stdout, and flush() writes everything logged before it returns.
+
+using namespace devpilot;
+
+static std::vector<std::string> lines(const std::string& text) {
+    std::vector<std::string> split;
+    std::istringstream stream(text);
+    for (std::string line; std::getline(stream, line);) {
+        split.push_back(line);
+    }
+    return split;
+}
+
+static void testLevels(std::ostringstream& out, std::ostringstream& err) {
+    logging::setLevel(LogLevel::WARNING);
+    CHECK(logging::enabled(LogLevel::ERROR) && logging::enabled(LogLevel::WARNING));
+    CHECK(!logging::enabled(LogLevel::INFO) && !logging::enabled(LogLevel::DEBUG));
+    logging::info("hidden info");
+    logging::debug("hidden debug");
+    logging::warning("shown ", 1);
+    logging::error("shown ", 2);
+    logging::flush();
+    CHECK(out.str().empty());
+    CHECK(lines(err.str()) == (std::vector<std::string>{"shown 1", "shown 2"}));
+
+    logging::setLevel(LogLevel::DEBUG);
+    logging::debug("detail");
+    logging::info("progress");
+    logging::flush();
+    CHECK(lines(out.str()) == (std::vector<std::string>{"detail", "progress"}));
+    out.str("");
+    err.str("");
+}
+
+// Two threads take turns, so every message happens after the one before it
+// and must be written after it too, though each sits on its own thread's ring
+static void testOrder(std::ostringstream& out) {
+    const int kTurns = 2000;
+    std::atomic<int> turn{0};
+    auto player = [&](int parity) {
+        for (int i = parity; i < kTurns; i += 2) {
+            while (turn.load() != i) {
+                std::this_thread::yield();
+            }
+            logging::info("turn ", i);
+            turn.store(i + 1);
+        }
+    };
+    std::thread other(player, 1);
+    player(0);
+    other.join();
+    logging::flush();
+
+    std::vector<std::string> written = lines(out.str());
+    CHECK(written.size() == static_cast<size_t>(kTurns));
+    for (int i = 0; i < kTurns; i++) {
+        CHECK(written[i] == "turn " + std::to_string(i));
+    }
+    out.str("");
+}
+
+// Many threads at once: each thread's messages stay in its own order, and
+// flush() returns only once all of them are out
+static void testFlush(std::ostringstream& out) {
+    const int kThreads = 8;
+    const int kMessages = 3000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([t]() {
+            for (int i = 0; i < kMessages; i++) {
+                logging::info(t, " ", i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    logging::flush();
+    std::cout << "data" << std::endl;
+
+    std::vector<std::string> written = lines(out.str());
+    CHECK(written.size() == static_cast<size_t>(kThreads * kMessages + 1));
+    CHECK(written.back() == "data");
+    std::vector<int> next(kThreads, 0);
+    for (size_t i = 0; i + 1 < written.size(); i++) {
+        std::istringstream line(written[i]);
+        int t = -1;
+        int message = -1;
+        line >> t >> message;
+        CHECK(t >= 0 && t < kThreads && message == next[t]);
+        next[t]++;
+    }
+    out.str("");
+}
+
+int main() {
+    // Captured while the tests run; progress goes to the real stdout
+    std::ostringstream out;
+    std::ostringstream err;
+    std::ostream progress(std::cout.rdbuf());
+    std::streambuf* stdoutBuffer = std::cout.rdbuf(out.rdbuf());
+    std::streambuf* stderrBuffer = std::cerr.rdbuf(err.rdbuf());
+
+    testLevels(out, err);
+    progress << "✓ Messages below the level are dropped" << std::endl;
+    testOrder(out);
+    progress << "✓ Messages from different threads keep the order they were logged in" << std::endl;
+    testFlush(out);
+    progress << "✓ flush() writes everything logged before a command's own output" << std::endl;
+
+    logging::writeAllToStderr();
+    logging::info("to stderr");
+    logging::flush();
+    CHECK(out.str().empty() && err.str() == "to stderr\n");
+    progress << "✓ writeAllToStderr() moves every level to stderr" << std::endl;
+
+    std::cout.rdbuf(stdoutBuffer);
+    std::cerr.rdbuf(stderrBuffer);
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "check.hpp"
+#include "memory_accounting.hpp"
+#include <thread>
+
+// Allocations are counted under the tag of the thread making them, and their
+// frees under that same tag whichever thread does the freeing. Blocks from
+// before enable() are never counted. Linked with the allocator hook.
+
+using namespace devpilot;
+using memory::MemoryTag;
+
+static const int kBlocks = 64;
+static const size_t kBlockSize = 1000;
+
+// Global, so the compiler cannot pair up and elide the allocations
+char* early = nullptr;
+char* blocks[kBlocks];
+char* symbols = nullptr;
+
+static memory::TagUsage usageOf(MemoryTag tag) {
+    return memory::currentUsage().tags[static_cast<size_t>(tag)];
+}
+
+int main() {
+    CHECK(memory::accountingAvailable());
+    early = new char[kBlockSize];
+
+    memory::enable();
+    CHECK(memory::enabled());
+    memory::TagUsage parserBefore = usageOf(MemoryTag::PARSER);
+    memory::TagUsage indexesBefore = usageOf(MemoryTag::INDEXES);
+    memory::TagUsage symbolsBefore = usageOf(MemoryTag::SYMBOLS);
+
+    {
+        memory::TagScope parser(MemoryTag::PARSER);
+        for (int i = 0; i < kBlocks; i++) {
+            blocks[i] = new char[kBlockSize];
+        }
+        {
+            // Nested scopes attribute to the innermost, then restore
+            memory::TagScope nested(MemoryTag::SYMBOLS);
+            symbols = new char[kBlockSize];
+        }
+        CHECK(memory::detail::currentTag == MemoryTag::PARSER);
+    }
+    CHECK(memory::detail::currentTag == MemoryTag::OTHER);
+
+    memory::TagUsage parser = usageOf(MemoryTag::PARSER);
+    CHECK(parser.allocations == parserBefore.allocations + kBlocks);
+    CHECK(parser.allocatedBytes == parserBefore.allocatedBytes + kBlocks * kBlockSize);
+    CHECK(parser.liveBytes == parserBefore.liveBytes + static_cast<int64_t>(kBlocks * kBlockSize));
+    memory::TagUsage symbolsAfter = usageOf(MemoryTag::SYMBOLS);
+    CHECK(symbolsAfter.allocations == symbolsBefore.allocations + 1);
+    CHECK(symbolsAfter.liveBytes == symbolsBefore.liveBytes + static_cast<int64_t>(kBlockSize));
+    std::cout << "✓ Allocations counted under the allocating thread's tag" << std::endl;
+
+    // Freed on another thread under another tag: the bytes still come off the
+    // parser's count, and nothing is charged to the freeing thread's tag
+    std::thread freer([]() {
+        memory::TagScope indexes(MemoryTag::INDEXES);
+        for (int i = 0; i < kBlocks; i++) {
+            delete[] blocks[i];
+        }
+        delete[] symbols;
+    });
+    freer.join();
+
+    parser = usageOf(MemoryTag::PARSER);
+    CHECK(parser.liveBytes == parserBefore.liveBytes);
+    CHECK(parser.allocations == parserBefore.allocations + kBlocks);
+    CHECK(usageOf(MemoryTag::SYMBOLS).liveBytes == symbolsBefore.liveBytes);
+    memory::TagUsage indexes = usageOf(MemoryTag::INDEXES);
+    CHECK(indexes.allocations == indexesBefore.allocations);
+    CHECK(indexes.liveBytes == indexesBefore.liveBytes);
+    std::cout << "✓ Frees on other threads charged back to the allocating tag" << std::endl;
+
+    int64_t live = memory::currentUsage().liveBytes();
+    delete[] early;
+    CHECK(memory::currentUsage().liveBytes() == live);
+    std::cout << "✓ Blocks from before enable() are never counted" << std::endl;
+    return 0;
+}
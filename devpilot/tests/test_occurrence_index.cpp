@@ -0,0 +1,83 @@
+#include "check.hpp"
+#include "occurrence_index.hpp"
+#include "storage.hpp"
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Postings flushed in several segments, as under a memory budget, must read
+// back through storage exactly as one list would.
+
+using namespace devpilot;
+namespace fs = std::filesystem;
+
+struct Flushed {
+    uint32_t nameId;
+    std::string name;
+    int segment;
+    uint64_t count;
+    std::string postings;
+};
+
+static void flushInto(OccurrenceIndex& index, std::vector<Flushed>& flushed) {
+    index.flush([&](uint32_t nameId, const std::string& name, int segment, uint64_t count,
+                    const std::string& postings) {
+        flushed.push_back({nameId, name, segment, count, postings});
+    });
+}
+
+int main() {
+    // alpha occurs in every segment, beta only in the first and last; file 3
+    // has two occurrences of alpha on one line and one further down
+    OccurrenceIndex index;
+    std::vector<Flushed> flushed;
+    index.addFile(1, {"alpha", "beta"}, {{0, 2, 5}, {1, 4, 1}});
+    flushInto(index, flushed);
+    index.addFile(2, {"alpha"}, {{0, 10, 3}});
+    index.addFile(3, {"alpha"}, {{0, 7, 1}, {0, 7, 20}, {0, 300, 2}});
+    CHECK(index.bufferedBytes() > 0);
+    flushInto(index, flushed);
+    CHECK(index.bufferedBytes() == 0);
+    index.addFile(70000, {"beta", "alpha"}, {{0, 1, 1}, {1, 1, 9}});
+    flushInto(index, flushed);
+    CHECK(index.nameCount() == 2 && index.occurrenceCount() == 8);
+
+    // Each segment decodes on its own: its first file id is absolute
+    std::vector<Occurrence> lastSegment;
+    const Flushed& last = flushed.back();
+    CHECK(last.segment == 2);
+    CHECK(OccurrenceIndex::decode(last.postings.data(), last.postings.size(), lastSegment));
+    CHECK(lastSegment.size() == last.count && lastSegment[0].file_id == 70000);
+
+    fs::path work = fs::temp_directory_path() / ("devpilot_postings_" + std::to_string(getpid()));
+    fs::create_directories(work);
+    {
+        SqliteStorage storage;
+        CHECK(storage.initialize((work / "devpilot.db").string()));
+        for (int64_t fileId : {1, 2, 3, 70000}) {
+            CHECK(storage.storeFile("f" + std::to_string(fileId) + ".cpp", 0, fileId) == fileId);
+        }
+        // Segments written out of order still read back in segment order
+        for (auto it = flushed.rbegin(); it != flushed.rend(); ++it) {
+            CHECK(storage.storePostings(it->nameId, it->name, it->segment,
+                                        static_cast<int64_t>(it->count), it->postings));
+        }
+
+        auto alpha = storage.getReferences("alpha");
+        std::vector<std::vector<int>> expected = {
+            {1, 2, 5}, {2, 10, 3}, {3, 7, 1}, {3, 7, 20}, {3, 300, 2}, {70000, 1, 9}};
+        CHECK(alpha.size() == expected.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            CHECK(alpha[i].file_path == "f" + std::to_string(expected[i][0]) + ".cpp");
+            CHECK(alpha[i].line_number == expected[i][1] && alpha[i].column_number == expected[i][2]);
+        }
+        auto beta = storage.getReferences("beta");
+        CHECK(beta.size() == 2 && beta[0].file_path == "f1.cpp" && beta[1].file_path == "f70000.cpp");
+        CHECK(storage.getReferences("gamma").empty());
+    }
+    fs::remove_all(work);
+
+    std::cout << "✓ Postings segments merge back into one list" << std::endl;
+    return 0;
+}
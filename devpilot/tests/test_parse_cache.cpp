@@ -0,0 +1,130 @@
+#include "check.hpp"
+#include "content_hash.hpp"
+#include "parse_cache.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+
+// A parse result must come back from the cache exactly as stored, under
+// whatever path it is loaded for, and a damaged entry must be a miss.
+
+using namespace devpilot;
+namespace fs = std::filesystem;
+
+static ParseResult sampleResult() {
+    ParseResult result;
+    result.content_hash = 0x1234567890abcdefULL;
+
+    SymbolRecord function;
+    function.name = "add";
+    function.type = SymbolType::FUNCTION;
+    function.file_path = "original/matrix.cpp";
+    function.line_number = 12;
+    function.column_number = 5;
+    function.parent_scope = "geometry::Matrix";
+    function.qualified_name = "geometry::Matrix::add";
+    function.param_count = 3;
+    function.required_param_count = 1;
+    function.start_offset = 300;
+    function.end_offset = 420;
+    result.symbols.push_back(function);
+
+    SymbolRecord type;
+    type.name = "Matrix";
+    type.type = SymbolType::CLASS;
+    type.line_number = 3;
+    type.column_number = 7;
+    type.qualified_name = "geometry::Matrix";
+    result.symbols.push_back(type);
+
+    result.includes.push_back({"matrix.h", false, 1});
+    result.includes.push_back({"vector", true, 2});
+    result.calls.push_back({0, "scale", "geometry", false, 2, 14, 16});
+    result.identifier_names = {"value", "scale"};
+    result.occurrences = {{0, 12, 13}, {1, 14, 16}, {0, 14, 22}, {0, 9, 1}};
+    return result;
+}
+
+static void checkSameResult(const ParseResult& loaded, const ParseResult& stored, std::string_view path) {
+    CHECK(loaded.content_hash == stored.content_hash);
+    CHECK(loaded.symbols.size() == stored.symbols.size());
+    for (size_t i = 0; i < stored.symbols.size(); i++) {
+        const SymbolRecord& a = loaded.symbols[i];
+        const SymbolRecord& b = stored.symbols[i];
+        CHECK(a.name == b.name && a.type == b.type && a.file_path == path);
+        CHECK(a.line_number == b.line_number && a.column_number == b.column_number);
+        CHECK(a.parent_scope == b.parent_scope && a.qualified_name == b.qualified_name);
+        CHECK(a.param_count == b.param_count && a.required_param_count == b.required_param_count);
+        CHECK(a.start_offset == b.start_offset && a.end_offset == b.end_offset);
+    }
+    CHECK(loaded.includes.size() == 2 && loaded.includes[1].path == "vector" && loaded.includes[1].is_system);
+    CHECK(loaded.calls.size() == 1 && loaded.calls[0].callee_name == "scale" &&
+          loaded.calls[0].qualifier == "geometry" && loaded.calls[0].arg_count == 2);
+    CHECK(loaded.identifier_names == stored.identifier_names);
+    CHECK(loaded.occurrences.size() == stored.occurrences.size());
+    for (size_t i = 0; i < stored.occurrences.size(); i++) {
+        CHECK(loaded.occurrences[i].name_index == stored.occurrences[i].name_index &&
+              loaded.occurrences[i].line_number == stored.occurrences[i].line_number &&
+              loaded.occurrences[i].column_number == stored.occurrences[i].column_number);
+    }
+}
+
+static std::string readFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const fs::path& path, const std::string& contents) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << contents;
+}
+
+int main() {
+    fs::path work = fs::temp_directory_path() / ("devpilot_parse_cache_" + std::to_string(getpid()));
+    ParseCache cache(work.string(), 1 << 20);
+    CHECK(cache.enabled());
+
+    ParseResult stored = sampleResult();
+    uint64_t key = ParseCache::key(stored.content_hash);
+    CHECK(key != ParseCache::key(stored.content_hash, ParseDepth::DECLARATIONS));
+    cache.store(key, stored);
+
+    // Entries carry no path: a hit is stamped with the path it is loaded for
+    ParseResult loaded;
+    CHECK(cache.load(key, "elsewhere/matrix.cpp", loaded));
+    checkSameResult(loaded, stored, "elsewhere/matrix.cpp");
+    std::cout << "✓ Parse results round-trip through the cache" << std::endl;
+
+    std::string hex = hashToHex(key);
+    fs::path entryPath = work / hex.substr(0, 2) / hex;
+    std::string entry = readFile(entryPath);
+    CHECK(!entry.empty());
+    std::string raw;
+    CHECK(cache.loadEntry(key, raw) && raw == entry);
+
+    // A flipped payload byte, a truncated payload, another parser version and
+    // trailing bytes all fail the header checks
+    std::string flipped = entry;
+    flipped[entry.size() / 2 + 12] ^= 0x40;
+    std::string version = entry;
+    version[4] ^= 0x01;
+    for (const std::string& damaged : {flipped, entry.substr(0, entry.size() - 1), version, entry + '\0',
+                                       entry.substr(0, 10)}) {
+        writeFile(entryPath, damaged);
+        uint64_t misses = cache.misses();
+        ParseResult missed;
+        CHECK(!cache.load(key, "elsewhere/matrix.cpp", missed));
+        CHECK(cache.misses() == misses + 1);
+        CHECK(!cache.storeEntry(key + 1, damaged));
+    }
+
+    // An entry carried over intact is accepted under its key
+    CHECK(cache.storeEntry(key + 1, entry));
+    CHECK(cache.load(key + 1, "copied/matrix.cpp", loaded));
+    checkSameResult(loaded, stored, "copied/matrix.cpp");
+    fs::remove_all(work);
+
+    std::cout << "✓ Damaged cache entries are misses" << std::endl;
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "check.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sqlite3.h>
+#include <string>
+#include <unistd.h>
+
+// Queries open the index read-only and never create or migrate it: with no
+// index they fail and leave no database behind, and an index an older build
+// wrote is left as it is until `devpilot index` rebuilds it.
+
+namespace fs = std::filesystem;
+
+static std::string run(const std::string& command, int& status) {
+    std::string output;
+    FILE* pipe = popen(command.c_str(), "r");
+    CHECK(pipe);
+    char buffer[4096];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, bytes);
+    }
+    status = pclose(pipe);
+    return output;
+}
+
+static int schemaVersion(const fs::path& database, int setTo = -1) {
+    sqlite3* db = nullptr;
+    CHECK(sqlite3_open_v2(database.c_str(), &db, SQLITE_OPEN_READWRITE, nullptr) == SQLITE_OK);
+    if (setTo >= 0) {
+        std::string sql = "PRAGMA user_version = " + std::to_string(setTo);
+        CHECK(sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK);
+    }
+    sqlite3_stmt* stmt = nullptr;
+    CHECK(sqlite3_prepare_v2(db, "PRAGMA user_version", -1, &stmt, nullptr) == SQLITE_OK);
+    CHECK(sqlite3_step(stmt) == SQLITE_ROW);
+    int version = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return version;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: test_read_only_open <devpilot executable>" << std::endl;
+        return 1;
+    }
+    std::string executable = fs::absolute(argv[1]).string();
+    fs::path work = fs::temp_directory_path() / ("devpilot_read_only_" + std::to_string(getpid()));
+    fs::path project = work / "project";
+    fs::create_directories(project);
+    std::ofstream(project / "clamp.cpp") << "int clamp(int value) { return value; }\n";
+    std::string prefix = "cd '" + work.string() + "' && '" + executable + "' ";
+    fs::path database = work / "devpilot.db";
+    int status;
+
+    for (const char* query : {"search clamp", "refs clamp", "usages clamp", "show clamp", "export -"}) {
+        std::string output = run(prefix + query + " 2>&1", status);
+        CHECK(status != 0);
+        CHECK(output.find("No index") != std::string::npos && output.find("devpilot index") != std::string::npos);
+        CHECK(!fs::exists(database));
+    }
+    std::cout << "✓ Queries without an index fail and create nothing" << std::endl;
+
+    run(prefix + "index '" + project.string() + "' 2>&1", status);
+    CHECK(status == 0);
+    std::string found = run(prefix + "search clamp 2>&1", status);
+    CHECK(status == 0 && found.find("clamp") != std::string::npos);
+    int current = schemaVersion(database);
+    CHECK(current > 1);
+
+    // As an older build would have left it
+    schemaVersion(database, current - 1);
+    std::string output = run(prefix + "search clamp 2>&1", status);
+    CHECK(status != 0 && output.find("needs re-indexing") != std::string::npos);
+    CHECK(schemaVersion(database) == current - 1);
+    std::cout << "✓ Queries on an older index ask for re-indexing and leave it alone" << std::endl;
+
+    run(prefix + "index '" + project.string() + "' 2>&1", status);
+    CHECK(status == 0 && schemaVersion(database) == current);
+    CHECK(run(prefix + "search clamp 2>&1", status) == found && status == 0);
+    std::cout << "✓ Re-indexing brings the index up to date" << std::endl;
+
+    fs::remove_all(work);
+    return 0;
+}
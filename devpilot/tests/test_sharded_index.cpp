@@ -0,0 +1,140 @@
+#include "check.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Indexes one corpus unsharded, split by directory and split by path hash,
+// and expects every query to answer the same: merged results in the order
+// the single database gives, and calls between shards in usages and
+// calltree as if nothing were split.
+
+namespace fs = std::filesystem;
+
+static const std::vector<std::string> kComponents = {"core", "net", "ui", "app", "db", "io", "gfx", "cli"};
+
+static std::string run(const std::string& command, int& status) {
+    std::string output;
+    FILE* pipe = popen(command.c_str(), "r");
+    CHECK(pipe);
+    char buffer[4096];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, bytes);
+    }
+    status = pclose(pipe);
+    return output;
+}
+
+// Every component calls the next one and core::log, so most calls cross
+// shards whichever way the files are split
+static void writeCorpus(const fs::path& corpus) {
+    fs::create_directories(corpus / "core");
+    std::ofstream(corpus / "core" / "log.h")
+        << "#pragma once\nnamespace core {\nvoid log(const char* message);\nint clamp(int value);\n}\n";
+    std::ofstream(corpus / "core" / "log.cpp")
+        << "#include \"log.h\"\nnamespace core {\nvoid log(const char* message) { clamp(1); }\n"
+        << "int clamp(int value) { return value; }\n}\n";
+    for (size_t i = 0; i < kComponents.size(); i++) {
+        const std::string& name = kComponents[i];
+        const std::string& next = kComponents[(i + 1) % kComponents.size()];
+        fs::create_directories(corpus / name);
+        std::ofstream(corpus / name / (name + ".cpp"))
+            << "#include \"../core/log.h\"\n"
+            << "namespace " << next << " { int step(int value); }\n"
+            << "namespace " << name << " {\n"
+            << "int step(int value) {\n"
+            << "    core::log(\"" << name << "\");\n"
+            << "    return value > " << i << " ? " << next << "::step(value - 1) : core::clamp(value);\n"
+            << "}\n}\n";
+    }
+}
+
+static std::string sortedLines(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream stream(text);
+    for (std::string line; std::getline(stream, line);) {
+        lines.push_back(line);
+    }
+    std::sort(lines.begin(), lines.end());
+    std::string sorted;
+    for (const std::string& line : lines) {
+        sorted += line + "\n";
+    }
+    return sorted;
+}
+
+struct Answers {
+    std::vector<std::string> ordered;    // Must match line for line
+    std::vector<std::string> unordered;  // Ties or id order: must match as a set
+};
+
+static Answers query(const std::string& executable, const fs::path& directory, const fs::path& corpus,
+                     const std::string& shardOptions) {
+    fs::create_directories(directory);
+    std::string prefix = "cd '" + directory.string() + "' && '" + executable + "' ";
+    int status;
+    std::string output = run(prefix + "index '" + corpus.string() + "' " + shardOptions + " 2>&1", status);
+    CHECK(status == 0);
+    if (!shardOptions.empty()) {
+        size_t crossing = output.find(" calls cross shards");
+        CHECK(crossing != std::string::npos);
+        size_t start = output.rfind(' ', crossing - 1) + 1;
+        CHECK(std::stoi(output.substr(start, crossing - start)) > 0);
+    }
+
+    Answers answers;
+    std::string core = (corpus / "core").string();
+    std::string outline = "outline '" + (corpus / "net" / "net.cpp").string() + "' '" + core + "/log.cpp' '" +
+                          (corpus / "gfx" / "gfx.cpp").string() + "'";
+    for (const std::string& ordered : std::vector<std::string>{
+             "usages core::log", "usages core::clamp", "usages ui::step", "calltree app::step 4",
+             "search core::clamp", "search Nothing", "refs clamp", "refs log", outline}) {
+        output = run(prefix + ordered + " 2>&1", status);
+        CHECK(status == 0);
+        answers.ordered.push_back(output);
+    }
+    for (const std::string& unordered :
+         std::vector<std::string>{"search step", "rdeps '" + core + "/log.h'"}) {
+        output = run(prefix + unordered + " 2>&1", status);
+        CHECK(status == 0);
+        answers.unordered.push_back(sortedLines(output));
+    }
+    return answers;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: test_sharded_index <devpilot executable>" << std::endl;
+        return 1;
+    }
+    std::string executable = fs::absolute(argv[1]).string();
+    fs::path work = fs::temp_directory_path() / ("devpilot_shards_" + std::to_string(getpid()));
+    fs::path corpus = work / "corpus";
+    writeCorpus(corpus);
+
+    Answers single = query(executable, work / "single", corpus, "");
+    // Every caller of core::log, one per shard or more
+    CHECK(std::count(single.ordered[0].begin(), single.ordered[0].end(), '\n') == kComponents.size() + 2);
+    CHECK(single.ordered[3].find("io::step") != std::string::npos);
+
+    for (const char* options : {"--shards 4", "--shards 3 --shard-by hash"}) {
+        Answers sharded = query(executable, work / std::string(options).substr(9, 1), corpus, options);
+        for (size_t i = 0; i < single.ordered.size(); i++) {
+            if (sharded.ordered[i] != single.ordered[i]) {
+                std::cerr << options << ":\n" << sharded.ordered[i] << "unsharded:\n" << single.ordered[i];
+            }
+            CHECK(sharded.ordered[i] == single.ordered[i]);
+        }
+        CHECK(sharded.unordered == single.unordered);
+        std::cout << "✓ " << options << " answers as one database does" << std::endl;
+    }
+
+    fs::remove_all(work);
+    return 0;
+}
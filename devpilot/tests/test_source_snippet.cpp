@@ -0,0 +1,121 @@
+#include "check.hpp"
+#include "content_hash.hpp"
+#include "parser.hpp"
+#include "source_snippet.hpp"
+#include "storage.hpp"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+// Declarations are read back from the source by the byte range and file hash
+// the index stored: exactly while the file is unchanged, reported stale once
+// its contents differ, even at the same length, and missing once it is gone.
+
+using namespace devpilot;
+namespace fs = std::filesystem;
+
+static const char* kSource =
+    "namespace geo {\n"
+    "class Shape {\n"
+    "public:\n"
+    "    virtual double area() const = 0;\n"
+    "};\n"
+    "int scale(int value,\n"
+    "          int factor = 2) {\n"
+    "    return value * factor;\n"
+    "}\n"
+    "int limit = 10;\n"
+    "}\n";
+
+static Symbol find(const std::vector<Symbol>& symbols, const std::string& name) {
+    for (const Symbol& symbol : symbols) {
+        if (symbol.name == name) {
+            return symbol;
+        }
+    }
+    CHECK(!"symbol missing");
+    return Symbol();
+}
+
+// Indexes the file as the indexer would: the parse gives the ranges, the
+// file row the hash, and the symbols come back from storage
+static std::vector<Symbol> index(SqliteStorage& storage, const fs::path& file, const std::string& source) {
+    // Records view the path, so it outlives them
+    std::string path = file.string();
+    CppParser parser;
+    CHECK(parser.isInitialized());
+    ParseResult result = parser.parseSource(source, path, ParseDepth::FULL);
+    CHECK(storage.beginTransaction());
+    CHECK(storage.clearDatabase());
+    CHECK(storage.storeFile(path, hashContent(source.data(), source.size())) > 0);
+    for (const SymbolRecord& record : result.symbols) {
+        CHECK(storage.storeSymbol(record) > 0);
+    }
+    CHECK(storage.commitTransaction());
+    return storage.getSymbolsInFile(path);
+}
+
+int main() {
+    fs::path work = fs::temp_directory_path() / ("devpilot_snippet_" + std::to_string(getpid()));
+    fs::create_directories(work);
+    fs::path file = work / "shapes.cpp";
+    std::string source = kSource;
+    std::ofstream(file, std::ios::binary) << source;
+
+    SqliteStorage storage;
+    CHECK(storage.initialize((work / "devpilot.db").string()));
+    std::vector<Symbol> symbols = index(storage, file, source);
+    Symbol scale = find(symbols, "scale");
+    Symbol area = find(symbols, "area");
+    Symbol shape = find(symbols, "Shape");
+    CHECK(scale.file_hash == hashContent(source.data(), source.size()));
+
+    {
+        SnippetReader snippets;
+        std::string_view text;
+        CHECK(snippets.text(scale, text) == SnippetStatus::OK);
+        CHECK(text == "int scale(int value,\n          int factor = 2) {\n    return value * factor;\n}");
+        std::string signature;
+        CHECK(snippets.signature(scale, signature) == SnippetStatus::OK);
+        CHECK(signature == "int scale(int value, int factor = 2)");
+        CHECK(snippets.signature(area, signature) == SnippetStatus::OK);
+        CHECK(signature == "virtual double area() const");
+        CHECK(snippets.signature(shape, signature) == SnippetStatus::OK);
+        CHECK(signature == "class Shape");
+    }
+    std::cout << "✓ Declarations read back exactly from an unchanged file" << std::endl;
+
+    // Same length, one character different: the offsets still fit but no
+    // longer mean anything
+    std::string edited = source;
+    edited[edited.find("value * factor")] = 'V';
+    CHECK(edited.size() == source.size());
+    std::ofstream(file, std::ios::binary | std::ios::trunc) << edited;
+    {
+        SnippetReader snippets;
+        std::string_view text;
+        std::string signature;
+        CHECK(snippets.text(scale, text) == SnippetStatus::STALE);
+        CHECK(snippets.signature(shape, signature) == SnippetStatus::STALE);
+    }
+    // Re-indexed, the stored hash matches again
+    scale = find(index(storage, file, edited), "scale");
+    {
+        SnippetReader snippets;
+        std::string_view text;
+        CHECK(snippets.text(scale, text) == SnippetStatus::OK && text.find("Value * factor") != std::string::npos);
+    }
+    std::cout << "✓ A changed file is reported stale until it is indexed again" << std::endl;
+
+    fs::remove(file);
+    {
+        SnippetReader snippets;
+        std::string_view text;
+        CHECK(snippets.text(scale, text) == SnippetStatus::MISSING);
+    }
+    std::cout << "✓ A deleted file is reported missing" << std::endl;
+
+    fs::remove_all(work);
+    return 0;
+}
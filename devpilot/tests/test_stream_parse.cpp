@@ -0,0 +1,132 @@
+#include "check.hpp"
+#include "indexer.hpp"
+#include "logger.hpp"
+#include "parser.hpp"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+// A file parsed as a stream of small chunks must give exactly what parsing it
+// whole gives, whichever declaration, comment or literal a chunk edge cuts.
+// An empty file is indexed like any other, with no symbols and no error.
+
+using namespace devpilot;
+namespace fs = std::filesystem;
+
+// One section per index; the long comment, string and raw string are longer
+// than the lexer's rewind limit at the chunk sizes below, so they are carried
+// across windows rather than lexed again
+static std::string section(int index) {
+    std::string n = std::to_string(index);
+    return "#include \"module" + n + ".h\"\n"
+           "#define LIMIT_" + n + " \\\n    (" + n + " * 2)\n"
+           "/* " + std::string(150, '*') + " { not a scope */\n"
+           "namespace outer" + n + " {\nnamespace inner {\n"
+           "template <typename T>\n"
+           "class Widget" + n + " : public Base<T> {\n"
+           "public:\n"
+           "    int resize(int width, int height = 10, bool keep = true);\n"
+           "    static const char* label() { return \"" + std::string(120, 'w') + " }\"; }\n"
+           "private:\n"
+           "    int size_ = LIMIT_" + n + ";\n"
+           "};\n"
+           "} // namespace inner\n\n"
+           "int inner::Widget" + n + "<int>::resize(int width, int height, bool keep) {\n"
+           "    const char* text = R\"raw(" + std::string(100, ')') + " })raw\";\n"
+           "    helper" + n + "(width, height);\n"
+           "    return keep ? inner::clamp(width * height) : 0;\n"
+           "}\n"
+           "} // namespace outer" + n + "\n\n"
+           "double scale" + n + "(double value, double factor = 2.0) { return value * factor; }\n\n";
+}
+
+static void checkSame(const ParseResult& streamed, const ParseResult& whole) {
+    CHECK(streamed.symbols.size() == whole.symbols.size());
+    for (size_t i = 0; i < whole.symbols.size(); i++) {
+        const SymbolRecord& a = streamed.symbols[i];
+        const SymbolRecord& b = whole.symbols[i];
+        CHECK(a.name == b.name && a.type == b.type && a.qualified_name == b.qualified_name);
+        CHECK(a.parent_scope == b.parent_scope && a.file_path == b.file_path);
+        CHECK(a.line_number == b.line_number && a.column_number == b.column_number);
+        CHECK(a.param_count == b.param_count && a.required_param_count == b.required_param_count);
+        CHECK(a.start_offset == b.start_offset && a.end_offset == b.end_offset);
+    }
+    CHECK(streamed.includes.size() == whole.includes.size());
+    for (size_t i = 0; i < whole.includes.size(); i++) {
+        CHECK(streamed.includes[i].path == whole.includes[i].path &&
+              streamed.includes[i].line_number == whole.includes[i].line_number);
+    }
+    CHECK(streamed.calls.size() == whole.calls.size());
+    for (size_t i = 0; i < whole.calls.size(); i++) {
+        const CallSite& a = streamed.calls[i];
+        const CallSite& b = whole.calls[i];
+        CHECK(a.caller_index == b.caller_index && a.callee_name == b.callee_name);
+        CHECK(a.qualifier == b.qualifier && a.arg_count == b.arg_count);
+        CHECK(a.line_number == b.line_number && a.column_number == b.column_number);
+    }
+    CHECK(streamed.identifier_names == whole.identifier_names);
+    CHECK(streamed.occurrences.size() == whole.occurrences.size());
+    for (size_t i = 0; i < whole.occurrences.size(); i++) {
+        CHECK(streamed.occurrences[i].name_index == whole.occurrences[i].name_index &&
+              streamed.occurrences[i].line_number == whole.occurrences[i].line_number &&
+              streamed.occurrences[i].column_number == whole.occurrences[i].column_number);
+    }
+}
+
+static void testEmptyFile(CppParser& parser, const fs::path& work) {
+    fs::path project = work / "project";
+    fs::create_directories(project);
+    std::ofstream(project / "empty.cpp");
+    std::ofstream(project / "full.cpp") << "int full() { return 1; }\n";
+
+    SqliteStorage storage;
+    CHECK(storage.initialize((work / "devpilot.db").string()));
+    IndexOptions options;
+    options.useCache = false;
+    options.databasePath = (work / "devpilot.db").string();
+    IndexSummary summary;
+    std::ostringstream errors;
+    std::streambuf* stderrBuffer = std::cerr.rdbuf(errors.rdbuf());
+    bool indexed = Indexer(parser, storage).run(project.string(), options, summary);
+    logging::flush();
+    std::cerr.rdbuf(stderrBuffer);
+
+    CHECK(indexed && summary.files == 2 && summary.symbols == 1);
+    CHECK(errors.str().find("Could not read") == std::string::npos);
+    CHECK(storage.findFiles("empty.cpp").size() == 1);
+    std::cout << "✓ Empty files are indexed without an error" << std::endl;
+}
+
+int main() {
+    std::string source;
+    for (int i = 0; i < 40; i++) {
+        source += section(i);
+    }
+
+    fs::path work = fs::temp_directory_path() / ("devpilot_stream_" + std::to_string(getpid()));
+    fs::create_directories(work);
+    fs::path file = work / "generated.cpp";
+    std::ofstream(file, std::ios::binary) << source;
+
+    CppParser parser;
+    CHECK(parser.isInitialized());
+    for (ParseDepth depth : {ParseDepth::FULL, ParseDepth::DECLARATIONS}) {
+        ParseResult whole = parser.parseSource(source, "generated.cpp", depth);
+        CHECK(whole.symbols.size() >= 40 * 5 && whole.includes.size() == 40);
+        CHECK(depth == ParseDepth::DECLARATIONS || whole.calls.size() >= 40 * 2);
+
+        // Chunk sizes that are not multiples of the section length move the
+        // edge through every part of it
+        for (size_t chunkSize : {256, 512, 700, 1021, 4096, 65536}) {
+            ParseResult streamed = parser.parseStream(file.string(), "generated.cpp", depth, chunkSize);
+            checkSame(streamed, whole);
+        }
+    }
+    std::cout << "✓ Streamed parses match whole-file parses at every chunk edge" << std::endl;
+
+    testEmptyFile(parser, work);
+    fs::remove_all(work);
+    return 0;
+}
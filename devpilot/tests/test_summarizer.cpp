@@ -0,0 +1,80 @@
+#include "check.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+// Summarizes a small indexed corpus twice through the stub backend: the
+// first run dedupes identical bodies and batches the rest, the second is
+// answered from the summary cache without starting a batch.
+
+namespace fs = std::filesystem;
+
+static std::string run(const std::string& command) {
+    std::string output;
+    FILE* pipe = popen(command.c_str(), "r");
+    CHECK(pipe);
+    char buffer[4096];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, bytes);
+    }
+    int status = pclose(pipe);
+    std::cout << output << std::flush;
+    CHECK(status == 0);
+    return output;
+}
+
+static std::string readFile(const fs::path& path) {
+    std::ifstream file(path);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: test_summarizer <devpilot executable> <stub backend>" << std::endl;
+        return 1;
+    }
+
+    fs::path work = fs::temp_directory_path() / ("devpilot_summarizer_" + std::to_string(getpid()));
+    fs::path corpus = work / "corpus";
+    fs::create_directories(corpus);
+    // helper has the same body in both files
+    const char* helper = "int helper(int value) {\n    return value * 2;\n}\n";
+    std::ofstream(corpus / "one.cpp") << helper
+        << "int alpha(int value) {\n    return helper(value) + 1;\n}\n"
+        << "int beta(int value) {\n    int doubled = helper(value);\n    return doubled - 1;\n}\n";
+    std::ofstream(corpus / "two.cpp") << helper
+        << "int gamma(int value) {\n    return value;\n}\n";
+
+    std::string executable = fs::absolute(argv[1]).string();
+    fs::path log = work / "batches.log";
+    std::string prefix = "cd '" + work.string() + "' && '" + executable + "' ";
+    std::string summarize = prefix + "summarize helper alpha beta gamma --backend \"'" +
+                            fs::absolute(argv[2]).string() + "' '" + log.string() + "'\" --batch 2 2>&1";
+    run(prefix + "index '" + corpus.string() + "' 2>&1");
+
+    // Five definitions, four distinct bodies, two per batch
+    std::string first = run(summarize);
+    CHECK(first.find("helper: 3 lines") != std::string::npos);
+    CHECK(first.find("beta: 4 lines") != std::string::npos);
+    CHECK(first.find("5 requested, 0 cache hits (0%), 1 deduplicated, 4 summarized in 2 batches, 0 failed")
+           != std::string::npos);
+    CHECK(readFile(log) == "batch 2\nbatch 2\n");
+
+    std::string second = run(summarize);
+    CHECK(second.find("gamma: 3 lines") != std::string::npos);
+    CHECK(second.find("5 requested, 5 cache hits (100%), 0 deduplicated, 0 summarized in 0 batches")
+           != std::string::npos);
+    CHECK(readFile(log) == "batch 2\nbatch 2\n");
+
+    fs::remove_all(work);
+    std::cout << "✓ Summarized 5 definitions in 2 batches, then from the cache" << std::endl;
+    return 0;
+}
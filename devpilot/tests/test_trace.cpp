@@ -0,0 +1,132 @@
+#include "check.hpp"
+#include "trace.hpp"
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Nested scopes are recorded as spans that nest in time on their own thread,
+// summarized per name in order of first appearance, and written as one
+// Chrome trace event per line: a thread_name record per thread, a complete
+// ("X") event per span and one counter ("C") sample per counter.
+
+using namespace devpilot;
+namespace fs = std::filesystem;
+
+static void work(int rounds) {
+    trace::Scope outer("outer");
+    for (int i = 0; i < rounds; i++) {
+        trace::Scope inner("inner");
+        trace::count(trace::Counter::FILES_PARSED);
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+struct Span {
+    std::string name;
+    int tid = 0;
+    double start = 0;
+    double end = 0;
+};
+
+int main() {
+    // Nothing is recorded before enable()
+    work(1);
+    CHECK(trace::summarize().spans.empty());
+
+    trace::enable();
+    trace::setThreadName("main \"0\"");
+    work(3);
+    std::thread worker([]() {
+        trace::setThreadName("worker");
+        work(2);
+    });
+    worker.join();
+
+    trace::Summary summary = trace::summarize();
+    CHECK(summary.spans.size() == 2);
+    CHECK(summary.spans[0].name == "outer" && summary.spans[0].count == 2);
+    CHECK(summary.spans[1].name == "inner" && summary.spans[1].count == 5);
+    CHECK(summary.spans[1].total <= summary.spans[0].total);
+    CHECK(summary.spans[1].max <= summary.spans[0].max);
+    CHECK(summary.counters[static_cast<size_t>(trace::Counter::FILES_PARSED)] == 5);
+    CHECK(summary.counters[static_cast<size_t>(trace::Counter::ROWS_WRITTEN)] == 0);
+    std::cout << "✓ Spans summarized per name, in order of first appearance" << std::endl;
+
+    fs::path path = fs::temp_directory_path() / ("devpilot_trace_" + std::to_string(getpid()) + ".json");
+    CHECK(trace::writeChromeTrace(path.string()));
+    std::ifstream in(path);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);) {
+        lines.push_back(line);
+    }
+    fs::remove(path);
+
+    CHECK(lines.size() >= 2);
+    CHECK(lines.front() == "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    CHECK(lines.back() == "]}");
+
+    const std::regex threadName(
+        R"re(\{"name":"thread_name","ph":"M","pid":1,"tid":(\d+),"args":\{"name":"((?:[^"\\]|\\.)*)"\}\},?)re");
+    const std::regex complete(
+        R"re(\{"name":"(\w+)","cat":"devpilot","ph":"X","pid":1,"tid":(\d+),"ts":(\d+\.\d{3}),"dur":(\d+\.\d{3})\},?)re");
+    const std::regex counter(R"re(\{"name":"(\w+)","ph":"C","pid":1,"ts":\d+\.\d{3},"args":\{"value":(\d+)\}\},?)re");
+    std::map<int, std::string> threads;
+    std::vector<Span> spans;
+    std::map<std::string, std::string> counters;
+    for (size_t i = 1; i + 1 < lines.size(); i++) {
+        // Every event but the last is followed by a comma
+        CHECK((lines[i].back() == ',') == (i + 2 < lines.size()));
+        std::smatch match;
+        if (std::regex_match(lines[i], match, threadName)) {
+            threads[std::stoi(match[1])] = match[2];
+        } else if (std::regex_match(lines[i], match, complete)) {
+            Span span;
+            span.name = match[1];
+            span.tid = std::stoi(match[2]);
+            span.start = std::stod(match[3]);
+            span.end = span.start + std::stod(match[4]);
+            spans.push_back(span);
+        } else if (std::regex_match(lines[i], match, counter)) {
+            counters[match[1]] = match[2];
+        } else {
+            CHECK(!"unexpected trace line");
+        }
+    }
+
+    CHECK(threads.size() == 2);
+    bool namedMain = false;
+    bool namedWorker = false;
+    for (const auto& thread : threads) {
+        namedMain = namedMain || thread.second == "main \\\"0\\\"";
+        namedWorker = namedWorker || thread.second == "worker";
+    }
+    CHECK(namedMain && namedWorker);
+    CHECK(spans.size() == 7);
+    CHECK(counters.size() == trace::kCounterCount);
+    CHECK(counters["files_parsed"] == "5" && counters["rows_written"] == "0");
+
+    // Each inner span lies within the outer span of its own thread, give or
+    // take the rounding to whole nanoseconds
+    const double slack = 0.002;
+    for (const Span& inner : spans) {
+        CHECK(threads.count(inner.tid) == 1);
+        if (inner.name != "inner") {
+            continue;
+        }
+        int enclosing = 0;
+        for (const Span& outer : spans) {
+            if (outer.name == "outer" && outer.tid == inner.tid &&
+                outer.start <= inner.start + slack && inner.end <= outer.end + slack) {
+                enclosing++;
+            }
+        }
+        CHECK(enclosing == 1);
+    }
+    std::cout << "✓ Chrome trace has one event per line, spans nested per thread" << std::endl;
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include "check.hpp"
+#include "embedder.hpp"
+#include "vector_index.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Checks the int8 kernel against plain arithmetic, the inverted lists
+// against the exact scan, and semantic search end to end through the
+// devpilot executable with the hashing embedder.
+
+using namespace devpilot;
+namespace fs = std::filesystem;
+
+static std::string run(const std::string& command, int& status) {
+    std::string output;
+    FILE* pipe = popen(command.c_str(), "r");
+    CHECK(pipe);
+    char buffer[4096];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, bytes);
+    }
+    status = pclose(pipe);
+    std::cout << output << std::flush;
+    return output;
+}
+
+static void testKernel(std::mt19937& random) {
+    std::uniform_int_distribution<int> value(-127, 127);
+    for (size_t size = 0; size <= 100; size++) {
+        std::vector<int8_t> a(size), b(size);
+        int32_t expected = 0;
+        for (size_t i = 0; i < size; i++) {
+            a[i] = static_cast<int8_t>(value(random));
+            b[i] = static_cast<int8_t>(value(random));
+            expected += a[i] * b[i];
+        }
+        CHECK(dotProductInt8(a.data(), b.data(), size) == expected);
+    }
+    std::cout << "✓ " << dotProductKernel() << " dot product matches scalar arithmetic" << std::endl;
+}
+
+static void testEmbedder() {
+    HashingEmbedder embedder(64);
+    std::vector<float> a(64), b(64), c(64);
+    embedder.embed("int retryHttpRequest(const std::string& url)", a.data());
+    embedder.embed("the function that retries HTTP requests", b.data());
+    embedder.embed("double computeChecksum(const char* data)", c.data());
+    double norm = 0, related = 0, unrelated = 0;
+    for (size_t i = 0; i < 64; i++) {
+        norm += a[i] * a[i];
+        related += a[i] * b[i];
+        unrelated += a[i] * c[i];
+    }
+    CHECK(std::fabs(norm - 1) < 1e-5);
+    CHECK(related > 0.5 && related > unrelated);
+
+    std::vector<float> again(64);
+    embedder.embed("int retryHttpRequest(const std::string& url)", again.data());
+    CHECK(again == a);
+    std::cout << "✓ Hashing embedder is deterministic and matches words across forms" << std::endl;
+}
+
+static void testInvertedLists(std::mt19937& random, const fs::path& work) {
+    const size_t dimensions = 64, count = 5000, k = 10;
+    std::normal_distribution<float> normal;
+    std::vector<float> centers(40 * dimensions), vectors(count * dimensions);
+    for (float& value : centers) {
+        value = normal(random);
+    }
+    VectorIndexBuilder builder(dimensions);
+    for (size_t i = 0; i < count; i++) {
+        float* vector = &vectors[i * dimensions];
+        double norm = 0;
+        for (size_t d = 0; d < dimensions; d++) {
+            vector[d] = centers[(i % 40) * dimensions + d] + 0.3f * normal(random);
+            norm += vector[d] * vector[d];
+        }
+        for (size_t d = 0; d < dimensions; d++) {
+            vector[d] = static_cast<float>(vector[d] / std::sqrt(norm));
+        }
+        builder.add(static_cast<int64_t>(i) * 3, vector);
+    }
+    fs::path file = work / "test.vectors";
+    VectorBuildOptions options;
+    options.lists = 50;
+    size_t lists = 0;
+    bool written = builder.write(file.string(), "test", 7, options, lists);
+    CHECK(written && lists == 50);
+
+    VectorIndex index;
+    bool opened = index.open(file.string());
+    CHECK(opened);
+    CHECK(index.size() == count && index.dimensions() == dimensions && index.lists() == 50);
+    CHECK(index.embedderId() == "test" && index.indexStamp() == 7);
+
+    size_t found = 0, wanted = 0;
+    for (size_t i = 0; i < count; i += 50) {
+        const float* query = &vectors[i * dimensions];
+        auto exact = index.searchExact(query, k);
+        CHECK(exact.size() == k && exact[0].id == static_cast<int64_t>(i) * 3);
+        CHECK(std::fabs(exact[0].score - 1) < 0.05);
+        for (size_t j = 1; j < exact.size(); j++) {
+            CHECK(exact[j - 1].score >= exact[j].score);
+        }
+
+        // Probing every list is the exact scan
+        auto all = index.search(query, k, index.lists());
+        for (size_t j = 0; j < k; j++) {
+            CHECK(all[j].id == exact[j].id && all[j].score == exact[j].score);
+        }
+
+        auto probed = index.search(query, k, 8);
+        for (const auto& expected : exact) {
+            for (const auto& match : probed) {
+                found += match.id == expected.id;
+            }
+            wanted++;
+        }
+    }
+    double recall = static_cast<double>(found) / wanted;
+    CHECK(recall >= 0.9);
+    std::cout << "✓ Inverted lists: recall@10 " << recall << " probing 8 of 50 lists" << std::endl;
+}
+
+static void testAsk(const std::string& executable, const fs::path& work) {
+    fs::path corpus = work / "corpus";
+    fs::create_directories(corpus);
+    std::ofstream(corpus / "net.cpp")
+        << "int sendRequest(const char* url) {\n    return url ? 200 : 500;\n}\n"
+        << "int retryHttpRequest(const char* url, int attempts) {\n"
+        << "    for (int i = 0; i < attempts; i++) {\n"
+        << "        if (sendRequest(url) == 200) {\n            return 200;\n        }\n    }\n"
+        << "    return 500;\n}\n";
+    std::ofstream(corpus / "config.cpp")
+        << "bool parseConfigFile(const char* path) {\n    return path != nullptr;\n}\n"
+        << "unsigned computeChecksum(const char* data, unsigned size) {\n"
+        << "    unsigned sum = 0;\n    for (unsigned i = 0; i < size; i++) {\n"
+        << "        sum = sum * 31 + data[i];\n    }\n    return sum;\n}\n";
+
+    std::string prefix = "cd '" + work.string() + "' && '" + executable + "' ";
+    int status;
+    run(prefix + "index '" + corpus.string() + "' 2>&1", status);
+    CHECK(status == 0);
+    std::string output = run(prefix + "embed 2>&1", status);
+    CHECK(status == 0 && output.find("Embedded 4 symbols") != std::string::npos);
+
+    output = run(prefix + "ask which function retries http requests --top 2 2>&1", status);
+    CHECK(status == 0);
+    CHECK(output.find("retryHttpRequest") < output.find('\n'));
+    output = run(prefix + "ask parsing config files --exact 2>&1", status);
+    CHECK(status == 0);
+    CHECK(output.find("parseConfigFile") < output.find('\n'));
+
+    // Indexing again leaves the vectors behind
+    run(prefix + "index '" + corpus.string() + "' --force 2>&1", status);
+    output = run(prefix + "ask retries 2>&1", status);
+    CHECK(status != 0 && output.find("run 'devpilot embed' again") != std::string::npos);
+    std::cout << "✓ ask finds functions by what they do" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: test_vector_index <devpilot executable>" << std::endl;
+        return 1;
+    }
+    fs::path work = fs::temp_directory_path() / ("devpilot_vectors_" + std::to_string(getpid()));
+    fs::create_directories(work);
+    std::mt19937 random(42);
+
+    testKernel(random);
+    testEmbedder();
+    testInvertedLists(random, work);
+    testAsk(fs::absolute(argv[1]).string(), work);
+
+    fs::remove_all(work);
+    return 0;
+}